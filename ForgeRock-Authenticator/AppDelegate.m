@@ -27,8 +27,10 @@
 #import "FRAIdentityModel.h"
 #import "FRAMechanismReaderAction.h"
 #import "FRANotification.h"
+#import "FRANotificationCompactor.h"
 #import "FRANotificationGateway.h"
 #import "FRAPushMechanism.h"
+#import "FRAResponseOutbox.h"
 #import "FRASplashEvents.h"
 #import "FRAUriMechanismReader.h"
 
@@ -46,12 +48,23 @@
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     [self checkDependenciesAreInitialized];
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleSplashScreenDidFinish:) name:FRASplashScreenDidFinish object:nil];
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangedNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangesCoalescedNotification object:nil];
     [self updateNotificationsCount];
+    [[[self assembly] notificationGateway] resumeDeferredWorkWithApplication:application];
+    [[[self assembly] responseOutbox] flushWithCompletion:nil];
+    [self enableIncrementalVacuum];
     NSLog(@"application:didFinishLaunchingWithOptions\n%@", launchOptions);
     return YES;
 }
 
+- (void)applicationDidEnterBackground:(UIApplication *)application {
+    [self compactNotificationsInBackground:application];
+}
+
+- (void)applicationWillEnterForeground:(UIApplication *)application {
+    [[[self assembly] responseOutbox] flushWithCompletion:nil];
+}
+
 - (void)applicationWillTerminate:(UIApplication *)application {
     NSLog(@"applicationWillTerminate:");
     [[NSNotificationCenter defaultCenter] removeObserver:self];
@@ -121,6 +134,37 @@
     }
 }
 
+/*!
+ * Converts the database for incremental vacuuming while the App is in the foreground, so that compaction in the
+ * background never has to rewrite the whole database.
+ */
+- (void)enableIncrementalVacuum {
+    [[[self assembly] notificationCompactor] enableIncrementalVacuumWithCompletion:^(NSError *error) {
+        if (error) {
+            NSLog(@"Could not enable incremental vacuum: %@", error);
+        }
+    }];
+}
+
+/*!
+ * Enforces the notification retention policy while the App is in the background, asking for time to finish.
+ */
+- (void)compactNotificationsInBackground:(UIApplication *)application {
+    __block UIBackgroundTaskIdentifier task = [application beginBackgroundTaskWithName:@"compactNotifications" expirationHandler:^{
+        [application endBackgroundTask:task];
+        task = UIBackgroundTaskInvalid;
+    }];
+    [[[self assembly] notificationCompactor] compactWithCompletion:^(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error) {
+        if (error) {
+            NSLog(@"Notification compaction failed: %@", error);
+        }
+        if (task != UIBackgroundTaskInvalid) {
+            [application endBackgroundTask:task];
+            task = UIBackgroundTaskInvalid;
+        }
+    }];
+}
+
 - (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
     NSLog(@"database changed: %@", notification.userInfo);
     [self updateNotificationsCount];
@@ -70,7 +70,7 @@ static const NSInteger PUSH_MECHANISM_ROW_INDEX = 2;
     [self reloadData];
     [self.oathTableViewCell.delegate viewWillAppear:animated];
     [self.pushTableViewCell.delegate viewWillAppear:animated];
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangedNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangesCoalescedNotification object:nil];
     if (!self.timer) {
         self.timer = [NSTimer scheduledTimerWithTimeInterval:1.0 target:self selector:@selector(timerCallback:) userInfo:nil repeats:YES];
     }
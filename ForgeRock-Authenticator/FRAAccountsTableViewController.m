@@ -24,7 +24,11 @@
 #import "FRAIdentity.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAIdentityModel.h"
+#import "FRAIdentitySearchIndex.h"
+#import "FRANotification.h"
 #import "FRAPushMechanism.h"
+#import "FRASnapshotDiff.h"
+#import "FRASortedView.h"
 #import "FRATotpOathMechanism.h"
 #import "FRAUIUtils.h"
 
@@ -32,6 +36,45 @@ NSString * const FRAAccountsTableViewControllerStoryboardIdentifer = @"AccountsT
 NSString * const FRAAccountsTableViewControllerShowAccountSegue = @"showAccountSegue";
 NSString * const FRAAccountsTableViewControllerScanQrCodeSegue = @"scanQrCodeSegue";
 
+/*!
+ * Private interface.
+ */
+@interface FRAAccountsTableViewController () <UISearchResultsUpdating>
+
+/*!
+ * The sorted identities as last presented to the table view, against which changes are diffed.
+ */
+@property (copy, nonatomic) NSArray<FRAIdentity *> *displayedIdentities;
+
+/*!
+ * Controller for the search bar used to filter the accounts.
+ */
+@property (strong, nonatomic) UISearchController *searchController;
+
+/*!
+ * Index of the identities used to answer searches. Created when the user first searches.
+ */
+@property (strong, nonatomic) FRAIdentitySearchIndex *searchIndex;
+
+/*!
+ * The identities matching the search query in display order, or nil if they must be found again because the
+ * query or the identities have changed.
+ */
+@property (copy, nonatomic) NSArray<FRAIdentity *> *filteredIdentities;
+
+/*!
+ * The identities ordered by issuer then account name, maintained as identities are added and removed.
+ */
+@property (strong, nonatomic) FRASortedView<FRAIdentity *> *sortedAccounts;
+
+/*!
+ * The identities snapshot which sortedAccounts reflects. A different snapshot from the model means there are
+ * changes which have not yet been reported, so the view is rebuilt.
+ */
+@property (strong, nonatomic) NSArray<FRAIdentity *> *syncedIdentities;
+
+@end
+
 @implementation FRAAccountsTableViewController;
 
 #pragma mark -
@@ -39,13 +82,19 @@ NSString * const FRAAccountsTableViewControllerScanQrCodeSegue = @"scanQrCodeSeg
 
 - (void)viewDidLoad {
     [super viewDidLoad];
+    self.searchController = [[UISearchController alloc] initWithSearchResultsController:nil];
+    self.searchController.searchResultsUpdater = self;
+    self.searchController.dimsBackgroundDuringPresentation = NO;
+    [self.searchController.searchBar sizeToFit];
+    self.tableView.tableHeaderView = self.searchController.searchBar;
+    self.definesPresentationContext = YES;
     [self layoutUI];
 }
 
 - (void)viewWillAppear:(BOOL)animated {
     [super viewWillAppear:animated];
-    [self.tableView reloadData];
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangedNotification object:nil];
+    [self reloadAllRows];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangesCoalescedNotification object:nil];
     if (!self.timer) {
         self.timer = [NSTimer scheduledTimerWithTimeInterval:1.0 target:self selector:@selector(timerCallback:) userInfo:nil repeats:YES];
     }
@@ -82,6 +131,17 @@ NSString * const FRAAccountsTableViewControllerScanQrCodeSegue = @"scanQrCodeSeg
     }
 }
 
+#pragma mark -
+#pragma mark UISearchResultsUpdating
+
+- (void)updateSearchResultsForSearchController:(UISearchController *)searchController {
+    if (!self.searchIndex) {
+        self.searchIndex = [[FRAIdentitySearchIndex alloc] initWithIdentityModel:self.identityModel];
+    }
+    self.filteredIdentities = nil;
+    [self reloadAllRows];
+}
+
 #pragma mark -
 #pragma mark UITableViewDataSource
 
@@ -92,7 +152,10 @@ NSString * const FRAAccountsTableViewControllerScanQrCodeSegue = @"scanQrCodeSeg
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
     [self layoutUI];
-    return [self.identityModel identities].count;
+    if ([self isFiltering]) {
+        return [self sortedIdentities].count;
+    }
+    return [self accountsView].count;
 }
 
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath {
@@ -187,23 +250,132 @@ NSString * const FRAAccountsTableViewControllerScanQrCodeSegue = @"scanQrCodeSeg
 #pragma mark FRAAccountsTableViewController (private)
 
 - (FRAIdentity *)identityAtIndexPath:(NSIndexPath *)indexPath {
-    NSArray *sortedIdentities = [[self.identityModel identities] sortedArrayUsingComparator:^NSComparisonResult(FRAIdentity* first, FRAIdentity* second) {
-        NSComparisonResult comparisonResult = [first.issuer caseInsensitiveCompare:second.issuer];
-        if (comparisonResult == NSOrderedSame) {
-            comparisonResult = [first.accountName caseInsensitiveCompare:second.accountName];
+    if ([self isFiltering]) {
+        return [[self sortedIdentities] objectAtIndex:indexPath.row];
+    }
+    return [[self accountsView] objectAtIndex:indexPath.row];
+}
+
+- (BOOL)isFiltering {
+    return self.searchController.active && self.searchIndex && self.searchController.searchBar.text.length > 0;
+}
+
+- (NSArray<FRAIdentity *> *)sortedIdentities {
+    FRASortedView<FRAIdentity *> *accountsView = [self accountsView];
+    if (![self isFiltering]) {
+        return [accountsView allObjects];
+    }
+    if (!self.filteredIdentities) {
+        NSArray<FRAIdentity *> *identities = [accountsView allObjects];
+        NSSet<FRAIdentity *> *matches = [self.searchIndex identitiesMatchingQuery:self.searchController.searchBar.text];
+        self.filteredIdentities = [identities objectsAtIndexes:[identities indexesOfObjectsPassingTest:^BOOL(FRAIdentity *identity, NSUInteger index, BOOL *stop) {
+            return [matches containsObject:identity];
+        }]];
+    }
+    return self.filteredIdentities;
+}
+
+/*!
+ * The sorted view of all identities, rebuilt only if the model has changed without the change being reported.
+ */
+- (FRASortedView<FRAIdentity *> *)accountsView {
+    if (!self.sortedAccounts) {
+        self.sortedAccounts = [[FRASortedView alloc] initWithComparator:^NSComparisonResult(FRAIdentity* first, FRAIdentity* second) {
+            NSComparisonResult comparisonResult = [first.issuer caseInsensitiveCompare:second.issuer];
+            if (comparisonResult == NSOrderedSame) {
+                comparisonResult = [first.accountName caseInsensitiveCompare:second.accountName];
+            }
+            return comparisonResult;
+        }];
+    }
+    NSArray<FRAIdentity *> *identities = [self.identityModel identities];
+    if (identities != self.syncedIdentities) {
+        [self.sortedAccounts setObjects:identities];
+        self.syncedIdentities = identities;
+        self.filteredIdentities = nil;
+    }
+    return self.sortedAccounts;
+}
+
+/*!
+ * Applies reported additions and removals of identities to the sorted view.
+ */
+- (void)updateAccountsViewWithStateChanges:(NSDictionary *)stateChanges {
+    if (!self.syncedIdentities) {
+        return;
+    }
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationRemovedItems]) {
+        if ([item isKindOfClass:[FRAIdentity class]]) {
+            [self.sortedAccounts removeObject:item];
         }
-        return comparisonResult;
-    }];
-    return [sortedIdentities objectAtIndex:indexPath.row];
+    }
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationAddedItems]) {
+        if ([item isKindOfClass:[FRAIdentity class]] && [self.sortedAccounts indexOfObject:item] == NSNotFound) {
+            [self.sortedAccounts addObject:item];
+        }
+    }
+    self.syncedIdentities = [self.identityModel identities];
 }
 
-- (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
+- (void)reloadAllRows {
+    self.displayedIdentities = [self sortedIdentities];
     [self.tableView reloadData];
 }
 
+- (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
+    [self.searchIndex applyStateChanges:notification.userInfo];
+    [self updateAccountsViewWithStateChanges:notification.userInfo];
+    self.filteredIdentities = nil;
+    NSArray<FRAIdentity *> *identities = [self sortedIdentities];
+    if ([self.tableView numberOfRowsInSection:0] != (NSInteger)self.displayedIdentities.count) {
+        // The table has already picked up some of the changes, so can't be updated incrementally
+        [self reloadAllRows];
+        return;
+    }
+    FRASnapshotDiff *diff = [FRASnapshotDiff diffFromSnapshot:self.displayedIdentities
+                                                   toSnapshot:identities
+                                               updatedObjects:[self identitiesAffectedByStateChanges:notification.userInfo]];
+    self.displayedIdentities = identities;
+    if ([diff isEmpty]) {
+        return;
+    }
+    [self.tableView beginUpdates];
+    [FRAUIUtils tableView:self.tableView applySnapshotDiff:diff toSection:0];
+    [self.tableView endUpdates];
+}
+
+/*!
+ * Finds the identities whose cells show state affected by the changed identities, mechanisms or notifications.
+ */
+- (NSSet<FRAIdentity *> *)identitiesAffectedByStateChanges:(NSDictionary *)stateChanges {
+    NSMutableSet<FRAIdentity *> *identities = [[NSMutableSet alloc] init];
+    for (NSSet *items in [stateChanges allValues]) {
+        for (id item in items) {
+            FRAIdentity *identity = nil;
+            if ([item isKindOfClass:[FRAIdentity class]]) {
+                identity = item;
+            } else if ([item isKindOfClass:[FRAMechanism class]]) {
+                identity = ((FRAMechanism *)item).parent;
+            } else if ([item isKindOfClass:[FRANotification class]]) {
+                identity = ((FRANotification *)item).parent.parent;
+            }
+            if (identity) {
+                [identities addObject:identity];
+            }
+        }
+    }
+    return identities;
+}
+
 - (void)timerCallback:(NSTimer*)timer {
-    if (!self.tableView.editing) {
-        [self.tableView reloadData];
+    // Changes to the accounts, including expired notifications, arrive as database changes, so only the visible
+    // cells need refreshing here
+    if (self.tableView.editing) {
+        return;
+    }
+    NSArray<NSIndexPath *> *visibleRows = [self.tableView indexPathsForVisibleRows];
+    if (visibleRows.count > 0) {
+        [self.tableView reloadRowsAtIndexPaths:visibleRows withRowAnimation:UITableViewRowAnimationNone];
     }
 }
 
@@ -17,18 +17,25 @@
 #import <Typhoon/Typhoon.h>
 
 @class FRAAccountsTableViewController;
+@class FRABackgroundPushScheduler;
 @class FRAFMDatabaseConnectionHelper;
 @class FRAIdentityDatabase;
 @class FRAIdentityDatabaseSQLiteOperations;
 @class FRAIdentityModel;
+@class FRAIdentitySnapshotFile;
 @class FRALAContextFactory;
 @class FRAMechanismReaderAction;
+@class FRANotificationArchive;
+@class FRANotificationCompactor;
 @class FRANotificationGateway;
 @class FRANotificationHandler;
 @class FRANotificationViewController;
+@class FRANotificationsTableViewController;
 @class FRAOathMechanismFactory;
 @class FRAPushMechanismFactory;
 @class FRAQRScanViewController;
+@class FRAResponseOutbox;
+@class FRASeenMessageFilter;
 @class FRAUriMechanismReader;
 @class FRASplashViewController;
 
@@ -39,17 +46,24 @@
 
 - (FRAAccountsTableViewController *)accountsTableViewController;
 - (FRALAContextFactory *)authContextFactory;
+- (FRABackgroundPushScheduler *)backgroundPushScheduler;
 - (FRAFMDatabaseConnectionHelper *)databaseConnectionHelper;
 - (FRAIdentityDatabase *)identityDatabase;
 - (FRAIdentityDatabaseSQLiteOperations *)identityDatabaseSQLiteOperations;
 - (FRAIdentityModel *)identityModel;
+- (FRAIdentitySnapshotFile *)identitySnapshotFile;
 - (FRAMechanismReaderAction *)mechanismReaderAction;
+- (FRANotificationArchive *)notificationArchive;
+- (FRANotificationCompactor *)notificationCompactor;
 - (FRANotificationHandler *)notificationHandler;
 - (FRANotificationGateway *)notificationGateway;
 - (FRANotificationViewController *)notificationViewController;
+- (FRANotificationsTableViewController *)notificationsTableViewController;
 - (FRAOathMechanismFactory *)oathMechanismFactory;
 - (FRAPushMechanismFactory *)pushMechanismFactory;
 - (FRAQRScanViewController *)qrScanViewController;
+- (FRAResponseOutbox *)responseOutbox;
+- (FRASeenMessageFilter *)seenMessageFilter;
 - (FRAUriMechanismReader *)uriMechanismReader;
 - (FRASplashViewController *)splashViewController;
 
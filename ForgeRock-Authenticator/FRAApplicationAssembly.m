@@ -17,20 +17,28 @@
 #import "FRAAccountsTableViewController.h"
 #import "FRAAccountTableViewController.h"
 #import "FRAApplicationAssembly.h"
+#import "FRABackgroundPushScheduler.h"
 #import "FRADatabaseConfiguration.h"
 #import "FRAFMDatabaseFactory.h"
 #import "FRALAContextFactory.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAIdentityDatabaseSQLiteOperations.h"
 #import "FRAIdentityModel.h"
+#import "FRAIdentitySnapshotFile.h"
 #import "FRAMechanismReaderAction.h"
 #import "FRAMessageUtils.h"
+#import "FRANotificationArchive.h"
+#import "FRANotificationCompactor.h"
 #import "FRANotificationGateway.h"
 #import "FRANotificationHandler.h"
+#import "FRANotificationRetentionPolicy.h"
 #import "FRANotificationViewController.h"
+#import "FRANotificationsTableViewController.h"
 #import "FRAOathMechanismFactory.h"
 #import "FRAPushMechanismFactory.h"
 #import "FRAQRScanViewController.h"
+#import "FRAResponseOutbox.h"
+#import "FRASeenMessageFilter.h"
 #import "FRAFMDatabaseConnectionHelper.h"
 #import "FRAUriMechanismReader.h"
 #import "FRASplashViewController.h"
@@ -49,6 +57,16 @@
     }];
 }
 
+- (FRABackgroundPushScheduler *)backgroundPushScheduler {
+    return [TyphoonDefinition withClass:[FRABackgroundPushScheduler class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithHandler:configuration:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[self notificationHandler]];
+            [initializer injectParameterWith:[[FRADatabaseConfiguration alloc] init]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
 - (FRAFMDatabaseConnectionHelper *)databaseConnectionHelper {
     return [TyphoonDefinition withClass:[FRAFMDatabaseConnectionHelper class] configuration:^(TyphoonDefinition *definition) {
         [definition useInitializer:@selector(initWithConfiguration:databaseFactory:) parameters:^(TyphoonMethod *initializer) {
@@ -64,6 +82,8 @@
         [definition useInitializer:@selector(initWithSqlOperations:) parameters:^(TyphoonMethod *initializer) {
             [initializer injectParameterWith:[self identityDatabaseSQLiteOperations]];
         }];
+        [definition injectProperty:@selector(snapshotFile) with:[self identitySnapshotFile]];
+        [definition injectProperty:@selector(responseOutbox) with:[self responseOutbox]];
         definition.scope = TyphoonScopeSingleton;
     }];
 }
@@ -87,6 +107,15 @@
     }];
 }
 
+- (FRAIdentitySnapshotFile *)identitySnapshotFile {
+    return [TyphoonDefinition withClass:[FRAIdentitySnapshotFile class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithConfiguration:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[[FRADatabaseConfiguration alloc] init]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
 - (FRAMechanismReaderAction *)mechanismReaderAction {
     return [TyphoonDefinition withClass:[FRAMechanismReaderAction class] configuration:^(TyphoonDefinition *definition) {
         [definition useInitializer:@selector(initWithMechanismReader:) parameters:^(TyphoonMethod *initializer) {
@@ -96,10 +125,32 @@
     }];
 }
 
+- (FRANotificationArchive *)notificationArchive {
+    return [TyphoonDefinition withClass:[FRANotificationArchive class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithConfiguration:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[[FRADatabaseConfiguration alloc] init]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
+- (FRANotificationCompactor *)notificationCompactor {
+    return [TyphoonDefinition withClass:[FRANotificationCompactor class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithIdentityModel:database:archive:policy:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[self identityModel]];
+            [initializer injectParameterWith:[self identityDatabase]];
+            [initializer injectParameterWith:[self notificationArchive]];
+            [initializer injectParameterWith:[FRANotificationRetentionPolicy defaultPolicy]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
 - (FRANotificationGateway *)notificationGateway {
     return [TyphoonDefinition withClass:[FRANotificationGateway class] configuration:^(TyphoonDefinition *definition) {
-        [definition useInitializer:@selector(initWithHandler:) parameters:^(TyphoonMethod *initializer) {
+        [definition useInitializer:@selector(initWithHandler:scheduler:) parameters:^(TyphoonMethod *initializer) {
             [initializer injectParameterWith:[self notificationHandler]];
+            [initializer injectParameterWith:[self backgroundPushScheduler]];
         }];
         definition.scope = TyphoonScopeSingleton;
     }];
@@ -111,6 +162,7 @@
             [initializer injectParameterWith:[self identityDatabase]];
             [initializer injectParameterWith:[self identityModel]];
         }];
+        [definition injectProperty:@selector(seenMessageFilter) with:[self seenMessageFilter]];
         definition.scope = TyphoonScopeSingleton;
     }];
 }
@@ -121,6 +173,12 @@
     }];
 }
 
+- (FRANotificationsTableViewController *)notificationsTableViewController {
+    return [TyphoonDefinition withClass:[FRANotificationsTableViewController class] configuration:^(TyphoonDefinition *definition) {
+        [definition injectProperty:@selector(notificationArchive) with:[self notificationArchive]];
+    }];
+}
+
 - (FRAOathMechanismFactory *)oathMechanismFactory {
     return [TyphoonDefinition withClass:[FRAOathMechanismFactory class] configuration:^(TyphoonDefinition *definition) {
         [definition useInitializer:@selector(init)];
@@ -143,6 +201,15 @@
     }];
 }
 
+- (FRAResponseOutbox *)responseOutbox {
+    return [TyphoonDefinition withClass:[FRAResponseOutbox class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithDatabase:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[self databaseConnectionHelper]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
 - (FRAUriMechanismReader *)uriMechanismReader {
     return [TyphoonDefinition withClass:[FRAUriMechanismReader class] configuration:^(TyphoonDefinition *definition) {
         [definition useInitializer:@selector(initWithDatabase:identityModel:) parameters:^(TyphoonMethod *initializer) {
@@ -159,6 +226,15 @@
     }];
 }
 
+- (FRASeenMessageFilter *)seenMessageFilter {
+    return [TyphoonDefinition withClass:[FRASeenMessageFilter class] configuration:^(TyphoonDefinition *definition) {
+        [definition useInitializer:@selector(initWithConfiguration:) parameters:^(TyphoonMethod *initializer) {
+            [initializer injectParameterWith:[[FRADatabaseConfiguration alloc] init]];
+        }];
+        definition.scope = TyphoonScopeSingleton;
+    }];
+}
+
 - (FRASplashViewController *)splashViewController {
     return [TyphoonDefinition withClass:[FRASplashViewController class] configuration:^(TyphoonDefinition *definition) {
         [definition injectProperty:@selector(identityModel) with:[self identityModel]];
@@ -0,0 +1,100 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+@class FRADatabaseConfiguration;
+@class FRANotificationHandler;
+
+/*!
+ * Processes push notifications delivered in the background within the time iOS allows, and reports the real
+ * outcome to the fetch completion handler.
+ *
+ * Each message is written to a pending work file before it is handed to the FRANotificationHandler. Once the
+ * handler finishes, the message is removed and the completion handler is told whether a new notification was
+ * created. If the budget is nearly spent first, the completion handler is called with
+ * UIBackgroundFetchResultFailed and the message stays pending until resumeDeferredWorkWithApplication: runs on
+ * the next launch. Ingestion is idempotent, so a message which was in fact finished is not added twice.
+ */
+@interface FRABackgroundPushScheduler : NSObject
+
+/*!
+ * The time allowed to process a message, in seconds. iOS allows about 30. Defaults to 25.
+ */
+@property (nonatomic) NSTimeInterval budget;
+
+/*!
+ * How long before the end of the budget the completion handler is called if the work has not finished, in
+ * seconds. Defaults to 2.
+ */
+@property (nonatomic) NSTimeInterval safetyMargin;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param handler The handler which ingests messages.
+ * @param configuration The configuration which locates the pending work file.
+ * @return The initialized scheduler.
+ */
+- (instancetype)initWithHandler:(FRANotificationHandler *)handler configuration:(FRADatabaseConfiguration *)configuration;
+
+/*!
+ * Init method.
+ *
+ * @param handler The handler which ingests messages.
+ * @param path The path of the pending work file.
+ * @return The initialized scheduler.
+ */
+- (instancetype)initWithHandler:(FRANotificationHandler *)handler path:(NSString *)path;
+
+#pragma mark -
+#pragma mark Scheduling Functions
+
+/*!
+ * Processes a message delivered by application:didReceiveRemoteNotification:fetchCompletionHandler:. Must be
+ * called on the main queue.
+ *
+ * @param application The application object.
+ * @param userInfo The push notification message received.
+ * @param completionHandler Called on the main queue exactly once: with UIBackgroundFetchResultNewData if a
+ * notification was created, UIBackgroundFetchResultNoData if there was nothing new, or
+ * UIBackgroundFetchResultFailed if the budget ran out first.
+ */
+- (void)application:(UIApplication *)application processRemoteNotification:(NSDictionary *)userInfo completionHandler:(void (^)(UIBackgroundFetchResult result))completionHandler;
+
+/*!
+ * Processes the messages left pending by an earlier run. Must be called on the main queue.
+ *
+ * @param application The application object.
+ * @param completion Called on the main queue once every pending message has been processed, with their number.
+ * May be nil.
+ */
+- (void)resumeDeferredWorkWithApplication:(UIApplication *)application completion:(void (^)(NSUInteger resumed))completion;
+
+/*!
+ * The messages whose processing has not finished.
+ *
+ * @return The pending messages.
+ */
+- (NSArray<NSDictionary *> *)deferredWork;
+
+/*!
+ * Blocks until every change to the pending work has been written to disk.
+ */
+- (void)flush;
+
+@end
@@ -0,0 +1,193 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRABackgroundPushScheduler.h"
+#import "FRADatabaseConfiguration.h"
+#import "FRANotificationHandler.h"
+
+static NSString * const MESSAGE_ID_KEY_PATH = @"aps.messageId";
+static const NSTimeInterval FRADefaultBackgroundBudget = 25.0;
+static const NSTimeInterval FRADefaultBackgroundSafetyMargin = 2.0;
+
+@implementation FRABackgroundPushScheduler {
+    FRANotificationHandler *handler;
+    FRADatabaseConfiguration *configuration;
+    NSString *path;
+    /*! Pending messages keyed by message id. Guarded by self. */
+    NSMutableDictionary<NSString *, NSDictionary *> *pending;
+    dispatch_queue_t writeQueue;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithHandler:(FRANotificationHandler *)aHandler configuration:(FRADatabaseConfiguration *)aConfiguration {
+    self = [self initWithHandler:aHandler path:nil];
+    if (self) {
+        configuration = aConfiguration;
+    }
+    return self;
+}
+
+- (instancetype)initWithHandler:(FRANotificationHandler *)aHandler path:(NSString *)aPath {
+    self = [super init];
+    if (self) {
+        handler = aHandler;
+        path = aPath;
+        _budget = FRADefaultBackgroundBudget;
+        _safetyMargin = FRADefaultBackgroundSafetyMargin;
+        writeQueue = dispatch_queue_create("org.forgerock.authenticator.pending-push", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Scheduling Functions
+
+- (void)application:(UIApplication *)application processRemoteNotification:(NSDictionary *)userInfo completionHandler:(void (^)(UIBackgroundFetchResult))completionHandler {
+    NSString *messageId = [self messageIdOf:userInfo];
+    [self addPendingMessage:userInfo withId:messageId];
+    
+    // Both blocks run on the main queue, so whichever comes first reports the result
+    __block BOOL reported = NO;
+    NSTimeInterval deadline = MAX(self.budget - self.safetyMargin, 0);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(deadline * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (!reported) {
+            reported = YES;
+            completionHandler(UIBackgroundFetchResultFailed);
+        }
+    });
+    
+    [handler application:application didReceiveRemoteNotification:userInfo completion:^(FRANotification *notification, BOOL created) {
+        [self removePendingMessageWithId:messageId];
+        if (!reported) {
+            reported = YES;
+            completionHandler(created ? UIBackgroundFetchResultNewData : UIBackgroundFetchResultNoData);
+        }
+    }];
+}
+
+- (void)resumeDeferredWorkWithApplication:(UIApplication *)application completion:(void (^)(NSUInteger))completion {
+    NSArray<NSDictionary *> *work = [self deferredWork];
+    __block NSUInteger remaining = work.count;
+    if (remaining == 0) {
+        if (completion) {
+            completion(0);
+        }
+        return;
+    }
+    
+    for (NSDictionary *userInfo in work) {
+        NSString *messageId = [self messageIdOf:userInfo];
+        [handler application:application didReceiveRemoteNotification:userInfo completion:^(FRANotification *notification, BOOL created) {
+            [self removePendingMessageWithId:messageId];
+            if (--remaining == 0 && completion) {
+                completion(work.count);
+            }
+        }];
+    }
+}
+
+- (NSArray<NSDictionary *> *)deferredWork {
+    @synchronized (self) {
+        return [[self pendingMessages] allValues];
+    }
+}
+
+- (void)flush {
+    dispatch_sync(writeQueue, ^{});
+}
+
+#pragma mark -
+#pragma mark Pending Work (private)
+
+- (NSString *)messageIdOf:(NSDictionary *)userInfo {
+    id messageId = [userInfo valueForKeyPath:MESSAGE_ID_KEY_PATH];
+    // Messages without an id are still kept apart, but are not recognised when delivered again
+    return [messageId isKindOfClass:[NSString class]] ? messageId : [[NSUUID UUID] UUIDString];
+}
+
+- (void)addPendingMessage:(NSDictionary *)userInfo withId:(NSString *)messageId {
+    @synchronized (self) {
+        [self pendingMessages][messageId] = userInfo;
+        [self writePendingMessages];
+    }
+}
+
+- (void)removePendingMessageWithId:(NSString *)messageId {
+    @synchronized (self) {
+        if (![self pendingMessages][messageId]) {
+            return;
+        }
+        [[self pendingMessages] removeObjectForKey:messageId];
+        [self writePendingMessages];
+    }
+}
+
+/*!
+ * The pending messages, read from disk on first use. Must be called while synchronized on self.
+ */
+- (NSMutableDictionary<NSString *, NSDictionary *> *)pendingMessages {
+    if (!pending) {
+        pending = [[NSMutableDictionary alloc] init];
+        NSString *pendingPath = [self pathWithError:nil];
+        NSData *data = pendingPath ? [NSData dataWithContentsOfFile:pendingPath] : nil;
+        if (data) {
+            id stored = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:nil];
+            if ([stored isKindOfClass:[NSDictionary class]]) {
+                [pending addEntriesFromDictionary:stored];
+            }
+        }
+    }
+    return pending;
+}
+
+/*!
+ * Writes a copy of the pending messages on the write queue. Must be called while synchronized on self.
+ */
+- (void)writePendingMessages {
+    NSDictionary *messages = [pending copy];
+    dispatch_async(writeQueue, ^{
+        NSError *error;
+        NSString *pendingPath = [self pathWithError:&error];
+        if (!pendingPath) {
+            NSLog(@"Could not locate pending push work: %@", error);
+            return;
+        }
+        if (messages.count == 0) {
+            [[NSFileManager defaultManager] removeItemAtPath:pendingPath error:nil];
+            return;
+        }
+        NSData *data = [NSPropertyListSerialization dataWithPropertyList:messages format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+        if (!data || ![data writeToFile:pendingPath options:NSDataWritingAtomic | NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication error:&error]) {
+            NSLog(@"Could not write pending push work: %@", error);
+        }
+    });
+}
+
+/*!
+ * Resolves the location of the pending work file.
+ */
+- (NSString *)pathWithError:(NSError *__autoreleasing *)error {
+    @synchronized (self) {
+        if (!path) {
+            path = [configuration getPendingPushWorkPathWithError:error];
+        }
+        return path;
+    }
+}
+
+@end
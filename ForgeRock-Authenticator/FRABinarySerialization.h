@@ -0,0 +1,77 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * The layout of the fields in a binary encoded map. The schema is recorded in the encoding so
+ * that a row can be decoded without knowing which table or mechanism it came from.
+ */
+typedef NS_ENUM(uint8_t, FRABinarySchema) {
+    /*! Options of an HOTP mechanism. */
+    FRABinarySchemaHotpOptions = 1,
+    /*! Options of a TOTP mechanism. */
+    FRABinarySchemaTotpOptions = 2,
+    /*! Options of a Push mechanism. */
+    FRABinarySchemaPushOptions = 3,
+    /*! Data of a Push notification. */
+    FRABinarySchemaNotificationData = 4,
+};
+
+/*!
+ * A compact, versioned tag-length-value encoding for the maps which are persisted
+ * alongside mechanisms and notifications.
+ *
+ * Unlike JSON, keys are replaced by the small numeric tags of the schema, integers are
+ * written as varints, time intervals as raw doubles and secrets as raw bytes. The encoding
+ * starts with a byte that can never start UTF-8 text, so it can share a column with rows
+ * written as JSON by earlier versions of the app.
+ */
+@interface FRABinarySerialization : NSObject
+
+/*!
+ * Encodes a map using the given schema.
+ *
+ * Each value must match the type of its field in the schema: NSNumber for integers and
+ * time intervals, NSData for raw bytes and NSString for text. NSNull values are omitted.
+ *
+ * @param map The map to encode.
+ * @param schema The schema which assigns a tag and type to each key of the map.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The encoded map, or nil if a key is not part of the schema or a value has the wrong type.
+ */
++ (NSData *)encodeMap:(NSDictionary<NSString *, id> *)map schema:(FRABinarySchema)schema error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Decodes a map encoded by encodeMap:schema:error:.
+ *
+ * Fields with tags unknown to this version of the schema are skipped.
+ *
+ * @param data The encoded map.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The decoded map, or nil if the data is truncated or was written by a newer version of the format.
+ */
++ (NSDictionary<NSString *, id> *)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Determines whether the data is in the binary encoding rather than legacy JSON text.
+ *
+ * @param data The data to check, may be nil.
+ * @return YES if the data starts with the binary encoding's marker.
+ */
++ (BOOL)isBinaryEncoded:(NSData *)data;
+
+@end
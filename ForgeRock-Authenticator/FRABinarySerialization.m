@@ -0,0 +1,339 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRABinarySerialization.h"
+#import "FRAError.h"
+#import "FRASerialization.h"
+
+/*!
+ * An encoded map is laid out as:
+ *
+ *   marker | version | schema | field...
+ *
+ * Each field is a varint key of (tag << 3 | wire type) followed by its value: a varint,
+ * a little-endian IEEE 754 double, or a varint length followed by that many bytes.
+ */
+static const uint8_t FRABinaryMarker = 0xFB; // Never the first byte of UTF-8 text
+static const uint8_t FRABinaryVersion = 1;
+static const NSUInteger FRABinaryHeaderLength = 3;
+
+typedef NS_ENUM(uint8_t, FRABinaryWireType) {
+    FRABinaryWireVarint = 0,
+    FRABinaryWireDouble = 1,
+    FRABinaryWireBytes = 2,
+    FRABinaryWireString = 3,
+};
+
+typedef struct {
+    uint32_t tag;
+    FRABinaryWireType wireType;
+    /*! One of the key constants of FRASerialization, which are never deallocated. */
+    __unsafe_unretained NSString *key;
+} FRABinaryField;
+
+typedef struct {
+    const FRABinaryField *fields;
+    NSUInteger count;
+} FRABinaryFieldTable;
+
+/*! Tags are part of the stored format: they may be added but never reused for another key. */
+static FRABinaryField FRAHotpOptionFields[4];
+static FRABinaryField FRATotpOptionFields[4];
+static FRABinaryField FRAPushOptionFields[3];
+static FRABinaryField FRANotificationDataFields[4];
+
+static FRABinaryFieldTable FRABinaryFieldTableForSchema(uint8_t schema) {
+    switch (schema) {
+        case FRABinarySchemaHotpOptions:
+            return (FRABinaryFieldTable){FRAHotpOptionFields, sizeof(FRAHotpOptionFields) / sizeof(FRABinaryField)};
+        case FRABinarySchemaTotpOptions:
+            return (FRABinaryFieldTable){FRATotpOptionFields, sizeof(FRATotpOptionFields) / sizeof(FRABinaryField)};
+        case FRABinarySchemaPushOptions:
+            return (FRABinaryFieldTable){FRAPushOptionFields, sizeof(FRAPushOptionFields) / sizeof(FRABinaryField)};
+        case FRABinarySchemaNotificationData:
+            return (FRABinaryFieldTable){FRANotificationDataFields, sizeof(FRANotificationDataFields) / sizeof(FRABinaryField)};
+        default:
+            return (FRABinaryFieldTable){NULL, 0};
+    }
+}
+
+static const FRABinaryField *FRABinaryFieldForKey(FRABinaryFieldTable table, NSString *key) {
+    for (NSUInteger i = 0; i < table.count; i++) {
+        if (table.fields[i].key == key || [table.fields[i].key isEqualToString:key]) {
+            return &table.fields[i];
+        }
+    }
+    return NULL;
+}
+
+static const FRABinaryField *FRABinaryFieldForTag(FRABinaryFieldTable table, uint64_t tag) {
+    for (NSUInteger i = 0; i < table.count; i++) {
+        if (table.fields[i].tag == tag) {
+            return &table.fields[i];
+        }
+    }
+    return NULL;
+}
+
+static void FRABinaryAppendVarint(NSMutableData *data, uint64_t value) {
+    uint8_t buffer[10];
+    NSUInteger length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    [data appendBytes:buffer length:length];
+}
+
+static BOOL FRABinaryReadVarint(const uint8_t **cursor, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (*cursor >= end) {
+            return NO;
+        }
+        uint8_t byte = *(*cursor)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static BOOL FRABinaryAppendField(NSMutableData *data, const FRABinaryField *field, id value) {
+    switch (field->wireType) {
+        case FRABinaryWireVarint:
+            if (![value isKindOfClass:[NSNumber class]]) {
+                return NO;
+            }
+            FRABinaryAppendVarint(data, (uint64_t)field->tag << 3 | field->wireType);
+            FRABinaryAppendVarint(data, [value unsignedLongLongValue]);
+            return YES;
+        case FRABinaryWireDouble: {
+            if (![value isKindOfClass:[NSNumber class]]) {
+                return NO;
+            }
+            double number = [value doubleValue];
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            bits = CFSwapInt64HostToLittle(bits);
+            FRABinaryAppendVarint(data, (uint64_t)field->tag << 3 | field->wireType);
+            [data appendBytes:&bits length:sizeof(bits)];
+            return YES;
+        }
+        case FRABinaryWireBytes:
+        case FRABinaryWireString: {
+            NSData *bytes;
+            if (field->wireType == FRABinaryWireBytes && [value isKindOfClass:[NSData class]]) {
+                bytes = value;
+            } else if (field->wireType == FRABinaryWireString && [value isKindOfClass:[NSString class]]) {
+                bytes = [value dataUsingEncoding:NSUTF8StringEncoding];
+            } else {
+                return NO;
+            }
+            FRABinaryAppendVarint(data, (uint64_t)field->tag << 3 | field->wireType);
+            FRABinaryAppendVarint(data, bytes.length);
+            [data appendData:bytes];
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static NSError *FRABinaryCorruptError(NSString *reason) {
+    return [FRAError createError:[NSString stringWithFormat:@"Invalid binary encoded map: %@", reason]];
+}
+
+@implementation FRABinarySerialization
+
++ (void)initialize {
+    if (self != [FRABinarySerialization class]) {
+        return;
+    }
+    FRAHotpOptionFields[0] = (FRABinaryField){1, FRABinaryWireBytes, OATH_MECHANISM_SECRET};
+    FRAHotpOptionFields[1] = (FRABinaryField){2, FRABinaryWireVarint, OATH_MECHANISM_ALGORITHM};
+    FRAHotpOptionFields[2] = (FRABinaryField){3, FRABinaryWireVarint, OATH_MECHANISM_DIGITS};
+    FRAHotpOptionFields[3] = (FRABinaryField){4, FRABinaryWireVarint, OATH_MECHANISM_COUNTER};
+    
+    FRATotpOptionFields[0] = (FRABinaryField){1, FRABinaryWireBytes, OATH_MECHANISM_SECRET};
+    FRATotpOptionFields[1] = (FRABinaryField){2, FRABinaryWireVarint, OATH_MECHANISM_ALGORITHM};
+    FRATotpOptionFields[2] = (FRABinaryField){3, FRABinaryWireVarint, OATH_MECHANISM_DIGITS};
+    FRATotpOptionFields[3] = (FRABinaryField){5, FRABinaryWireVarint, OATH_MECHANISM_PERIOD};
+    
+    FRAPushOptionFields[0] = (FRABinaryField){1, FRABinaryWireString, PUSH_MECHANISM_SECRET};
+    FRAPushOptionFields[1] = (FRABinaryField){2, FRABinaryWireString, PUSH_MECHANISM_AUTH_END_POINT};
+    FRAPushOptionFields[2] = (FRABinaryField){3, FRABinaryWireVarint, PUSH_MECHANISM_VERSION};
+    
+    FRANotificationDataFields[0] = (FRABinaryField){1, FRABinaryWireString, NOTIFICATION_MESSAGE_ID};
+    FRANotificationDataFields[1] = (FRABinaryField){2, FRABinaryWireString, NOTIFICATION_PUSH_CHALLENGE};
+    FRANotificationDataFields[2] = (FRABinaryField){3, FRABinaryWireDouble, NOTIFICATION_TIME_TO_LIVE};
+    FRANotificationDataFields[3] = (FRABinaryField){4, FRABinaryWireString, NOTIFICATION_LOAD_BALANCER_COOKIE};
+}
+
++ (NSData *)encodeMap:(NSDictionary<NSString *, id> *)map schema:(FRABinarySchema)schema error:(NSError *__autoreleasing *)error {
+    FRABinaryFieldTable table = FRABinaryFieldTableForSchema(schema);
+    if (!table.fields) {
+        if (error) {
+            *error = [FRAError createError:[NSString stringWithFormat:@"Unknown binary schema %u", schema]];
+        }
+        return nil;
+    }
+    for (NSString *key in map) {
+        if (!FRABinaryFieldForKey(table, key)) {
+            if (error) {
+                *error = [FRAError createError:[NSString stringWithFormat:@"Key %@ is not part of binary schema %u", key, schema]];
+            }
+            return nil;
+        }
+    }
+    
+    NSMutableData *data = [[NSMutableData alloc] initWithCapacity:64];
+    uint8_t header[] = {FRABinaryMarker, FRABinaryVersion, schema};
+    [data appendBytes:header length:sizeof(header)];
+    
+    // Fields are written in tag order so that equal maps have equal encodings
+    for (NSUInteger i = 0; i < table.count; i++) {
+        const FRABinaryField *field = &table.fields[i];
+        id value = map[field->key];
+        if (!value || value == [NSNull null]) {
+            continue;
+        }
+        if (!FRABinaryAppendField(data, field, value)) {
+            if (error) {
+                *error = [FRAError createError:[NSString stringWithFormat:@"Value of %@ has the wrong type for binary schema %u", field->key, schema]];
+            }
+            return nil;
+        }
+    }
+    return data;
+}
+
++ (NSDictionary<NSString *, id> *)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error {
+    if (![self isBinaryEncoded:data] || data.length < FRABinaryHeaderLength) {
+        if (error) {
+            *error = FRABinaryCorruptError(@"missing header");
+        }
+        return nil;
+    }
+    const uint8_t *bytes = data.bytes;
+    if (bytes[1] > FRABinaryVersion) {
+        if (error) {
+            *error = FRABinaryCorruptError([NSString stringWithFormat:@"unsupported version %u", bytes[1]]);
+        }
+        return nil;
+    }
+    FRABinaryFieldTable table = FRABinaryFieldTableForSchema(bytes[2]);
+    if (!table.fields) {
+        if (error) {
+            *error = FRABinaryCorruptError([NSString stringWithFormat:@"unknown schema %u", bytes[2]]);
+        }
+        return nil;
+    }
+    
+    NSMutableDictionary<NSString *, id> *map = [[NSMutableDictionary alloc] initWithCapacity:table.count];
+    const uint8_t *cursor = bytes + FRABinaryHeaderLength;
+    const uint8_t *end = bytes + data.length;
+    while (cursor < end) {
+        uint64_t key;
+        if (!FRABinaryReadVarint(&cursor, end, &key)) {
+            cursor = NULL;
+            break;
+        }
+        FRABinaryWireType wireType = key & 0x7;
+        // Fields from a later revision of the schema are skipped over
+        const FRABinaryField *field = FRABinaryFieldForTag(table, key >> 3);
+        if (field && field->wireType != wireType) {
+            if (error) {
+                *error = FRABinaryCorruptError([NSString stringWithFormat:@"%@ has wire type %u", field->key, wireType]);
+            }
+            return nil;
+        }
+        
+        id value = nil;
+        switch (wireType) {
+            case FRABinaryWireVarint: {
+                uint64_t number;
+                if (!FRABinaryReadVarint(&cursor, end, &number)) {
+                    cursor = NULL;
+                    break;
+                }
+                value = field ? [NSNumber numberWithUnsignedLongLong:number] : nil;
+                break;
+            }
+            case FRABinaryWireDouble: {
+                uint64_t bits;
+                if ((NSUInteger)(end - cursor) < sizeof(bits)) {
+                    cursor = NULL;
+                    break;
+                }
+                memcpy(&bits, cursor, sizeof(bits));
+                cursor += sizeof(bits);
+                bits = CFSwapInt64LittleToHost(bits);
+                double number;
+                memcpy(&number, &bits, sizeof(number));
+                value = field ? [NSNumber numberWithDouble:number] : nil;
+                break;
+            }
+            case FRABinaryWireBytes:
+            case FRABinaryWireString: {
+                uint64_t length;
+                if (!FRABinaryReadVarint(&cursor, end, &length) || length > (uint64_t)(end - cursor)) {
+                    cursor = NULL;
+                    break;
+                }
+                if (field && wireType == FRABinaryWireBytes) {
+                    value = [NSData dataWithBytes:cursor length:(NSUInteger)length];
+                } else if (field) {
+                    value = [[NSString alloc] initWithBytes:cursor length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+                    if (!value) {
+                        if (error) {
+                            *error = FRABinaryCorruptError([NSString stringWithFormat:@"%@ is not UTF-8", field->key]);
+                        }
+                        return nil;
+                    }
+                }
+                cursor += length;
+                break;
+            }
+            default:
+                if (error) {
+                    *error = FRABinaryCorruptError([NSString stringWithFormat:@"unknown wire type %u", wireType]);
+                }
+                return nil;
+        }
+        if (!cursor) {
+            break;
+        }
+        if (value) {
+            map[field->key] = value;
+        }
+    }
+    if (cursor != end) {
+        if (error) {
+            *error = FRABinaryCorruptError(@"truncated field");
+        }
+        return nil;
+    }
+    return map;
+}
+
++ (BOOL)isBinaryEncoded:(NSData *)data {
+    return data.length > 0 && ((const uint8_t *)data.bytes)[0] == FRABinaryMarker;
+}
+
+@end
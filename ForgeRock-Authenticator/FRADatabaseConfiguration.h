@@ -26,6 +26,34 @@
  */
 -(NSString *)getDatabasePathWithError:(NSError *__autoreleasing *)error;
 
+/*!
+ * Gets the path to the folder holding the segment files of the notification archive, creating it if needed.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return nil if the folder could not be created, otherwise the complete path to the folder.
+ */
+-(NSString *)getNotificationArchivePathWithError:(NSError *__autoreleasing *)error;
+
+/*!
+ * Gets the path to the binary snapshot of identities and mechanisms which is read in place of the database at launch.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return nil if the folder could not be located, otherwise the complete path to the snapshot file.
+ */
+-(NSString *)getIdentitySnapshotPathWithError:(NSError *__autoreleasing *)error;
+
+/*!
+ * Gets the path to the file holding push notifications whose background processing has not finished yet.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return nil if the folder could not be located, otherwise the complete path to the file.
+ */
+-(NSString *)getPendingPushWorkPathWithError:(NSError *__autoreleasing *)error;
+
+/*!
+ * Gets the path to the filter of push message ids which have already been ingested.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return nil if the folder could not be located, otherwise the complete path to the file.
+ */
+-(NSString *)getSeenMessageFilterPathWithError:(NSError *__autoreleasing *)error;
+
 /*!
  * Given a path, create any folders necessary in the path.
  * @param folder The folder and parent folders to create.
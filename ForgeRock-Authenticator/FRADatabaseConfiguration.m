@@ -46,6 +46,58 @@
     return [databaseFile stringByAppendingPathExtension:@"sqlite"];
 }
 
+/*!
+ * Uses the <Library folder>/Database/NotificationArchive folder, alongside the database it offloads.
+ */
+- (NSString *)getNotificationArchivePathWithError:(NSError *__autoreleasing *)error {
+    NSURL *library = [self systemLibraryPathWithError:error];
+    if (library == nil) {
+        return nil;
+    }
+    
+    NSString *archiveFolder = [[[library path] stringByAppendingPathComponent:@"Database"] stringByAppendingPathComponent:@"NotificationArchive"];
+    if (![FRADatabaseConfiguration parentFoldersFor:archiveFolder error:error]) {
+        return nil;
+    }
+    return archiveFolder;
+}
+
+/*!
+ * Uses the <Library folder>/Database/identities.snapshot file, alongside the database it mirrors.
+ */
+- (NSString *)getIdentitySnapshotPathWithError:(NSError *__autoreleasing *)error {
+    NSString *databasePath = [self getDatabasePathWithError:error];
+    if (databasePath == nil) {
+        return nil;
+    }
+    NSString *snapshotFile = [[databasePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"identities"];
+    return [snapshotFile stringByAppendingPathExtension:@"snapshot"];
+}
+
+/*!
+ * Uses the <Library folder>/Database/pending-push.plist file, alongside the database the work is written to.
+ */
+- (NSString *)getPendingPushWorkPathWithError:(NSError *__autoreleasing *)error {
+    NSString *databasePath = [self getDatabasePathWithError:error];
+    if (databasePath == nil) {
+        return nil;
+    }
+    NSString *pendingFile = [[databasePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"pending-push"];
+    return [pendingFile stringByAppendingPathExtension:@"plist"];
+}
+
+/*!
+ * Uses the <Library folder>/Database/seen-messages.filter file, alongside the database whose notifications it tracks.
+ */
+- (NSString *)getSeenMessageFilterPathWithError:(NSError *__autoreleasing *)error {
+    NSString *databasePath = [self getDatabasePathWithError:error];
+    if (databasePath == nil) {
+        return nil;
+    }
+    NSString *filterFile = [[databasePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"seen-messages"];
+    return [filterFile stringByAppendingPathExtension:@"filter"];
+}
+
 + (BOOL)parentFoldersFor:(NSString *)folder error:(NSError *__autoreleasing *)error {
     NSFileManager* manager = [NSFileManager defaultManager];
     // Creating the folder if required
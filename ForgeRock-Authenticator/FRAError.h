@@ -23,7 +23,8 @@ typedef NS_ENUM(NSInteger, FRAErrorCodes) {
     FRAInvalidOperation,
     FRAMissingDeviceId,
     FRAInvalidQRCode,
-    FRANetworkFailure
+    FRANetworkFailure,
+    FRAInvalidPushMessage
 };
 
 @interface FRAError : NSObject
@@ -0,0 +1,86 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <AFNetworking.h>
+
+/*!
+ * Pool of HTTP sessions, one per endpoint origin (scheme, host and port).
+ *
+ * Reusing a session keeps its connections warm, so successive responses to the same OpenAM server skip DNS,
+ * TCP and TLS setup and, where the server supports HTTP/2, are multiplexed over a single connection. The
+ * pool is drained when the application receives a memory warning.
+ *
+ * Session managers are leased from the pool, and a drained session manager is only invalidated once its
+ * leases have been released, so that a task is never created in an invalidated session.
+ *
+ * The pool is thread safe.
+ */
+@interface FRAHTTPSessionPool : NSObject
+
+/*!
+ * The number of sessions requested from the pool.
+ */
+@property (nonatomic, readonly) NSUInteger requestCount;
+
+/*!
+ * The number of requests served by a session which was already in the pool.
+ */
+@property (nonatomic, readonly) NSUInteger reuseCount;
+
+/*!
+ * The number of sessions currently pooled.
+ */
+@property (nonatomic, readonly) NSUInteger sessionCount;
+
+/*!
+ * The pool shared by the application.
+ *
+ * @return The shared pool.
+ */
++ (instancetype)sharedPool;
+
+/*!
+ * Leases the pooled session for the origin of the URL, creating it if needed. Each lease must be released
+ * with releaseSessionManager: once the tasks which use it have been created.
+ *
+ * @param url The URL which will be requested.
+ * @param protocol A custom NSURLProtocol class to register with the session, or nil.
+ * @return The session manager for the origin of the URL.
+ */
+- (AFHTTPSessionManager *)sessionManagerForURL:(NSURL *)url protocol:(Class)protocol;
+
+/*!
+ * Releases a lease taken by sessionManagerForURL:protocol:. Invalidates the session once its tasks finish if
+ * it has been drained from the pool and this was its last lease.
+ *
+ * @param manager The leased session manager.
+ */
+- (void)releaseSessionManager:(AFHTTPSessionManager *)manager;
+
+/*!
+ * The fraction of requests served by a pooled session, between 0 and 1.
+ *
+ * @return The reuse rate, or 0 if no session has been requested.
+ */
+- (double)reuseRate;
+
+/*!
+ * Empties the pool. Each session is invalidated once its outstanding tasks finish, and once any leases of it
+ * have been released.
+ */
+- (void)drain;
+
+@end
@@ -0,0 +1,145 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <UIKit/UIKit.h>
+
+#import "FRAHTTPSessionPool.h"
+
+@implementation FRAHTTPSessionPool {
+    NSMutableDictionary<NSString *, AFHTTPSessionManager *> *sessions;
+    /*! Number of outstanding leases of each leased session manager. */
+    NSMapTable<AFHTTPSessionManager *, NSNumber *> *leases;
+    /*! Drained session managers which are invalidated when their last lease is released. */
+    NSHashTable<AFHTTPSessionManager *> *retiring;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
++ (instancetype)sharedPool {
+    static FRAHTTPSessionPool *sharedPool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[FRAHTTPSessionPool alloc] init];
+    });
+    return sharedPool;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        sessions = [[NSMutableDictionary alloc] init];
+        leases = [NSMapTable strongToStrongObjectsMapTable];
+        retiring = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(drain)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self drain];
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (AFHTTPSessionManager *)sessionManagerForURL:(NSURL *)url protocol:(Class)protocol {
+    NSString *key = [self keyForURL:url protocol:protocol];
+    @synchronized (self) {
+        _requestCount++;
+        AFHTTPSessionManager *manager = sessions[key];
+        if (manager) {
+            _reuseCount++;
+        } else {
+            manager = [[AFHTTPSessionManager alloc] initWithSessionConfiguration:[self configurationWithProtocol:protocol]];
+            sessions[key] = manager;
+        }
+        [leases setObject:@([[leases objectForKey:manager] unsignedIntegerValue] + 1) forKey:manager];
+        return manager;
+    }
+}
+
+- (void)releaseSessionManager:(AFHTTPSessionManager *)manager {
+    if (!manager) {
+        return;
+    }
+    @synchronized (self) {
+        NSUInteger count = [[leases objectForKey:manager] unsignedIntegerValue];
+        if (count > 1) {
+            [leases setObject:@(count - 1) forKey:manager];
+            return;
+        }
+        [leases removeObjectForKey:manager];
+        if (![retiring containsObject:manager]) {
+            return;
+        }
+        [retiring removeObject:manager];
+    }
+    [manager invalidateSessionCancelingTasks:NO];
+}
+
+- (NSUInteger)sessionCount {
+    @synchronized (self) {
+        return sessions.count;
+    }
+}
+
+- (double)reuseRate {
+    @synchronized (self) {
+        return _requestCount == 0 ? 0 : (double)_reuseCount / _requestCount;
+    }
+}
+
+- (void)drain {
+    NSMutableArray<AFHTTPSessionManager *> *drained = [[NSMutableArray alloc] init];
+    @synchronized (self) {
+        for (AFHTTPSessionManager *manager in sessions.allValues) {
+            // A leased session may be about to create a task, so it is left to be invalidated on release
+            if ([leases objectForKey:manager]) {
+                [retiring addObject:manager];
+            } else {
+                [drained addObject:manager];
+            }
+        }
+        [sessions removeAllObjects];
+    }
+    for (AFHTTPSessionManager *manager in drained) {
+        [manager invalidateSessionCancelingTasks:NO];
+    }
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+- (NSString *)keyForURL:(NSURL *)url protocol:(Class)protocol {
+    return [NSString stringWithFormat:@"%@://%@:%@ %@", url.scheme.lowercaseString, url.host.lowercaseString, url.port ?: @"", protocol ? NSStringFromClass(protocol) : @""];
+}
+
+- (NSURLSessionConfiguration *)configurationWithProtocol:(Class)protocol {
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    if (protocol) {
+        NSMutableArray *protocolsArray = [configuration.protocolClasses mutableCopy];
+        [protocolsArray insertObject:protocol atIndex:0];
+        configuration.protocolClasses = protocolsArray;
+    }
+    return configuration;
+}
+
+@end
@@ -0,0 +1,31 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/***********************************************************************
+ * Lookup table shared by the hex decoders of the URI and JWS parsers
+ * and of FRASerialization.
+ ***********************************************************************/
+
+#ifndef _FRA_HEX_H_
+#define _FRA_HEX_H_
+
+/* Marks bytes which are not hex digits in FRAHexValues. */
+#define FRA_HEX_INVALID 0xFF
+
+/* Nibble value of each hex digit in either case, or FRA_HEX_INVALID for any other byte. */
+extern const unsigned char FRAHexValues[256] __attribute__((visibility("hidden")));
+
+#endif /* _FRA_HEX_H_ */
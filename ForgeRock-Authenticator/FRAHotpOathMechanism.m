@@ -19,9 +19,12 @@
 #import "FRAHotpOathMechanism.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAModelObjectProtected.h"
-#import "FRAOathCode.h"
+#import "FRAMechanismProtected.h"
+#import "FRAOathKey.h"
 
-@implementation FRAHotpOathMechanism
+@implementation FRAHotpOathMechanism {
+    FRAOathKey *oathKey;
+}
 
 #pragma mark -
 #pragma mark Lifecyle
@@ -29,7 +32,7 @@
 - (instancetype)initWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel secretKey:(NSData *)secretKey HMACAlgorithm:(CCHmacAlgorithm)algorithm codeLength:(NSUInteger)codeLenght counter:(u_int64_t)counter {
     self = [super initWithDatabase:database identityModel:identityModel];
     if (self) {
-        _secretKey = secretKey;
+        [self setSecretKey:secretKey];
         _algorithm = algorithm;
         _codeLength = codeLenght;
         _counter = counter;
@@ -47,7 +50,7 @@
 
 - (BOOL)generateNextCode:(NSError *__autoreleasing*)error {
     NSString *previousCode = _code;
-    _code = [FRAOathCode hmac:self.algorithm codeLength:self.codeLength key:self.secretKey counter:++_counter];
+    _code = [self codeForCounter:++_counter];
     if ([self.database updateMechanism:self error:error]) {
         return YES;
     }
@@ -60,4 +63,22 @@
     return @"hotp";
 }
 
+- (NSData *)secretKey {
+    return [oathKey data];
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+/*!
+ * Moves the secret key into the key arena. Also used when the mechanism is loaded from the database.
+ */
+- (void)setSecretKey:(NSData *)secretKey {
+    oathKey = [[FRAOathKey alloc] initWithData:secretKey];
+}
+
+- (NSString *)codeForCounter:(uint64_t)counter {
+    return [oathKey codeWithAlgorithm:self.algorithm codeLength:self.codeLength counter:counter];
+}
+
 @end
\ No newline at end of file
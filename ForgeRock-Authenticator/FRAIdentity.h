@@ -47,6 +47,9 @@
 
 /*!
  * The Mechanisms assigned to the Identity. Maybe empty.
+ *
+ * The returned array is an immutable snapshot which is shared rather than copied; it is not affected by
+ * subsequent changes to the identity.
  */
 @property (getter=mechanisms, nonatomic, readonly) NSArray<FRAMechanism *> *mechanisms;
 
@@ -105,8 +108,22 @@
 /*!
  * Count of notifications that have not yet been dealt with.
  *
+ * The count is cached and only recalculated after a change has been reported or a pending notification expires.
+ *
  * @return The number of pending notifications.
  */
 - (NSInteger)pendingNotificationsCount;
 
+/*!
+ * The time at which the earliest pending notification of this identity expires.
+ *
+ * @return The expiry time, or nil if there are no pending notifications.
+ */
+- (NSDate *)nextPendingNotificationExpiry;
+
+/*!
+ * Informs the identity that the pending notifications count of one of its mechanisms has changed.
+ */
+- (void)pendingNotificationsCountDidChange;
+
 @end
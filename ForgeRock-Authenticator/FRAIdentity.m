@@ -24,9 +24,29 @@
 #import "FRAPushMechanism.h"
 #import "FRATotpOathMechanism.h"
 
+/*!
+ * Private interface.
+ */
+@interface FRAIdentity ()
+
+/*!
+ * Immutable snapshot of the mechanisms. Replaced (never mutated) by writers while holding the identity's lock;
+ * atomic so that readers on any thread can take a reference without locking.
+ */
+@property (atomic, strong) NSArray<FRAMechanism *> *mechanismSnapshot;
+
+@end
+
 @implementation FRAIdentity {
     
-    NSMutableArray *mechanismList;
+    /*! Cached count of pending notifications across all mechanisms. */
+    NSInteger pendingCount;
+    /*! Whether pendingCount must be recalculated before it can be used. */
+    BOOL pendingCountStale;
+    /*! Incremented whenever pendingCount is invalidated, so that a recount racing with a change is discarded. */
+    NSUInteger pendingCountGeneration;
+    /*! Time at which the earliest counted pending notification expires, or nil if none are pending. */
+    NSDate *pendingCountExpiry;
 
 }
 
@@ -38,8 +58,9 @@
         _accountName = accountName;
         _issuer = issuer;
         _image = image;
-        mechanismList = [[NSMutableArray alloc] init];
+        _mechanismSnapshot = @[];
         _backgroundColor = color;
+        pendingCountStale = YES;
     }
     return self;
 }
@@ -52,11 +73,11 @@
 #pragma mark Mechanism Functions
 
 - (NSArray *)mechanisms {
-    return [[NSArray alloc] initWithArray:mechanismList];
+    return self.mechanismSnapshot;
 }
 
 - (FRAMechanism *)mechanismOfClass:(Class)aClass {
-    for (FRAMechanism *mechanism in mechanismList) {
+    for (FRAMechanism *mechanism in self.mechanismSnapshot) {
         if ([mechanism isKindOfClass:aClass]) {
             return mechanism;
         }
@@ -67,10 +88,17 @@
 - (BOOL)addMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
     
     FRAMechanism *duplicateMechanism;
-    if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
-        duplicateMechanism = [self mechanismOfClass:[FRAPushMechanism class]];
-    } else {
-        duplicateMechanism = [self mechanismOfClass:[FRAHotpOathMechanism class]] ? [self mechanismOfClass:[FRAHotpOathMechanism class]] : [self mechanismOfClass:[FRATotpOathMechanism class]];
+    @synchronized (self) {
+        if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
+            duplicateMechanism = [self mechanismOfClass:[FRAPushMechanism class]];
+        } else {
+            duplicateMechanism = [self mechanismOfClass:[FRAHotpOathMechanism class]] ? [self mechanismOfClass:[FRAHotpOathMechanism class]] : [self mechanismOfClass:[FRATotpOathMechanism class]];
+        }
+        
+        if (!duplicateMechanism) {
+            [mechanism setParent:self];
+            self.mechanismSnapshot = [self.mechanismSnapshot arrayByAddingObject:mechanism];
+        }
     }
 
     if (duplicateMechanism) {
@@ -82,8 +110,7 @@
         return NO;
     }
     
-    [mechanism setParent:self];
-    [mechanismList addObject:mechanism];
+    [self pendingNotificationsCountDidChange];
     BOOL result = YES;
     if ([self isStored]) {
         result = [self.database insertMechanism:mechanism error:error];
@@ -94,22 +121,30 @@
 - (BOOL)removeMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
     BOOL result = YES;
     
-    if (![mechanismList containsObject:mechanism]) {
-        if (error) {
-            *error = [FRAError createError:@"Invalid operation" code:FRAInvalidOperation];
+    BOOL lastMechanism;
+    @synchronized (self) {
+        NSArray<FRAMechanism *> *mechanisms = self.mechanismSnapshot;
+        if (![mechanisms containsObject:mechanism]) {
+            if (error) {
+                *error = [FRAError createError:@"Invalid operation" code:FRAInvalidOperation];
+            }
+            return NO;
         }
-        return NO;
+        lastMechanism = mechanisms.count == 1;
+        NSMutableArray<FRAMechanism *> *remaining = [mechanisms mutableCopy];
+        [remaining removeObject:mechanism];
+        self.mechanismSnapshot = [remaining copy];
     }
     
-    if (mechanismList.count == 1) {
+    if (lastMechanism) {
         result = [_identityModel removeIdentity:self error:error];
     } else {
         if ([self isStored]) {
             result = [self.database deleteMechanism:mechanism error:error];
         }
     }
-    [mechanismList removeObject:mechanism];
     [mechanism setParent:nil];
+    [self pendingNotificationsCountDidChange];
     
     return result;
 }
@@ -118,9 +153,61 @@
 #pragma mark Notification Functions
 
 - (NSInteger)pendingNotificationsCount {
+    return [self recountPendingNotificationsIfNeeded:nil];
+}
+
+- (NSDate *)nextPendingNotificationExpiry {
+    NSDate *expiry;
+    [self recountPendingNotificationsIfNeeded:&expiry];
+    return expiry;
+}
+
+- (void)pendingNotificationsCountDidChange {
+    @synchronized (self) {
+        pendingCountStale = YES;
+        pendingCountGeneration++;
+    }
+    [_identityModel pendingNotificationsCountDidChange];
+}
+
+/*!
+ * Returns the cached pending count, first recalculating it from the (themselves cached) counts of each
+ * mechanism if it has been invalidated or a counted notification has since expired.
+ *
+ * The recount is done without holding the lock, as mechanisms take their own locks and report changes back up
+ * to the identity. A recount which raced with a change is returned but not cached.
+ */
+- (NSInteger)recountPendingNotificationsIfNeeded:(NSDate **)nextExpiry {
+    NSUInteger generation;
+    @synchronized (self) {
+        if (!pendingCountStale && !(pendingCountExpiry && [pendingCountExpiry timeIntervalSinceNow] <= 0)) {
+            if (nextExpiry) {
+                *nextExpiry = pendingCountExpiry;
+            }
+            return pendingCount;
+        }
+        generation = pendingCountGeneration;
+    }
+    
     NSInteger count = 0;
-    for (FRAMechanism *mechanism in self.mechanisms) {
+    NSDate *expiry = nil;
+    for (FRAMechanism *mechanism in self.mechanismSnapshot) {
         count += [mechanism pendingNotificationsCount];
+        NSDate *mechanismExpiry = [mechanism nextPendingNotificationExpiry];
+        if (mechanismExpiry && (!expiry || [mechanismExpiry compare:expiry] == NSOrderedAscending)) {
+            expiry = mechanismExpiry;
+        }
+    }
+    
+    @synchronized (self) {
+        if (generation == pendingCountGeneration) {
+            pendingCount = count;
+            pendingCountExpiry = expiry;
+            pendingCountStale = NO;
+        }
+    }
+    if (nextExpiry) {
+        *nextExpiry = expiry;
     }
     return count;
 }
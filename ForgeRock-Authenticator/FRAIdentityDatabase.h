@@ -18,13 +18,27 @@
 @class FRAIdentity;
 @class FRAIdentityDatabase;
 @class FRAIdentityDatabaseSQLiteOperations;
+@class FRAIdentitySnapshotFile;
 @class FRAMechanism;
 @class FRANotification;
+@class FRAResponseOutbox;
 
 
-/*! Identifier for NSNotificationCenter event broadcast by FRAIdentityDatase when state change occurs. */
+/*!
+ * Identifier for NSNotificationCenter event broadcast by FRAIdentityDatase when state change occurs. The event is
+ * posted synchronously on the thread which made the change; observers which update the UI should observe
+ * FRAIdentityDatabaseChangesCoalescedNotification, which is always posted on the main thread.
+ */
 extern NSString * const FRAIdentityDatabaseChangedNotification;
 
+/*!
+ * Identifier for NSNotificationCenter event broadcast by FRAIdentityDatabase at most once per main run loop turn,
+ * merging all of the state changes which have occurred since the last such event. The userInfo dictionary uses the
+ * same keys as FRAIdentityDatabaseChangedNotification. Objects that were added and then removed within the same
+ * turn are omitted, and objects that were removed and then added again are reported as updated.
+ */
+extern NSString * const FRAIdentityDatabaseChangesCoalescedNotification;
+
 /*! Key identifying added objects in FRAIdentityDatabaseChangedNotification userInfo dictionary. */
 extern NSString * const FRAIdentityDatabaseChangedNotificationAddedItems;
 
@@ -45,6 +59,18 @@ extern NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems;
 
 @property (strong, nonatomic, readonly) FRAIdentityDatabaseSQLiteOperations *sqlOperations;
 
+/*!
+ * Binary snapshot of the identities and mechanisms which is invalidated before, and rewritten after, each change to
+ * them is committed. May be nil. Exposed to allow (setter) dependency injection.
+ */
+@property (strong, nonatomic) FRAIdentitySnapshotFile *snapshotFile;
+
+/*!
+ * Durable queue through which notifications send their responses. May be nil, in which case responses are sent
+ * directly. Exposed to allow (setter) dependency injection.
+ */
+@property (strong, nonatomic) FRAResponseOutbox *responseOutbox;
+
 #pragma mark -
 #pragma mark Lifecycle
 
@@ -123,4 +149,41 @@ extern NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems;
  */
 - (BOOL)updateNotification:(FRANotification *)notification error:(NSError *__autoreleasing *)error;
 
+/*!
+ * Save changes to several existing notifications to the database in a single transaction, broadcasting one change
+ * event.
+ * @param notifications The notifications to save.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if there was an error whilst processing, including when one of the notifications has not been stored, in which case none of the notifications were saved. YES if the operation completed successfully.
+ */
+- (BOOL)updateNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Remove several notifications from the database in a single transaction, broadcasting one change event.
+ * Notifications which have not been stored are skipped.
+ * @param notifications The notifications to remove.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if there was an error whilst processing, in which case none of the notifications were removed. YES if the operation completed successfully.
+ */
+- (BOOL)deleteNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error;
+
+#pragma mark -
+#pragma mark Maintenance Functions
+
+/*!
+ * Convert a database created before incremental vacuuming was enabled so that free pages can be released. This
+ * rewrites the whole database the first time it is called.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if there was an error whilst processing. YES if the operation completed successfully.
+ */
+- (BOOL)enableIncrementalVacuumWithError:(NSError *__autoreleasing *)error;
+
+/*!
+ * Release free pages left behind by deleted records back to the file system.
+ * @param reclaimedPages Upon return contains the number of pages which were released. May be NULL.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if there was an error whilst processing. YES if the operation completed successfully.
+ */
+- (BOOL)incrementalVacuumReclaimingPages:(NSInteger *)reclaimedPages error:(NSError *__autoreleasing *)error;
+
 @end
@@ -21,6 +21,8 @@
 #import "FRAIdentity.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAIdentityDatabaseSQLiteOperations.h"
+#import "FRAIdentityModel.h"
+#import "FRAIdentitySnapshotFile.h"
 #import "FRAMechanismFactory.h"
 #import "FRAModelObjectProtected.h"
 #import "FRANotification.h"
@@ -28,6 +30,7 @@
 #import "FRATotpOathMechanism.h"
 
 NSString * const FRAIdentityDatabaseChangedNotification = @"FRAIdentityDatabaseChangedNotification";
+NSString * const FRAIdentityDatabaseChangesCoalescedNotification = @"FRAIdentityDatabaseChangesCoalescedNotification";
 NSString * const FRAIdentityDatabaseChangedNotificationAddedItems = @"added";
 NSString * const FRAIdentityDatabaseChangedNotificationRemovedItems = @"removed";
 NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated";
@@ -36,11 +39,15 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 /*!
  * Responsible for persisting model objects to the SQLite database, managing the storage IDs for persisted objects
  * and broadcasting FRAIdentityDatabaseChangedNotification event to the NSNotificationCenter defaultCenter so that
- * listeners can observe when the model is updated.
+ * listeners can observe when the model is updated. Bursts of changes are also merged into a single
+ * FRAIdentityDatabaseChangesCoalescedNotification event which is broadcast on the main thread.
  * 
  * Actual SQL calls are delegated to FRAIdentityDatabaseSQLiteOperations.
  */
-@implementation FRAIdentityDatabase
+@implementation FRAIdentityDatabase {
+    /*! State changes not yet broadcast in a coalesced event, or nil if no coalesced event is scheduled. */
+    NSMutableDictionary *coalescedStateChanges;
+}
 
 #pragma mark -
 #pragma mark Lifecyle
@@ -57,9 +64,11 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 
 - (BOOL)insertIdentity:(FRAIdentity *)identity error:(NSError *__autoreleasing *)error {
     NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    [self.snapshotFile invalidate];
     if (![self doInsertIdentity:identity andCollectStateChanges:stateChanges withError:error]) {
         return NO;
     }
+    [self writeSnapshotOfModelContaining:identity];
     [self postDatabaseChangeNotificationForStateChanges:stateChanges];
     return YES;
 }
@@ -87,9 +96,11 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 
 - (BOOL)deleteIdentity:(FRAIdentity *)identity error:(NSError *__autoreleasing *)error {
     NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    [self.snapshotFile invalidate];
     if (![self doDeleteIdentity:identity andCollectStateChanges:stateChanges withError:error]) {
         return NO;
     }
+    [self writeSnapshotOfModelContaining:identity];
     [self postDatabaseChangeNotificationForStateChanges:stateChanges];
     return YES;
 }
@@ -120,9 +131,11 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 
 - (BOOL)insertMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
     NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    [self.snapshotFile invalidate];
     if (![self doInsertMechanism:mechanism andCollectStateChanges:stateChanges withError:error]) {
         return NO;
     }
+    [self writeSnapshotOfModelContaining:mechanism];
     [self postDatabaseChangeNotificationForStateChanges:stateChanges];
     return YES;
 }
@@ -149,9 +162,11 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 
 - (BOOL)deleteMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
     NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    [self.snapshotFile invalidate];
     if (![self doDeleteMechanism:mechanism andCollectStateChanges:stateChanges withError:error]) {
         return NO;
     }
+    [self writeSnapshotOfModelContaining:mechanism];
     [self postDatabaseChangeNotificationForStateChanges:stateChanges];
     return YES;
 }
@@ -178,9 +193,16 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
 
 - (BOOL)updateMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
     NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    BOOL updatesSnapshot = [self.snapshotFile recordsUpdatesOfMechanism:mechanism];
+    if (updatesSnapshot) {
+        [self.snapshotFile invalidate];
+    }
     if (![self doUpdateMechanism:mechanism andCollectStateChanges:stateChanges withError:error]) {
         return NO;
     }
+    if (updatesSnapshot) {
+        [self writeSnapshotOfModelContaining:mechanism];
+    }
     [self postDatabaseChangeNotificationForStateChanges:stateChanges];
     return YES;
 }
@@ -276,11 +298,134 @@ NSString * const FRAIdentityDatabaseChangedNotificationUpdatedItems = @"updated"
     return YES;
 }
 
+- (BOOL)updateNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error {
+    for (FRANotification *notification in notifications) {
+        if (![notification isStored]) {
+            if (error) {
+                NSString *reason = [[NSString alloc] initWithFormat:@"Notification %@ was not already persisted", notification.messageId];
+                *error = [FRAError createError:reason];
+            }
+            return NO;
+        }
+    }
+    if (notifications.count == 0) {
+        return YES;
+    }
+    if (![self.sqlOperations updateNotifications:notifications error:error]) {
+        return NO;
+    }
+    NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    [[stateChanges valueForKey:FRAIdentityDatabaseChangedNotificationUpdatedItems] addObjectsFromArray:notifications];
+    [self postDatabaseChangeNotificationForStateChanges:stateChanges];
+    return YES;
+}
+
+- (BOOL)deleteNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error {
+    NSMutableArray<FRANotification *> *storedNotifications = [[NSMutableArray alloc] initWithCapacity:notifications.count];
+    for (FRANotification *notification in notifications) {
+        if ([notification isStored]) {
+            [storedNotifications addObject:notification];
+        }
+    }
+    if (storedNotifications.count == 0) {
+        return YES;
+    }
+    if (![self.sqlOperations deleteNotifications:storedNotifications error:error]) {
+        return NO;
+    }
+    NSMutableDictionary *stateChanges = [self dictionaryForStateChanges];
+    for (FRANotification *notification in storedNotifications) {
+        notification.stored = NO;
+        [[stateChanges valueForKey:FRAIdentityDatabaseChangedNotificationRemovedItems] addObject:notification];
+    }
+    [self postDatabaseChangeNotificationForStateChanges:stateChanges];
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Maintenance Functions
+
+- (BOOL)enableIncrementalVacuumWithError:(NSError *__autoreleasing *)error {
+    return [self.sqlOperations enableIncrementalVacuumWithError:error];
+}
+
+- (BOOL)incrementalVacuumReclaimingPages:(NSInteger *)reclaimedPages error:(NSError *__autoreleasing *)error {
+    return [self.sqlOperations incrementalVacuumReclaimingPages:reclaimedPages error:error];
+}
+
+#pragma mark -
+#pragma mark Snapshot Functions (private)
+
+/*!
+ * Rewrites the identity snapshot once a change to an identity or mechanism has been committed. Objects which do not
+ * belong to an identity model have nothing to snapshot.
+ */
+- (void)writeSnapshotOfModelContaining:(FRAModelObject *)object {
+    FRAIdentityModel *identityModel = object.identityModel;
+    if (self.snapshotFile && identityModel) {
+        [self.snapshotFile writeIdentities:[identityModel identities]];
+    }
+}
+
 #pragma mark -
 #pragma mark Listener Functions (private)
 
 - (void)postDatabaseChangeNotificationForStateChanges:(NSDictionary *)stateChanges {
     [[NSNotificationCenter defaultCenter] postNotificationName:FRAIdentityDatabaseChangedNotification object:self userInfo:stateChanges];
+    [self coalesceStateChanges:stateChanges];
+}
+
+/*!
+ * Merges state changes into those awaiting broadcast, scheduling the coalesced event on the main queue if this is
+ * the first change since the last one was broadcast.
+ */
+- (void)coalesceStateChanges:(NSDictionary *)stateChanges {
+    BOOL scheduleBroadcast = NO;
+    @synchronized (self) {
+        if (!coalescedStateChanges) {
+            coalescedStateChanges = [self dictionaryForStateChanges];
+            scheduleBroadcast = YES;
+        }
+        NSMutableSet *added = [coalescedStateChanges valueForKey:FRAIdentityDatabaseChangedNotificationAddedItems];
+        NSMutableSet *removed = [coalescedStateChanges valueForKey:FRAIdentityDatabaseChangedNotificationRemovedItems];
+        NSMutableSet *updated = [coalescedStateChanges valueForKey:FRAIdentityDatabaseChangedNotificationUpdatedItems];
+        
+        for (id item in [stateChanges valueForKey:FRAIdentityDatabaseChangedNotificationAddedItems]) {
+            if ([removed containsObject:item]) {
+                [removed removeObject:item];
+                [updated addObject:item];
+            } else {
+                [added addObject:item];
+            }
+        }
+        for (id item in [stateChanges valueForKey:FRAIdentityDatabaseChangedNotificationRemovedItems]) {
+            [updated removeObject:item];
+            if ([added containsObject:item]) {
+                [added removeObject:item];
+            } else {
+                [removed addObject:item];
+            }
+        }
+        for (id item in [stateChanges valueForKey:FRAIdentityDatabaseChangedNotificationUpdatedItems]) {
+            if (![added containsObject:item]) {
+                [updated addObject:item];
+            }
+        }
+    }
+    if (scheduleBroadcast) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self postCoalescedDatabaseChangeNotification];
+        });
+    }
+}
+
+- (void)postCoalescedDatabaseChangeNotification {
+    NSDictionary *stateChanges;
+    @synchronized (self) {
+        stateChanges = coalescedStateChanges;
+        coalescedStateChanges = nil;
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:FRAIdentityDatabaseChangesCoalescedNotification object:self userInfo:stateChanges];
 }
 
 - (NSMutableDictionary *)dictionaryForStateChanges {
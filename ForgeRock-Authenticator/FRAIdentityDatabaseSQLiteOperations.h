@@ -105,4 +105,43 @@
  */
 - (BOOL)updateNotification:(FRANotification *)notification error:(NSError *__autoreleasing *)error;
 
+/*!
+ * Save changes to several existing notifications to the database in a single transaction. Either all of the
+ * notifications are saved or, if there is an error, none of them are.
+ * @param notifications The notifications to save.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the notifications are updated in the database, otherwise NO.
+ */
+- (BOOL)updateNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Remove several notifications from the database in a single transaction. Either all of the notifications are
+ * removed or, if there is an error, none of them are.
+ * @param notifications The notifications to remove.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the notifications are removed from the database, otherwise NO.
+ */
+- (BOOL)deleteNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error;
+
+#pragma mark -
+#pragma mark Maintenance Functions
+
+/*!
+ * Convert a database created before incremental vacuuming was enabled in the schema with a one-off full vacuum.
+ * Does nothing if the database has already been converted. The full vacuum rewrites the whole database, so this
+ * should not be called where the time available is limited.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the database uses incremental vacuuming, otherwise NO.
+ */
+- (BOOL)enableIncrementalVacuumWithError:(NSError *__autoreleasing *)error;
+
+/*!
+ * Return free pages to the file system. Databases which have not been converted with
+ * enableIncrementalVacuumWithError: are left untouched.
+ * @param reclaimedPages Upon return contains the number of pages which were released. May be NULL.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the database was vacuumed, otherwise NO.
+ */
+- (BOOL)incrementalVacuumReclaimingPages:(NSInteger *)reclaimedPages error:(NSError *__autoreleasing *)error;
+
 @end
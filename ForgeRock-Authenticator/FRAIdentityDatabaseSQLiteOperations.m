@@ -15,17 +15,19 @@
  */
 
 #import "FMDatabase.h"
+#import "FMDatabaseAdditions.h"
+#import "FRABinarySerialization.h"
 #import "FRAError.h"
 #import "FRAFMDatabaseConnectionHelper.h"
-#import "FRAHotpOathMechanism.h"
 #import "FRAIdentity.h"
 #import "FRAIdentityDatabaseSQLiteOperations.h"
 #import "FRAMechanism.h"
+#import "FRAMechanismDescriptor.h"
 #import "FRANotification.h"
-#import "FRAOathCode.h"
-#import "FRAPushMechanism.h"
 #import "FRASerialization.h"
-#import "FRATotpOathMechanism.h"
+
+/*! Value of PRAGMA auto_vacuum when free pages are only released by PRAGMA incremental_vacuum. */
+static const int FRAAutoVacuumIncremental = 2;
 
 @implementation FRAIdentityDatabaseSQLiteOperations {
     FRAFMDatabaseConnectionHelper *sqlDatabase;
@@ -125,84 +127,26 @@
     // idAccountName
     [arguments addObject:[FRASerialization nonNilString:parent.accountName]];
     
-    // mechanismUID - Special case for PushMechanism
-    if ([mechanism isKindOfClass:[FRAHotpOathMechanism class]] || [mechanism isKindOfClass:[FRATotpOathMechanism class]]) {
-        [arguments addObject:[NSNull null]];
-    } else if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
-        FRAPushMechanism *pushMechanism = (FRAPushMechanism*)mechanism;
-        [arguments addObject:[FRASerialization nonNilString:pushMechanism.mechanismUID]];
-    } else {
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    if (!descriptor) {
         @throw [FRAError createIllegalStateException:@"Unrecognised class of Mechanism"];
     }
     
+    // mechanismUID
+    [arguments addObject:[FRASerialization nonNilString:[descriptor mechanismUIDOfMechanism:mechanism]]];
+    
     // Mechanism Type
-    [arguments addObject:[FRASerialization nonNilString:[[mechanism class] mechanismType]]];
+    [arguments addObject:[FRASerialization nonNilString:descriptor.type]];
 
     // Version
     [arguments addObject:[NSNumber numberWithInteger:mechanism.version]];
     
     // Options
-    NSMutableDictionary *options = [[NSMutableDictionary alloc] init];
-    if ([mechanism isKindOfClass:[FRAHotpOathMechanism class]]) {
-        FRAHotpOathMechanism *hotpOathMechanism = (FRAHotpOathMechanism *)mechanism;
-        
-        // Secret Key
-        NSString *base64Key = [FRASerialization serializeSecret:hotpOathMechanism.secretKey];
-        [options setObject:[FRASerialization nonNilString:base64Key] forKey:OATH_MECHANISM_SECRET];
-        
-        // Algorithm
-        NSString *algorithm = [FRAOathCode asString:hotpOathMechanism.algorithm];
-        [options setObject:[FRASerialization nonNilString:algorithm] forKey:OATH_MECHANISM_ALGORITHM];
-
-        // Code Length
-        NSString *digitsString = [[NSNumber numberWithUnsignedInteger:hotpOathMechanism.codeLength] stringValue];
-        [options setObject:[FRASerialization nonNilString:digitsString] forKey:OATH_MECHANISM_DIGITS];
-        
-        // Counter
-        NSString *counterString = [[NSNumber numberWithUnsignedLongLong:hotpOathMechanism.counter] stringValue];
-        [options setObject:[FRASerialization nonNilString:counterString] forKey:OATH_MECHANISM_COUNTER];
-        
-    } else if ([mechanism isKindOfClass:[FRATotpOathMechanism class]]) {
-        FRATotpOathMechanism *totpOathMechanism = (FRATotpOathMechanism *)mechanism;
-        
-        // Secret Key
-        NSString *base64Key = [FRASerialization serializeSecret:totpOathMechanism.secretKey];
-        [options setObject:[FRASerialization nonNilString:base64Key] forKey:OATH_MECHANISM_SECRET];
-        
-        // Algorithm
-        NSString *algorithm = [FRAOathCode asString:totpOathMechanism.algorithm];
-        [options setObject:[FRASerialization nonNilString:algorithm] forKey:OATH_MECHANISM_ALGORITHM];
-        
-        // Code Length
-        NSString *digitsString = [[NSNumber numberWithUnsignedInteger:totpOathMechanism.codeLength] stringValue];
-        [options setObject:[FRASerialization nonNilString:digitsString] forKey:OATH_MECHANISM_DIGITS];
-        
-        // Period
-        NSString *periodString = [[NSNumber numberWithUnsignedInteger:totpOathMechanism.period] stringValue];
-        [options setObject:[FRASerialization nonNilString:periodString] forKey:OATH_MECHANISM_PERIOD];
-        
-    } else if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
-        FRAPushMechanism *pushMechanism = (FRAPushMechanism *)mechanism;
-        
-        // Secret Key as String
-        [options setObject:[FRASerialization nonNilString:pushMechanism.secret] forKey:PUSH_MECHANISM_SECRET];
-        
-        // Auth Endpoint as String
-        [options setObject:[FRASerialization nonNilString:pushMechanism.authEndpoint] forKey:PUSH_MECHANISM_AUTH_END_POINT];
-        
-        // Version integer as String
-        NSString *versionString = [[NSNumber numberWithInteger:pushMechanism.version] stringValue];
-        [options setObject:[FRASerialization nonNilString:versionString] forKey:PUSH_MECHANISM_VERSION];
-    } else {
-        @throw [FRAError createIllegalStateException:@"Unrecognised class of Mechanism"];
-    }
-    
-    // Convert options to JSON
-    NSString *jsonString;
-    if (![FRASerialization serializeMap:options intoString:&jsonString error:error]) {
+    NSData *encodedOptions = [descriptor encodeOptionsOfMechanism:mechanism error:error];
+    if (!encodedOptions) {
         return NO;
     }
-    [arguments addObject:jsonString];
+    [arguments addObject:encodedOptions];
 
     return [self performStatement:@"insert_mechanism" withValues:arguments error:error];
 }
@@ -232,20 +176,19 @@
 #pragma mark Notification Functions
 
 - (BOOL)insertNotification:(FRANotification *)notification error:(NSError *__autoreleasing *)error {
+    NSArray *arguments = [self insertNotificationArguments:notification error:error];
+    if (!arguments) {
+        return NO;
+    }
+    return [self performStatement:@"insert_notification" withValues:arguments error:error];
+}
+
+- (NSArray *)insertNotificationArguments:(FRANotification *)notification error:(NSError *__autoreleasing *)error {
     NSMutableArray* arguments = [[NSMutableArray alloc] init];
     
     FRAMechanism *parent = notification.parent;
     // mechanismUID
-    NSString *mechanismUID;
-    if ([parent isKindOfClass:[FRAHotpOathMechanism class]] || [parent isKindOfClass:[FRATotpOathMechanism class]]) {
-        mechanismUID = nil;
-    } else if ([parent isKindOfClass:[FRAPushMechanism class]]) {
-        FRAPushMechanism *pushMechanism = (FRAPushMechanism *)parent;
-        mechanismUID = pushMechanism.mechanismUID;
-    } else {
-        @throw [[NSException alloc] initWithName:@"Illegal State" reason:@"Unrecognised class of Mechanism" userInfo:nil];
-    }
-    [arguments addObject:[FRASerialization nonNilString:mechanismUID]];
+    [arguments addObject:[FRASerialization nonNilString:[self mechanismUIDOfMechanism:parent]]];
     
     // timeReceived
     [arguments addObject:[FRASerialization nonNilDate:notification.timeReceived]];
@@ -253,7 +196,7 @@
     // timeExpired
     [arguments addObject:[FRASerialization nonNilDate:notification.timeExpired]];
     
-    // Data Json Map
+    // Data Map
     NSMutableDictionary *dataMap = [[NSMutableDictionary alloc] init];
     
     // Data: Message ID
@@ -263,54 +206,223 @@
     [dataMap setObject:notification.challenge forKey:NOTIFICATION_PUSH_CHALLENGE];
     
     // Data: Time to Live
-    NSString *ttlString = [NSString stringWithFormat:@"%f", notification.timeToLive];
-    [dataMap setObject:ttlString forKey:NOTIFICATION_TIME_TO_LIVE];
+    [dataMap setObject:[NSNumber numberWithDouble:notification.timeToLive] forKey:NOTIFICATION_TIME_TO_LIVE];
 
     // Data: Load Balancer cookie
     [dataMap setObject:notification.loadBalancerCookie forKey:NOTIFICATION_LOAD_BALANCER_COOKIE];
 
-    // Convert map to JSON
-    NSString *jsonString;
-    if (![FRASerialization serializeMap:dataMap intoString:&jsonString error:error]) {
-        return NO;
+    // Convert map to its binary encoding
+    NSData *encodedData = [FRABinarySerialization encodeMap:dataMap schema:FRABinarySchemaNotificationData error:error];
+    if (!encodedData) {
+        return nil;
     }
-    [arguments addObject:jsonString];
+    [arguments addObject:encodedData];
     
-    // pending
-    [arguments addObject:[NSNumber numberWithBool:[notification isPending]]];
+    // pending - an expired notification was never approved or denied, and is recognised as expired from timeExpired
+    [arguments addObject:[NSNumber numberWithBool:[notification isPending] || [notification isExpired]]];
     
     // approved
     [arguments addObject:[NSNumber numberWithBool:[notification isApproved]]];
     
-    return [self performStatement:@"insert_notification" withValues:arguments error:error];
+    return arguments;
+}
+
+- (NSString *)mechanismUIDOfMechanism:(FRAMechanism *)mechanism {
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    if (!descriptor) {
+        @throw [[NSException alloc] initWithName:@"Illegal State" reason:@"Unrecognised class of Mechanism" userInfo:nil];
+    }
+    return [descriptor mechanismUIDOfMechanism:mechanism];
 }
 
 - (BOOL)deleteNotification:(FRANotification *)notification error:(NSError *__autoreleasing *)error {
+    return [self performStatement:@"delete_notification" withValues:[self deleteNotificationArguments:notification] error:error];
+}
+
+- (NSArray *)deleteNotificationArguments:(FRANotification *)notification {
     NSMutableArray *arguments = [[NSMutableArray alloc] init];
     
     FRAMechanism *parent = notification.parent;
     
     // mechanismUID
-    NSString *mechanismUID;
-    if ([parent isKindOfClass:[FRAHotpOathMechanism class]] || [parent isKindOfClass:[FRATotpOathMechanism class]]) {
-        mechanismUID = nil;
-    } else if ([parent isKindOfClass:[FRAPushMechanism class]]) {
-        FRAPushMechanism *pushMechanism = (FRAPushMechanism *)parent;
-        mechanismUID = pushMechanism.mechanismUID;
-    } else {
-        @throw [[NSException alloc] initWithName:@"Illegal State" reason:@"Unrecognised class of Mechanism" userInfo:nil];
-    }
-    [arguments addObject:[FRASerialization nonNilString:mechanismUID]];
+    [arguments addObject:[FRASerialization nonNilString:[self mechanismUIDOfMechanism:parent]]];
     
     // timeReceived
     [arguments addObject:[FRASerialization nonNilDate:notification.timeReceived]];
     
-    return [self performStatement:@"delete_notification" withValues:arguments error:error];
+    return arguments;
 }
 
 - (BOOL)updateNotification:(FRANotification *)notification error:(NSError *__autoreleasing *)error {
     return [self insertNotification:notification error:error];
 }
 
+- (BOOL)updateNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error {
+    if (notifications.count == 0) {
+        return YES;
+    }
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"insert_notification" withError:error];
+    if (sql == nil) {
+        return NO;
+    }
+    
+    // Encode every notification before the transaction is opened, so that it is held for as short a time as possible
+    NSMutableArray<NSArray *> *argumentsList = [[NSMutableArray alloc] initWithCapacity:notifications.count];
+    for (FRANotification *notification in notifications) {
+        NSArray *arguments = [self insertNotificationArguments:notification error:error];
+        if (!arguments) {
+            return NO;
+        }
+        [argumentsList addObject:arguments];
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (database == nil) {
+            return NO;
+        }
+        
+        if (![database beginTransaction]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return NO;
+        }
+        for (NSArray *arguments in argumentsList) {
+            if (![database executeUpdate:sql values:arguments error:error]) {
+                [database rollback];
+                return NO;
+            }
+        }
+        if (![database commit]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            [database rollback];
+            return NO;
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+- (BOOL)deleteNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error {
+    if (notifications.count == 0) {
+        return YES;
+    }
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"delete_notification" withError:error];
+    if (sql == nil) {
+        return NO;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (database == nil) {
+            return NO;
+        }
+        
+        // One transaction for the whole batch, rather than one per notification
+        if (![database beginTransaction]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return NO;
+        }
+        for (FRANotification *notification in notifications) {
+            if (![database executeUpdate:sql values:[self deleteNotificationArguments:notification] error:error]) {
+                [database rollback];
+                return NO;
+            }
+        }
+        if (![database commit]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            [database rollback];
+            return NO;
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+#pragma mark -
+#pragma mark Maintenance Functions
+
+- (BOOL)enableIncrementalVacuumWithError:(NSError *__autoreleasing *)error {
+    NSString *autoVacuumSql = [FRAFMDatabaseConnectionHelper readSchema:@"auto_vacuum_mode" withError:error];
+    NSString *enableSql = [FRAFMDatabaseConnectionHelper readSchema:@"enable_incremental_vacuum" withError:error];
+    if (autoVacuumSql == nil || enableSql == nil) {
+        return NO;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (database == nil) {
+            return NO;
+        }
+        
+        // auto_vacuum can only be changed on an existing database by rebuilding it
+        if ([database intForQuery:autoVacuumSql] != FRAAutoVacuumIncremental && ![database executeStatements:enableSql]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return NO;
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+- (BOOL)incrementalVacuumReclaimingPages:(NSInteger *)reclaimedPages error:(NSError *__autoreleasing *)error {
+    NSString *autoVacuumSql = [FRAFMDatabaseConnectionHelper readSchema:@"auto_vacuum_mode" withError:error];
+    NSString *freelistSql = [FRAFMDatabaseConnectionHelper readSchema:@"freelist_count" withError:error];
+    NSString *vacuumSql = [FRAFMDatabaseConnectionHelper readSchema:@"incremental_vacuum" withError:error];
+    if (autoVacuumSql == nil || freelistSql == nil || vacuumSql == nil) {
+        return NO;
+    }
+    if (reclaimedPages) {
+        *reclaimedPages = 0;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (database == nil) {
+            return NO;
+        }
+        
+        // Nothing can be reclaimed until the database has been converted by enableIncrementalVacuumWithError:
+        if ([database intForQuery:autoVacuumSql] != FRAAutoVacuumIncremental) {
+            return YES;
+        }
+        
+        int freePagesBefore = [database intForQuery:freelistSql];
+        if (![database executeStatements:vacuumSql]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return NO;
+        }
+        int freePagesAfter = [database intForQuery:freelistSql];
+        if (reclaimedPages) {
+            *reclaimedPages = MAX(0, freePagesBefore - freePagesAfter);
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
 
 @end
@@ -19,12 +19,29 @@
 @class FRAIdentityDatabase;
 @class FRAMechanism;
 @class FRANotification;
+@class FRANotificationExpiryQueue;
 
 /*!
  * Root of the Authenticator data model containing a listing of identities and methods for querying them.
+ *
+ * The model may be read and modified from any thread. Changes build a new immutable snapshot which is
+ * published atomically; readers take a reference to the current snapshot without locking and never see a
+ * partially applied change.
  */
 @interface FRAIdentityModel : NSObject
 
+/*!
+ * Revision of the identities snapshot. Incremented each time an identity is added or removed, so callers
+ * can cheaply detect that a previously returned identities array is out of date.
+ */
+@property (atomic, readonly) NSUInteger revision;
+
+/*!
+ * Queue of the pending notifications of every mechanism in the model, which expires each notification when its
+ * time to live runs out.
+ */
+@property (nonatomic, readonly) FRANotificationExpiryQueue *notificationExpiryQueue;
+
 #pragma mark -
 #pragma mark Lifecycle
 
@@ -35,6 +52,10 @@
 
 /*!
  * Gets all of the identities which are stored.
+ *
+ * The returned array is an immutable snapshot which is shared rather than copied; it is not affected by
+ * subsequent changes to the model.
+ *
  * @return The list of identities.
  */
 - (NSArray *)identities;
@@ -85,8 +106,15 @@
 /*!
  * Count of notifications that have not yet been dealt with.
  *
+ * The count is cached and only recalculated after a change has been reported or a pending notification expires.
+ *
  * @return The number of pending notifications.
  */
 - (NSInteger)pendingNotificationsCount;
 
+/*!
+ * Informs the model that the pending notifications count of one of its identities has changed.
+ */
+- (void)pendingNotificationsCountDidChange;
+
 @end
@@ -19,8 +19,10 @@
 #import "FRAIdentityDatabase.h"
 #import "FRAIdentityDatabaseSQLiteOperations.h"
 #import "FRAIdentityModel.h"
+#import "FRAIdentitySnapshotFile.h"
 #import "FRAMechanism.h"
 #import "FRANotification.h"
+#import "FRANotificationExpiryQueue.h"
 #import "FRAModelsFromDatabase.h"
 #import "FRAPushMechanism.h"
 #import "FRAModelObjectProtected.h"
@@ -35,12 +37,30 @@
  */
 @property (strong, nonatomic) FRAIdentityDatabase *database;
 
+/*!
+ * Immutable snapshot of the identities. Replaced (never mutated) by writers while holding the model's lock;
+ * atomic so that readers on any thread can take a reference without locking.
+ */
+@property (atomic, strong) NSArray<FRAIdentity*> *identitiesSnapshot;
+
+/*!
+ * Revision of the identities snapshot, writable internally.
+ */
+@property (atomic, readwrite) NSUInteger revision;
+
 @end
 
 
 @implementation FRAIdentityModel {
     
-    NSMutableArray<FRAIdentity*> *identitiesList;
+    /*! Cached count of pending notifications across all identities. */
+    NSInteger pendingCount;
+    /*! Whether pendingCount must be recalculated before it can be used. */
+    BOOL pendingCountStale;
+    /*! Incremented whenever pendingCount is invalidated, so that a recount racing with a change is discarded. */
+    NSUInteger pendingCountGeneration;
+    /*! Time at which the earliest counted pending notification expires, or nil if none are pending. */
+    NSDate *pendingCountExpiry;
 
 }
 
@@ -50,25 +70,59 @@
 - (instancetype)initWithDatabase:(FRAIdentityDatabase *)database sqlDatabase:(FRAFMDatabaseConnectionHelper *) sql {
     if (self = [super init]) {
         _database = database;
+        // Created before the identities are loaded, so that their pending notifications are queued as they are added
+        _notificationExpiryQueue = [[FRANotificationExpiryQueue alloc] init];
         NSError *error;
-        NSArray<FRAIdentity*> *identities = [FRAModelsFromDatabase allIdentitiesWithDatabase:sql identityDatabase:database identityModel:self error:&error];
+        NSArray<FRAIdentity*> *identities = [self identitiesFromStorage:sql error:&error];
         if (!identities) {
             return nil;
         }
-        identitiesList = [[NSMutableArray alloc] initWithArray:identities];
+        _identitiesSnapshot = [identities copy];
+        _revision = 0;
+        pendingCountStale = YES;
     }
     return self;
 }
 
+/*!
+ * Reads identities and mechanisms from the snapshot file if there is a valid one, and otherwise from the database,
+ * after which the snapshot is rewritten. HOTP counters and notifications are always read from the database.
+ */
+- (NSArray<FRAIdentity*> *)identitiesFromStorage:(FRAFMDatabaseConnectionHelper *)sql error:(NSError *__autoreleasing *)error {
+    FRAIdentitySnapshotFile *snapshotFile = self.database.snapshotFile;
+    NSError *snapshotError;
+    NSArray<FRAIdentity*> *identities = [snapshotFile identitiesWithDatabase:self.database identityModel:self error:&snapshotError];
+    if (identities && ![FRAModelsFromDatabase restoreOptionsChangingWithUseWithDatabase:sql toIdentities:identities error:&snapshotError]) {
+        // The snapshot does not match the database, which is read instead
+        identities = nil;
+    }
+    if (identities) {
+        if (![FRAModelsFromDatabase addNotificationsWithDatabase:sql toIdentities:identities identityDatabase:self.database identityModel:self error:error]) {
+            return nil;
+        }
+        [FRAModelsFromDatabase markStored:identities];
+        return identities;
+    }
+    
+    if (snapshotFile) {
+        NSLog(@"Reading identities from the database: %@", snapshotError);
+    }
+    identities = [FRAModelsFromDatabase allIdentitiesWithDatabase:sql identityDatabase:self.database identityModel:self error:error];
+    if (identities) {
+        [snapshotFile writeIdentities:identities];
+    }
+    return identities;
+}
+
 #pragma mark -
 #pragma mark Identity Functions
 
 - (NSArray *)identities {
-    return [[NSArray alloc] initWithArray:identitiesList];
+    return self.identitiesSnapshot;
 }
 
 - (FRAIdentity *)identityWithIssuer:(NSString *)issuer accountName:(NSString *)accountName {
-    for (FRAIdentity *identity in identitiesList) {
+    for (FRAIdentity *identity in self.identitiesSnapshot) {
         if ([identity.issuer isEqualToString:issuer] && [identity.accountName isEqualToString:accountName]) {
             return identity;
         }
@@ -77,24 +131,42 @@
 }
 
 - (BOOL)addIdentity:(FRAIdentity *)identity error:(NSError *__autoreleasing *)error {
-    [identitiesList addObject:identity];
+    @synchronized (self) {
+        [self publishIdentities:[self.identitiesSnapshot arrayByAddingObject:identity]];
+    }
     return [self.database insertIdentity:identity error:error];
 }
 
 - (BOOL)removeIdentity:(FRAIdentity *)identity error:(NSError *__autoreleasing *)error {
-    [identitiesList removeObject:identity];
+    @synchronized (self) {
+        NSMutableArray<FRAIdentity*> *identities = [self.identitiesSnapshot mutableCopy];
+        [identities removeObject:identity];
+        [self publishIdentities:identities];
+    }
     return [self.database deleteIdentity:identity error:error];
 }
 
 - (BOOL)isEmpty {
-    return self.identities.count == 0;
+    return self.identitiesSnapshot.count == 0;
+}
+
+/*!
+ * Replaces the current identities snapshot. Snapshots already handed out to callers are never modified.
+ *
+ * Must be called while holding the lock on self.
+ */
+- (void)publishIdentities:(NSArray<FRAIdentity*> *)identities {
+    self.identitiesSnapshot = [identities copy];
+    self.revision++;
+    pendingCountStale = YES;
+    pendingCountGeneration++;
 }
 
 #pragma mark -
 #pragma mark Mechanism Functions
 
 - (FRAMechanism *)mechanismWithId:(NSString *)uid {
-    for (FRAIdentity *identity in identitiesList) {
+    for (FRAIdentity *identity in self.identitiesSnapshot) {
         for (FRAMechanism *mechanism in [identity mechanisms]) {
             if ([mechanism isKindOfClass:[FRAPushMechanism class]] && [((FRAPushMechanism *)mechanism).mechanismUID isEqualToString: uid]) {
                 return mechanism;
@@ -108,11 +180,40 @@
 #pragma mark Notification Functions
 
 - (NSInteger)pendingNotificationsCount {
+    NSUInteger generation;
+    @synchronized (self) {
+        if (!pendingCountStale && !(pendingCountExpiry && [pendingCountExpiry timeIntervalSinceNow] <= 0)) {
+            return pendingCount;
+        }
+        generation = pendingCountGeneration;
+    }
+    
+    // Recount without holding the lock, as identities take their own locks and report changes back up to the model
     NSInteger count = 0;
-    for (FRAIdentity *identity in self.identities) {
+    NSDate *expiry = nil;
+    for (FRAIdentity *identity in self.identitiesSnapshot) {
         count += [identity pendingNotificationsCount];
+        NSDate *identityExpiry = [identity nextPendingNotificationExpiry];
+        if (identityExpiry && (!expiry || [identityExpiry compare:expiry] == NSOrderedAscending)) {
+            expiry = identityExpiry;
+        }
+    }
+    
+    @synchronized (self) {
+        if (generation == pendingCountGeneration) {
+            pendingCount = count;
+            pendingCountExpiry = expiry;
+            pendingCountStale = NO;
+        }
     }
     return count;
 }
 
+- (void)pendingNotificationsCountDidChange {
+    @synchronized (self) {
+        pendingCountStale = YES;
+        pendingCountGeneration++;
+    }
+}
+
 @end
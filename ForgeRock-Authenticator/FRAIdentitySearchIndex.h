@@ -0,0 +1,96 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRAIdentity;
+@class FRAIdentityModel;
+
+/*!
+ * In-memory index over the issuer and account name of identities, used to filter the accounts list as the user
+ * types.
+ *
+ * Text is case and diacritic folded once, when an identity is indexed. A query matches anywhere in the issuer or in
+ * the account name. Queries of fewer than three characters are answered from a prefix trie of the text following
+ * every position; longer queries take candidates from trigram postings which are then verified. A query which
+ * extends the previous query only re-examines the previous results.
+ *
+ * When created with an identity model the index is kept up to date from FRAIdentityDatabaseChangesCoalescedNotification
+ * events. The index is not thread safe and should only be used from the main thread.
+ */
+@interface FRAIdentitySearchIndex : NSObject
+
+/*!
+ * The number of identities currently indexed.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Creates an empty index which is maintained explicitly using addIdentity: and removeIdentity:.
+ *
+ * @return The initialized index.
+ */
+- (instancetype)init;
+
+/*!
+ * Creates an index of the identities in the model which tracks subsequent changes to the model.
+ *
+ * @param identityModel The identity model to index.
+ * @return The initialized index.
+ */
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)identityModel;
+
+#pragma mark -
+#pragma mark Index Functions
+
+/*!
+ * Adds an identity to the index. Adding an identity which is already indexed has no effect.
+ *
+ * @param identity The identity to index.
+ */
+- (void)addIdentity:(FRAIdentity *)identity;
+
+/*!
+ * Removes an identity from the index. Removing an identity which is not indexed has no effect.
+ *
+ * @param identity The identity to remove.
+ */
+- (void)removeIdentity:(FRAIdentity *)identity;
+
+/*!
+ * Adds and removes the identities reported in the userInfo of a database change notification. Changes which have
+ * already been applied are ignored, so observers of the same notification can call this to ensure the index is up
+ * to date before they query it.
+ *
+ * @param stateChanges The userInfo of a FRAIdentityDatabaseChangedNotification or
+ * FRAIdentityDatabaseChangesCoalescedNotification.
+ */
+- (void)applyStateChanges:(NSDictionary *)stateChanges;
+
+#pragma mark -
+#pragma mark Query Functions
+
+/*!
+ * Finds the identities whose issuer or account name matches the query.
+ *
+ * @param query The text entered by the user. Leading and trailing whitespace is ignored.
+ * @return The matching identities, or all indexed identities if the query is empty.
+ */
+- (NSSet<FRAIdentity *> *)identitiesMatchingQuery:(NSString *)query;
+
+@end
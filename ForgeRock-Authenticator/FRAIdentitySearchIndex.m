@@ -0,0 +1,300 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRAIdentity.h"
+#import "FRAIdentityDatabase.h"
+#import "FRAIdentityModel.h"
+#import "FRAIdentitySearchIndex.h"
+
+/*! Queries at least this long are answered from trigram postings rather than the prefix trie. */
+static const NSUInteger FRASearchTrigramLength = 3;
+
+/*! Separates the issuer from the account name in the folded search text, so matches cannot span both. */
+static NSString * const FRASearchFieldSeparator = @"\n";
+
+/*!
+ * A node in the prefix trie, holding every identity whose text contains the path to this node.
+ */
+@interface FRASearchTrieNode : NSObject
+
+@property (strong, nonatomic, readonly) NSMutableDictionary<NSNumber *, FRASearchTrieNode *> *children;
+@property (strong, nonatomic, readonly) NSMutableSet<FRAIdentity *> *identities;
+
+@end
+
+@implementation FRASearchTrieNode
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _children = [[NSMutableDictionary alloc] init];
+        _identities = [[NSMutableSet alloc] init];
+    }
+    return self;
+}
+
+@end
+
+
+@implementation FRAIdentitySearchIndex {
+    
+    /*! Root of the prefix trie. */
+    FRASearchTrieNode *root;
+    /*! Identities containing each trigram of folded text. */
+    NSMutableDictionary<NSString *, NSMutableSet<FRAIdentity *> *> *trigramPostings;
+    /*! Folded issuer and account name of each indexed identity, keyed by identity. */
+    NSMapTable<FRAIdentity *, NSString *> *searchText;
+    /*! Folded text of the last trigram query, or nil if its results are no longer valid. */
+    NSString *lastQuery;
+    /*! Results of the last trigram query. */
+    NSSet<FRAIdentity *> *lastResults;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)init {
+    if (self = [super init]) {
+        root = [[FRASearchTrieNode alloc] init];
+        trigramPostings = [[NSMutableDictionary alloc] init];
+        searchText = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    return self;
+}
+
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)identityModel {
+    if (self = [self init]) {
+        for (FRAIdentity *identity in [identityModel identities]) {
+            [self addIdentity:identity];
+        }
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(handleIdentityDatabaseChanged:)
+                                                     name:FRAIdentityDatabaseChangesCoalescedNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark -
+#pragma mark Index Functions
+
+- (NSUInteger)count {
+    return searchText.count;
+}
+
+- (void)addIdentity:(FRAIdentity *)identity {
+    if ([searchText objectForKey:identity]) {
+        return;
+    }
+    NSArray<NSString *> *fields = @[[self foldText:identity.issuer], [self foldText:identity.accountName]];
+    [searchText setObject:[fields componentsJoinedByString:FRASearchFieldSeparator] forKey:identity];
+    
+    for (FRASearchTrieNode *node in [self trieNodesForFields:fields createIfMissing:YES]) {
+        [node.identities addObject:identity];
+    }
+    for (NSString *trigram in [self trigramsForFields:fields]) {
+        NSMutableSet<FRAIdentity *> *postings = trigramPostings[trigram];
+        if (!postings) {
+            postings = [[NSMutableSet alloc] init];
+            trigramPostings[trigram] = postings;
+        }
+        [postings addObject:identity];
+    }
+    lastQuery = nil;
+}
+
+- (void)removeIdentity:(FRAIdentity *)identity {
+    NSString *text = [searchText objectForKey:identity];
+    if (!text) {
+        return;
+    }
+    NSArray<NSString *> *fields = [text componentsSeparatedByString:FRASearchFieldSeparator];
+    [searchText removeObjectForKey:identity];
+    
+    for (FRASearchTrieNode *node in [self trieNodesForFields:fields createIfMissing:NO]) {
+        [node.identities removeObject:identity];
+    }
+    [self pruneTrieForFields:fields];
+    for (NSString *trigram in [self trigramsForFields:fields]) {
+        NSMutableSet<FRAIdentity *> *postings = trigramPostings[trigram];
+        [postings removeObject:identity];
+        if (postings.count == 0) {
+            [trigramPostings removeObjectForKey:trigram];
+        }
+    }
+    lastQuery = nil;
+}
+
+- (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
+    [self applyStateChanges:notification.userInfo];
+}
+
+- (void)applyStateChanges:(NSDictionary *)stateChanges {
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationRemovedItems]) {
+        if ([item isKindOfClass:[FRAIdentity class]]) {
+            [self removeIdentity:item];
+        }
+    }
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationAddedItems]) {
+        if ([item isKindOfClass:[FRAIdentity class]]) {
+            [self addIdentity:item];
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Query Functions
+
+- (NSSet<FRAIdentity *> *)identitiesMatchingQuery:(NSString *)query {
+    NSString *foldedQuery = [self foldText:[query stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]];
+    
+    if (foldedQuery.length == 0) {
+        return [NSSet setWithArray:[[searchText keyEnumerator] allObjects]];
+    }
+    
+    if (foldedQuery.length < FRASearchTrigramLength) {
+        FRASearchTrieNode *node = root;
+        for (NSUInteger i = 0; i < foldedQuery.length && node; i++) {
+            node = node.children[@([foldedQuery characterAtIndex:i])];
+        }
+        return node ? [node.identities copy] : [NSSet set];
+    }
+    
+    // Results for a longer query are always a subset of the results for the query it extends
+    id<NSFastEnumeration> candidates;
+    if (lastQuery && [foldedQuery hasPrefix:lastQuery]) {
+        candidates = lastResults;
+    } else {
+        candidates = [self smallestPostingsForQuery:foldedQuery];
+    }
+    
+    NSMutableSet<FRAIdentity *> *results = [[NSMutableSet alloc] init];
+    for (FRAIdentity *identity in candidates) {
+        if ([[searchText objectForKey:identity] rangeOfString:foldedQuery options:NSLiteralSearch].location != NSNotFound) {
+            [results addObject:identity];
+        }
+    }
+    lastQuery = foldedQuery;
+    lastResults = results;
+    return results;
+}
+
+#pragma mark -
+#pragma mark FRAIdentitySearchIndex (private)
+
+/*!
+ * The posting list of the rarest trigram in the query, or an empty set if any trigram does not occur.
+ */
+- (NSSet<FRAIdentity *> *)smallestPostingsForQuery:(NSString *)foldedQuery {
+    NSSet<FRAIdentity *> *smallest = nil;
+    for (NSString *trigram in [self trigramsForFields:@[foldedQuery]]) {
+        NSSet<FRAIdentity *> *postings = trigramPostings[trigram];
+        if (!postings) {
+            return [NSSet set];
+        }
+        if (!smallest || postings.count < smallest.count) {
+            smallest = postings;
+        }
+    }
+    return smallest ? smallest : [NSSet set];
+}
+
+- (NSString *)foldText:(NSString *)text {
+    if (!text) {
+        return @"";
+    }
+    return [text stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch locale:nil];
+}
+
+/*!
+ * The text following each position of the fields, up to the depth of the trie, so that the trie matches short
+ * queries anywhere in the text just as the trigram postings do for longer ones.
+ */
+- (NSSet<NSString *> *)substringsForFields:(NSArray<NSString *> *)fields {
+    NSMutableSet<NSString *> *substrings = [[NSMutableSet alloc] init];
+    for (NSString *field in fields) {
+        for (NSUInteger i = 0; i < field.length; i++) {
+            [substrings addObject:[field substringWithRange:NSMakeRange(i, MIN(field.length - i, FRASearchTrigramLength - 1))]];
+        }
+    }
+    return substrings;
+}
+
+/*!
+ * The distinct trie nodes visited by the substrings of the fields. Only nodes for prefixes shorter than the trigram
+ * length are needed, as longer queries are answered from trigram postings.
+ */
+- (NSArray<FRASearchTrieNode *> *)trieNodesForFields:(NSArray<NSString *> *)fields createIfMissing:(BOOL)create {
+    NSHashTable<FRASearchTrieNode *> *nodes = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    for (NSString *substring in [self substringsForFields:fields]) {
+        FRASearchTrieNode *node = root;
+        NSUInteger depth = MIN(substring.length, FRASearchTrigramLength - 1);
+        for (NSUInteger i = 0; i < depth; i++) {
+            NSNumber *key = @([substring characterAtIndex:i]);
+            FRASearchTrieNode *child = node.children[key];
+            if (!child) {
+                if (!create) {
+                    break;
+                }
+                child = [[FRASearchTrieNode alloc] init];
+                node.children[key] = child;
+            }
+            node = child;
+            [nodes addObject:node];
+        }
+    }
+    return [nodes allObjects];
+}
+
+/*!
+ * Removes trie nodes on the paths of the fields' substrings which no longer hold any identities.
+ */
+- (void)pruneTrieForFields:(NSArray<NSString *> *)fields {
+    for (NSString *substring in [self substringsForFields:fields]) {
+        FRASearchTrieNode *node = root;
+        NSUInteger depth = MIN(substring.length, FRASearchTrigramLength - 1);
+        for (NSUInteger i = 0; i < depth; i++) {
+            NSNumber *key = @([substring characterAtIndex:i]);
+            FRASearchTrieNode *child = node.children[key];
+            if (!child) {
+                break;
+            }
+            if (child.identities.count == 0) {
+                [node.children removeObjectForKey:key];
+                break;
+            }
+            node = child;
+        }
+    }
+}
+
+- (NSSet<NSString *> *)trigramsForFields:(NSArray<NSString *> *)fields {
+    NSMutableSet<NSString *> *trigrams = [[NSMutableSet alloc] init];
+    for (NSString *field in fields) {
+        for (NSUInteger i = 0; i + FRASearchTrigramLength <= field.length; i++) {
+            [trigrams addObject:[field substringWithRange:NSMakeRange(i, FRASearchTrigramLength)]];
+        }
+    }
+    return trigrams;
+}
+
+@end
@@ -0,0 +1,105 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRADatabaseConfiguration;
+@class FRAIdentity;
+@class FRAIdentityDatabase;
+@class FRAIdentityModel;
+@class FRAMechanism;
+
+/*!
+ * Binary snapshot of every stored identity and mechanism, read at launch in place of the SQL queries, JSON and
+ * secret decoding which would otherwise rebuild them.
+ *
+ * The file is a versioned header, a table of fixed size identity records, a table of fixed size mechanism records
+ * and a region of string and secret bytes which the records refer to by offset and length. Mechanism options are
+ * held in the binary encoding of their FRAMechanismDescriptor. The file is memory mapped and checksummed as a
+ * whole, and any file which fails validation is ignored.
+ *
+ * The database remains the source of truth. The snapshot is removed before each change to identities or mechanisms
+ * is committed and rewritten once it has been, so a crash in between leaves no snapshot rather than a stale one,
+ * and the model falls back to reading the database. Options which change with every code generated, such as HOTP
+ * counters, are not held in the snapshot and are read from the database instead.
+ *
+ * The snapshot holds the same secrets as the database, so is written with the data protection class of the database
+ * file and is excluded from backups.
+ */
+@interface FRAIdentitySnapshotFile : NSObject
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param configuration The configuration which locates the snapshot file.
+ * @return The initialized snapshot file.
+ */
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)configuration;
+
+/*!
+ * Init method.
+ *
+ * @param path The location of the snapshot file.
+ * @return The initialized snapshot file.
+ */
+- (instancetype)initWithPath:(NSString *)path;
+
+#pragma mark -
+#pragma mark Snapshot Functions
+
+/*!
+ * Rebuilds identities and their mechanisms from the snapshot. The objects returned are not yet marked as stored,
+ * so that notifications can be added to them without being written back to the database. Options which change
+ * with use, such as HOTP counters, are left at their initial values for the caller to restore from the database.
+ *
+ * @param database Assigned to the model objects created.
+ * @param identityModel The identity model which will contain the identities.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The identities, or nil if there is no valid snapshot.
+ */
+- (NSArray<FRAIdentity *> *)identitiesWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Removes the snapshot and drops any write of identities from before the change. Called before a change is
+ * committed to the database.
+ */
+- (void)invalidate;
+
+/*!
+ * Encodes the stored identities and mechanisms and writes them to the snapshot in the background. Writes requested
+ * while one is waiting to start are coalesced into a single write of the latest identities. Called once a change
+ * has been committed to the database.
+ *
+ * @param identities The identities of the identity model.
+ */
+- (void)writeIdentities:(NSArray<FRAIdentity *> *)identities;
+
+/*!
+ * Waits for any write in progress to finish.
+ */
+- (void)waitUntilWritten;
+
+/*!
+ * Whether an update of the mechanism changes what is held in the snapshot.
+ *
+ * @param mechanism The mechanism being updated.
+ * @return NO if the update can be committed to the database without touching the snapshot.
+ */
+- (BOOL)recordsUpdatesOfMechanism:(FRAMechanism *)mechanism;
+
+@end
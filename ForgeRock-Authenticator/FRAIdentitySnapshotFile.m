@@ -0,0 +1,413 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <unistd.h>
+#include <zlib.h>
+
+#import "FRADatabaseConfiguration.h"
+#import "FRAError.h"
+#import "FRAIdentity.h"
+#import "FRAIdentitySnapshotFile.h"
+#import "FRAMechanismDescriptor.h"
+#import "FRAModelObjectProtected.h"
+
+/*! The snapshot is written in the device's byte order; it never leaves the device. */
+static const uint32_t FRAIdentitySnapshotMagic = 0x534E5246; // "FRNS"
+static const uint32_t FRAIdentitySnapshotVersion = 3;
+/*! Marks a nil string or secret. */
+static const uint32_t FRAIdentitySnapshotNil = UINT32_MAX;
+
+/*!
+ * A range of the bytes region.
+ */
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} FRAIdentitySnapshotBytes;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    /*! CRC-32 of everything after the header. */
+    uint32_t checksum;
+    uint32_t reserved;
+    uint64_t length;
+    uint32_t identityCount;
+    uint32_t identityTableOffset;
+    uint32_t mechanismCount;
+    uint32_t mechanismTableOffset;
+    uint32_t bytesOffset;
+    uint32_t bytesLength;
+} FRAIdentitySnapshotHeader;
+
+typedef struct {
+    FRAIdentitySnapshotBytes issuer;
+    FRAIdentitySnapshotBytes accountName;
+    FRAIdentitySnapshotBytes image;
+    FRAIdentitySnapshotBytes backgroundColor;
+    /*! The identity's mechanisms are consecutive records of the mechanism table. */
+    uint32_t firstMechanism;
+    uint32_t mechanismCount;
+} FRAIdentitySnapshotIdentity;
+
+typedef struct {
+    /*! The stored type name, which selects the FRAMechanismDescriptor that decodes the options. */
+    FRAIdentitySnapshotBytes type;
+    int32_t version;
+    uint32_t reserved;
+    FRAIdentitySnapshotBytes mechanismUID;
+    /*! The options as encoded by the descriptor, without those which change with use such as HOTP counters. */
+    FRAIdentitySnapshotBytes options;
+} FRAIdentitySnapshotMechanism;
+
+@implementation FRAIdentitySnapshotFile {
+    
+    FRADatabaseConfiguration *configuration;
+    NSString *path;
+    /*! Encodes and writes snapshots in the background. */
+    dispatch_queue_t writeQueue;
+    /*! Incremented by each invalidation, so that writes of identities from before it are dropped. */
+    NSUInteger generation;
+    /*! The latest identities waiting to be written, along with the generation they were written in. */
+    NSArray<FRAIdentity *> *pendingIdentities;
+    NSUInteger pendingGeneration;
+    /*! Whether a write of pendingIdentities has been queued. */
+    BOOL writeScheduled;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)aConfiguration {
+    if (self = [super init]) {
+        configuration = aConfiguration;
+        writeQueue = dispatch_queue_create("org.forgerock.authenticator.snapshot", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (instancetype)initWithPath:(NSString *)aPath {
+    if (self = [super init]) {
+        path = aPath;
+        writeQueue = dispatch_queue_create("org.forgerock.authenticator.snapshot", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Snapshot Functions
+
+- (NSArray<FRAIdentity *> *)identitiesWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error {
+    NSString *snapshotPath;
+    @synchronized (self) {
+        snapshotPath = [self pathWithError:error];
+    }
+    if (!snapshotPath) {
+        return nil;
+    }
+    NSData *mapping = [NSData dataWithContentsOfFile:snapshotPath options:NSDataReadingMappedAlways error:error];
+    if (!mapping) {
+        return nil;
+    }
+    if (![self isValidSnapshot:mapping]) {
+        if (error) {
+            *error = [FRAError createErrorForFilePath:snapshotPath reason:@"Invalid identity snapshot"];
+        }
+        return nil;
+    }
+    
+    const uint8_t *base = mapping.bytes;
+    const FRAIdentitySnapshotHeader *header = (const FRAIdentitySnapshotHeader *)base;
+    const FRAIdentitySnapshotIdentity *identityRecords = (const FRAIdentitySnapshotIdentity *)(base + header->identityTableOffset);
+    const FRAIdentitySnapshotMechanism *mechanismRecords = (const FRAIdentitySnapshotMechanism *)(base + header->mechanismTableOffset);
+    const uint8_t *bytes = base + header->bytesOffset;
+    
+    NSMutableArray<FRAIdentity *> *identities = [[NSMutableArray alloc] initWithCapacity:header->identityCount];
+    for (uint32_t i = 0; i < header->identityCount; i++) {
+        const FRAIdentitySnapshotIdentity *record = &identityRecords[i];
+        NSString *image = [self stringWithBytes:record->image in:bytes];
+        FRAIdentity *identity = [FRAIdentity identityWithDatabase:database
+                                                    identityModel:identityModel
+                                                      accountName:[self stringWithBytes:record->accountName in:bytes]
+                                                           issuer:[self stringWithBytes:record->issuer in:bytes]
+                                                            image:image ? [[NSURL alloc] initWithString:image] : nil
+                                                  backgroundColor:[self stringWithBytes:record->backgroundColor in:bytes]];
+        for (uint32_t m = record->firstMechanism; m < record->firstMechanism + record->mechanismCount; m++) {
+            FRAMechanism *mechanism = [self mechanismWithRecord:&mechanismRecords[m] bytes:bytes database:database identityModel:identityModel];
+            if (!mechanism || ![identity addMechanism:mechanism error:error]) {
+                if (error && !mechanism) {
+                    *error = [FRAError createErrorForFilePath:snapshotPath reason:@"Unknown mechanism in identity snapshot"];
+                }
+                return nil;
+            }
+        }
+        [identities addObject:identity];
+    }
+    return identities;
+}
+
+- (void)invalidate {
+    @synchronized (self) {
+        generation++;
+        NSString *snapshotPath = [self pathWithError:nil];
+        if (snapshotPath && unlink([snapshotPath fileSystemRepresentation]) != 0 && errno != ENOENT) {
+            NSLog(@"Could not remove identity snapshot: %s", strerror(errno));
+        }
+    }
+}
+
+- (void)writeIdentities:(NSArray<FRAIdentity *> *)identities {
+    @synchronized (self) {
+        pendingIdentities = [identities copy];
+        pendingGeneration = generation;
+        if (writeScheduled) {
+            // The queued write picks up the latest identities
+            return;
+        }
+        writeScheduled = YES;
+    }
+    dispatch_async(writeQueue, ^{
+        [self writePendingIdentities];
+    });
+}
+
+- (void)waitUntilWritten {
+    dispatch_sync(writeQueue, ^{});
+}
+
+- (BOOL)recordsUpdatesOfMechanism:(FRAMechanism *)mechanism {
+    // Options which change with use are left to the database, and updates of such mechanisms change nothing else
+    return ![FRAMechanismDescriptor descriptorForMechanism:mechanism].hasOptionsChangingWithUse;
+}
+
+/*!
+ * Encodes and writes the latest identities, unless the snapshot has been invalidated since. Only called on the
+ * write queue.
+ */
+- (void)writePendingIdentities {
+    NSArray<FRAIdentity *> *identities;
+    NSUInteger identitiesGeneration;
+    @synchronized (self) {
+        identities = pendingIdentities;
+        identitiesGeneration = pendingGeneration;
+        pendingIdentities = nil;
+        writeScheduled = NO;
+    }
+    NSData *snapshot = [self encodeIdentities:identities];
+    @synchronized (self) {
+        if (identitiesGeneration != generation) {
+            // A newer change is being committed, after which the identities are written again
+            return;
+        }
+        NSError *error;
+        NSString *snapshotPath = [self pathWithError:&error];
+        if (!snapshotPath || ![snapshot writeToFile:snapshotPath options:NSDataWritingAtomic | [self fileProtection] error:&error]) {
+            NSLog(@"Could not write identity snapshot: %@", error);
+            return;
+        }
+        // Rebuilt from the database when missing, so there is no need for backups to hold another copy of the secrets
+        if (![[NSURL fileURLWithPath:snapshotPath] setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:&error]) {
+            NSLog(@"Could not exclude identity snapshot from backups: %@", error);
+        }
+    }
+}
+
+/*!
+ * The snapshot holds the same secrets as the database, so is given the same data protection class as the database
+ * file.
+ */
+- (NSDataWritingOptions)fileProtection {
+    NSString *databasePath = [configuration getDatabasePathWithError:nil];
+    NSString *protection = databasePath ? [[NSFileManager defaultManager] attributesOfItemAtPath:databasePath error:nil][NSFileProtectionKey] : nil;
+    if ([protection isEqualToString:NSFileProtectionComplete]) {
+        return NSDataWritingFileProtectionComplete;
+    }
+    if ([protection isEqualToString:NSFileProtectionCompleteUnlessOpen]) {
+        return NSDataWritingFileProtectionCompleteUnlessOpen;
+    }
+    return NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication;
+}
+
+/*!
+ * Resolves the location of the snapshot file. Only called while holding the lock on self.
+ */
+- (NSString *)pathWithError:(NSError *__autoreleasing *)error {
+    if (!path) {
+        path = [configuration getIdentitySnapshotPathWithError:error];
+    }
+    return path;
+}
+
+#pragma mark -
+#pragma mark Encoding Functions
+
+- (NSData *)encodeIdentities:(NSArray<FRAIdentity *> *)identities {
+    NSMutableData *identityTable = [[NSMutableData alloc] init];
+    NSMutableData *mechanismTable = [[NSMutableData alloc] init];
+    NSMutableData *bytes = [[NSMutableData alloc] init];
+    uint32_t mechanismCount = 0;
+    
+    for (FRAIdentity *identity in identities) {
+        if (![identity isStored]) {
+            continue;
+        }
+        FRAIdentitySnapshotIdentity record;
+        record.issuer = [self appendString:identity.issuer to:bytes];
+        record.accountName = [self appendString:identity.accountName to:bytes];
+        record.image = [self appendString:[identity.image absoluteString] to:bytes];
+        record.backgroundColor = [self appendString:identity.backgroundColor to:bytes];
+        record.firstMechanism = mechanismCount;
+        record.mechanismCount = 0;
+        for (FRAMechanism *mechanism in identity.mechanisms) {
+            FRAIdentitySnapshotMechanism mechanismRecord;
+            if (![mechanism isStored] || ![self encodeMechanism:mechanism into:&mechanismRecord bytes:bytes]) {
+                continue;
+            }
+            [mechanismTable appendBytes:&mechanismRecord length:sizeof(mechanismRecord)];
+            mechanismCount++;
+            record.mechanismCount++;
+        }
+        [identityTable appendBytes:&record length:sizeof(record)];
+    }
+    
+    FRAIdentitySnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FRAIdentitySnapshotMagic;
+    header.version = FRAIdentitySnapshotVersion;
+    header.identityCount = (uint32_t)(identityTable.length / sizeof(FRAIdentitySnapshotIdentity));
+    header.identityTableOffset = sizeof(header);
+    header.mechanismCount = mechanismCount;
+    header.mechanismTableOffset = header.identityTableOffset + (uint32_t)identityTable.length;
+    header.bytesOffset = header.mechanismTableOffset + (uint32_t)mechanismTable.length;
+    header.bytesLength = (uint32_t)bytes.length;
+    header.length = header.bytesOffset + bytes.length;
+    
+    NSMutableData *snapshot = [[NSMutableData alloc] initWithCapacity:(NSUInteger)header.length];
+    [snapshot appendBytes:&header length:sizeof(header)];
+    [snapshot appendData:identityTable];
+    [snapshot appendData:mechanismTable];
+    [snapshot appendData:bytes];
+    uint32_t checksum = (uint32_t)crc32(0, (const uint8_t *)snapshot.bytes + sizeof(header), (uInt)(snapshot.length - sizeof(header)));
+    [snapshot replaceBytesInRange:NSMakeRange(offsetof(FRAIdentitySnapshotHeader, checksum), sizeof(checksum)) withBytes:&checksum];
+    return snapshot;
+}
+
+- (BOOL)encodeMechanism:(FRAMechanism *)mechanism into:(FRAIdentitySnapshotMechanism *)record bytes:(NSMutableData *)bytes {
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    NSData *options = [descriptor encodeOptionsOfMechanism:mechanism includingOptionsChangingWithUse:NO error:nil];
+    if (!options) {
+        return NO;
+    }
+    memset(record, 0, sizeof(*record));
+    record->type = [self appendString:descriptor.type to:bytes];
+    record->version = (int32_t)mechanism.version;
+    record->mechanismUID = [self appendString:[descriptor mechanismUIDOfMechanism:mechanism] to:bytes];
+    record->options = [self appendData:options to:bytes];
+    return YES;
+}
+
+- (FRAIdentitySnapshotBytes)appendString:(NSString *)string to:(NSMutableData *)bytes {
+    return [self appendData:[string dataUsingEncoding:NSUTF8StringEncoding] to:bytes];
+}
+
+- (FRAIdentitySnapshotBytes)appendData:(NSData *)data to:(NSMutableData *)bytes {
+    FRAIdentitySnapshotBytes range = { (uint32_t)bytes.length, data ? (uint32_t)data.length : FRAIdentitySnapshotNil };
+    if (data) {
+        [bytes appendData:data];
+    }
+    return range;
+}
+
+#pragma mark -
+#pragma mark Decoding Functions
+
+/*!
+ * Checks the header, the checksum and that every record only refers to bytes and mechanisms within the snapshot,
+ * so that the records can then be read in place without further checks.
+ */
+- (BOOL)isValidSnapshot:(NSData *)mapping {
+    if (mapping.length < sizeof(FRAIdentitySnapshotHeader)) {
+        return NO;
+    }
+    const uint8_t *base = mapping.bytes;
+    const FRAIdentitySnapshotHeader *header = (const FRAIdentitySnapshotHeader *)base;
+    if (header->magic != FRAIdentitySnapshotMagic || header->version != FRAIdentitySnapshotVersion || header->length != mapping.length) {
+        return NO;
+    }
+    uint64_t identityTableEnd = (uint64_t)header->identityTableOffset + (uint64_t)header->identityCount * sizeof(FRAIdentitySnapshotIdentity);
+    uint64_t mechanismTableEnd = (uint64_t)header->mechanismTableOffset + (uint64_t)header->mechanismCount * sizeof(FRAIdentitySnapshotMechanism);
+    if (header->identityTableOffset < sizeof(*header) || header->identityTableOffset % 8 != 0 || header->mechanismTableOffset % 8 != 0
+            || identityTableEnd > header->mechanismTableOffset || mechanismTableEnd > header->bytesOffset
+            || (uint64_t)header->bytesOffset + header->bytesLength != mapping.length) {
+        return NO;
+    }
+    uint32_t checksum = (uint32_t)crc32(0, base + sizeof(*header), (uInt)(mapping.length - sizeof(*header)));
+    if (checksum != header->checksum) {
+        return NO;
+    }
+    
+    const FRAIdentitySnapshotIdentity *identityRecords = (const FRAIdentitySnapshotIdentity *)(base + header->identityTableOffset);
+    for (uint32_t i = 0; i < header->identityCount; i++) {
+        const FRAIdentitySnapshotIdentity *record = &identityRecords[i];
+        if (![self isValidBytes:record->issuer length:header->bytesLength] || ![self isValidBytes:record->accountName length:header->bytesLength]
+                || ![self isValidBytes:record->image length:header->bytesLength] || ![self isValidBytes:record->backgroundColor length:header->bytesLength]
+                || (uint64_t)record->firstMechanism + record->mechanismCount > header->mechanismCount) {
+            return NO;
+        }
+    }
+    const FRAIdentitySnapshotMechanism *mechanismRecords = (const FRAIdentitySnapshotMechanism *)(base + header->mechanismTableOffset);
+    for (uint32_t m = 0; m < header->mechanismCount; m++) {
+        const FRAIdentitySnapshotMechanism *record = &mechanismRecords[m];
+        if (![self isValidBytes:record->type length:header->bytesLength] || ![self isValidBytes:record->mechanismUID length:header->bytesLength]
+                || ![self isValidBytes:record->options length:header->bytesLength]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL)isValidBytes:(FRAIdentitySnapshotBytes)range length:(uint32_t)length {
+    return range.length == FRAIdentitySnapshotNil || (uint64_t)range.offset + range.length <= length;
+}
+
+- (NSData *)dataWithBytes:(FRAIdentitySnapshotBytes)range in:(const uint8_t *)bytes {
+    if (range.length == FRAIdentitySnapshotNil) {
+        return nil;
+    }
+    // Copied, as the mapping is released once the snapshot has been read
+    return [NSData dataWithBytes:bytes + range.offset length:range.length];
+}
+
+- (NSString *)stringWithBytes:(FRAIdentitySnapshotBytes)range in:(const uint8_t *)bytes {
+    if (range.length == FRAIdentitySnapshotNil) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:bytes + range.offset length:range.length encoding:NSUTF8StringEncoding];
+}
+
+- (FRAMechanism *)mechanismWithRecord:(const FRAIdentitySnapshotMechanism *)record bytes:(const uint8_t *)bytes database:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel {
+    // Options which change with use are left at their initial values, for the caller to restore from the database
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForType:[self stringWithBytes:record->type in:bytes]];
+    return [descriptor mechanismWithDatabase:database
+                               identityModel:identityModel
+                                     version:record->version
+                                mechanismUID:[self stringWithBytes:record->mechanismUID in:bytes]
+                                     options:[self dataWithBytes:record->options in:bytes]
+                                       error:nil];
+}
+
+@end
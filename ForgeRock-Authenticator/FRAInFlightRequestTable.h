@@ -0,0 +1,80 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/*!
+ * Table of the responses being sent to OpenAM, keyed by message id, which collapses identical responses into
+ * one network operation.
+ *
+ * A response which is identical to one already in flight - the same message id, endpoint, body and cookie - is
+ * not sent again; its handler waits for the request in flight and receives the same result. Once the server has
+ * accepted or rejected a response, the result is kept for a short time and given to identical responses straight
+ * away, so a double slide or an early retry does not reach the server twice. Results the server may answer
+ * differently if asked again (no response, 408, 429 and 5xx) are not kept.
+ *
+ * The table is thread safe.
+ */
+@interface FRAInFlightRequestTable : NSObject
+
+/*!
+ * How long the result of an accepted or rejected response is kept, in seconds. Defaults to 30 seconds.
+ */
+@property (nonatomic) NSTimeInterval resultLifetime;
+
+/*!
+ * The number of responses requested from the table.
+ */
+@property (nonatomic, readonly) NSUInteger requestCount;
+
+/*!
+ * The number of responses which did not cause a network operation, because an identical response was in flight
+ * or had recently finished.
+ */
+@property (nonatomic, readonly) NSUInteger collapsedCount;
+
+/*!
+ * The table shared by the application.
+ *
+ * @return The shared table.
+ */
++ (instancetype)sharedTable;
+
+/*!
+ * Sends a response unless an identical response is in flight or has a kept result.
+ *
+ * @param messageId The id of the message being responded to.
+ * @param fingerprint Everything else which identifies the response, compared with isEqual:.
+ * @param handler A block object to be executed with the result of the response. It is called on the queue which
+ * the send block completes on, or on the main queue for a kept result. May be nil.
+ * @param send A block object which performs the network operation and calls its argument with the result.
+ */
+- (void)performRequestWithMessageId:(NSString *)messageId
+                        fingerprint:(id)fingerprint
+                            handler:(void (^)(NSInteger statusCode, NSError *error))handler
+                               send:(void (^)(void (^complete)(NSInteger statusCode, NSError *error)))send;
+
+/*!
+ * The number of responses in flight.
+ *
+ * @return The number of network operations which have not completed.
+ */
+- (NSUInteger)inFlightCount;
+
+/*!
+ * Discards every kept result. Responses in flight are not affected.
+ */
+- (void)removeAllResults;
+
+@end
@@ -0,0 +1,168 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRAInFlightRequestTable.h"
+
+static const NSTimeInterval FRADefaultResultLifetime = 30.0;
+
+/*!
+ * A response in the table: in flight while it has waiting handlers, and a kept result once it has a completion
+ * time.
+ */
+@interface FRAInFlightRequest : NSObject
+
+@property (strong, nonatomic) id fingerprint;
+@property (strong, nonatomic) NSMutableArray<void (^)(NSInteger, NSError *)> *handlers;
+@property (nonatomic) NSInteger statusCode;
+@property (strong, nonatomic) NSError *error;
+@property (nonatomic) NSTimeInterval timeCompleted;
+
+@end
+
+@implementation FRAInFlightRequest
+@end
+
+@implementation FRAInFlightRequestTable {
+    NSMutableDictionary<NSString *, FRAInFlightRequest *> *requests;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
++ (instancetype)sharedTable {
+    static FRAInFlightRequestTable *sharedTable;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedTable = [[FRAInFlightRequestTable alloc] init];
+    });
+    return sharedTable;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        requests = [[NSMutableDictionary alloc] init];
+        _resultLifetime = FRADefaultResultLifetime;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (void)performRequestWithMessageId:(NSString *)messageId
+                        fingerprint:(id)fingerprint
+                            handler:(void (^)(NSInteger, NSError *))handler
+                               send:(void (^)(void (^)(NSInteger, NSError *)))send {
+    void (^waitingHandler)(NSInteger, NSError *) = handler ? [handler copy] : ^(NSInteger statusCode, NSError *error) {};
+    FRAInFlightRequest *request;
+    @synchronized (self) {
+        _requestCount++;
+        [self removeExpiredResults];
+        FRAInFlightRequest *existing = requests[messageId];
+        if (existing && [existing.fingerprint isEqual:fingerprint]) {
+            _collapsedCount++;
+            if (existing.handlers) {
+                [existing.handlers addObject:waitingHandler];
+            } else {
+                NSInteger statusCode = existing.statusCode;
+                NSError *error = existing.error;
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    waitingHandler(statusCode, error);
+                });
+            }
+            return;
+        }
+        // A different response to the same message, such as a deny after an approve, is sent in its own right. It
+        // only takes over the entry if the earlier response is no longer in flight.
+        if (!existing || !existing.handlers) {
+            request = [[FRAInFlightRequest alloc] init];
+            request.fingerprint = fingerprint;
+            request.handlers = [NSMutableArray arrayWithObject:waitingHandler];
+            requests[messageId] = request;
+        }
+    }
+    
+    if (!request) {
+        send(waitingHandler);
+        return;
+    }
+    send(^(NSInteger statusCode, NSError *error) {
+        NSArray<void (^)(NSInteger, NSError *)> *handlers;
+        @synchronized (self) {
+            handlers = request.handlers;
+            request.handlers = nil;
+            if ([self isFinalStatusCode:statusCode]) {
+                request.statusCode = statusCode;
+                request.error = error;
+                request.timeCompleted = [NSDate timeIntervalSinceReferenceDate];
+            } else if (requests[messageId] == request) {
+                [requests removeObjectForKey:messageId];
+            }
+        }
+        for (void (^waiting)(NSInteger, NSError *) in handlers) {
+            waiting(statusCode, error);
+        }
+    });
+}
+
+- (NSUInteger)inFlightCount {
+    @synchronized (self) {
+        NSUInteger count = 0;
+        for (FRAInFlightRequest *request in requests.allValues) {
+            if (request.handlers) {
+                count++;
+            }
+        }
+        return count;
+    }
+}
+
+- (void)removeAllResults {
+    @synchronized (self) {
+        for (NSString *messageId in requests.allKeys) {
+            if (!requests[messageId].handlers) {
+                [requests removeObjectForKey:messageId];
+            }
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+/*!
+ * Whether the server would give the same answer to the same response: it was accepted, or rejected for a reason
+ * other than load or a timeout.
+ */
+- (BOOL)isFinalStatusCode:(NSInteger)statusCode {
+    return statusCode >= 200 && statusCode < 500 && statusCode != 408 && statusCode != 429;
+}
+
+/*!
+ * Drops the kept results which have outlived resultLifetime. Must be called while synchronized.
+ */
+- (void)removeExpiredResults {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    for (NSString *messageId in requests.allKeys) {
+        FRAInFlightRequest *request = requests[messageId];
+        if (!request.handlers && now - request.timeCompleted >= self.resultLifetime) {
+            [requests removeObjectForKey:messageId];
+        }
+    }
+}
+
+@end
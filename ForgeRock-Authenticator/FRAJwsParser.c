@@ -0,0 +1,287 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <string.h>
+
+#include "FRAHex.h"
+#include "FRAJwsParser.h"
+
+/* Maximum nesting of skipped objects and arrays. */
+#define FRA_JWS_MAX_DEPTH 32
+
+int FRAJwsSplit(const char *token, size_t length, FRAJws *result) {
+    const char *end = token + length;
+    const char *first = memchr(token, '.', length);
+    const char *second;
+
+    if (!first) {
+        return -1;
+    }
+    second = memchr(first + 1, '.', end - first - 1);
+    if (!second || memchr(second + 1, '.', end - second - 1)) {
+        return -1;
+    }
+    if (first == token || second == first + 1) {
+        return -1;
+    }
+
+    result->header.bytes = token;
+    result->header.length = first - token;
+    result->payload.bytes = first + 1;
+    result->payload.length = second - first - 1;
+    result->signature.bytes = second + 1;
+    result->signature.length = end - second - 1;
+    result->signingInput.bytes = token;
+    result->signingInput.length = second - token;
+    return 0;
+}
+
+static const char *skipWhitespace(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Find the closing quote of the string starting after the opening quote
+ * at p. Sets *escaped if the string contains an escape. Returns NULL if
+ * the string is not terminated.
+ */
+static char *stringEnd(char *p, const char *end, int *escaped) {
+    *escaped = 0;
+    while (p < end) {
+        if (*p == '"') {
+            return p;
+        }
+        if (*p == '\\') {
+            *escaped = 1;
+            p++;
+        } else if ((unsigned char)*p < 0x20) {
+            return NULL;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+/* Unescape the string [p, end) in place. Returns the new length, or -1. */
+static long unescape(char *p, const char *end) {
+    char *out = p;
+    const char *start = p;
+    while (p < end) {
+        if (*p != '\\') {
+            *out++ = *p++;
+            continue;
+        }
+        if (++p == end) {
+            return -1;
+        }
+        switch (*p++) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                unsigned int code = 0;
+                int i;
+                if (end - p < 4) {
+                    return -1;
+                }
+                for (i = 0; i < 4; i++) {
+                    unsigned char value = FRAHexValues[(unsigned char)p[i]];
+                    if (value == FRA_HEX_INVALID) {
+                        return -1;
+                    }
+                    code = code << 4 | value;
+                }
+                p += 4;
+                /* Claims are ASCII; surrogate pairs are not expected. */
+                if (code >= 0xD800 && code <= 0xDFFF) {
+                    return -1;
+                }
+                /* At most three bytes are written for the six read. */
+                if (code < 0x80) {
+                    *out++ = (char)code;
+                } else if (code < 0x800) {
+                    *out++ = (char)(0xC0 | code >> 6);
+                    *out++ = (char)(0x80 | (code & 0x3F));
+                } else {
+                    *out++ = (char)(0xE0 | code >> 12);
+                    *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+                    *out++ = (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                return -1;
+        }
+    }
+    return out - start;
+}
+
+/* Skip a nested object or array starting at p. Returns NULL if malformed. */
+static char *skipContainer(char *p, const char *end) {
+    char stack[FRA_JWS_MAX_DEPTH];
+    int depth = 0;
+    int escaped;
+
+    while (p < end) {
+        switch (*p) {
+            case '{':
+            case '[':
+                if (depth == FRA_JWS_MAX_DEPTH) {
+                    return NULL;
+                }
+                stack[depth++] = *p == '{' ? '}' : ']';
+                p++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0 || stack[--depth] != *p) {
+                    return NULL;
+                }
+                p++;
+                if (depth == 0) {
+                    return p;
+                }
+                break;
+            case '"':
+                p = stringEnd(p + 1, end, &escaped);
+                if (!p) {
+                    return NULL;
+                }
+                p++;
+                break;
+            default:
+                p++;
+        }
+    }
+    return NULL;
+}
+
+static int claimForKey(const char *key, size_t length) {
+    if (length != 1) {
+        return -1;
+    }
+    switch (*key) {
+        case 'c': return FRAPushClaimChallenge;
+        case 't': return FRAPushClaimTimeToLive;
+        case 'u': return FRAPushClaimMechanismUid;
+        case 'l': return FRAPushClaimLoadBalancer;
+        default: return -1;
+    }
+}
+
+int FRAJwsParsePushClaims(char *json, size_t length, FRAPushClaims *result) {
+    char *p = json;
+    const char *end = json + length;
+    int escaped;
+
+    memset(result, 0, sizeof(*result));
+
+    p = (char *)skipWhitespace(p, end);
+    if (p == end || *p++ != '{') {
+        return -1;
+    }
+    p = (char *)skipWhitespace(p, end);
+    if (p < end && *p == '}') {
+        p++;
+        return skipWhitespace(p, end) == end ? 0 : -1;
+    }
+
+    for (;;) {
+        char *key;
+        char *keyEnd;
+        int claim;
+
+        /* key */
+        if (p == end || *p != '"') {
+            return -1;
+        }
+        key = p + 1;
+        keyEnd = stringEnd(key, end, &escaped);
+        if (!keyEnd) {
+            return -1;
+        }
+        /* Escaped keys are never one of the claims. */
+        claim = escaped ? -1 : claimForKey(key, keyEnd - key);
+        p = (char *)skipWhitespace(keyEnd + 1, end);
+        if (p == end || *p++ != ':') {
+            return -1;
+        }
+        p = (char *)skipWhitespace(p, end);
+        if (p == end) {
+            return -1;
+        }
+
+        /* value */
+        if (*p == '"') {
+            char *value = p + 1;
+            char *valueEnd = stringEnd(value, end, &escaped);
+            long valueLength;
+            if (!valueEnd) {
+                return -1;
+            }
+            valueLength = valueEnd - value;
+            if (claim >= 0 && escaped) {
+                valueLength = unescape(value, valueEnd);
+                if (valueLength < 0) {
+                    return -1;
+                }
+            }
+            if (claim >= 0) {
+                result->values[claim].bytes = value;
+                result->values[claim].length = valueLength;
+            }
+            p = valueEnd + 1;
+        } else if (*p == '{' || *p == '[') {
+            p = skipContainer(p, end);
+            if (!p) {
+                return -1;
+            }
+        } else {
+            char *value = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+                p++;
+            }
+            if (p == value) {
+                return -1;
+            }
+            if (claim >= 0) {
+                result->values[claim].bytes = value;
+                result->values[claim].length = p - value;
+            }
+        }
+
+        p = (char *)skipWhitespace(p, end);
+        if (p == end) {
+            return -1;
+        }
+        if (*p == '}') {
+            p++;
+            return skipWhitespace(p, end) == end ? 0 : -1;
+        }
+        if (*p++ != ',') {
+            return -1;
+        }
+        p = (char *)skipWhitespace(p, end);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/***********************************************************************
+ * Zero copy parser for the compact JWS tokens carried by push
+ * notifications.
+ *
+ *   base64url(header) "." base64url(payload) "." base64url(signature)
+ *
+ * FRAJwsSplit locates the three segments with a single scan and returns
+ * them as spans over the token, which must outlive the FRAJws. The
+ * header is not interpreted: push tokens are always verified as HS256
+ * with the key of the target mechanism.
+ *
+ * FRAJwsParsePushClaims reads the decoded payload, a flat JSON object,
+ * and keeps only the claims a push notification needs. It does not
+ * build a JSON DOM and unescapes string values in place.
+ ***********************************************************************/
+
+#ifndef _FRA_JWS_PARSER_H_
+#define _FRA_JWS_PARSER_H_
+#include <stddef.h>
+
+typedef struct {
+    const char *bytes;
+    size_t length;
+} FRAJwsSpan;
+
+typedef struct {
+    FRAJwsSpan header;
+    FRAJwsSpan payload;
+    FRAJwsSpan signature;
+    /* header "." payload, the bytes covered by the signature. */
+    FRAJwsSpan signingInput;
+} FRAJws;
+
+typedef enum {
+    /* "c", the Base64 encoded challenge. */
+    FRAPushClaimChallenge,
+    /* "t", the time to live in seconds. */
+    FRAPushClaimTimeToLive,
+    /* "u", the UID of the target mechanism. */
+    FRAPushClaimMechanismUid,
+    /* "l", the Base64 encoded load balancer cookie. */
+    FRAPushClaimLoadBalancer,
+    FRAPushClaimCount
+} FRAPushClaim;
+
+typedef struct {
+    /* Empty (NULL bytes) for claims absent from the payload. */
+    FRAJwsSpan values[FRAPushClaimCount];
+} FRAPushClaims;
+
+/*
+ * Split a compact JWS into its segments. Returns 0 on success, -1 if the
+ * token does not have exactly three segments or its header or payload
+ * is empty.
+ */
+int FRAJwsSplit(const char *token, size_t length, FRAJws *result);
+
+/*
+ * Read the push claims of a JSON object. String values are unescaped in
+ * place, so the returned spans point into json; other scalar values are
+ * returned as they appear. Unknown members, including nested objects and
+ * arrays, are skipped. Returns 0 on success, -1 if json is not a well
+ * formed object.
+ */
+int FRAJwsParsePushClaims(char *json, size_t length, FRAPushClaims *result);
+
+#endif /* _FRA_JWS_PARSER_H_ */
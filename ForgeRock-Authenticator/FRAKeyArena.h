@@ -0,0 +1,135 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/*!
+ * Size in bytes of the smallest slot handed out by an FRAKeyArena. Every slot is aligned to (at least)
+ * this boundary, which is one cache line on the devices the app supports.
+ */
+extern const NSUInteger FRAKeyArenaMinimumSlotSize;
+
+/*!
+ * Size in bytes of the largest slot handed out by an FRAKeyArena; longer key material is refused.
+ */
+extern const NSUInteger FRAKeyArenaMaximumSlotSize;
+
+@class FRAKeyArena;
+
+/*!
+ * A handle to a slot of an FRAKeyArena holding secret key material.
+ *
+ * The slot is zeroized and returned to the arena when the handle is deallocated, so the key bytes never
+ * linger in freed heap memory.
+ */
+@interface FRAKeyMaterial : NSObject
+
+/*!
+ * The number of bytes of key material held by the slot.
+ */
+@property (nonatomic, readonly) NSUInteger length;
+
+/*!
+ * The key bytes. Only valid for as long as the handle is retained.
+ */
+@property (nonatomic, readonly) const void *bytes;
+
+/*!
+ * The key bytes, writable. Only valid for as long as the handle is retained.
+ */
+@property (nonatomic, readonly) void *mutableBytes;
+
+/*!
+ * Copies the key bytes into a new NSData. The copy is zeroized when the NSData is deallocated.
+ *
+ * @return A copy of the key material.
+ */
+- (NSData *)data;
+
+/*!
+ * Compares the key material with the given bytes in time independent of where they differ.
+ *
+ * @param data The bytes to compare against.
+ * @return YES if the key material is equal to the given bytes, NO otherwise.
+ */
+- (BOOL)isEqualToData:(NSData *)data;
+
+@end
+
+/*!
+ * Slab allocator for secret key material.
+ *
+ * The arena carves page-sized slabs into fixed-size slots of a handful of size classes. Slabs are mapped
+ * once and reused, so handing out or returning a slot never touches malloc; slots are aligned to a cache
+ * line, zeroized when they are released and, when requested, the slabs are locked in memory so that the
+ * key material is not paged out.
+ *
+ * The arena is thread safe.
+ */
+@interface FRAKeyArena : NSObject
+
+/*!
+ * The number of slots currently handed out.
+ */
+@property (nonatomic, readonly) NSUInteger allocatedSlotCount;
+
+/*!
+ * The number of slabs mapped by the arena.
+ */
+@property (nonatomic, readonly) NSUInteger slabCount;
+
+/*!
+ * The arena shared by the mechanisms of the application. Its slabs are locked in memory.
+ *
+ * @return The shared arena.
+ */
++ (instancetype)defaultArena;
+
+/*!
+ * Init a new arena.
+ *
+ * @param lockMemory YES if the slabs should be locked in memory. Locking is best effort.
+ * @return The initialized arena.
+ */
+- (instancetype)initWithLockedMemory:(BOOL)lockMemory;
+
+/*!
+ * Copies key material into a slot of the arena.
+ *
+ * @param bytes The key material.
+ * @param length The number of bytes of key material.
+ * @return A handle to the slot, or nil if the key material is longer than FRAKeyArenaMaximumSlotSize or the
+ * arena could not map a new slab.
+ */
+- (FRAKeyMaterial *)keyMaterialWithBytes:(const void *)bytes length:(NSUInteger)length;
+
+/*!
+ * Copies key material into a slot of the arena.
+ *
+ * @param data The key material.
+ * @return A handle to the slot, or nil if data is nil, longer than FRAKeyArenaMaximumSlotSize or the arena
+ * could not map a new slab.
+ */
+- (FRAKeyMaterial *)keyMaterialWithData:(NSData *)data;
+
+/*!
+ * Reserves a zero filled slot of the arena, for key material which is written in place.
+ *
+ * @param length The number of bytes to reserve.
+ * @return A handle to the slot, or nil if length is longer than FRAKeyArenaMaximumSlotSize or the arena could
+ * not map a new slab.
+ */
+- (FRAKeyMaterial *)keyMaterialWithLength:(NSUInteger)length;
+
+@end
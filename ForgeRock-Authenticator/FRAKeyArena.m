@@ -0,0 +1,292 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#import "FRAKeyArena.h"
+
+const NSUInteger FRAKeyArenaMinimumSlotSize = 64;
+const NSUInteger FRAKeyArenaMaximumSlotSize = 512;
+
+/*! Number of slot size classes: 64, 128, 256 and 512 bytes. */
+#define FRA_KEY_ARENA_SIZE_CLASSES 4
+/*! Size in bytes of a slab, rounded up to the page size at runtime. */
+#define FRA_KEY_ARENA_SLAB_SIZE 16384
+
+/*!
+ * A page aligned mapping carved into slots of a single size class. The free slots are kept as a stack of
+ * indexes beside the mapping so that released slots stay entirely zero.
+ */
+typedef struct FRAKeySlab {
+    struct FRAKeySlab *next;
+    uint8_t *memory;
+    NSUInteger slotSize;
+    uint16_t freeCount;
+    uint16_t freeSlots[];
+} FRAKeySlab;
+
+static NSUInteger FRAKeyArenaSizeClass(NSUInteger length) {
+    NSUInteger sizeClass = 0;
+    NSUInteger slotSize = FRAKeyArenaMinimumSlotSize;
+    while (slotSize < length) {
+        slotSize <<= 1;
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+@interface FRAKeyArena ()
+
+- (FRAKeySlab *)allocateSlotOfLength:(NSUInteger)length index:(uint16_t *)index;
+- (void)releaseSlot:(uint16_t)index ofSlab:(FRAKeySlab *)slab;
+- (FRAKeySlab *)mapSlabOfSizeClass:(NSUInteger)sizeClass;
+
+@end
+
+#pragma mark -
+#pragma mark FRAKeyMaterial
+
+@implementation FRAKeyMaterial {
+    FRAKeyArena *arena;
+    FRAKeySlab *slab;
+    uint16_t slot;
+}
+
+- (instancetype)initWithArena:(FRAKeyArena *)keyArena slab:(FRAKeySlab *)keySlab slot:(uint16_t)index length:(NSUInteger)length {
+    self = [super init];
+    if (self) {
+        arena = keyArena;
+        slab = keySlab;
+        slot = index;
+        _length = length;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [arena releaseSlot:slot ofSlab:slab];
+}
+
+- (const void *)bytes {
+    return slab->memory + slot * slab->slotSize;
+}
+
+- (void *)mutableBytes {
+    return slab->memory + slot * slab->slotSize;
+}
+
+- (NSData *)data {
+    if (self.length == 0) {
+        return [NSData data];
+    }
+    void *copy = malloc(self.length);
+    if (!copy) {
+        return nil;
+    }
+    memcpy(copy, self.bytes, self.length);
+    return [[NSData alloc] initWithBytesNoCopy:copy length:self.length deallocator:^(void *bytes, NSUInteger length) {
+        memset_s(bytes, length, 0, length);
+        free(bytes);
+    }];
+}
+
+- (BOOL)isEqualToData:(NSData *)data {
+    if (!data || data.length != self.length) {
+        return NO;
+    }
+    const uint8_t *left = self.bytes;
+    const uint8_t *right = data.bytes;
+    uint8_t difference = 0;
+    for (NSUInteger i = 0; i < self.length; i++) {
+        difference |= left[i] ^ right[i];
+    }
+    return difference == 0;
+}
+
+@end
+
+#pragma mark -
+#pragma mark FRAKeyArena
+
+@implementation FRAKeyArena {
+    pthread_mutex_t lock;
+    BOOL lockMemory;
+    NSUInteger slabSize;
+    FRAKeySlab *slabs[FRA_KEY_ARENA_SIZE_CLASSES];
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
++ (instancetype)defaultArena {
+    static FRAKeyArena *defaultArena;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        defaultArena = [[FRAKeyArena alloc] initWithLockedMemory:YES];
+    });
+    return defaultArena;
+}
+
+- (instancetype)init {
+    return [self initWithLockedMemory:NO];
+}
+
+- (instancetype)initWithLockedMemory:(BOOL)shouldLockMemory {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&lock, NULL);
+        lockMemory = shouldLockMemory;
+        NSUInteger pageSize = (NSUInteger)getpagesize();
+        slabSize = ((FRA_KEY_ARENA_SLAB_SIZE + pageSize - 1) / pageSize) * pageSize;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger sizeClass = 0; sizeClass < FRA_KEY_ARENA_SIZE_CLASSES; sizeClass++) {
+        FRAKeySlab *slab = slabs[sizeClass];
+        while (slab) {
+            FRAKeySlab *next = slab->next;
+            memset_s(slab->memory, slabSize, 0, slabSize);
+            if (lockMemory) {
+                munlock(slab->memory, slabSize);
+            }
+            munmap(slab->memory, slabSize);
+            free(slab);
+            slab = next;
+        }
+    }
+    pthread_mutex_destroy(&lock);
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (NSUInteger)allocatedSlotCount {
+    NSUInteger count = 0;
+    pthread_mutex_lock(&lock);
+    for (NSUInteger sizeClass = 0; sizeClass < FRA_KEY_ARENA_SIZE_CLASSES; sizeClass++) {
+        for (FRAKeySlab *slab = slabs[sizeClass]; slab; slab = slab->next) {
+            count += slabSize / slab->slotSize - slab->freeCount;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+- (NSUInteger)slabCount {
+    NSUInteger count = 0;
+    pthread_mutex_lock(&lock);
+    for (NSUInteger sizeClass = 0; sizeClass < FRA_KEY_ARENA_SIZE_CLASSES; sizeClass++) {
+        for (FRAKeySlab *slab = slabs[sizeClass]; slab; slab = slab->next) {
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+- (FRAKeyMaterial *)keyMaterialWithBytes:(const void *)bytes length:(NSUInteger)length {
+    FRAKeyMaterial *keyMaterial = [self keyMaterialWithLength:length];
+    if (keyMaterial && length > 0) {
+        memcpy(keyMaterial.mutableBytes, bytes, length);
+    }
+    return keyMaterial;
+}
+
+- (FRAKeyMaterial *)keyMaterialWithData:(NSData *)data {
+    if (!data) {
+        return nil;
+    }
+    return [self keyMaterialWithBytes:data.bytes length:data.length];
+}
+
+- (FRAKeyMaterial *)keyMaterialWithLength:(NSUInteger)length {
+    uint16_t index;
+    FRAKeySlab *slab = [self allocateSlotOfLength:length index:&index];
+    if (!slab) {
+        return nil;
+    }
+    return [[FRAKeyMaterial alloc] initWithArena:self slab:slab slot:index length:length];
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+- (FRAKeySlab *)allocateSlotOfLength:(NSUInteger)length index:(uint16_t *)index {
+    if (length > FRAKeyArenaMaximumSlotSize) {
+        return NULL;
+    }
+    NSUInteger sizeClass = FRAKeyArenaSizeClass(length);
+    
+    pthread_mutex_lock(&lock);
+    FRAKeySlab *slab = slabs[sizeClass];
+    while (slab && slab->freeCount == 0) {
+        slab = slab->next;
+    }
+    if (!slab) {
+        slab = [self mapSlabOfSizeClass:sizeClass];
+    }
+    if (slab) {
+        *index = slab->freeSlots[--slab->freeCount];
+    }
+    pthread_mutex_unlock(&lock);
+    return slab;
+}
+
+- (void)releaseSlot:(uint16_t)index ofSlab:(FRAKeySlab *)slab {
+    memset_s(slab->memory + index * slab->slotSize, slab->slotSize, 0, slab->slotSize);
+    pthread_mutex_lock(&lock);
+    slab->freeSlots[slab->freeCount++] = index;
+    pthread_mutex_unlock(&lock);
+}
+
+/*!
+ * Maps a new slab and pushes it on the list of its size class. Must be called with the lock held.
+ */
+- (FRAKeySlab *)mapSlabOfSizeClass:(NSUInteger)sizeClass {
+    NSUInteger slotSize = FRAKeyArenaMinimumSlotSize << sizeClass;
+    NSUInteger slotCount = slabSize / slotSize;
+    FRAKeySlab *slab = malloc(sizeof(FRAKeySlab) + slotCount * sizeof(uint16_t));
+    if (!slab) {
+        return NULL;
+    }
+    void *memory = mmap(NULL, slabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (memory == MAP_FAILED) {
+        free(slab);
+        return NULL;
+    }
+    if (lockMemory && mlock(memory, slabSize) != 0) {
+        NSLog(@"Unable to lock key material in memory: %s", strerror(errno));
+    }
+    
+    slab->memory = memory;
+    slab->slotSize = slotSize;
+    slab->freeCount = (uint16_t)slotCount;
+    // Hand out the lowest slots first
+    for (NSUInteger i = 0; i < slotCount; i++) {
+        slab->freeSlots[i] = (uint16_t)(slotCount - 1 - i);
+    }
+    slab->next = slabs[sizeClass];
+    slabs[sizeClass] = slab;
+    return slab;
+}
+
+@end
@@ -21,6 +21,7 @@
 @class FRAIdentity;
 @class FRAIdentityDatabase;
 @class FRANotification;
+@class FRANotificationStore;
 
 /*!
  * A mechanism used for authentication within the Authenticator Application.
@@ -46,9 +47,28 @@
 
 /*!
  * A list of the current Notficiations that are assigned to this Mechanism.
+ *
+ * The returned array is an immutable snapshot which is shared rather than copied; it is not affected by
+ * subsequent changes to the mechanism. Notifications in the history are materialized to build the array, so
+ * callers which only need the active notifications should prefer activeNotifications.
  */
 @property (getter=notifications, nonatomic, readonly) NSArray<FRANotification *> *notifications;
 
+/*!
+ * The notifications of this Mechanism which are pending or have not yet been moved into the history.
+ *
+ * As with notifications, the returned array is an immutable snapshot.
+ */
+@property (nonatomic, readonly) NSArray<FRANotification *> *activeNotifications;
+
+/*!
+ * Compact store of the notifications of this Mechanism which have been approved, denied or have expired.
+ *
+ * Resolved notifications are moved here from the active notifications so that they do not each need to be
+ * held in memory as an object.
+ */
+@property (nonatomic, readonly) FRANotificationStore *notificationHistory;
+
 #pragma mark -
 #pragma mark Lifecyle
 
@@ -84,13 +104,48 @@
  */
 - (BOOL)removeNotification:(FRANotification *)notification error:(NSError *__autoreleasing*)error;
 
+/*!
+ * Removes several notifications from the Mechanism at once, deleting them from the database in a single
+ * transaction if the Mechanism has been stored.
+ *
+ * @param notifications The notifications to remove from the Mechanism.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if there was an error deleting the Notifications, in which case the error value will be populated.
+ */
+- (BOOL)removeNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing*)error;
+
 /*!
  * Count of notifications that have not yet been dealt with.
  *
+ * The count is maintained as notifications are added, removed and change state, and is only recalculated
+ * once a pending notification expires.
+ *
  * @return The number of pending notifications.
  */
 - (NSInteger)pendingNotificationsCount;
 
+/*!
+ * The time at which the earliest pending notification of this mechanism expires.
+ *
+ * @return The expiry time, or nil if there are no pending notifications.
+ */
+- (NSDate *)nextPendingNotificationExpiry;
+
+/*!
+ * Called by a Notification of this Mechanism when its pending state or expiry time changes, so that the
+ * pending notifications count can be kept up to date.
+ *
+ * @param notification The notification which changed.
+ * @param wasPending Whether the notification was pending before the change.
+ */
+- (void)notificationDidChangeState:(FRANotification *)notification wasPending:(BOOL)wasPending;
+
+/*!
+ * Moves any active notifications which are no longer pending, such as those that have just expired, into the
+ * notification history.
+ */
+- (void)archiveResolvedNotifications;
+
 /*!
  * Gets the notification identified uniquely by the provided messageID.
  * @param messageId The message id of the notification to get.
@@ -15,13 +15,66 @@
  */
 
 #import "FRAError.h"
+#import "FRAIdentity.h"
 #import "FRAIdentityDatabase.h"
+#import "FRAIdentityModel.h"
 #import "FRAMechanism.h"
+#import "FRAMechanismProtected.h"
 #import "FRAModelObjectProtected.h"
 #import "FRANotification.h"
+#import "FRANotificationExpiryQueue.h"
+#import "FRANotificationStore.h"
+
+/*!
+ * The combination of the history and active notifications, with the active snapshot and history revision it was
+ * built from. Immutable, so that readers can check and use it without locking.
+ */
+@interface FRAAllNotificationsSnapshot : NSObject
+
+/*! The combined notifications, held weakly so that the materialized history is released once unused. */
+@property (weak, nonatomic, readonly) NSArray<FRANotification *> *notifications;
+@property (strong, nonatomic, readonly) NSArray<FRANotification *> *activeNotifications;
+@property (nonatomic, readonly) NSUInteger historyRevision;
+
+@end
+
+@implementation FRAAllNotificationsSnapshot
+
+- (instancetype)initWithNotifications:(NSArray<FRANotification *> *)notifications activeNotifications:(NSArray<FRANotification *> *)activeNotifications historyRevision:(NSUInteger)historyRevision {
+    if (self = [super init]) {
+        _notifications = notifications;
+        _activeNotifications = activeNotifications;
+        _historyRevision = historyRevision;
+    }
+    return self;
+}
+
+@end
+
+/*!
+ * Private interface.
+ */
+@interface FRAMechanism ()
+
+/*!
+ * Immutable snapshot of the active notifications. Replaced (never mutated) by writers while holding the mechanism's
+ * lock; atomic so that readers on any thread can take a reference without locking.
+ */
+@property (atomic, strong) NSArray<FRANotification *> *notificationSnapshot;
+
+/*!
+ * The most recent combination of the history and active notifications. Replaced by readers which find it stale;
+ * atomic so that this needs no lock.
+ */
+@property (atomic, strong) FRAAllNotificationsSnapshot *allNotificationsSnapshot;
+
+@end
 
 @implementation FRAMechanism {
-    NSMutableArray *notificationList;
+    /*! Number of pending notifications, maintained incrementally as notifications are added, removed or resolved. */
+    NSInteger pendingCount;
+    /*! Time at which the earliest counted pending notification expires, or nil if none are pending. */
+    NSDate *pendingCountExpiry;
 }
 
 #pragma mark -
@@ -31,7 +84,10 @@
     self = [super initWithDatabase:database identityModel:identityModel];
     if (self) {
         _parent = nil;
-        notificationList = [[NSMutableArray alloc] init];
+        _notificationSnapshot = @[];
+        _notificationHistory = [[FRANotificationStore alloc] initWithDatabase:database identityModel:identityModel mechanism:self];
+        pendingCount = 0;
+        pendingCountExpiry = nil;
     }
     return self;
 }
@@ -40,22 +96,142 @@
 #pragma mark Notification Functions
 
 - (NSArray *)notifications {
-    return [[NSArray alloc] initWithArray:notificationList];
+    // Readers never lock: the active snapshot is replaced atomically by writers and the history store is thread safe
+    NSArray<FRANotification *> *active = self.notificationSnapshot;
+    if (self.notificationHistory.count == 0) {
+        return active;
+    }
+    // The revision is read first, so a history change made while combining only makes the result look stale
+    NSUInteger historyRevision = self.notificationHistory.revision;
+    FRAAllNotificationsSnapshot *snapshot = self.allNotificationsSnapshot;
+    NSArray<FRANotification *> *all = snapshot.notifications;
+    if (all && snapshot.activeNotifications == active && snapshot.historyRevision == historyRevision) {
+        return all;
+    }
+    all = [[self.notificationHistory allNotifications] arrayByAddingObjectsFromArray:active];
+    self.allNotificationsSnapshot = [[FRAAllNotificationsSnapshot alloc] initWithNotifications:all activeNotifications:active historyRevision:historyRevision];
+    return all;
+}
+
+- (NSArray<FRANotification *> *)activeNotifications {
+    return self.notificationSnapshot;
 }
 
 - (NSInteger)pendingNotificationsCount {
+    @synchronized (self) {
+        if (pendingCountExpiry && [pendingCountExpiry timeIntervalSinceNow] <= 0) {
+            // Only expiry can invalidate the count without this mechanism being told about it
+            [self recountPendingNotifications];
+        }
+        return pendingCount;
+    }
+}
+
+- (NSDate *)nextPendingNotificationExpiry {
+    @synchronized (self) {
+        [self pendingNotificationsCount];
+        return pendingCountExpiry;
+    }
+}
+
+- (void)notificationDidChangeState:(FRANotification *)notification wasPending:(BOOL)wasPending {
+    @synchronized (self) {
+        BOOL isPending = [notification isPending];
+        BOOL isActive = [self.notificationSnapshot containsObject:notification];
+        NSUInteger historyIndex = isActive ? NSNotFound : [self.notificationHistory indexOfNotification:notification];
+        if (!isActive && historyIndex == NSNotFound) {
+            // Already removed from this mechanism
+            return;
+        }
+        // Only active notifications are counted, so a notification which has already been archived by a recount is not
+        // counted twice
+        BOOL wasCounted = isActive && wasPending;
+        if (historyIndex != NSNotFound) {
+            // The history holds a copy of the notification's state, so it is either refreshed or made active again
+            [self.notificationHistory removeNotificationAtIndex:historyIndex];
+            if (isPending) {
+                self.notificationSnapshot = [self.notificationSnapshot arrayByAddingObject:notification];
+            } else {
+                [self.notificationHistory addNotification:notification];
+            }
+        } else if (!isPending) {
+            [self archiveNotification:notification];
+        }
+        if (wasCounted && !isPending) {
+            // The notification may have held the earliest expiry
+            [self recountPendingNotifications];
+        } else if (!wasCounted && isPending) {
+            pendingCount++;
+        }
+        if (isPending) {
+            [self includeExpiryOfPendingNotification:notification];
+        }
+    }
+    FRANotificationExpiryQueue *expiryQueue = [_identityModel notificationExpiryQueue];
+    if ([notification isPending]) {
+        [expiryQueue addNotification:notification];
+    } else {
+        [expiryQueue removeNotification:notification];
+    }
+    [self.parent pendingNotificationsCountDidChange];
+}
+
+- (void)archiveResolvedNotifications {
+    @synchronized (self) {
+        [self recountPendingNotifications];
+    }
+}
+
+/*!
+ * Moves an active notification into the history.
+ *
+ * Must be called while holding the lock on self.
+ */
+- (void)archiveNotification:(FRANotification *)notification {
+    NSMutableArray<FRANotification *> *remaining = [self.notificationSnapshot mutableCopy];
+    [remaining removeObjectIdenticalTo:notification];
+    self.notificationSnapshot = [remaining copy];
+    [self.notificationHistory addNotification:notification];
+}
+
+/*!
+ * Recalculates the pending count and earliest expiry by scanning the active notifications, moving any which
+ * are no longer pending into the history.
+ *
+ * Must be called while holding the lock on self.
+ */
+- (void)recountPendingNotifications {
     NSInteger count = 0;
-    for (FRANotification *notification in self.notifications) {
+    pendingCountExpiry = nil;
+    NSMutableArray<FRANotification *> *active = [[NSMutableArray alloc] initWithCapacity:self.notificationSnapshot.count];
+    for (FRANotification *notification in self.notificationSnapshot) {
         if (notification.isPending) {
             count += 1;
+            [self includeExpiryOfPendingNotification:notification];
+            [active addObject:notification];
+        } else {
+            [self.notificationHistory addNotification:notification];
         }
     }
-    return count;
+    if (active.count != self.notificationSnapshot.count) {
+        self.notificationSnapshot = [active copy];
+    }
+    pendingCount = count;
+}
+
+- (void)includeExpiryOfPendingNotification:(FRANotification *)notification {
+    NSDate *timeExpired = notification.timeExpired;
+    if (timeExpired && (!pendingCountExpiry || [timeExpired compare:pendingCountExpiry] == NSOrderedAscending)) {
+        pendingCountExpiry = timeExpired;
+    }
 }
 
 - (BOOL)addNotification:(FRANotification*)notification error:(NSError *__autoreleasing*)error {
     [notification setParent:self];
-    [notificationList addObject:notification];
+    @synchronized (self) {
+        self.notificationSnapshot = [self.notificationSnapshot arrayByAddingObject:notification];
+    }
+    [self notificationDidChangeState:notification wasPending:NO];
     if ([self isStored]) {
         return [self.database insertNotification:notification error:error];
     }
@@ -63,7 +239,29 @@
 }
 
 - (BOOL)removeNotification:(FRANotification*)notification error:(NSError *__autoreleasing*)error {
-    [notificationList removeObject:notification];
+    BOOL countChanged = NO;
+    @synchronized (self) {
+        NSArray<FRANotification *> *notifications = self.notificationSnapshot;
+        if ([notifications containsObject:notification]) {
+            NSMutableArray<FRANotification *> *remaining = [notifications mutableCopy];
+            [remaining removeObject:notification];
+            self.notificationSnapshot = [remaining copy];
+            if ([notification isPending]) {
+                // The notification may have held the earliest expiry
+                [self recountPendingNotifications];
+                countChanged = YES;
+            }
+        } else {
+            NSUInteger historyIndex = [self.notificationHistory indexOfNotification:notification];
+            if (historyIndex != NSNotFound) {
+                [self.notificationHistory removeNotificationAtIndex:historyIndex];
+            }
+        }
+    }
+    [[_identityModel notificationExpiryQueue] removeNotification:notification];
+    if (countChanged) {
+        [self.parent pendingNotificationsCountDidChange];
+    }
     [notification setParent:nil];
     if ([self isStored]) {
         return [self.database deleteNotification:notification error:error];
@@ -71,12 +269,57 @@
     return YES;
 }
 
+- (BOOL)removeNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing*)error {
+    BOOL countChanged = NO;
+    @synchronized (self) {
+        NSMutableArray<FRANotification *> *remaining = [self.notificationSnapshot mutableCopy];
+        for (FRANotification *notification in notifications) {
+            NSUInteger activeIndex = [remaining indexOfObjectIdenticalTo:notification];
+            if (activeIndex != NSNotFound) {
+                [remaining removeObjectAtIndex:activeIndex];
+                countChanged = countChanged || [notification isPending];
+            } else {
+                NSUInteger historyIndex = [self.notificationHistory indexOfNotification:notification];
+                if (historyIndex != NSNotFound) {
+                    [self.notificationHistory removeNotificationAtIndex:historyIndex];
+                }
+            }
+        }
+        if (remaining.count != self.notificationSnapshot.count) {
+            self.notificationSnapshot = [remaining copy];
+        }
+        if (countChanged) {
+            // The removed notifications may have held the earliest expiry
+            [self recountPendingNotifications];
+        }
+    }
+    FRANotificationExpiryQueue *expiryQueue = [_identityModel notificationExpiryQueue];
+    for (FRANotification *notification in notifications) {
+        [expiryQueue removeNotification:notification];
+    }
+    if (countChanged) {
+        [self.parent pendingNotificationsCountDidChange];
+    }
+    // The parent identifies the notifications' rows in the database, so is only cleared once they are deleted
+    BOOL deleted = ![self isStored] || [self.database deleteNotifications:notifications error:error];
+    for (FRANotification *notification in notifications) {
+        [notification setParent:nil];
+    }
+    return deleted;
+}
+
 - (FRANotification *)notificationWithMessageId:(NSString *)messageId {
-    for (FRANotification *notification in self.notifications) {
+    for (FRANotification *notification in self.notificationSnapshot) {
         if ([notification.messageId isEqualToString:messageId]) {
             return notification;
         }
     }
+    @synchronized (self) {
+        NSUInteger historyIndex = [self.notificationHistory indexOfNotificationWithMessageId:messageId];
+        if (historyIndex != NSNotFound) {
+            return [self.notificationHistory notificationAtIndex:historyIndex];
+        }
+    }
     return nil;
 }
 
@@ -0,0 +1,135 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRABinarySerialization.h"
+
+@class FRAIdentityDatabase;
+@class FRAIdentityModel;
+@class FRAMechanism;
+
+/*!
+ * Describes how a type of mechanism is persisted: its stored type name, the binary schema
+ * of its options and which of its properties are stored under which option key.
+ *
+ * Descriptors for every mechanism type are registered once, and a single generic encoder
+ * and decoder walks their field tables. Storing a new type of mechanism therefore only
+ * needs a new descriptor rather than another branch at every place mechanisms are stored
+ * or loaded.
+ */
+@interface FRAMechanismDescriptor : NSObject
+
+/*!
+ * The class of mechanism which this descriptor persists.
+ */
+@property (nonatomic, readonly) Class mechanismClass;
+
+/*!
+ * The type name under which mechanisms of this class are stored.
+ */
+@property (nonatomic, readonly) NSString *type;
+
+/*!
+ * The binary schema used to encode the options of this type of mechanism.
+ */
+@property (nonatomic, readonly) FRABinarySchema schema;
+
+/*!
+ * Whether mechanisms of this type have an identifier, by which their notifications refer to them.
+ */
+@property (nonatomic, readonly) BOOL hasMechanismUID;
+
+/*!
+ * Whether mechanisms of this type have options, such as the HOTP counter, which change each time a code is
+ * generated. Updates of such mechanisms change nothing else.
+ */
+@property (nonatomic, readonly) BOOL hasOptionsChangingWithUse;
+
+/*!
+ * Returns the descriptors of every type of mechanism which can be persisted.
+ *
+ * @return The registered descriptors.
+ */
++ (NSArray<FRAMechanismDescriptor *> *)allDescriptors;
+
+/*!
+ * Returns the descriptor registered for a stored type name.
+ *
+ * @param type The type name of a stored mechanism.
+ * @return The descriptor, or nil if no type of mechanism is stored under that name.
+ */
++ (instancetype)descriptorForType:(NSString *)type;
+
+/*!
+ * Returns the descriptor registered for the class of a mechanism.
+ *
+ * @param mechanism The mechanism to be persisted.
+ * @return The descriptor, or nil if the class of mechanism cannot be persisted.
+ */
++ (instancetype)descriptorForMechanism:(FRAMechanism *)mechanism;
+
+/*!
+ * Returns the identifier by which a mechanism's notifications refer to it.
+ *
+ * @param mechanism A mechanism of this descriptor's class.
+ * @return The identifier, or nil if this type of mechanism does not have one.
+ */
+- (NSString *)mechanismUIDOfMechanism:(FRAMechanism *)mechanism;
+
+/*!
+ * Encodes the stored properties of a mechanism into its options.
+ *
+ * @param mechanism A mechanism of this descriptor's class.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The binary encoded options, or nil if an error occurred.
+ */
+- (NSData *)encodeOptionsOfMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Encodes the stored properties of a mechanism into its options, optionally leaving out those which change each
+ * time a code is generated.
+ *
+ * @param mechanism A mechanism of this descriptor's class.
+ * @param includeChangingWithUse NO to leave out the options which change each time a code is generated.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The binary encoded options, or nil if an error occurred.
+ */
+- (NSData *)encodeOptionsOfMechanism:(FRAMechanism *)mechanism includingOptionsChangingWithUse:(BOOL)includeChangingWithUse error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Sets the properties which change each time a code is generated from a mechanism's stored options, leaving its
+ * other properties untouched.
+ *
+ * @param options The stored options, either binary encoded or JSON written by earlier versions.
+ * @param mechanism A mechanism of this descriptor's class.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if the options could not be decoded or are missing one of the properties.
+ */
+- (BOOL)restoreOptionsChangingWithUse:(NSData *)options toMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Recreates a mechanism of this descriptor's class from its stored columns.
+ *
+ * @param database The database to which the mechanism can be persisted.
+ * @param identityModel The identity model which contains the list of identities.
+ * @param version The stored version of the mechanism.
+ * @param mechanismUID The stored identifier of the mechanism, ignored if this type of mechanism does not have one.
+ * @param options The stored options, either binary encoded or JSON written by earlier versions.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The mechanism, or nil if the options could not be decoded.
+ */
+- (FRAMechanism *)mechanismWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel version:(NSInteger)version mechanismUID:(NSString *)mechanismUID options:(NSData *)options error:(NSError *__autoreleasing *)error;
+
+@end
@@ -0,0 +1,370 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRAError.h"
+#import "FRAHotpOathMechanism.h"
+#import "FRAMechanismDescriptor.h"
+#import "FRAMechanismProtected.h"
+#import "FRAOathCode.h"
+#import "FRAPushMechanism.h"
+#import "FRASerialization.h"
+#import "FRATotpOathMechanism.h"
+
+/*!
+ * How a stored option value maps onto a mechanism property.
+ */
+typedef NS_ENUM(NSInteger, FRAMechanismFieldType) {
+    /*! A scalar property, stored as a number. */
+    FRAMechanismFieldNumber,
+    /*! A String property. */
+    FRAMechanismFieldString,
+    /*! An NSData secret, stored as raw bytes or as hex by earlier versions. */
+    FRAMechanismFieldSecret,
+    /*! A CCHmacAlgorithm, stored as its value or by name by earlier versions. */
+    FRAMechanismFieldAlgorithm,
+};
+
+/*!
+ * Reads a mechanism property, boxing scalars into NSNumbers.
+ */
+typedef id (*FRAMechanismFieldGetter)(FRAMechanism *mechanism);
+
+/*!
+ * Writes a mechanism property from a value converted by FRAMechanismFieldValue.
+ */
+typedef void (*FRAMechanismFieldSetter)(FRAMechanism *mechanism, id value);
+
+typedef struct {
+    /*! One of the option key constants of FRASerialization, which are never deallocated. */
+    __unsafe_unretained NSString *optionKey;
+    FRAMechanismFieldType type;
+    FRAMechanismFieldGetter get;
+    FRAMechanismFieldSetter set;
+    /*! Whether the property changes each time a code is generated, like the HOTP counter. */
+    BOOL changesWithUse;
+} FRAMechanismField;
+
+static FRAMechanismField FRAHotpMechanismFields[4];
+static FRAMechanismField FRATotpMechanismFields[4];
+static FRAMechanismField FRAPushMechanismFields[3];
+
+static NSArray<FRAMechanismDescriptor *> *allDescriptors;
+static NSDictionary<NSString *, FRAMechanismDescriptor *> *descriptorsByType;
+static NSDictionary<id, FRAMechanismDescriptor *> *descriptorsByClass;
+/*! Descriptors resolved for subclasses of the registered classes, with NSNull for classes which have none. */
+static NSMapTable<Class, id> *descriptorsBySubclass;
+
+#pragma mark -
+#pragma mark Field Accessors
+
+static id FRAHotpSecretKey(FRAMechanism *mechanism) {
+    return ((FRAHotpOathMechanism *)mechanism).secretKey;
+}
+
+static void FRAHotpSetSecretKey(FRAMechanism *mechanism, id value) {
+    ((FRAHotpOathMechanism *)mechanism).secretKey = value;
+}
+
+static id FRAHotpAlgorithm(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedInt:((FRAHotpOathMechanism *)mechanism).algorithm];
+}
+
+static void FRAHotpSetAlgorithm(FRAMechanism *mechanism, id value) {
+    ((FRAHotpOathMechanism *)mechanism).algorithm = [value unsignedIntValue];
+}
+
+static id FRAHotpCodeLength(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedInteger:((FRAHotpOathMechanism *)mechanism).codeLength];
+}
+
+static void FRAHotpSetCodeLength(FRAMechanism *mechanism, id value) {
+    ((FRAHotpOathMechanism *)mechanism).codeLength = [value unsignedIntegerValue];
+}
+
+static id FRAHotpCounter(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedLongLong:((FRAHotpOathMechanism *)mechanism).counter];
+}
+
+static void FRAHotpSetCounter(FRAMechanism *mechanism, id value) {
+    ((FRAHotpOathMechanism *)mechanism).counter = [value unsignedLongLongValue];
+}
+
+static id FRATotpSecretKey(FRAMechanism *mechanism) {
+    return ((FRATotpOathMechanism *)mechanism).secretKey;
+}
+
+static void FRATotpSetSecretKey(FRAMechanism *mechanism, id value) {
+    ((FRATotpOathMechanism *)mechanism).secretKey = value;
+}
+
+static id FRATotpAlgorithm(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedInt:((FRATotpOathMechanism *)mechanism).algorithm];
+}
+
+static void FRATotpSetAlgorithm(FRAMechanism *mechanism, id value) {
+    ((FRATotpOathMechanism *)mechanism).algorithm = [value unsignedIntValue];
+}
+
+static id FRATotpCodeLength(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedInteger:((FRATotpOathMechanism *)mechanism).codeLength];
+}
+
+static void FRATotpSetCodeLength(FRAMechanism *mechanism, id value) {
+    ((FRATotpOathMechanism *)mechanism).codeLength = [value unsignedIntegerValue];
+}
+
+static id FRATotpPeriod(FRAMechanism *mechanism) {
+    return [NSNumber numberWithUnsignedInt:((FRATotpOathMechanism *)mechanism).period];
+}
+
+static void FRATotpSetPeriod(FRAMechanism *mechanism, id value) {
+    ((FRATotpOathMechanism *)mechanism).period = [value unsignedIntValue];
+}
+
+static id FRAPushSecret(FRAMechanism *mechanism) {
+    return ((FRAPushMechanism *)mechanism).secret;
+}
+
+static void FRAPushSetSecret(FRAMechanism *mechanism, id value) {
+    ((FRAPushMechanism *)mechanism).secret = value;
+}
+
+static id FRAPushAuthEndpoint(FRAMechanism *mechanism) {
+    return ((FRAPushMechanism *)mechanism).authEndpoint;
+}
+
+static void FRAPushSetAuthEndpoint(FRAMechanism *mechanism, id value) {
+    ((FRAPushMechanism *)mechanism).authEndpoint = value;
+}
+
+static id FRAPushVersion(FRAMechanism *mechanism) {
+    return [NSNumber numberWithInteger:mechanism.version];
+}
+
+static void FRAPushSetVersion(FRAMechanism *mechanism, id value) {
+    mechanism.version = [value integerValue];
+}
+
+static id FRAPushMechanismUID(FRAMechanism *mechanism) {
+    return ((FRAPushMechanism *)mechanism).mechanismUID;
+}
+
+static void FRAPushSetMechanismUID(FRAMechanism *mechanism, id value) {
+    ((FRAPushMechanism *)mechanism).mechanismUID = value;
+}
+
+/*!
+ * Converts a stored option value into the value of its property, accepting both the binary
+ * encoding's values and the Strings written to JSON by earlier versions.
+ */
+static id FRAMechanismFieldValue(FRAMechanismFieldType type, id value) {
+    switch (type) {
+        case FRAMechanismFieldNumber:
+            return [FRASerialization numberFromValue:value];
+        case FRAMechanismFieldString:
+            return [value isKindOfClass:[NSString class]] ? value : nil;
+        case FRAMechanismFieldSecret:
+            if ([value isKindOfClass:[NSData class]]) {
+                return value;
+            }
+            return [value isKindOfClass:[NSString class]] ? [FRASerialization deserializeSecret:value] : nil;
+        case FRAMechanismFieldAlgorithm:
+            if ([value isKindOfClass:[NSNumber class]]) {
+                return value;
+            }
+            return [value isKindOfClass:[NSString class]] ? [NSNumber numberWithUnsignedInt:[FRAOathCode fromString:value]] : nil;
+    }
+    return nil;
+}
+
+@implementation FRAMechanismDescriptor {
+    const FRAMechanismField *fields;
+    NSUInteger fieldCount;
+    /*! Accessors of the identifier property, or NULL if the mechanism does not have one. */
+    FRAMechanismFieldGetter getMechanismUID;
+    FRAMechanismFieldSetter setMechanismUID;
+}
+
+#pragma mark -
+#pragma mark Registry
+
++ (void)initialize {
+    if (self != [FRAMechanismDescriptor class]) {
+        return;
+    }
+    FRAHotpMechanismFields[0] = (FRAMechanismField){OATH_MECHANISM_SECRET, FRAMechanismFieldSecret, FRAHotpSecretKey, FRAHotpSetSecretKey, NO};
+    FRAHotpMechanismFields[1] = (FRAMechanismField){OATH_MECHANISM_ALGORITHM, FRAMechanismFieldAlgorithm, FRAHotpAlgorithm, FRAHotpSetAlgorithm, NO};
+    FRAHotpMechanismFields[2] = (FRAMechanismField){OATH_MECHANISM_DIGITS, FRAMechanismFieldNumber, FRAHotpCodeLength, FRAHotpSetCodeLength, NO};
+    FRAHotpMechanismFields[3] = (FRAMechanismField){OATH_MECHANISM_COUNTER, FRAMechanismFieldNumber, FRAHotpCounter, FRAHotpSetCounter, YES};
+    
+    FRATotpMechanismFields[0] = (FRAMechanismField){OATH_MECHANISM_SECRET, FRAMechanismFieldSecret, FRATotpSecretKey, FRATotpSetSecretKey, NO};
+    FRATotpMechanismFields[1] = (FRAMechanismField){OATH_MECHANISM_ALGORITHM, FRAMechanismFieldAlgorithm, FRATotpAlgorithm, FRATotpSetAlgorithm, NO};
+    FRATotpMechanismFields[2] = (FRAMechanismField){OATH_MECHANISM_DIGITS, FRAMechanismFieldNumber, FRATotpCodeLength, FRATotpSetCodeLength, NO};
+    FRATotpMechanismFields[3] = (FRAMechanismField){OATH_MECHANISM_PERIOD, FRAMechanismFieldNumber, FRATotpPeriod, FRATotpSetPeriod, NO};
+    
+    FRAPushMechanismFields[0] = (FRAMechanismField){PUSH_MECHANISM_SECRET, FRAMechanismFieldString, FRAPushSecret, FRAPushSetSecret, NO};
+    FRAPushMechanismFields[1] = (FRAMechanismField){PUSH_MECHANISM_AUTH_END_POINT, FRAMechanismFieldString, FRAPushAuthEndpoint, FRAPushSetAuthEndpoint, NO};
+    FRAPushMechanismFields[2] = (FRAMechanismField){PUSH_MECHANISM_VERSION, FRAMechanismFieldNumber, FRAPushVersion, FRAPushSetVersion, NO};
+    
+    NSArray<FRAMechanismDescriptor *> *descriptors = @[
+        [[FRAMechanismDescriptor alloc] initWithClass:[FRAHotpOathMechanism class]
+                                               schema:FRABinarySchemaHotpOptions
+                                               fields:FRAHotpMechanismFields
+                                                count:sizeof(FRAHotpMechanismFields) / sizeof(FRAMechanismField)
+                                      getMechanismUID:NULL
+                                      setMechanismUID:NULL],
+        [[FRAMechanismDescriptor alloc] initWithClass:[FRATotpOathMechanism class]
+                                               schema:FRABinarySchemaTotpOptions
+                                               fields:FRATotpMechanismFields
+                                                count:sizeof(FRATotpMechanismFields) / sizeof(FRAMechanismField)
+                                      getMechanismUID:NULL
+                                      setMechanismUID:NULL],
+        [[FRAMechanismDescriptor alloc] initWithClass:[FRAPushMechanism class]
+                                               schema:FRABinarySchemaPushOptions
+                                               fields:FRAPushMechanismFields
+                                                count:sizeof(FRAPushMechanismFields) / sizeof(FRAMechanismField)
+                                      getMechanismUID:FRAPushMechanismUID
+                                      setMechanismUID:FRAPushSetMechanismUID],
+    ];
+    
+    NSMutableDictionary *byType = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary *byClass = [[NSMutableDictionary alloc] init];
+    for (FRAMechanismDescriptor *descriptor in descriptors) {
+        byType[descriptor.type] = descriptor;
+        byClass[(id<NSCopying>)descriptor.mechanismClass] = descriptor;
+    }
+    allDescriptors = descriptors;
+    descriptorsByType = byType;
+    descriptorsByClass = byClass;
+    descriptorsBySubclass = [NSMapTable strongToStrongObjectsMapTable];
+}
+
++ (NSArray<FRAMechanismDescriptor *> *)allDescriptors {
+    return allDescriptors;
+}
+
++ (instancetype)descriptorForType:(NSString *)type {
+    return type ? descriptorsByType[type] : nil;
+}
+
++ (instancetype)descriptorForMechanism:(FRAMechanism *)mechanism {
+    Class mechanismClass = [mechanism class];
+    FRAMechanismDescriptor *descriptor = descriptorsByClass[(id<NSCopying>)mechanismClass];
+    if (descriptor || !mechanismClass) {
+        return descriptor;
+    }
+    
+    // Subclasses walk up the hierarchy once, after which the outcome is remembered
+    @synchronized (descriptorsBySubclass) {
+        id resolved = [descriptorsBySubclass objectForKey:mechanismClass];
+        if (!resolved) {
+            for (Class superclass = [mechanismClass superclass]; superclass && !descriptor; superclass = [superclass superclass]) {
+                descriptor = descriptorsByClass[(id<NSCopying>)superclass];
+            }
+            resolved = descriptor ? descriptor : [NSNull null];
+            [descriptorsBySubclass setObject:resolved forKey:mechanismClass];
+        }
+        return resolved == [NSNull null] ? nil : resolved;
+    }
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithClass:(Class)mechanismClass schema:(FRABinarySchema)schema fields:(const FRAMechanismField *)mechanismFields count:(NSUInteger)count getMechanismUID:(FRAMechanismFieldGetter)getUID setMechanismUID:(FRAMechanismFieldSetter)setUID {
+    self = [super init];
+    if (self) {
+        _mechanismClass = mechanismClass;
+        _type = [mechanismClass mechanismType];
+        _schema = schema;
+        fields = mechanismFields;
+        fieldCount = count;
+        getMechanismUID = getUID;
+        setMechanismUID = setUID;
+        for (NSUInteger i = 0; i < count; i++) {
+            _hasOptionsChangingWithUse = _hasOptionsChangingWithUse || mechanismFields[i].changesWithUse;
+        }
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Encoding
+
+- (BOOL)hasMechanismUID {
+    return getMechanismUID != NULL;
+}
+
+- (NSString *)mechanismUIDOfMechanism:(FRAMechanism *)mechanism {
+    return getMechanismUID ? getMechanismUID(mechanism) : nil;
+}
+
+- (NSData *)encodeOptionsOfMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
+    return [self encodeOptionsOfMechanism:mechanism includingOptionsChangingWithUse:YES error:error];
+}
+
+- (NSData *)encodeOptionsOfMechanism:(FRAMechanism *)mechanism includingOptionsChangingWithUse:(BOOL)includeChangingWithUse error:(NSError *__autoreleasing *)error {
+    NSMutableDictionary *options = [[NSMutableDictionary alloc] initWithCapacity:fieldCount];
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        if (includeChangingWithUse || !fields[i].changesWithUse) {
+            [options setValue:fields[i].get(mechanism) forKey:fields[i].optionKey];
+        }
+    }
+    return [FRABinarySerialization encodeMap:options schema:self.schema error:error];
+}
+
+- (BOOL)restoreOptionsChangingWithUse:(NSData *)options toMechanism:(FRAMechanism *)mechanism error:(NSError *__autoreleasing *)error {
+    NSDictionary *optionsMap;
+    if (![FRASerialization deserializeData:options intoDictionary:&optionsMap error:error]) {
+        return NO;
+    }
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        if (!fields[i].changesWithUse) {
+            continue;
+        }
+        id value = FRAMechanismFieldValue(fields[i].type, [optionsMap objectForKey:fields[i].optionKey]);
+        if (!value) {
+            if (error) {
+                *error = [FRAError createError:[NSString stringWithFormat:@"Stored %@ mechanism has no %@", self.type, fields[i].optionKey]];
+            }
+            return NO;
+        }
+        fields[i].set(mechanism, value);
+    }
+    return YES;
+}
+
+- (FRAMechanism *)mechanismWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel version:(NSInteger)version mechanismUID:(NSString *)mechanismUID options:(NSData *)options error:(NSError *__autoreleasing *)error {
+    NSDictionary *optionsMap;
+    if (![FRASerialization deserializeData:options intoDictionary:&optionsMap error:error]) {
+        return nil;
+    }
+    
+    FRAMechanism *mechanism = [[self.mechanismClass alloc] initWithDatabase:database identityModel:identityModel];
+    mechanism.version = version;
+    if (setMechanismUID) {
+        setMechanismUID(mechanism, mechanismUID);
+    }
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        id value = FRAMechanismFieldValue(fields[i].type, [optionsMap objectForKey:fields[i].optionKey]);
+        if (value) {
+            fields[i].set(mechanism, value);
+        }
+    }
+    return mechanism;
+}
+
+@end
@@ -0,0 +1,113 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRAHotpOathMechanism.h"
+#import "FRAMechanism.h"
+#import "FRAPushMechanism.h"
+#import "FRATotpOathMechanism.h"
+
+/*!
+ * Extension interface for FRAMechanism defining protected properties that should only be accessible to subclasses
+ * and to the code which restores mechanisms from storage.
+ */
+@interface FRAMechanism ()
+
+/*!
+ * The version number of this mechanism.
+ */
+@property (nonatomic, readwrite) NSInteger version;
+
+@end
+
+/*!
+ * Extension interface for FRAHotpOathMechanism defining protected properties that should only be accessible to
+ * the code which restores mechanisms from storage.
+ */
+@interface FRAHotpOathMechanism ()
+
+/*!
+ * The length of the codes generated.
+ */
+@property (nonatomic, readwrite) NSUInteger codeLength;
+
+/*!
+ * The secret key, which is moved into the key arena when set.
+ */
+@property (nonatomic, readwrite) NSData *secretKey;
+
+/*!
+ * The HMAC algorithm used to generate codes.
+ */
+@property (nonatomic, readwrite) CCHmacAlgorithm algorithm;
+
+/*!
+ * The HMAC counter which is used to generate the next hash code.
+ */
+@property (nonatomic, readwrite) u_int64_t counter;
+
+@end
+
+/*!
+ * Extension interface for FRATotpOathMechanism defining protected properties that should only be accessible to
+ * the code which restores mechanisms from storage.
+ */
+@interface FRATotpOathMechanism ()
+
+/*!
+ * The length of the codes generated.
+ */
+@property (nonatomic, readwrite) NSUInteger codeLength;
+
+/*!
+ * The secret key, which is moved into the key arena when set.
+ */
+@property (nonatomic, readwrite) NSData *secretKey;
+
+/*!
+ * The HMAC algorithm used to generate codes.
+ */
+@property (nonatomic, readwrite) CCHmacAlgorithm algorithm;
+
+/*!
+ * The number of seconds for which each code is valid.
+ */
+@property (nonatomic, readwrite) u_int32_t period;
+
+@end
+
+/*!
+ * Extension interface for FRAPushMechanism defining protected properties that should only be accessible to the
+ * code which restores mechanisms from storage.
+ */
+@interface FRAPushMechanism ()
+
+/*!
+ * The shared secret, from which the crypto context is derived when set.
+ */
+@property (nonatomic, readwrite) NSString *secret;
+
+/*!
+ * The endpoint to which responses to notifications are sent.
+ */
+@property (nonatomic, readwrite) NSString *authEndpoint;
+
+/*!
+ * The identifier by which notifications refer to this mechanism.
+ */
+@property (nonatomic, readwrite) NSString *mechanismUID;
+
+@end
@@ -0,0 +1,77 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/*!
+ * An otpauth:// or pushauth:// URI read from a QR code.
+ *
+ * The URI is parsed once by FRAUriParse; parameters are kept as spans over the URI and only decoded into
+ * strings when they are asked for.
+ */
+@interface FRAMechanismUri : NSObject
+
+/*!
+ * The scheme of the URI, e.g. otpauth.
+ */
+@property (nonatomic, readonly) NSString *scheme;
+
+/*!
+ * The mechanism type, e.g. totp, held in the host of the URI.
+ */
+@property (nonatomic, readonly) NSString *type;
+
+/*!
+ * The percent-decoded issuer prefix of the path, or the empty string if the path has none.
+ */
+@property (nonatomic, readonly) NSString *issuer;
+
+/*!
+ * The percent-decoded account name of the path.
+ */
+@property (nonatomic, readonly) NSString *label;
+
+/*!
+ * Parse a URI.
+ *
+ * @param url The URI to parse.
+ * @return The parsed URI, or nil if it has no scheme, type or path.
+ */
++ (instancetype)uriWithURL:(NSURL *)url;
+
+/*!
+ * Returns YES if the scheme of the URI is the given scheme, without creating a string for it.
+ *
+ * @param scheme The expected scheme.
+ * @return YES if the scheme matches, NO otherwise.
+ */
+- (BOOL)hasScheme:(NSString *)scheme;
+
+/*!
+ * The percent-decoded value of a query parameter. When a parameter is repeated, the last value wins.
+ *
+ * @param name The name of the parameter.
+ * @return The decoded value, or nil if the parameter is absent or does not decode to UTF-8.
+ */
+- (NSString *)parameter:(NSString *)name;
+
+/*!
+ * The value of a query parameter as it appears in the URI.
+ *
+ * @param name The name of the parameter.
+ * @return The value, or nil if the parameter is absent.
+ */
+- (NSString *)rawParameter:(NSString *)name;
+
+@end
@@ -0,0 +1,114 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include "FRAUriParser.h"
+
+#import "FRAMechanismUri.h"
+
+/*! Values up to this length are decoded on the stack. */
+static const size_t FRAMaximumStackDecodeLength = 256;
+
+static NSString *stringFromSpan(FRAUriSpan span) {
+    return [[NSString alloc] initWithBytes:span.bytes length:span.length encoding:NSUTF8StringEncoding];
+}
+
+static NSString *decodedStringFromSpan(FRAUriSpan span) {
+    if (!FRAUriSpanNeedsDecoding(span)) {
+        return stringFromSpan(span);
+    }
+    if (span.length <= FRAMaximumStackDecodeLength) {
+        char buffer[FRAMaximumStackDecodeLength];
+        size_t length = FRAUriPercentDecode(span, buffer);
+        return [[NSString alloc] initWithBytes:buffer length:length encoding:NSUTF8StringEncoding];
+    }
+    NSMutableData *buffer = [NSMutableData dataWithLength:span.length];
+    size_t length = FRAUriPercentDecode(span, buffer.mutableBytes);
+    return [[NSString alloc] initWithBytes:buffer.bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+@implementation FRAMechanismUri {
+    NSData *bytes;
+    FRAUri uri;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
++ (instancetype)uriWithURL:(NSURL *)url {
+    NSData *bytes = [[url absoluteString] dataUsingEncoding:NSUTF8StringEncoding];
+    if (!bytes) {
+        return nil;
+    }
+    return [[FRAMechanismUri alloc] initWithBytes:bytes];
+}
+
+- (instancetype)initWithBytes:(NSData *)data {
+    self = [super init];
+    if (self) {
+        bytes = data;
+        if (FRAUriParse(bytes.bytes, bytes.length, &uri) != 0) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (NSString *)scheme {
+    return stringFromSpan(uri.scheme);
+}
+
+- (NSString *)type {
+    return stringFromSpan(uri.type);
+}
+
+- (NSString *)issuer {
+    return decodedStringFromSpan(uri.issuer);
+}
+
+- (NSString *)label {
+    return decodedStringFromSpan(uri.label);
+}
+
+- (BOOL)hasScheme:(NSString *)scheme {
+    const char *expected = [scheme UTF8String];
+    return expected && FRAUriSpanEquals(uri.scheme, expected, strlen(expected));
+}
+
+- (NSString *)parameter:(NSString *)name {
+    const FRAUriParameter *parameter = [self findParameter:name];
+    return parameter ? decodedStringFromSpan(parameter->value) : nil;
+}
+
+- (NSString *)rawParameter:(NSString *)name {
+    const FRAUriParameter *parameter = [self findParameter:name];
+    return parameter ? stringFromSpan(parameter->value) : nil;
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+- (const FRAUriParameter *)findParameter:(NSString *)name {
+    const char *key = [name UTF8String];
+    if (!key) {
+        return NULL;
+    }
+    return FRAUriFindParameter(&uri, key, strlen(key));
+}
+
+@end
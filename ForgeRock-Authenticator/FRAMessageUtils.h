@@ -15,8 +15,8 @@
  */
 
 #import <AFNetworking.h>
-#import <JWT.h>
-#import <JWTAlgorithmFactory.h>
+
+@class FRAPushCryptoContext;
 
 /*!
  * Class that handles communication with OpenAM.
@@ -57,6 +57,69 @@
                    protocol:(Class) protocol
                     handler:(void (^)(NSInteger statusCode, NSError *error))handler;
 
+/*!
+ * POST request method, signing the JWT with the cached crypto context of a push mechanism.
+ *
+ * @param endpoint The URL string used to create the request URL.
+ * @param cryptoContext The crypto context used to sign the JWT.
+ * @param messageId The id of the message.
+ * @param data The payload to transmit with the request.
+ * @param handler A block object to be executed when the task finishes.
+ */
++ (void)respondWithEndpoint:(NSString *)endpoint
+              cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                  messageId:(NSString *)messageId
+     loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                       data:(NSDictionary *)data
+                    handler:(void (^)(NSInteger statusCode, NSError *error))handler;
+
+/*!
+ * POST request method, signing the JWT with the cached crypto context of a push mechanism.
+ *
+ * @param endpoint The URL string used to create the request URL.
+ * @param cryptoContext The crypto context used to sign the JWT.
+ * @param messageId The id of the message.
+ * @param data The payload to transmit with the request.
+ * @param protocol The protocol used to process URLs.
+ * @param handler A block object to be executed when the task finishes.
+ */
++ (void)respondWithEndpoint:(NSString *)endpoint
+              cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                  messageId:(NSString *)messageId
+     loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                       data:(NSDictionary *)data
+                   protocol:(Class) protocol
+                    handler:(void (^)(NSInteger statusCode, NSError *error))handler;
+
+/*!
+ * POST a payload which has already been signed, for example one which was queued while the device was offline.
+ * A payload identical to one in flight, or to one recently accepted or rejected, is not sent again; see
+ * FRAInFlightRequestTable. A payload without a messageId is always sent.
+ *
+ * @param payload The request body, as built by payloadWithMessageId:cryptoContext:data:.
+ * @param endpoint The URL string used to create the request URL.
+ * @param loadBalancerCookieData The load balancer cookie of the message, or nil.
+ * @param protocol The protocol used to process URLs, or nil.
+ * @param handler A block object to be executed when the task finishes.
+ */
++ (void)postPayload:(NSDictionary *)payload
+         toEndpoint:(NSString *)endpoint
+loadBalancerCookieData:(NSString *)loadBalancerCookieData
+           protocol:(Class)protocol
+            handler:(void (^)(NSInteger statusCode, NSError *error))handler;
+
+/*!
+ * Build the request body of a response to a message, signing the data as a JWT.
+ *
+ * @param messageId The id of the message.
+ * @param cryptoContext The crypto context used to sign the JWT.
+ * @param data The claims to sign.
+ * @return The request body, holding the message id and the signed JWT.
+ */
++ (NSDictionary *)payloadWithMessageId:(NSString *)messageId
+                         cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                                  data:(NSDictionary *)data;
+
 /*!
  * Generate challenge response.
  *
@@ -67,11 +130,21 @@
 + (NSString *) generateChallengeResponse:(NSString *) challenge secret:(NSString *) secret;
 
 /*!
- * Extracts the data from the body of a JWT string;
+ * Generate challenge response with the cached crypto context of a push mechanism.
+ *
+ * @param challenge The challenge.
+ * @param cryptoContext The crypto context of the mechanism.
+ * @return The challenge response.
+ */
++ (NSString *)generateChallengeResponse:(NSString *)challenge cryptoContext:(FRAPushCryptoContext *)cryptoContext;
+
+/*!
+ * Extracts the data from the body of a JWT string, with every claim and its JSON type. The signature is not
+ * verified; use FRAPushMessage to check it against the key of the target mechanism.
  *
  * @param message The compleye JWT string.
   * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
- * @return The data from the body of the JWT.
+ * @return The data from the body of the JWT, or nil if the JWT is malformed.
  */
 + (NSDictionary *)extractJTWBodyFromString:(NSString *)message error:(NSError *__autoreleasing*)error;
 
@@ -14,9 +14,11 @@
  * Copyright 2016 ForgeRock AS.
  */
 
-#include <CommonCrypto/CommonHMAC.h>
-
+#import "FRAError.h"
+#import "FRAHTTPSessionPool.h"
+#import "FRAInFlightRequestTable.h"
 #import "FRAMessageUtils.h"
+#import "FRAPushCryptoContext.h"
 #import "FRAQRUtils.h"
 
 /*! The Communication mechanism Content Type. */
@@ -48,81 +50,114 @@ static NSString * const ACCEPT_API_VERSION_HEADER_VALUE = @"resource=1.0, protoc
                        data:(NSDictionary *)data
                    protocol:(Class) protocol
                     handler:(void (^)(NSInteger, NSError *))handler {
+    [self respondWithEndpoint:endpoint cryptoContext:[FRAPushCryptoContext contextWithBase64Secret:base64Secret] messageId:messageId loadBalancerCookieData:loadBalancerCookieData data:data protocol:protocol handler:handler];
+}
+
++ (void)respondWithEndpoint:(NSString *)endpoint
+              cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                  messageId:(NSString *)messageId
+     loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                       data:(NSDictionary *)data
+                    handler:(void (^)(NSInteger, NSError *))handler {
+    [self respondWithEndpoint:endpoint cryptoContext:cryptoContext messageId:messageId loadBalancerCookieData:loadBalancerCookieData data:data protocol:nil handler:handler];
+}
+
++ (void)respondWithEndpoint:(NSString *)endpoint
+              cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                  messageId:(NSString *)messageId
+     loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                       data:(NSDictionary *)data
+                   protocol:(Class) protocol
+                    handler:(void (^)(NSInteger, NSError *))handler {
     
-    NSURL *URL = [NSURL URLWithString:endpoint];
-    NSDictionary *payload = [self createPayloadWithMessageId:messageId base64Secret:base64Secret data:data];
+    NSDictionary *payload = [self payloadWithMessageId:messageId cryptoContext:cryptoContext data:data];
+    [self postPayload:payload toEndpoint:endpoint loadBalancerCookieData:loadBalancerCookieData protocol:protocol handler:handler];
+}
+
++ (void)postPayload:(NSDictionary *)payload
+         toEndpoint:(NSString *)endpoint
+loadBalancerCookieData:(NSString *)loadBalancerCookieData
+           protocol:(Class)protocol
+            handler:(void (^)(NSInteger, NSError *))handler {
     
-    AFHTTPSessionManager *manager = [self createHTTPSessionManager:protocol];
-    [manager setRequestSerializer:[AFJSONRequestSerializer serializer]];
-    [manager.requestSerializer setValue:JSON_CONTENT_TYPE forHTTPHeaderField:CONTENT_TYPE_HEADER];
-    [manager.requestSerializer setValue:loadBalancerCookieData forHTTPHeaderField:SET_COOKIE_HEADER];
-    [manager.requestSerializer setValue:ACCEPT_API_VERSION_HEADER_VALUE forHTTPHeaderField:ACCEPT_API_VERSION_HEADER];
+    NSURL *URL = [NSURL URLWithString:endpoint];
     
-    [manager POST:URL.absoluteString
-      parameters:payload
-        progress:nil
-         success:^(NSURLSessionTask *task, id responseObject) {
-             handler([(NSHTTPURLResponse*)task.response statusCode], nil);
-         } failure:^(NSURLSessionTask *task, NSError *error) {
-             NSLog(@"Error code = %li", [(NSHTTPURLResponse*)task.response statusCode]);
-            
-             handler([(NSHTTPURLResponse*)task.response statusCode], error);
-         }];
+    // Headers differ per request, so they go on a request of our own rather than on the pooled manager
+    AFJSONRequestSerializer *requestSerializer = [AFJSONRequestSerializer serializer];
+    [requestSerializer setValue:JSON_CONTENT_TYPE forHTTPHeaderField:CONTENT_TYPE_HEADER];
+    [requestSerializer setValue:loadBalancerCookieData forHTTPHeaderField:SET_COOKIE_HEADER];
+    [requestSerializer setValue:ACCEPT_API_VERSION_HEADER_VALUE forHTTPHeaderField:ACCEPT_API_VERSION_HEADER];
+    NSError *serializationError;
+    NSMutableURLRequest *request = [requestSerializer requestWithMethod:@"POST" URLString:URL.absoluteString parameters:payload error:&serializationError];
+    if (!request) {
+        handler(0, serializationError);
+        return;
+    }
     
-}
-
-+ (AFHTTPSessionManager *)createHTTPSessionManager:(Class)protocol {
+    void (^send)(void (^)(NSInteger, NSError *)) = ^(void (^complete)(NSInteger, NSError *)) {
+        FRAHTTPSessionPool *pool = [FRAHTTPSessionPool sharedPool];
+        AFHTTPSessionManager *manager = [pool sessionManagerForURL:URL protocol:protocol];
+        NSURLSessionDataTask *task = [manager dataTaskWithRequest:request completionHandler:^(NSURLResponse *response, id responseObject, NSError *error) {
+            NSInteger statusCode = [(NSHTTPURLResponse *)response statusCode];
+            if (error) {
+                NSLog(@"Error code = %li", (long)statusCode);
+            }
+            complete(statusCode, error);
+        }];
+        [task resume];
+        [pool releaseSessionManager:manager];
+    };
     
-    if(protocol) {
-        NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration defaultSessionConfiguration];
-        NSMutableArray * protocolsArray = [sessionConfiguration.protocolClasses mutableCopy];
-        [protocolsArray insertObject:protocol atIndex:0];
-        sessionConfiguration.protocolClasses = protocolsArray;
-        
-        return [[AFHTTPSessionManager alloc] initWithSessionConfiguration:sessionConfiguration];
+    // A payload without a message id cannot be matched to other responses, so is always sent
+    NSString *messageId = payload[@"messageId"];
+    if (!messageId) {
+        send(handler);
+        return;
     }
     
-    return [AFHTTPSessionManager manager];
+    // Identical responses to the same message, from a double slide or a retry, share one network operation
+    NSArray *fingerprint = @[URL.absoluteString ?: @"", payload, loadBalancerCookieData ?: [NSNull null]];
+    [[FRAInFlightRequestTable sharedTable] performRequestWithMessageId:messageId
+                                                           fingerprint:fingerprint
+                                                               handler:handler
+                                                                  send:send];
 }
 
-+ (NSDictionary *)createPayloadWithMessageId:(NSString *)messageId
-                                base64Secret:(NSString *)base64Secret
-                                        data:(NSDictionary *)data {
-    NSString *jwtData = [self generateJwtWithPayload:data base64Secret:base64Secret];
++ (NSDictionary *)payloadWithMessageId:(NSString *)messageId
+                         cryptoContext:(FRAPushCryptoContext *)cryptoContext
+                                  data:(NSDictionary *)data {
+    NSString *jwtData = [cryptoContext jwtWithPayload:data] ?: @"";
     NSDictionary *topLevelData = @{@"messageId":messageId, @"jwt":jwtData};
     
     return topLevelData;
 }
 
-+ (NSString *)generateJwtWithPayload:(NSDictionary *)payload base64Secret:(NSString *)base64Secret {
-    id<JWTAlgorithm> algorithm = [JWTAlgorithmFactory algorithmByName:@"HS256"];
-    NSData *secretBytes = [FRAQRUtils decodeURL:base64Secret];
-    
-    return (secretBytes) ? [JWTBuilder encodePayload:payload].secretData(secretBytes).algorithm(algorithm).encode : @"";
-}
-
 + (NSDictionary *)extractJTWBodyFromString:(NSString *)message error:(NSError *__autoreleasing*)error {
-    NSArray* strings = [message componentsSeparatedByString:@"."];
-    NSString* payloadString = strings[1];
-    payloadString = [FRAQRUtils pad:payloadString];
+    NSArray<NSString *> *strings = [message componentsSeparatedByString:@"."];
+    NSData *payloadBytes = strings.count > 1 ? [FRAQRUtils decodeURL:strings[1]] : nil;
+    if (!payloadBytes) {
+        if (error) {
+            *error = [FRAError createError:@"Invalid push message" code:FRAInvalidPushMessage];
+        }
+        return nil;
+    }
     
-    NSData *payloadBytes = [[NSData alloc] initWithBase64EncodedString:payloadString options:0];
-
-    return [NSJSONSerialization JSONObjectWithData:payloadBytes
-                                           options:NSJSONReadingMutableContainers
-                                             error:error];
+    id body = [NSJSONSerialization JSONObjectWithData:payloadBytes
+                                              options:NSJSONReadingMutableContainers
+                                                error:error];
+    return [body isKindOfClass:[NSDictionary class]] ? body : nil;
 }
 
 + (NSString *)generateChallengeResponse:(NSString *)challenge secret:(NSString *)secret {
-    
-    NSData *saltData = [FRAQRUtils decodeURL:secret];
-    NSData *paramData = [FRAQRUtils decodeBase64:challenge];
-    
-    NSMutableData * data = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
-    CCHmac(kCCHmacAlgSHA256, saltData.bytes, saltData.length, paramData.bytes, paramData.length, data.mutableBytes);
-    NSString * hashedResponseString = [data base64EncodedStringWithOptions:0];
-    
-    return hashedResponseString;
+    return [self generateChallengeResponse:challenge cryptoContext:[FRAPushCryptoContext contextWithBase64Secret:secret]];
+}
+
++ (NSString *)generateChallengeResponse:(NSString *)challenge cryptoContext:(FRAPushCryptoContext *)cryptoContext {
+    // An undecodable secret has always been treated as an empty key
+    if (!cryptoContext) {
+        cryptoContext = [[FRAPushCryptoContext alloc] initWithKey:nil];
+    }
+    return [cryptoContext challengeResponse:challenge];
 }
 
 @end
@@ -27,6 +27,11 @@
  */
 @property (nonatomic, strong) FRAIdentityDatabase* database;
 
+/*!
+ * The identity model which contains this object.
+ */
+@property (nonatomic, readonly) FRAIdentityModel *identityModel;
+
 /*!
  * Indicates whether this model object has been persisted to the database.
  * YES indicates it has been stored, NO indicates it has not yet been stored.
@@ -34,4 +34,35 @@
  */
 + (NSArray<FRAIdentity*> *)allIdentitiesWithDatabase:(FRAFMDatabaseConnectionHelper *)sqlDatabase identityDatabase:(FRAIdentityDatabase *)identityDatabase identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error;
 
+/*!
+ * Read all Notifications from the database and add them to the Push Mechanisms of
+ * identities which were read some other way, such as from the identity snapshot file.
+ *
+ * @param sqlDatabase The SQL Database to read the notifications from.
+ * @param identities The identities whose Push Mechanisms receive the notifications.
+ * @param identityDatabase Assigned to the model objects created.
+ * @param identityModel The identity model which contains the list of identities.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if the notifications could not be read.
+ */
++ (BOOL)addNotificationsWithDatabase:(FRAFMDatabaseConnectionHelper *)sqlDatabase toIdentities:(NSArray<FRAIdentity*> *)identities identityDatabase:(FRAIdentityDatabase *)identityDatabase identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Read the options which change with use, such as the counters of HOTP Mechanisms, from the database and restore
+ * them to the Mechanisms of identities which were read some other way, such as from the identity snapshot file.
+ *
+ * @param sqlDatabase The SQL Database to read the options from.
+ * @param identities The identities whose Mechanisms receive the options.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if the options could not be read, or if a Mechanism which has such options is not in the database.
+ */
++ (BOOL)restoreOptionsChangingWithUseWithDatabase:(FRAFMDatabaseConnectionHelper *)sqlDatabase toIdentities:(NSArray<FRAIdentity*> *)identities error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Mark identities, along with their mechanisms and notifications, as stored.
+ *
+ * @param identities The identities which were read from storage.
+ */
++ (void)markStored:(NSArray<FRAIdentity*> *)identities;
+
 @end
\ No newline at end of file
@@ -16,16 +16,18 @@
 
 
 #import "FMDatabase.h"
+#import "FRABinarySerialization.h"
 #import "FRAError.h"
 #import "FRAFMDatabaseConnectionHelper.h"
-#import "FRAOathCode.h"
 #import "FRAIdentity.h"
+#import "FRAIdentityDatabase.h"
+#import "FRAIdentityDatabaseSQLiteOperations.h"
+#import "FRAMechanism.h"
+#import "FRAMechanismDescriptor.h"
+#import "FRAMechanismProtected.h"
 #import "FRAModelObjectProtected.h"
 #import "FRAModelsFromDatabase.h"
 #import "FRANotification.h"
-#import "FRAHotpOathMechanism.h"
-#import "FRATotpOathMechanism.h"
-#import "FRAPushMechanism.h"
 #import "FRASerialization.h"
 
 /*!
@@ -71,6 +73,8 @@
         NSLog(@"Reading all rows from the database:");
         
         NSMutableArray* identities = [[NSMutableArray alloc] init];
+        NSMutableDictionary<NSString *, FRAMechanism *> *mechanismsByUID = [[NSMutableDictionary alloc] init];
+        NSMutableArray<FRAMechanism *> *legacyMechanisms = [[NSMutableArray alloc] init];
         
         int row = 0;
         while ([results next]) {
@@ -83,11 +87,11 @@
             NSString *type = [FRASerialization nullToEmpty:[results stringForColumn:@"type"]];
             NSInteger version = [results intForColumn:@"version"];
             NSString *mechanismUID = [FRASerialization nullToEmpty:[results stringForColumn:@"mechanismUID"]];
-            NSString *optionsJSON = [FRASerialization nullToEmpty:[results stringForColumn:@"options"]];
+            NSData *options = [results dataForColumn:@"options"];
             // Notification
             NSString *timeReceived = [FRASerialization nullToEmpty:[results stringForColumn:@"timeReceived"]];
             NSString *timeExpired = [FRASerialization nullToEmpty:[results stringForColumn:@"timeExpired"]];
-            NSString *data = [FRASerialization nullToEmpty:[results stringForColumn:@"data"]];
+            NSData *data = [results dataForColumn:@"data"];
             int pending = [results intForColumn:@"pending"];
             int approved = [results intForColumn:@"approved"];
             
@@ -130,182 +134,233 @@
                 [identities addObject:newIdentity];
             }
             
-            // Formatter for parsing numbers from Strings.
-            NSNumberFormatter *numberFormatter = [[NSNumberFormatter alloc] init];
-            numberFormatter.numberStyle = NSNumberFormatterDecimalStyle;
+            // Create the Mechanism from the descriptor registered for its type
+            FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForType:type];
+            if (!descriptor) {
+                @throw [FRAError createIllegalStateException:@"Invalid mechanism"];
+            }
             
-            // Create the Mechanism
-            if ([type  isEqualToString:[FRAHotpOathMechanism mechanismType]]) {
-                
-                // Options Map is a String to String mapping stored in JSON.
-                NSDictionary *optionsMap;
-                if (![FRASerialization deserializeJSON:optionsJSON intoDictionary:&optionsMap error:error]) {
+            // A mechanism with an identifier is repeated on the row of each of its notifications, so re-use it.
+            NSString *uid = descriptor.hasMechanismUID ? mechanismUID : nil;
+            FRAMechanism *newMechanism = uid ? mechanismsByUID[uid] : nil;
+            if (!newMechanism) {
+                newMechanism = [descriptor mechanismWithDatabase:identityDatabase
+                                                   identityModel:identityModel
+                                                         version:version
+                                                    mechanismUID:uid
+                                                         options:options
+                                                           error:error];
+                if (!newMechanism || ![newIdentity addMechanism:newMechanism error:error]) {
                     return nil;
                 }
-                
-                // Secret Key - Base 64 encoded bytes
-                NSString *secretValue = [optionsMap objectForKey:OATH_MECHANISM_SECRET];
-                NSData* secret = [FRASerialization deserializeSecret:secretValue];
-                
-                // Algorithm - String enumeration
-                NSString *algorithmValue = [optionsMap objectForKey:OATH_MECHANISM_ALGORITHM];
-                CCHmacAlgorithm algorithm = [FRAOathCode fromString:algorithmValue];
-                
-                // Code Length - String value of Integer
-                NSString *codeLengthValue = [optionsMap objectForKey:OATH_MECHANISM_DIGITS];
-                int codeLength = [[numberFormatter numberFromString:codeLengthValue] intValue];
-                
-                // Counter - String value of unsigned Long Long
-                NSString *counterValue = [optionsMap objectForKey:OATH_MECHANISM_COUNTER];
-                u_int64_t counter = [[numberFormatter numberFromString:counterValue] unsignedLongLongValue];
-                
-                FRAHotpOathMechanism *newMechanism = [FRAHotpOathMechanism mechanismWithDatabase:identityDatabase
-                                                                                   identityModel:identityModel
-                                                                                       secretKey:secret
-                                                                                   HMACAlgorithm:algorithm
-                                                                                      codeLength:codeLength
-                                                                                         counter:counter];
-                
-                // Note: We are not de-duplicating OATH Mechanism because they will not be duplicated in the SQL results.
-                if (![newIdentity addMechanism:newMechanism error:error]) {
-                    return nil;
+                if (uid) {
+                    mechanismsByUID[uid] = newMechanism;
                 }
-                
-            } else if ([type isEqualToString:[FRATotpOathMechanism mechanismType]]) {
-                
-                // Options Map is a String to String mapping stored in JSON.
-                NSDictionary *optionsMap;
-                if (![FRASerialization deserializeJSON:optionsJSON intoDictionary:&optionsMap error:error]) {
-                    return nil;
+                if (options.length > 0 && ![FRABinarySerialization isBinaryEncoded:options]) {
+                    [legacyMechanisms addObject:newMechanism];
                 }
-                
-                // Secret Key - Base 64 encoded bytes
-                NSString *secretValue = [optionsMap objectForKey:OATH_MECHANISM_SECRET];
-                NSData* secret = [FRASerialization deserializeSecret:secretValue];
-                
-                // Algorithm - String enumeration
-                NSString *algorithmValue = [optionsMap objectForKey:OATH_MECHANISM_ALGORITHM];
-                CCHmacAlgorithm algorithm = [FRAOathCode fromString:algorithmValue];
-                
-                // Code Length - String value of Integer
-                NSString *codeLengthValue = [optionsMap objectForKey:OATH_MECHANISM_DIGITS];
-                int codeLength = [[numberFormatter numberFromString:codeLengthValue] intValue];
-                
-                // Period - String value of unsigned Integer
-                NSString *periodValue = [optionsMap objectForKey:OATH_MECHANISM_PERIOD];
-                u_int32_t period = [[numberFormatter numberFromString:periodValue] unsignedIntValue];
-                
-                FRATotpOathMechanism *newMechanism = [FRATotpOathMechanism mechanismWithDatabase:identityDatabase
-                                                                                   identityModel:identityModel
-                                                                                       secretKey:secret
-                                                                                   HMACAlgorithm:algorithm
-                                                                                      codeLength:codeLength
-                                                                                          period:period];
-                
-                // Note: We are not de-duplicating OATH Mechanism because they will not be duplicated in the SQL results.
-                if (![newIdentity addMechanism:newMechanism error:error]) {
-                    return nil;
-                }
-                
-            } else if ([type isEqualToString:[FRAPushMechanism mechanismType]]) {
-                
-                // Options Map is a String to String mapping stored in JSON.
-                NSDictionary *optionsMap;
-                if (![FRASerialization deserializeJSON:optionsJSON intoDictionary:&optionsMap error:error]) {
+            }
+            
+            // If we have a notification, parse and create the Notification for the Mechanism.
+            // Note: Notifications refer to their mechanism by its identifier, so only such mechanisms have them.
+            if (uid && timeReceived != nil && [timeReceived length] > 0) {
+                FRANotification *notification = [self notificationWithTimeReceived:timeReceived data:data pending:pending approved:approved identityDatabase:identityDatabase identityModel:identityModel error:error];
+                if (!notification || ![newMechanism addNotification:notification error:error]) {
                     return nil;
                 }
-                
-                // Secret stored as String (Base64?)
-                NSString *secretValue = [optionsMap objectForKey:PUSH_MECHANISM_SECRET];
-                
-                // Auth Endpoint as string
-                NSString *authEndpointValue = [optionsMap objectForKey:PUSH_MECHANISM_AUTH_END_POINT];
-                
-                // Version as string
-                NSString *versionString = [optionsMap objectForKey:PUSH_MECHANISM_VERSION];
-                NSInteger version = [[numberFormatter numberFromString:versionString] integerValue];
-                
-                
-                FRAPushMechanism *newMechanism = [FRAPushMechanism pushMechanismWithDatabase:identityDatabase
-                                                                               identityModel:identityModel
-                                                                                authEndpoint:authEndpointValue
-                                                                                      secret:secretValue
-                                                                                     version:version
-                                                                         mechanismIdentifier:mechanismUID];
-                
-                
-                // Check to see if we already have this PushMechanism present, otherwise add it in.
-                BOOL add = true;
-                for (FRAMechanism *mechanism in newIdentity.mechanisms) {
-                    if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
-                        FRAPushMechanism *pushMechanism = (FRAPushMechanism *)mechanism;
-                        if ([pushMechanism.mechanismUID isEqualToString:newMechanism.mechanismUID]) {
-                            newMechanism = pushMechanism;
-                            add = false;
-                            break;
-                        }
-                    }
-                }
-                
-                if (add) {
-                    if (![newIdentity addMechanism:newMechanism error:error]) {
-                        return nil;
-                    }
-                }
-
-                // If we have a notification, parse and create the Notification for the Push Mechanism.
-                // Note: Notifications can only currently exist for PushMechanisms.
-                if (timeReceived != nil && [timeReceived length] > 0) {
-                    
-                    // Extract notifcation data from database
-                    NSDate *dateTimeReceived = [NSDate dateWithTimeIntervalSince1970:[timeReceived doubleValue]];
-                    NSDictionary *dataMap;
-                    if (![FRASerialization deserializeJSON:data intoDictionary:&dataMap error:error]) {
-                        return nil;
-                    }
-                    NSString *messageId = [dataMap valueForKey:NOTIFICATION_MESSAGE_ID];
-                    NSString *challenge = [[NSString alloc] initWithData:[FRASerialization deserializeBytes:[dataMap valueForKey:NOTIFICATION_PUSH_CHALLENGE]] encoding:NSUTF8StringEncoding];
-                    NSTimeInterval ttl = [[dataMap valueForKey:NOTIFICATION_TIME_TO_LIVE] doubleValue];
-                    NSString *loadBalancerCookieData = [dataMap valueForKey:NOTIFICATION_LOAD_BALANCER_COOKIE];
-                    
-                    // recreate notificaiton
-                    FRANotification *notification = [FRANotification notificationWithDatabase:identityDatabase
-                                                                                identityModel:identityModel
-                                                                                    messageId:messageId
-                                                                                    challenge:challenge
-                                                                                 timeReceived:dateTimeReceived
-                                                                                   timeToLive:ttl
-                                                                       loadBalancerCookieData:loadBalancerCookieData
-                                                                                      pending:pending
-                                                                                     approved:approved];
-                    
-                    if (![newMechanism addNotification:notification error:error]) {
-                        return nil;
-                    }
-                }
-                
-            } else {
-                @throw [FRAError createIllegalStateException:@"Invalid mechanism"];
             }
         }
         
         // As we have read the objects from the database, marked them as stored.
-        for (FRAIdentity* identity in identities) {
-            identity.stored = YES;
-            for (FRAMechanism *mechanism in identity.mechanisms) {
-                mechanism.stored = YES;
-                for (FRANotification *notification in mechanism.notifications) {
-                    notification.stored = YES;
-                }
+        [self markStored:identities];
+        
+        [sqlDatabase closeConnectionToDatabase:database];
+        database = nil;
+        [self upgradeLegacyMechanisms:legacyMechanisms identityDatabase:identityDatabase];
+        
+        return identities;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+/*!
+ * Rewrites mechanisms whose options were stored as JSON by earlier versions, so that their secrets are kept as raw
+ * bytes and are not decoded from hex again on the next load. A mechanism which cannot be rewritten is upgraded on a
+ * later load instead.
+ */
++ (void)upgradeLegacyMechanisms:(NSArray<FRAMechanism *> *)mechanisms identityDatabase:(FRAIdentityDatabase *)identityDatabase {
+    for (FRAMechanism *mechanism in mechanisms) {
+        NSError *error;
+        if (![identityDatabase.sqlOperations updateMechanism:mechanism error:&error]) {
+            NSLog(@"Could not upgrade the stored options of a mechanism: %@", error);
+        }
+    }
+}
+
++ (BOOL)addNotificationsWithDatabase:(FRAFMDatabaseConnectionHelper *)sqlDatabase toIdentities:(NSArray<FRAIdentity*> *)identities identityDatabase:(FRAIdentityDatabase *)identityDatabase identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error {
+    
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"read_all_notifications" withError:error];
+    if (!sql) {
+        return NO;
+    }
+    
+    NSMutableDictionary<NSString *, FRAMechanism *> *mechanismsByUID = [[NSMutableDictionary alloc] init];
+    for (FRAIdentity *identity in identities) {
+        for (FRAMechanism *mechanism in identity.mechanisms) {
+            NSString *mechanismUID = [[FRAMechanismDescriptor descriptorForMechanism:mechanism] mechanismUIDOfMechanism:mechanism];
+            if (mechanismUID) {
+                mechanismsByUID[mechanismUID] = mechanism;
+            }
+        }
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (!database) {
+            return NO;
+        }
+        
+        FMResultSet *results = [database executeQuery:sql];
+        if (!results) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
             }
+            return NO;
         }
+        
+        while ([results next]) {
+            NSString *mechanismUID = [FRASerialization nullToEmpty:[results stringForColumn:@"mechanismUID"]];
+            FRAMechanism *mechanism = mechanismsByUID[mechanismUID];
+            if (!mechanism) {
+                // Orphaned row, which the account list never showed either
+                continue;
+            }
+            FRANotification *notification = [self notificationWithTimeReceived:[FRASerialization nullToEmpty:[results stringForColumn:@"timeReceived"]]
+                                                                           data:[results dataForColumn:@"data"]
+                                                                        pending:[results intForColumn:@"pending"]
+                                                                       approved:[results intForColumn:@"approved"]
+                                                               identityDatabase:identityDatabase
+                                                                  identityModel:identityModel
+                                                                          error:error];
+            if (!notification || ![mechanism addNotification:notification error:error]) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
 
++ (BOOL)restoreOptionsChangingWithUseWithDatabase:(FRAFMDatabaseConnectionHelper *)sqlDatabase toIdentities:(NSArray<FRAIdentity*> *)identities error:(NSError *__autoreleasing *)error {
+    
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"read_mechanism_options" withError:error];
+    if (!sql) {
+        return NO;
+    }
+    
+    // An identity holds at most one mechanism of each type, so mechanisms are keyed by their identity and type
+    NSMutableDictionary<NSArray<NSString *> *, FRAMechanism *> *mechanismsByKey = [[NSMutableDictionary alloc] init];
+    NSMutableArray<FRAMechanismDescriptor *> *descriptors = [[NSMutableArray alloc] init];
+    for (FRAIdentity *identity in identities) {
+        for (FRAMechanism *mechanism in identity.mechanisms) {
+            FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+            if (descriptor.hasOptionsChangingWithUse) {
+                mechanismsByKey[@[identity.issuer, identity.accountName, descriptor.type]] = mechanism;
+                if (![descriptors containsObject:descriptor]) {
+                    [descriptors addObject:descriptor];
+                }
+            }
+        }
+    }
+    if (mechanismsByKey.count == 0) {
+        return YES;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [sqlDatabase getConnectionWithError:error];
+        if (!database) {
+            return NO;
+        }
         
-        return identities;
+        for (FRAMechanismDescriptor *descriptor in descriptors) {
+            FMResultSet *results = [database executeQuery:sql values:@[descriptor.type] error:error];
+            if (!results) {
+                return NO;
+            }
+            
+            while ([results next]) {
+                NSArray<NSString *> *key = @[[FRASerialization nullToEmpty:[results stringForColumn:@"idIssuer"]],
+                                             [FRASerialization nullToEmpty:[results stringForColumn:@"idAccountName"]],
+                                             descriptor.type];
+                FRAMechanism *mechanism = mechanismsByKey[key];
+                if (!mechanism) {
+                    continue;
+                }
+                if (![descriptor restoreOptionsChangingWithUse:[results dataForColumn:@"options"] toMechanism:mechanism error:error]) {
+                    return NO;
+                }
+                [mechanismsByKey removeObjectForKey:key];
+            }
+        }
     }
     @finally {
         [sqlDatabase closeConnectionToDatabase:database];
     }
+    
+    if (mechanismsByKey.count > 0) {
+        if (error) {
+            *error = [FRAError createError:@"Mechanism is missing from the database"];
+        }
+        return NO;
+    }
+    return YES;
+}
+
++ (void)markStored:(NSArray<FRAIdentity*> *)identities {
+    for (FRAIdentity* identity in identities) {
+        identity.stored = YES;
+        for (FRAMechanism *mechanism in identity.mechanisms) {
+            mechanism.stored = YES;
+            // Notifications in the history take their stored state from the mechanism when materialized
+            for (FRANotification *notification in mechanism.activeNotifications) {
+                notification.stored = YES;
+            }
+        }
+    }
+}
+
+/*!
+ * Recreates a notification from the columns of its row.
+ */
++ (FRANotification *)notificationWithTimeReceived:(NSString *)timeReceived data:(NSData *)data pending:(BOOL)pending approved:(BOOL)approved identityDatabase:(FRAIdentityDatabase *)identityDatabase identityModel:(FRAIdentityModel *)identityModel error:(NSError *__autoreleasing *)error {
+    
+    // Extract notifcation data from database
+    NSDate *dateTimeReceived = [NSDate dateWithTimeIntervalSince1970:[timeReceived doubleValue]];
+    NSDictionary *dataMap;
+    if (![FRASerialization deserializeData:data intoDictionary:&dataMap error:error]) {
+        return nil;
+    }
+    NSString *messageId = [dataMap valueForKey:NOTIFICATION_MESSAGE_ID];
+    NSString *challenge = [dataMap valueForKey:NOTIFICATION_PUSH_CHALLENGE];
+    NSTimeInterval ttl = [[FRASerialization numberFromValue:[dataMap valueForKey:NOTIFICATION_TIME_TO_LIVE]] doubleValue];
+    NSString *loadBalancerCookieData = [dataMap valueForKey:NOTIFICATION_LOAD_BALANCER_COOKIE];
+    
+    // recreate notificaiton
+    return [FRANotification notificationWithDatabase:identityDatabase
+                                       identityModel:identityModel
+                                           messageId:messageId
+                                           challenge:challenge
+                                        timeReceived:dateTimeReceived
+                                          timeToLive:ttl
+                              loadBalancerCookieData:loadBalancerCookieData
+                                             pending:pending
+                                            approved:approved];
 }
 
 @end
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 @class FRAIdentityDatabase;
 @class FRAMechanism;
+@class FRANotificationResponse;
 
 /*!
  * Models a notification in the Authenticator Application. This notification 
@@ -151,5 +152,39 @@
  */
 - (BOOL)denyWithHandler:(void (^)(NSInteger, NSError *))handler error:(NSError *__autoreleasing*)error;
 
+/*!
+ * Approve several pending notifications, which may belong to different mechanisms, at once. The notifications
+ * are saved in a single transaction and their responses are sent concurrently, those to the same endpoint over
+ * one pooled connection. Notifications which are not pending, or have not been stored, are skipped.
+ *
+ * @param notifications The notifications to approve.
+ * @param handler A block object to be executed on the main queue once every response has finished. It takes one result per notification, in the order the notifications were given.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if the notifications could not be saved, in which case none of them are approved, no responses are sent and the error value will be populated.
+ */
++ (BOOL)approveNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *results))handler error:(NSError *__autoreleasing*)error;
+
+/*!
+ * Deny several pending notifications, which may belong to different mechanisms, at once. The notifications
+ * are saved in a single transaction and their responses are sent concurrently, those to the same endpoint over
+ * one pooled connection. Notifications which are not pending, or have not been stored, are skipped.
+ *
+ * @param notifications The notifications to deny.
+ * @param handler A block object to be executed on the main queue once every response has finished. It takes one result per notification, in the order the notifications were given.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if the notifications could not be saved, in which case none of them are denied, no responses are sent and the error value will be populated.
+ */
++ (BOOL)denyNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *results))handler error:(NSError *__autoreleasing*)error;
+
+/*!
+ * Called once the expiry time of a pending notification has passed. Tells the parent Mechanism that the
+ * notification is no longer pending and, if the notification has been stored, persists it so that the change
+ * is broadcast.
+ *
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if there was an error persisting the Notification, in which case the error value will be populated.
+ */
+- (BOOL)expireWithError:(NSError *__autoreleasing*)error;
+
 
 @end
@@ -15,18 +15,20 @@
  */
 
 #import "FRADateUtils.h"
+#import "FRAError.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAMessageUtils.h"
 #import "FRAModelObjectProtected.h"
 #import "FRANotification.h"
+#import "FRANotificationResponse.h"
 #import "FRAPushMechanism.h"
+#import "FRAResponseOutbox.h"
 
 /*!
  * All notifications are expected to be able to transition from the initial state
  * of pending, to the final state of approved or denied.
  */
 @implementation FRANotification {
-    NSDateFormatter *formatter;
     BOOL _approved;
     BOOL _pending;
 }
@@ -74,37 +76,183 @@
     return [self sendAuthenticationResponse:NO handler:handler error:error];
 }
 
+- (void)setTimeExpired:(NSDate *)timeExpired {
+    BOOL wasPending = [self isPending];
+    _timeExpired = timeExpired;
+    [self.parent notificationDidChangeState:self wasPending:wasPending];
+}
+
+- (BOOL)expireWithError:(NSError *__autoreleasing*)error {
+    if (!_pending) {
+        // Approved or denied before it expired
+        return YES;
+    }
+    [self.parent notificationDidChangeState:self wasPending:YES];
+    if ([self isStored]) {
+        return [self.database updateNotification:self error:error];
+    }
+    return YES;
+}
+
 - (BOOL)sendAuthenticationResponse:(BOOL)approved handler:(void (^)(NSInteger, NSError *))handler error:(NSError *__autoreleasing*)error {
-    _approved = approved;
-    _pending = NO;
+    [self resolveApproved:approved];
     if ([self isStored]) {
         if (![self.database updateNotification:self error:error]) {
             return NO;
         }
         FRAPushMechanism *mechanism = (FRAPushMechanism *)self.parent;
         if (mechanism) {
-            NSMutableDictionary *data = [[NSMutableDictionary alloc] init];
-            data[@"response"] = [FRAMessageUtils generateChallengeResponse:self.challenge secret:mechanism.secret];
-            if (!approved) {
-                data[@"deny"] = @YES;
+            FRAResponseOutbox *outbox = self.database.responseOutbox;
+            if (outbox) {
+                NSError *outboxError;
+                if ([outbox enqueuePayload:[self responsePayload]
+                                  endpoint:mechanism.authEndpoint
+                                 messageId:self.messageId
+                    loadBalancerCookieData:self.loadBalancerCookie
+                               timeExpired:self.timeExpired
+                                   handler:handler
+                                     error:&outboxError]) {
+                    return YES;
+                }
+                // The response can still be sent, it just will not be retried
+                NSLog(@"Could not queue response to message %@: %@", self.messageId, outboxError);
             }
             [FRAMessageUtils respondWithEndpoint:mechanism.authEndpoint
-                                    base64Secret:mechanism.secret
+                                   cryptoContext:mechanism.cryptoContext
                                        messageId:self.messageId
                                     loadBalancerCookieData:self.loadBalancerCookie
-                                            data:data
+                                            data:[self responseData]
                                          handler:handler];
         }
     }
     return YES;
 }
 
++ (BOOL)approveNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *))handler error:(NSError *__autoreleasing*)error {
+    return [self sendAuthenticationResponse:YES toNotifications:notifications handler:handler error:error];
+}
+
++ (BOOL)denyNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *))handler error:(NSError *__autoreleasing*)error {
+    return [self sendAuthenticationResponse:NO toNotifications:notifications handler:handler error:error];
+}
+
++ (BOOL)sendAuthenticationResponse:(BOOL)approved toNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *))handler error:(NSError *__autoreleasing*)error {
+    // Results are filled in as responses complete, in the order the notifications were given
+    NSMutableArray *results = [[NSMutableArray alloc] initWithCapacity:notifications.count];
+    NSMutableArray<FRANotification *> *resolving = [[NSMutableArray alloc] initWithCapacity:notifications.count];
+    NSMutableArray<NSNumber *> *resolvingIndexes = [[NSMutableArray alloc] initWithCapacity:notifications.count];
+    for (FRANotification *notification in notifications) {
+        if ([notification isPending] && [notification isStored] && [notification.parent isKindOfClass:[FRAPushMechanism class]]) {
+            [resolvingIndexes addObject:@(results.count)];
+            [resolving addObject:notification];
+            [results addObject:[NSNull null]];
+        } else {
+            NSError *skippedError = [FRAError createError:@"Notification is not pending" code:FRAInvalidOperation];
+            [results addObject:[[FRANotificationResponse alloc] initWithNotification:notification statusCode:0 error:skippedError]];
+        }
+    }
+    
+    // One transaction for every notification; if it fails none of them are resolved
+    for (FRANotification *notification in resolving) {
+        [notification resolveApproved:approved];
+    }
+    FRAIdentityDatabase *database = resolving.firstObject.database;
+    if (resolving.count > 0 && ![database updateNotifications:resolving error:error]) {
+        for (FRANotification *notification in resolving) {
+            [notification unresolve];
+        }
+        return NO;
+    }
+    
+    dispatch_group_t group = dispatch_group_create();
+    NSMutableArray<FRAQueuedResponse *> *responses = [[NSMutableArray alloc] initWithCapacity:resolving.count];
+    for (NSUInteger i = 0; i < resolving.count; i++) {
+        FRANotification *notification = resolving[i];
+        NSUInteger index = [resolvingIndexes[i] unsignedIntegerValue];
+        dispatch_group_enter(group);
+        void (^responseHandler)(NSInteger, NSError *) = ^(NSInteger statusCode, NSError *responseError) {
+            results[index] = [[FRANotificationResponse alloc] initWithNotification:notification statusCode:statusCode error:responseError];
+            dispatch_group_leave(group);
+        };
+        FRAPushMechanism *mechanism = (FRAPushMechanism *)notification.parent;
+        [responses addObject:[[FRAQueuedResponse alloc] initWithPayload:[notification responsePayload]
+                                                               endpoint:mechanism.authEndpoint
+                                                              messageId:notification.messageId
+                                                 loadBalancerCookieData:notification.loadBalancerCookie
+                                                            timeExpired:notification.timeExpired
+                                                                handler:responseHandler]];
+    }
+    
+    // Queued responses to the same endpoint go out as one burst; without an outbox they are posted concurrently,
+    // sharing the pooled session of their endpoint
+    NSError *outboxError;
+    if (!database.responseOutbox || ![database.responseOutbox enqueueResponses:responses error:&outboxError]) {
+        if (outboxError) {
+            NSLog(@"Could not queue %lu responses: %@", (unsigned long)responses.count, outboxError);
+        }
+        for (FRAQueuedResponse *response in responses) {
+            [FRAMessageUtils postPayload:response.payload
+                              toEndpoint:response.endpoint
+                  loadBalancerCookieData:response.loadBalancerCookie
+                                protocol:nil
+                                 handler:response.handler];
+        }
+    }
+    
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        if (handler) {
+            handler(results);
+        }
+    });
+    return YES;
+}
+
+/*!
+ * Moves the notification out of the pending state and tells its parent.
+ */
+- (void)resolveApproved:(BOOL)approved {
+    BOOL wasPending = [self isPending];
+    _approved = approved;
+    _pending = NO;
+    [self.parent notificationDidChangeState:self wasPending:wasPending];
+}
+
+/*!
+ * Returns a notification which was resolved, but could not be saved, to the pending state.
+ */
+- (void)unresolve {
+    _approved = NO;
+    _pending = YES;
+    [self.parent notificationDidChangeState:self wasPending:NO];
+}
+
+/*!
+ * The claims of the response to the challenge of a resolved notification.
+ */
+- (NSDictionary *)responseData {
+    FRAPushMechanism *mechanism = (FRAPushMechanism *)self.parent;
+    NSMutableDictionary *data = [[NSMutableDictionary alloc] init];
+    data[@"response"] = [FRAMessageUtils generateChallengeResponse:self.challenge cryptoContext:mechanism.cryptoContext];
+    if (!_approved) {
+        data[@"deny"] = @YES;
+    }
+    return data;
+}
+
+/*!
+ * The signed request body of the response of a resolved notification.
+ */
+- (NSDictionary *)responsePayload {
+    FRAPushMechanism *mechanism = (FRAPushMechanism *)self.parent;
+    return [FRAMessageUtils payloadWithMessageId:self.messageId cryptoContext:mechanism.cryptoContext data:[self responseData]];
+}
+
 - (BOOL)isPending {
     return _pending && ![self isExpired];
 }
 
 - (BOOL)isExpired {
-    return _pending && [[NSDate date] timeIntervalSinceDate:_timeExpired] > 0;
+    return _pending && (!_timeExpired || [_timeExpired timeIntervalSinceNow] < 0);
 }
 
 - (BOOL)isApproved {
@@ -0,0 +1,105 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRADatabaseConfiguration;
+@class FRANotification;
+
+/*!
+ * Append-only store for notifications which no longer need to be kept in the database.
+ *
+ * The archive is a folder of segment files. Each call to append writes one block to the newest segment: a short
+ * header giving the block's time range, the mechanism it belongs to and a checksum, followed by the block's records
+ * compressed with zlib. Segments are read through memory mappings, and the block headers form a sparse time index
+ * which is kept in memory, so a page of history only inflates the blocks which can contain it.
+ *
+ * Blocks are never rewritten. Retention is enforced by deleting whole segments once everything in them is older
+ * than the cutoff, and a block torn by a crash part way through an append is truncated away when the archive is
+ * next opened.
+ *
+ * All methods are thread safe.
+ */
+@interface FRANotificationArchive : NSObject
+
+/*!
+ * The size beyond which the newest segment is sealed and a new segment started. Defaults to 256 KB.
+ */
+@property (nonatomic) NSUInteger maximumSegmentSize;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param configuration The configuration which locates the folder of segment files, created on first use.
+ * @return The initialized archive.
+ */
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)configuration;
+
+/*!
+ * Init method.
+ *
+ * @param directory The folder of segment files, which must already exist.
+ * @return The initialized archive.
+ */
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+#pragma mark -
+#pragma mark Archive Functions
+
+/*!
+ * Appends notifications of one mechanism to the archive as a single block.
+ *
+ * @param notifications The notifications to archive.
+ * @param mechanismUID The UID of the mechanism that the notifications belong to.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if the block could not be written, in which case the archive is left unchanged.
+ */
+- (BOOL)appendNotifications:(NSArray<FRANotification *> *)notifications mechanismUID:(NSString *)mechanismUID error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Reads a page of a mechanism's archived notifications, most recently received first.
+ *
+ * The notifications returned are detached from the identity model: they have no parent and are not stored.
+ *
+ * @param mechanismUID The UID of the mechanism.
+ * @param timeReceived Only notifications received before this time are returned. Pass the time received of the
+ * last notification of the previous page to read the next page.
+ * @param limit The most notifications to return.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The notifications, fewer than the limit if the archive has no more, or nil if the archive could not be read.
+ */
+- (NSArray<FRANotification *> *)notificationsWithMechanismUID:(NSString *)mechanismUID receivedBefore:(NSDate *)timeReceived limit:(NSUInteger)limit error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Deletes the segments in which every notification was received before a cutoff.
+ *
+ * @param cutoff The time before which archived notifications are no longer needed.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return NO if a segment could not be deleted.
+ */
+- (BOOL)removeSegmentsOlderThan:(NSDate *)cutoff error:(NSError *__autoreleasing *)error;
+
+/*!
+ * The number of segment files in the archive.
+ *
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return The number of segments, or NSNotFound if the archive could not be opened.
+ */
+- (NSUInteger)segmentCountWithError:(NSError *__autoreleasing *)error;
+
+@end
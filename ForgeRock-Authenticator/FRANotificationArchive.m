@@ -0,0 +1,637 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#import "FRADatabaseConfiguration.h"
+#import "FRAError.h"
+#import "FRANotification.h"
+#import "FRANotificationArchive.h"
+
+/*! Segments and blocks are written in the device's byte order; they never leave the device. */
+static const uint32_t FRANotificationArchiveSegmentMagic = 0x414E5246; // "FRNA"
+static const uint32_t FRANotificationArchiveBlockMagic = 0x4B4C4246; // "FBLK"
+static const uint32_t FRANotificationArchiveVersion = 1;
+static const NSUInteger FRADefaultMaximumSegmentSize = 256 * 1024;
+static NSString * const FRANotificationArchiveSegmentExtension = @"segment";
+
+typedef NS_OPTIONS(uint8_t, FRANotificationArchiveRecordFlags) {
+    FRANotificationArchiveRecordPending = 1 << 0,
+    FRANotificationArchiveRecordApproved = 1 << 1,
+    FRANotificationArchiveRecordHasTimeExpired = 1 << 2,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t reserved;
+} FRANotificationArchiveSegmentHeader;
+
+/*!
+ * Precedes the compressed records of each block. The payload starts with the mechanism UID, followed by records of
+ * time received, time expired, time to live, flags, message id, challenge and load balancer cookie. Strings are a
+ * 32-bit length, or UINT32_MAX for nil, followed by UTF-8 bytes.
+ */
+typedef struct {
+    uint32_t magic;
+    /*! Lets blocks of other mechanisms be skipped without inflating them. */
+    uint32_t mechanismHash;
+    uint32_t recordCount;
+    uint32_t uncompressedLength;
+    uint32_t compressedLength;
+    /*! CRC-32 of the compressed payload. */
+    uint32_t checksum;
+    /*! Times received, as seconds since the reference date, of the first and last record. */
+    double minTime;
+    double maxTime;
+} FRANotificationArchiveBlockHeader;
+
+/*!
+ * An entry of the sparse time index: one per block.
+ */
+typedef struct {
+    uint64_t offset;
+    FRANotificationArchiveBlockHeader header;
+} FRANotificationArchiveIndexEntry;
+
+/*!
+ * FNV-1a hash of a mechanism UID.
+ */
+static uint32_t FRAMechanismHash(NSString *mechanismUID) {
+    const char *bytes = [mechanismUID UTF8String];
+    uint32_t hash = 2166136261u;
+    for (; bytes && *bytes; bytes++) {
+        hash = (hash ^ (uint8_t)*bytes) * 16777619u;
+    }
+    return hash;
+}
+
+static BOOL FRAWriteFully(int fd, const void *bytes, size_t length) {
+    const uint8_t *cursor = bytes;
+    while (length > 0) {
+        ssize_t written = write(fd, cursor, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return NO;
+        }
+        cursor += written;
+        length -= (size_t)written;
+    }
+    return YES;
+}
+
+static NSError *FRAErrorForFile(NSString *path) {
+    return [FRAError createErrorForFilePath:path reason:[NSString stringWithUTF8String:strerror(errno)]];
+}
+
+#pragma mark -
+#pragma mark Segment
+
+/*!
+ * One segment file, along with its part of the sparse time index.
+ */
+@interface FRANotificationArchiveSegment : NSObject
+
+@property (nonatomic, readonly) NSString *path;
+@property (nonatomic, readonly) NSUInteger number;
+@property (nonatomic) uint64_t length;
+@property (nonatomic, readonly) NSUInteger entryCount;
+@property (nonatomic, readonly) FRANotificationArchiveIndexEntry *entries;
+/*! The time received of the most recent notification in the segment, or -INFINITY if the segment is empty. */
+@property (nonatomic, readonly) double maxTime;
+/*! Read-only mapping of the segment, discarded whenever the segment grows. */
+@property (nonatomic) NSData *mapping;
+
+@end
+
+@implementation FRANotificationArchiveSegment {
+    NSUInteger capacity;
+}
+
+- (instancetype)initWithPath:(NSString *)path number:(NSUInteger)number {
+    if (self = [super init]) {
+        _path = path;
+        _number = number;
+        _maxTime = -INFINITY;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_entries);
+}
+
+- (void)addEntry:(FRANotificationArchiveIndexEntry)entry {
+    if (_entryCount == capacity) {
+        capacity = MAX(16, capacity * 2);
+        _entries = reallocf(_entries, capacity * sizeof(*_entries));
+        if (!_entries) {
+            @throw [FRAError createIllegalStateException:@"Could not grow notification archive index"];
+        }
+    }
+    _entries[_entryCount++] = entry;
+    _maxTime = MAX(_maxTime, entry.header.maxTime);
+}
+
+- (NSData *)mappingWithError:(NSError *__autoreleasing *)error {
+    if (!self.mapping) {
+        self.mapping = [NSData dataWithContentsOfFile:self.path options:NSDataReadingMappedAlways error:error];
+    }
+    return self.mapping;
+}
+
+@end
+
+#pragma mark -
+#pragma mark Archive
+
+@implementation FRANotificationArchive {
+    
+    FRADatabaseConfiguration *configuration;
+    NSString *directory;
+    /*! Segments in the order they were written, or nil until the archive has been opened. */
+    NSMutableArray<FRANotificationArchiveSegment *> *segments;
+    /*! Numbered past every segment file in the folder, including any which could not be read. */
+    NSUInteger nextSegmentNumber;
+    /*! The most recently inflated block, as consecutive pages usually come from the same block. */
+    FRANotificationArchiveSegment *cachedSegment;
+    uint64_t cachedOffset;
+    NSData *cachedRecords;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)aConfiguration {
+    if (self = [super init]) {
+        configuration = aConfiguration;
+        _maximumSegmentSize = FRADefaultMaximumSegmentSize;
+    }
+    return self;
+}
+
+- (instancetype)initWithDirectory:(NSString *)aDirectory {
+    if (self = [super init]) {
+        directory = aDirectory;
+        _maximumSegmentSize = FRADefaultMaximumSegmentSize;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Archive Functions
+
+- (BOOL)appendNotifications:(NSArray<FRANotification *> *)notifications mechanismUID:(NSString *)mechanismUID error:(NSError *__autoreleasing *)error {
+    if (notifications.count == 0) {
+        return YES;
+    }
+    NSArray<FRANotification *> *oldestFirst = [notifications sortedArrayUsingComparator:^NSComparisonResult(FRANotification *first, FRANotification *second) {
+        return [first.timeReceived compare:second.timeReceived];
+    }];
+    NSMutableData *records = [[NSMutableData alloc] init];
+    [self appendString:mechanismUID toData:records];
+    for (FRANotification *notification in oldestFirst) {
+        [self appendNotification:notification toData:records];
+    }
+    
+    uLongf compressedLength = compressBound((uLong)records.length);
+    NSMutableData *compressed = [[NSMutableData alloc] initWithLength:compressedLength];
+    if (compress2(compressed.mutableBytes, &compressedLength, records.bytes, (uLong)records.length, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        if (error) {
+            *error = [FRAError createError:@"Could not compress archived notifications"];
+        }
+        return NO;
+    }
+    compressed.length = compressedLength;
+    
+    FRANotificationArchiveIndexEntry entry;
+    entry.header.magic = FRANotificationArchiveBlockMagic;
+    entry.header.mechanismHash = FRAMechanismHash(mechanismUID);
+    entry.header.recordCount = (uint32_t)oldestFirst.count;
+    entry.header.uncompressedLength = (uint32_t)records.length;
+    entry.header.compressedLength = (uint32_t)compressed.length;
+    entry.header.checksum = (uint32_t)crc32(0, compressed.bytes, (uInt)compressed.length);
+    entry.header.minTime = [[oldestFirst firstObject].timeReceived timeIntervalSinceReferenceDate];
+    entry.header.maxTime = [[oldestFirst lastObject].timeReceived timeIntervalSinceReferenceDate];
+    
+    @synchronized (self) {
+        if (![self openWithError:error]) {
+            return NO;
+        }
+        FRANotificationArchiveSegment *segment = [segments lastObject];
+        if (!segment || segment.length >= self.maximumSegmentSize) {
+            segment = [self createSegmentNumbered:nextSegmentNumber error:error];
+            if (!segment) {
+                return NO;
+            }
+            [segments addObject:segment];
+            nextSegmentNumber++;
+        }
+        
+        entry.offset = segment.length;
+        int fd = open([segment.path fileSystemRepresentation], O_WRONLY);
+        if (fd < 0) {
+            if (error) {
+                *error = FRAErrorForFile(segment.path);
+            }
+            return NO;
+        }
+        BOOL written = lseek(fd, (off_t)entry.offset, SEEK_SET) >= 0
+                && FRAWriteFully(fd, &entry.header, sizeof(entry.header))
+                && FRAWriteFully(fd, compressed.bytes, compressed.length)
+                && fsync(fd) == 0;
+        if (!written) {
+            if (error) {
+                *error = FRAErrorForFile(segment.path);
+            }
+            // Leave no partial block behind
+            ftruncate(fd, (off_t)entry.offset);
+        }
+        close(fd);
+        if (!written) {
+            return NO;
+        }
+        
+        segment.length = entry.offset + sizeof(entry.header) + compressed.length;
+        segment.mapping = nil;
+        [segment addEntry:entry];
+        return YES;
+    }
+}
+
+- (NSArray<FRANotification *> *)notificationsWithMechanismUID:(NSString *)mechanismUID receivedBefore:(NSDate *)timeReceived limit:(NSUInteger)limit error:(NSError *__autoreleasing *)error {
+    double before = timeReceived ? [timeReceived timeIntervalSinceReferenceDate] : INFINITY;
+    uint32_t mechanismHash = FRAMechanismHash(mechanismUID);
+    NSMutableArray<FRANotification *> *page = [[NSMutableArray alloc] init];
+    if (limit == 0) {
+        return page;
+    }
+    
+    @synchronized (self) {
+        if (![self openWithError:error]) {
+            return nil;
+        }
+        // Blocks are usually written oldest first, so scanning newest first normally fills the page from the first
+        // blocks visited. Once the page is full, only blocks which could hold something newer than its oldest
+        // notification are inflated.
+        double oldestInPage = -INFINITY;
+        for (FRANotificationArchiveSegment *segment in [segments reverseObjectEnumerator]) {
+            if (page.count == limit && segment.maxTime <= oldestInPage) {
+                continue;
+            }
+            for (NSUInteger index = segment.entryCount; index > 0; index--) {
+                FRANotificationArchiveIndexEntry *entry = &segment.entries[index - 1];
+                if (entry->header.mechanismHash != mechanismHash || entry->header.minTime >= before
+                        || (page.count == limit && entry->header.maxTime <= oldestInPage)) {
+                    continue;
+                }
+                NSData *records = [self recordsOfEntry:entry inSegment:segment error:error];
+                if (!records || ![self decodeRecords:records mechanismUID:mechanismUID receivedBefore:before intoPage:page error:error]) {
+                    return nil;
+                }
+                [self trimPage:page toLimit:limit];
+                if (page.count == limit) {
+                    oldestInPage = [[page lastObject].timeReceived timeIntervalSinceReferenceDate];
+                }
+            }
+        }
+    }
+    return page;
+}
+
+- (BOOL)removeSegmentsOlderThan:(NSDate *)cutoff error:(NSError *__autoreleasing *)error {
+    double cutoffTime = [cutoff timeIntervalSinceReferenceDate];
+    @synchronized (self) {
+        if (![self openWithError:error]) {
+            return NO;
+        }
+        for (FRANotificationArchiveSegment *segment in [segments copy]) {
+            // An empty segment is only worth keeping if it is the one being appended to
+            BOOL expired = segment.entryCount > 0 ? segment.maxTime < cutoffTime : segment != [segments lastObject];
+            if (!expired) {
+                continue;
+            }
+            if (![[NSFileManager defaultManager] removeItemAtPath:segment.path error:error]) {
+                return NO;
+            }
+            if (segment == cachedSegment) {
+                cachedSegment = nil;
+                cachedRecords = nil;
+            }
+            [segments removeObject:segment];
+        }
+        return YES;
+    }
+}
+
+- (NSUInteger)segmentCountWithError:(NSError *__autoreleasing *)error {
+    @synchronized (self) {
+        if (![self openWithError:error]) {
+            return NSNotFound;
+        }
+        return segments.count;
+    }
+}
+
+#pragma mark -
+#pragma mark Segment Functions
+
+/*!
+ * Builds the sparse time index from the block headers of every segment. Only the headers are read, so the pages of
+ * the mapping holding compressed records are not touched.
+ */
+- (BOOL)openWithError:(NSError *__autoreleasing *)error {
+    if (segments) {
+        return YES;
+    }
+    if (!directory) {
+        directory = [configuration getNotificationArchivePathWithError:error];
+        if (!directory) {
+            return NO;
+        }
+    }
+    NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:error];
+    if (!names) {
+        return NO;
+    }
+    NSMutableArray<FRANotificationArchiveSegment *> *loaded = [[NSMutableArray alloc] init];
+    for (NSString *name in names) {
+        if ([[name pathExtension] isEqualToString:FRANotificationArchiveSegmentExtension]) {
+            NSString *path = [directory stringByAppendingPathComponent:name];
+            [loaded addObject:[[FRANotificationArchiveSegment alloc] initWithPath:path number:(NSUInteger)[[name stringByDeletingPathExtension] integerValue]]];
+        }
+    }
+    [loaded sortUsingComparator:^NSComparisonResult(FRANotificationArchiveSegment *first, FRANotificationArchiveSegment *second) {
+        return first.number < second.number ? NSOrderedAscending : (first.number > second.number ? NSOrderedDescending : NSOrderedSame);
+    }];
+    
+    NSMutableArray<FRANotificationArchiveSegment *> *valid = [[NSMutableArray alloc] init];
+    for (FRANotificationArchiveSegment *segment in loaded) {
+        if ([self indexSegment:segment isLast:segment == [loaded lastObject]]) {
+            [valid addObject:segment];
+        } else {
+            NSLog(@"Ignoring unreadable notification archive segment %@", segment.path);
+        }
+    }
+    segments = valid;
+    nextSegmentNumber = [loaded lastObject].number + 1;
+    return YES;
+}
+
+- (BOOL)indexSegment:(FRANotificationArchiveSegment *)segment isLast:(BOOL)isLast {
+    NSData *mapping = [segment mappingWithError:nil];
+    FRANotificationArchiveSegmentHeader segmentHeader;
+    if (mapping.length < sizeof(segmentHeader)) {
+        return NO;
+    }
+    [mapping getBytes:&segmentHeader length:sizeof(segmentHeader)];
+    if (segmentHeader.magic != FRANotificationArchiveSegmentMagic || segmentHeader.version != FRANotificationArchiveVersion) {
+        return NO;
+    }
+    
+    uint64_t offset = sizeof(segmentHeader);
+    while (offset + sizeof(FRANotificationArchiveBlockHeader) <= mapping.length) {
+        FRANotificationArchiveIndexEntry entry;
+        entry.offset = offset;
+        [mapping getBytes:&entry.header range:NSMakeRange((NSUInteger)offset, sizeof(entry.header))];
+        uint64_t end = offset + sizeof(entry.header) + entry.header.compressedLength;
+        if (entry.header.magic != FRANotificationArchiveBlockMagic || end > mapping.length) {
+            break;
+        }
+        // Only the final block can have been torn by a crash, so only its checksum is verified up front
+        if (isLast && end == mapping.length && ![self verifyEntry:&entry mapping:mapping]) {
+            break;
+        }
+        [segment addEntry:entry];
+        offset = end;
+    }
+    segment.length = offset;
+    
+    if (offset < mapping.length) {
+        NSLog(@"Truncating torn block at %llu of notification archive segment %@", offset, segment.path);
+        segment.mapping = nil;
+        if (truncate([segment.path fileSystemRepresentation], (off_t)offset) != 0) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (FRANotificationArchiveSegment *)createSegmentNumbered:(NSUInteger)number error:(NSError *__autoreleasing *)error {
+    NSString *name = [[NSString stringWithFormat:@"%08lu", (unsigned long)number] stringByAppendingPathExtension:FRANotificationArchiveSegmentExtension];
+    NSString *path = [directory stringByAppendingPathComponent:name];
+    int fd = open([path fileSystemRepresentation], O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        if (error) {
+            *error = FRAErrorForFile(path);
+        }
+        return nil;
+    }
+    FRANotificationArchiveSegmentHeader header = { FRANotificationArchiveSegmentMagic, FRANotificationArchiveVersion, 0 };
+    BOOL written = FRAWriteFully(fd, &header, sizeof(header)) && fsync(fd) == 0;
+    if (!written && error) {
+        *error = FRAErrorForFile(path);
+    }
+    close(fd);
+    if (!written) {
+        unlink([path fileSystemRepresentation]);
+        return nil;
+    }
+    FRANotificationArchiveSegment *segment = [[FRANotificationArchiveSegment alloc] initWithPath:path number:number];
+    segment.length = sizeof(header);
+    return segment;
+}
+
+#pragma mark -
+#pragma mark Block Functions
+
+- (BOOL)verifyEntry:(FRANotificationArchiveIndexEntry *)entry mapping:(NSData *)mapping {
+    const uint8_t *compressed = (const uint8_t *)mapping.bytes + entry->offset + sizeof(entry->header);
+    return (uint32_t)crc32(0, compressed, entry->header.compressedLength) == entry->header.checksum;
+}
+
+- (NSData *)recordsOfEntry:(FRANotificationArchiveIndexEntry *)entry inSegment:(FRANotificationArchiveSegment *)segment error:(NSError *__autoreleasing *)error {
+    if (cachedSegment == segment && cachedOffset == entry->offset) {
+        return cachedRecords;
+    }
+    NSData *mapping = [segment mappingWithError:error];
+    if (!mapping) {
+        return nil;
+    }
+    if (entry->offset + sizeof(entry->header) + entry->header.compressedLength > mapping.length || ![self verifyEntry:entry mapping:mapping]) {
+        if (error) {
+            *error = [FRAError createErrorForFilePath:segment.path reason:@"Corrupt notification archive block"];
+        }
+        return nil;
+    }
+    NSMutableData *records = [[NSMutableData alloc] initWithLength:entry->header.uncompressedLength];
+    uLongf length = entry->header.uncompressedLength;
+    const uint8_t *compressed = (const uint8_t *)mapping.bytes + entry->offset + sizeof(entry->header);
+    if (uncompress(records.mutableBytes, &length, compressed, entry->header.compressedLength) != Z_OK || length != entry->header.uncompressedLength) {
+        if (error) {
+            *error = [FRAError createErrorForFilePath:segment.path reason:@"Could not inflate notification archive block"];
+        }
+        return nil;
+    }
+    cachedSegment = segment;
+    cachedOffset = entry->offset;
+    cachedRecords = records;
+    return records;
+}
+
+/*!
+ * Sorts a page most recent first, drops notifications whose messageId was already seen, as left by an append whose
+ * notifications could not then be removed from the database, and trims the page to its limit.
+ */
+- (void)trimPage:(NSMutableArray<FRANotification *> *)page toLimit:(NSUInteger)limit {
+    [page sortUsingComparator:^NSComparisonResult(FRANotification *first, FRANotification *second) {
+        return [second.timeReceived compare:first.timeReceived];
+    }];
+    NSMutableSet<NSString *> *messageIds = [[NSMutableSet alloc] initWithCapacity:page.count];
+    NSMutableIndexSet *duplicates = [[NSMutableIndexSet alloc] init];
+    [page enumerateObjectsUsingBlock:^(FRANotification *notification, NSUInteger index, BOOL *stop) {
+        if (!notification.messageId) {
+            return;
+        }
+        if ([messageIds containsObject:notification.messageId]) {
+            [duplicates addIndex:index];
+        } else {
+            [messageIds addObject:notification.messageId];
+        }
+    }];
+    [page removeObjectsAtIndexes:duplicates];
+    if (page.count > limit) {
+        [page removeObjectsInRange:NSMakeRange(limit, page.count - limit)];
+    }
+}
+
+#pragma mark -
+#pragma mark Record Functions
+
+- (void)appendString:(NSString *)string toData:(NSMutableData *)data {
+    NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+    uint32_t length = bytes ? (uint32_t)bytes.length : UINT32_MAX;
+    [data appendBytes:&length length:sizeof(length)];
+    if (bytes) {
+        [data appendData:bytes];
+    }
+}
+
+- (void)appendNotification:(FRANotification *)notification toData:(NSMutableData *)data {
+    double times[3] = {
+        [notification.timeReceived timeIntervalSinceReferenceDate],
+        [notification.timeExpired timeIntervalSinceReferenceDate],
+        notification.timeToLive
+    };
+    // Read the stored state rather than the derived one, so that expiry is worked out again when read back
+    FRANotificationArchiveRecordFlags flags = 0;
+    if (notification.isPending || notification.isExpired) {
+        flags |= FRANotificationArchiveRecordPending;
+    }
+    if (notification.isApproved) {
+        flags |= FRANotificationArchiveRecordApproved;
+    }
+    if (notification.timeExpired) {
+        flags |= FRANotificationArchiveRecordHasTimeExpired;
+    }
+    [data appendBytes:times length:sizeof(times)];
+    [data appendBytes:&flags length:sizeof(flags)];
+    [self appendString:notification.messageId toData:data];
+    [self appendString:notification.challenge toData:data];
+    [self appendString:notification.loadBalancerCookie toData:data];
+}
+
+- (BOOL)readBytes:(void *)bytes length:(size_t)length from:(NSData *)data cursor:(NSUInteger *)cursor {
+    if (*cursor + length > data.length) {
+        return NO;
+    }
+    memcpy(bytes, (const uint8_t *)data.bytes + *cursor, length);
+    *cursor += length;
+    return YES;
+}
+
+- (BOOL)readString:(NSString **)string from:(NSData *)data cursor:(NSUInteger *)cursor {
+    uint32_t length;
+    if (![self readBytes:&length length:sizeof(length) from:data cursor:cursor]) {
+        return NO;
+    }
+    if (length == UINT32_MAX) {
+        *string = nil;
+        return YES;
+    }
+    if (*cursor + length > data.length) {
+        return NO;
+    }
+    *string = [[NSString alloc] initWithBytes:(const uint8_t *)data.bytes + *cursor length:length encoding:NSUTF8StringEncoding];
+    *cursor += length;
+    return *string != nil;
+}
+
+- (BOOL)decodeRecords:(NSData *)records mechanismUID:(NSString *)mechanismUID receivedBefore:(double)before intoPage:(NSMutableArray<FRANotification *> *)page error:(NSError *__autoreleasing *)error {
+    NSUInteger cursor = 0;
+    NSString *blockMechanismUID;
+    if (![self readString:&blockMechanismUID from:records cursor:&cursor]) {
+        return [self failWithCorruptRecords:error];
+    }
+    if (![blockMechanismUID isEqualToString:mechanismUID]) {
+        // Hash collision with another mechanism
+        return YES;
+    }
+    while (cursor < records.length) {
+        double times[3];
+        FRANotificationArchiveRecordFlags flags;
+        NSString *messageId;
+        NSString *challenge;
+        NSString *loadBalancerCookie;
+        if (![self readBytes:times length:sizeof(times) from:records cursor:&cursor]
+                || ![self readBytes:&flags length:sizeof(flags) from:records cursor:&cursor]
+                || ![self readString:&messageId from:records cursor:&cursor]
+                || ![self readString:&challenge from:records cursor:&cursor]
+                || ![self readString:&loadBalancerCookie from:records cursor:&cursor]) {
+            return [self failWithCorruptRecords:error];
+        }
+        if (times[0] >= before) {
+            continue;
+        }
+        FRANotification *notification = [FRANotification notificationWithDatabase:nil
+                                                                     identityModel:nil
+                                                                         messageId:messageId
+                                                                         challenge:challenge
+                                                                      timeReceived:[NSDate dateWithTimeIntervalSinceReferenceDate:times[0]]
+                                                                        timeToLive:times[2]
+                                                            loadBalancerCookieData:loadBalancerCookie
+                                                                           pending:(flags & FRANotificationArchiveRecordPending) != 0
+                                                                          approved:(flags & FRANotificationArchiveRecordApproved) != 0];
+        notification.timeExpired = (flags & FRANotificationArchiveRecordHasTimeExpired) ? [NSDate dateWithTimeIntervalSinceReferenceDate:times[1]] : nil;
+        [page addObject:notification];
+    }
+    return YES;
+}
+
+- (BOOL)failWithCorruptRecords:(NSError *__autoreleasing *)error {
+    if (error) {
+        *error = [FRAError createError:@"Corrupt notification archive records"];
+    }
+    return NO;
+}
+
+@end
@@ -0,0 +1,101 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRAIdentityDatabase;
+@class FRAIdentityModel;
+@class FRAMechanism;
+@class FRANotification;
+@class FRANotificationArchive;
+@class FRANotificationRetentionPolicy;
+
+/*!
+ * Background job which enforces a retention policy on the notifications of every mechanism.
+ *
+ * Notifications beyond the policy are removed from the model and deleted from the database in batches, each in
+ * its own transaction, after which the database is incrementally vacuumed to give the freed pages back to the
+ * file system. Resolved notifications old enough to be archived are appended to the notification archive before
+ * being deleted, and archive segments beyond the maximum age are dropped. All of the work happens on a private serial queue, so compaction never blocks the main thread.
+ */
+@interface FRANotificationCompactor : NSObject
+
+/*!
+ * The retention policy which is enforced.
+ */
+@property (nonatomic, readonly) FRANotificationRetentionPolicy *policy;
+
+/*!
+ * The most notifications deleted in a single transaction. Defaults to 100.
+ */
+@property (nonatomic) NSUInteger batchSize;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param identityModel The identity model whose notifications are compacted.
+ * @param database The database from which notifications are deleted.
+ * @param policy The retention policy to enforce.
+ * @return The initialized compactor.
+ */
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)identityModel database:(FRAIdentityDatabase *)database policy:(FRANotificationRetentionPolicy *)policy;
+
+/*!
+ * Init method.
+ *
+ * @param identityModel The identity model whose notifications are compacted.
+ * @param database The database from which notifications are deleted.
+ * @param archive The archive into which old resolved notifications are moved, or nil to delete them instead.
+ * @param policy The retention policy to enforce.
+ * @return The initialized compactor.
+ */
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)identityModel database:(FRAIdentityDatabase *)database archive:(FRANotificationArchive *)archive policy:(FRANotificationRetentionPolicy *)policy;
+
+#pragma mark -
+#pragma mark Compaction Functions
+
+/*!
+ * Starts the one-off conversion of a database created before incremental vacuuming was enabled, which compaction
+ * needs in order to reclaim pages. The conversion rewrites the whole database, so should be started while the App
+ * is in the foreground rather than from a background task with limited time.
+ *
+ * @param completion Called on the main queue once the database has been converted, with the error that stopped
+ * the conversion, if any. May be nil.
+ */
+- (void)enableIncrementalVacuumWithCompletion:(void (^)(NSError *error))completion;
+
+/*!
+ * Starts compacting in the background. If compaction is already in progress, this call completes straight away
+ * without removing anything.
+ *
+ * @param completion Called on the main queue once compaction finishes, with the number of notifications removed
+ * from the database, including those archived, the number of database pages reclaimed and the error that stopped
+ * compaction, if any. May be nil.
+ */
+- (void)compactWithCompletion:(void (^)(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error))completion;
+
+/*!
+ * Selects the oldest notifications of a mechanism which the policy does not allow to be kept.
+ *
+ * @param mechanism The mechanism.
+ * @param limit The most notifications to select.
+ * @return The notifications to remove, oldest first.
+ */
+- (NSArray<FRANotification *> *)notificationsToRemoveFromMechanism:(FRAMechanism *)mechanism limit:(NSUInteger)limit;
+
+@end
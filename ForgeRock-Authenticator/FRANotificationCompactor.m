@@ -0,0 +1,254 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRAIdentity.h"
+#import "FRAIdentityDatabase.h"
+#import "FRAIdentityModel.h"
+#import "FRAMechanism.h"
+#import "FRANotification.h"
+#import "FRANotificationArchive.h"
+#import "FRANotificationCompactor.h"
+#import "FRANotificationRetentionPolicy.h"
+#import "FRANotificationStore.h"
+#import "FRAPushMechanism.h"
+
+static const NSUInteger FRADefaultCompactionBatchSize = 100;
+
+@implementation FRANotificationCompactor {
+    
+    FRAIdentityModel *identityModel;
+    FRAIdentityDatabase *database;
+    FRANotificationArchive *archive;
+    dispatch_queue_t compactionQueue;
+    /*! Whether a compaction is in progress. Only accessed while holding the lock on self. */
+    BOOL compacting;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)anIdentityModel database:(FRAIdentityDatabase *)aDatabase policy:(FRANotificationRetentionPolicy *)policy {
+    return [self initWithIdentityModel:anIdentityModel database:aDatabase archive:nil policy:policy];
+}
+
+- (instancetype)initWithIdentityModel:(FRAIdentityModel *)anIdentityModel database:(FRAIdentityDatabase *)aDatabase archive:(FRANotificationArchive *)anArchive policy:(FRANotificationRetentionPolicy *)policy {
+    if (self = [super init]) {
+        identityModel = anIdentityModel;
+        database = aDatabase;
+        archive = anArchive;
+        _policy = policy;
+        _batchSize = FRADefaultCompactionBatchSize;
+        compactionQueue = dispatch_queue_create("org.forgerock.authenticator.compaction", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(compactionQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Compaction Functions
+
+- (void)enableIncrementalVacuumWithCompletion:(void (^)(NSError *))completion {
+    dispatch_async(compactionQueue, ^{
+        NSError *error = nil;
+        [database enableIncrementalVacuumWithError:&error];
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(error);
+            });
+        }
+    });
+}
+
+- (void)compactWithCompletion:(void (^)(NSUInteger, NSInteger, NSError *))completion {
+    BOOL alreadyCompacting;
+    @synchronized (self) {
+        alreadyCompacting = compacting;
+        compacting = YES;
+    }
+    if (alreadyCompacting) {
+        if (completion) {
+            completion(0, 0, nil);
+        }
+        return;
+    }
+    dispatch_async(compactionQueue, ^{
+        NSUInteger removedNotifications = 0;
+        NSInteger reclaimedPages = 0;
+        NSError *error = nil;
+        BOOL succeeded = [self removeNotificationsExceedingPolicyCountingRemoved:&removedNotifications error:&error];
+        if (succeeded) {
+            NSError *vacuumError;
+            if (![database incrementalVacuumReclaimingPages:&reclaimedPages error:&vacuumError]) {
+                error = vacuumError;
+            }
+        }
+        @synchronized (self) {
+            compacting = NO;
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (completion) {
+                completion(removedNotifications, reclaimedPages, error);
+            }
+        });
+    });
+}
+
+/*!
+ * Archives and then removes the notifications which exceed the policy from every mechanism, one batch at a time.
+ * Notifications are archived first, so that the count limit only applies to what is left in the database.
+ */
+- (BOOL)removeNotificationsExceedingPolicyCountingRemoved:(NSUInteger *)removedNotifications error:(NSError *__autoreleasing *)error {
+    BOOL archiving = archive && self.policy.archiveAge > 0;
+    for (FRAIdentity *identity in [identityModel identities]) {
+        for (FRAMechanism *mechanism in [identity mechanisms]) {
+            [mechanism archiveResolvedNotifications];
+            // Archived notifications are filed under the UID which the notification table is keyed by
+            NSString *mechanismUID = [mechanism isKindOfClass:[FRAPushMechanism class]] ? ((FRAPushMechanism *)mechanism).mechanismUID : nil;
+            if (archiving && mechanismUID) {
+                // Each batch is removed from the history, leaving only the skipped notifications ahead of the next
+                __block NSUInteger skipped = 0;
+                BOOL archived = [self removeBatchesFromMechanism:mechanism archivingUnder:mechanismUID counting:removedNotifications error:error selection:^NSArray<FRANotification *> *{
+                    return [self notificationsToArchiveFromMechanism:mechanism limit:self.batchSize skipped:&skipped];
+                }];
+                if (!archived) {
+                    return NO;
+                }
+            }
+            BOOL removed = [self removeBatchesFromMechanism:mechanism archivingUnder:nil counting:removedNotifications error:error selection:^NSArray<FRANotification *> *{
+                return [self notificationsToRemoveFromMechanism:mechanism limit:self.batchSize];
+            }];
+            if (!removed) {
+                return NO;
+            }
+        }
+    }
+    if (archive && self.policy.maximumAge > 0) {
+        return [archive removeSegmentsOlderThan:[NSDate dateWithTimeIntervalSinceNow:-self.policy.maximumAge] error:error];
+    }
+    return YES;
+}
+
+/*!
+ * Removes batches of notifications from a mechanism until the selection is empty, first appending each batch to the
+ * archive if a mechanism UID is given.
+ */
+- (BOOL)removeBatchesFromMechanism:(FRAMechanism *)mechanism archivingUnder:(NSString *)mechanismUID counting:(NSUInteger *)removedNotifications error:(NSError *__autoreleasing *)error selection:(NSArray<FRANotification *> *(^)(void))selection {
+    // Kept outside of the autorelease pool, which would otherwise release it
+    NSError *batchError = nil;
+    BOOL failed = NO;
+    BOOL mechanismCompacted = NO;
+    while (!mechanismCompacted && !failed) {
+        @autoreleasepool {
+            NSArray<FRANotification *> *batch = selection();
+            if (batch.count == 0) {
+                mechanismCompacted = YES;
+            } else if (mechanismUID && ![archive appendNotifications:batch mechanismUID:mechanismUID error:&batchError]) {
+                failed = YES;
+            } else if ([mechanism removeNotifications:batch error:&batchError]) {
+                *removedNotifications += batch.count;
+            } else {
+                failed = YES;
+            }
+        }
+    }
+    if (failed && error) {
+        *error = batchError;
+    }
+    return !failed;
+}
+
+/*!
+ * Selects notifications to archive, starting after the given number of leading notifications which have already
+ * been skipped, and adds the number of notifications skipped by this call.
+ */
+- (NSArray<FRANotification *> *)notificationsToArchiveFromMechanism:(FRAMechanism *)mechanism limit:(NSUInteger)limit skipped:(NSUInteger *)skipped {
+    NSDate *cutoff = self.policy.archiveAge > 0 ? [NSDate dateWithTimeIntervalSinceNow:-self.policy.archiveAge] : nil;
+    NSDate *expiredCutoff = self.policy.maximumAge > 0 ? [NSDate dateWithTimeIntervalSinceNow:-self.policy.maximumAge] : nil;
+    FRANotificationStore *history = mechanism.notificationHistory;
+    NSMutableArray<FRANotification *> *notifications = [[NSMutableArray alloc] init];
+    @synchronized (history) {
+        // Only resolved notifications are in the history, in order of time received
+        for (NSUInteger index = *skipped; index < history.count && notifications.count < limit; index++) {
+            NSDate *timeReceived = [history timeReceivedAtIndex:index];
+            if (![self isTimeReceived:timeReceived before:cutoff]) {
+                break;
+            }
+            if (!timeReceived || [self isTimeReceived:timeReceived before:expiredCutoff]) {
+                // Either cannot be paged back out of the archive or is about to be removed anyway
+                *skipped += 1;
+                continue;
+            }
+            [notifications addObject:[history notificationAtIndex:index]];
+        }
+    }
+    return notifications;
+}
+
+- (NSArray<FRANotification *> *)notificationsToRemoveFromMechanism:(FRAMechanism *)mechanism limit:(NSUInteger)limit {
+    NSDate *cutoff = self.policy.maximumAge > 0 ? [NSDate dateWithTimeIntervalSinceNow:-self.policy.maximumAge] : nil;
+    NSArray<FRANotification *> *activeNotifications = [mechanism activeNotifications];
+    FRANotificationStore *history = mechanism.notificationHistory;
+    NSMutableArray<FRANotification *> *notifications = [[NSMutableArray alloc] init];
+    
+    NSUInteger excess = 0;
+    NSUInteger index = 0;
+    @synchronized (history) {
+        NSUInteger total = history.count + activeNotifications.count;
+        if (self.policy.maximumCountPerMechanism > 0 && total > self.policy.maximumCountPerMechanism) {
+            excess = total - self.policy.maximumCountPerMechanism;
+        }
+        // The history is in order of time received, so the notifications to remove are always a prefix of it
+        for (; index < history.count && notifications.count < limit; index++) {
+            if (index >= excess && ![self isTimeReceived:[history timeReceivedAtIndex:index] before:cutoff]) {
+                break;
+            }
+            [notifications addObject:[history notificationAtIndex:index]];
+        }
+    }
+    if (self.policy.keepPending || notifications.count == limit) {
+        return notifications;
+    }
+    
+    NSUInteger remainingExcess = excess > index ? excess - index : 0;
+    NSArray<FRANotification *> *oldestActiveFirst = [activeNotifications sortedArrayUsingComparator:^NSComparisonResult(FRANotification *first, FRANotification *second) {
+        return [first.timeReceived compare:second.timeReceived];
+    }];
+    for (FRANotification *notification in oldestActiveFirst) {
+        if (notifications.count == limit || (remainingExcess == 0 && ![self isTimeReceived:notification.timeReceived before:cutoff])) {
+            break;
+        }
+        [notifications addObject:notification];
+        if (remainingExcess > 0) {
+            remainingExcess--;
+        }
+    }
+    return notifications;
+}
+
+/*!
+ * Whether a notification received at a time is older than the cutoff. Notifications with no time received are
+ * treated as the oldest possible.
+ */
+- (BOOL)isTimeReceived:(NSDate *)timeReceived before:(NSDate *)cutoff {
+    if (!cutoff) {
+        return NO;
+    }
+    return !timeReceived || [timeReceived compare:cutoff] == NSOrderedAscending;
+}
+
+@end
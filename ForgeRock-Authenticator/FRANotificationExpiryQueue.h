@@ -0,0 +1,87 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRANotification;
+
+/*!
+ * Min-heap of pending notifications keyed by the time at which they expire.
+ *
+ * The queue holds a single timer which is armed for the earliest expiry, so nothing runs while no notification
+ * is due. When the timer fires, every notification whose expiry time has passed is removed from the heap and
+ * told that it has expired, which moves it out of the pending state, persists it and broadcasts the change.
+ *
+ * Adding, repositioning and removing a notification are O(log n). The queue may be modified from any thread;
+ * expired notifications are handled on the dispatch queue given at initialization.
+ */
+@interface FRANotificationExpiryQueue : NSObject
+
+/*!
+ * The number of notifications waiting to expire.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method which handles expired notifications on the main queue.
+ *
+ * @return The initialized queue.
+ */
+- (instancetype)init;
+
+/*!
+ * Init method.
+ *
+ * @param dispatchQueue The dispatch queue on which expired notifications are handled.
+ * @return The initialized queue.
+ */
+- (instancetype)initWithDispatchQueue:(dispatch_queue_t)dispatchQueue;
+
+#pragma mark -
+#pragma mark Queue Functions
+
+/*!
+ * Adds a pending notification to the queue, or moves it if it is already queued and its expiry time has changed.
+ * A notification which is not pending or has no expiry time is removed from the queue instead.
+ *
+ * @param notification The notification.
+ */
+- (void)addNotification:(FRANotification *)notification;
+
+/*!
+ * Removes a notification from the queue, if present.
+ *
+ * @param notification The notification.
+ */
+- (void)removeNotification:(FRANotification *)notification;
+
+/*!
+ * The expiry time of the notification which will expire next.
+ *
+ * @return The expiry time, or nil if the queue is empty.
+ */
+- (NSDate *)nextExpiry;
+
+/*!
+ * Removes and expires every queued notification whose expiry time has passed. Called when the timer fires.
+ *
+ * @return The notifications which were expired, in order of expiry.
+ */
+- (NSArray<FRANotification *> *)expireDueNotifications;
+
+@end
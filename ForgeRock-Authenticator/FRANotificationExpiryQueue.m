@@ -0,0 +1,227 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRANotification.h"
+#import "FRANotificationExpiryQueue.h"
+
+/*! Leeway allowed to the system when firing the expiry timer, so that it can be coalesced with other wakeups. */
+static const uint64_t FRAExpiryTimerLeeway = NSEC_PER_SEC / 10;
+
+@implementation FRANotificationExpiryQueue {
+    
+    /*! The queued notifications, in heap order. */
+    NSMutableArray<FRANotification *> *heap;
+    /*! The expiry time of each entry in the heap, as seconds since the reference date. */
+    NSTimeInterval *keys;
+    /*! Number of keys allocated. */
+    NSUInteger capacity;
+    /*! Position in the heap of each queued notification. */
+    NSMapTable<FRANotification *, NSNumber *> *positions;
+    
+    dispatch_source_t timer;
+    /*! The expiry time for which the timer is armed, or DBL_MAX if it is idle. */
+    NSTimeInterval armedExpiry;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)init {
+    return [self initWithDispatchQueue:dispatch_get_main_queue()];
+}
+
+- (instancetype)initWithDispatchQueue:(dispatch_queue_t)dispatchQueue {
+    if (self = [super init]) {
+        heap = [[NSMutableArray alloc] init];
+        positions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                          valueOptions:NSPointerFunctionsStrongMemory];
+        armedExpiry = DBL_MAX;
+        timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatchQueue);
+        __weak FRANotificationExpiryQueue *weakSelf = self;
+        dispatch_source_set_event_handler(timer, ^{
+            [weakSelf expireDueNotifications];
+        });
+        dispatch_source_set_timer(timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, FRAExpiryTimerLeeway);
+        dispatch_resume(timer);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_source_cancel(timer);
+    free(keys);
+}
+
+#pragma mark -
+#pragma mark Queue Functions
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        return heap.count;
+    }
+}
+
+- (void)addNotification:(FRANotification *)notification {
+    if (![notification isPending] || !notification.timeExpired) {
+        [self removeNotification:notification];
+        return;
+    }
+    NSTimeInterval key = [notification.timeExpired timeIntervalSinceReferenceDate];
+    @synchronized (self) {
+        NSNumber *position = [positions objectForKey:notification];
+        NSUInteger index;
+        if (position) {
+            index = position.unsignedIntegerValue;
+            keys[index] = key;
+        } else {
+            [self ensureCapacity:heap.count + 1];
+            index = heap.count;
+            [heap addObject:notification];
+            keys[index] = key;
+            [positions setObject:@(index) forKey:notification];
+        }
+        [self siftDown:[self siftUp:index]];
+        [self armTimer];
+    }
+}
+
+- (void)removeNotification:(FRANotification *)notification {
+    @synchronized (self) {
+        NSNumber *position = [positions objectForKey:notification];
+        if (position) {
+            [self removeEntryAtIndex:position.unsignedIntegerValue];
+            [self armTimer];
+        }
+    }
+}
+
+- (NSDate *)nextExpiry {
+    @synchronized (self) {
+        return heap.count > 0 ? [NSDate dateWithTimeIntervalSinceReferenceDate:keys[0]] : nil;
+    }
+}
+
+- (NSArray<FRANotification *> *)expireDueNotifications {
+    NSMutableArray<FRANotification *> *expired = [[NSMutableArray alloc] init];
+    @synchronized (self) {
+        NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+        while (heap.count > 0 && keys[0] <= now) {
+            [expired addObject:heap[0]];
+            [self removeEntryAtIndex:0];
+        }
+        armedExpiry = DBL_MAX;
+        [self armTimer];
+    }
+    // Expiring calls back into the mechanism, which may call back into this queue
+    for (FRANotification *notification in expired) {
+        [notification expireWithError:nil];
+    }
+    return expired;
+}
+
+#pragma mark -
+#pragma mark Heap Functions
+
+- (void)ensureCapacity:(NSUInteger)required {
+    if (required <= capacity) {
+        return;
+    }
+    NSUInteger newCapacity = MAX(16, capacity * 2);
+    keys = reallocf(keys, newCapacity * sizeof(*keys));
+    if (!keys) {
+        @throw [NSException exceptionWithName:NSMallocException reason:@"Unable to grow expiry queue" userInfo:nil];
+    }
+    capacity = newCapacity;
+}
+
+- (void)removeEntryAtIndex:(NSUInteger)index {
+    NSUInteger last = heap.count - 1;
+    [positions removeObjectForKey:heap[index]];
+    if (index != last) {
+        heap[index] = heap[last];
+        keys[index] = keys[last];
+        [positions setObject:@(index) forKey:heap[index]];
+    }
+    [heap removeLastObject];
+    if (index < heap.count) {
+        [self siftDown:[self siftUp:index]];
+    }
+}
+
+- (void)swapEntryAtIndex:(NSUInteger)first withEntryAtIndex:(NSUInteger)second {
+    [heap exchangeObjectAtIndex:first withObjectAtIndex:second];
+    NSTimeInterval key = keys[first];
+    keys[first] = keys[second];
+    keys[second] = key;
+    [positions setObject:@(first) forKey:heap[first]];
+    [positions setObject:@(second) forKey:heap[second]];
+}
+
+- (NSUInteger)siftUp:(NSUInteger)index {
+    while (index > 0) {
+        NSUInteger parent = (index - 1) / 2;
+        if (keys[parent] <= keys[index]) {
+            break;
+        }
+        [self swapEntryAtIndex:index withEntryAtIndex:parent];
+        index = parent;
+    }
+    return index;
+}
+
+- (NSUInteger)siftDown:(NSUInteger)index {
+    NSUInteger count = heap.count;
+    while (YES) {
+        NSUInteger smallest = index;
+        NSUInteger left = 2 * index + 1;
+        NSUInteger right = left + 1;
+        if (left < count && keys[left] < keys[smallest]) {
+            smallest = left;
+        }
+        if (right < count && keys[right] < keys[smallest]) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return index;
+        }
+        [self swapEntryAtIndex:index withEntryAtIndex:smallest];
+        index = smallest;
+    }
+}
+
+/*!
+ * Arms the timer for the earliest expiry, or idles it if the queue is empty.
+ *
+ * Must be called while holding the lock on self.
+ */
+- (void)armTimer {
+    NSTimeInterval nextExpiry = heap.count > 0 ? keys[0] : DBL_MAX;
+    if (nextExpiry == armedExpiry) {
+        return;
+    }
+    armedExpiry = nextExpiry;
+    if (nextExpiry == DBL_MAX) {
+        dispatch_source_set_timer(timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, FRAExpiryTimerLeeway);
+        return;
+    }
+    // Wall clock time, so that notifications which fall due while the device sleeps are expired on waking
+    NSTimeInterval delay = MAX(0, nextExpiry - [NSDate timeIntervalSinceReferenceDate]);
+    dispatch_source_set_timer(timer, dispatch_walltime(NULL, (int64_t)(delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, FRAExpiryTimerLeeway);
+}
+
+@end
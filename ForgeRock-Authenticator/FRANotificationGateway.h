@@ -17,6 +17,8 @@
 
 #import "FRANotificationHandler.h"
 
+@class FRABackgroundPushScheduler;
+
 /*!
  * Gateway which encapsulates interaction with Push Notification Service.
  */
@@ -32,6 +34,14 @@
  * @return The notification gateway or nil if initialization failed.
  */
 - (instancetype)initWithHandler:(FRANotificationHandler *)handler;
+/*!
+ * Init method.
+ *
+ * @param handler The object to which push notifications received by this object will be passed.
+ * @param scheduler The scheduler which processes push notifications delivered in the background.
+ * @return The notification gateway or nil if initialization failed.
+ */
+- (instancetype)initWithHandler:(FRANotificationHandler *)handler scheduler:(FRABackgroundPushScheduler *)scheduler;
 /*!
  * Static factory.
  *
@@ -39,6 +49,14 @@
  * @return The notification gateway or nil if initialization failed.
  */
 + (instancetype)gatewayWithHandler:(FRANotificationHandler *)handler;
+/*!
+ * Static factory.
+ *
+ * @param handler The object to which push notifications received by this object will be passed.
+ * @param scheduler The scheduler which processes push notifications delivered in the background.
+ * @return The notification gateway or nil if initialization failed.
+ */
++ (instancetype)gatewayWithHandler:(FRANotificationHandler *)handler scheduler:(FRABackgroundPushScheduler *)scheduler;
 /*!
  * Contact APNS to register for remote notifications. The first time an installation of this app calls
  * this method, the user will be asked whether or not they give permission for this app to show notifications.
@@ -59,7 +77,16 @@
 - (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)userInfo;
 /*!
  * Method copied from UIApplicationDelegate protocol.
+ *
+ * The message is processed by the background scheduler, which calls the completion handler with the real result
+ * once processing finishes or its time budget is nearly spent.
  */
 - (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)userInfo fetchCompletionHandler:(void (^)(UIBackgroundFetchResult result))completionHandler;
+/*!
+ * Processes the push notifications whose background processing was cut short in an earlier run.
+ *
+ * @param application The application object.
+ */
+- (void)resumeDeferredWorkWithApplication:(UIApplication *)application;
 
 @end
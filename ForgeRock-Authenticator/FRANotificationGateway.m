@@ -14,6 +14,8 @@
  * Copyright 2016 ForgeRock AS.
  */
 
+#import "FRABackgroundPushScheduler.h"
+#import "FRADatabaseConfiguration.h"
 #import "FRANotificationGateway.h"
 
 /*!
@@ -24,6 +26,9 @@
 /*! The object to which push notifications received by this object will be passed. */
 @property (nonatomic, strong, readonly) FRANotificationHandler *notificationHandler;
 
+/*! The scheduler which processes push notifications delivered in the background. */
+@property (nonatomic, strong, readonly) FRABackgroundPushScheduler *scheduler;
+
 @end
 
 @implementation FRANotificationGateway
@@ -32,9 +37,14 @@
 #pragma mark Lifecycle
 
 - (instancetype)initWithHandler:(FRANotificationHandler *)handler {
+    return [self initWithHandler:handler scheduler:[[FRABackgroundPushScheduler alloc] initWithHandler:handler configuration:[[FRADatabaseConfiguration alloc] init]]];
+}
+
+- (instancetype)initWithHandler:(FRANotificationHandler *)handler scheduler:(FRABackgroundPushScheduler *)scheduler {
     self = [super init];
     if (self) {
         _notificationHandler = handler;
+        _scheduler = scheduler;
     }
     return self;
 }
@@ -43,6 +53,10 @@
     return [[FRANotificationGateway alloc] initWithHandler:handler];
 }
 
++ (instancetype)gatewayWithHandler:(FRANotificationHandler *)handler scheduler:(FRABackgroundPushScheduler *)scheduler {
+    return [[FRANotificationGateway alloc] initWithHandler:handler scheduler:scheduler];
+}
+
 
 - (void)registerForRemoteNotifications {
     UIUserNotificationType allNotificationTypes = (UIUserNotificationTypeSound | UIUserNotificationTypeAlert | UIUserNotificationTypeBadge);
@@ -75,8 +89,11 @@
 
 - (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)userInfo fetchCompletionHandler:(void (^)(UIBackgroundFetchResult result))completionHandler {
     NSLog(@"Notification received: %@", userInfo);
-    [[self notificationHandler] application:application didReceiveRemoteNotification:userInfo];
-    completionHandler(UIBackgroundFetchResultNewData);
+    [[self scheduler] application:application processRemoteNotification:userInfo completionHandler:completionHandler];
+}
+
+- (void)resumeDeferredWorkWithApplication:(UIApplication *)application {
+    [[self scheduler] resumeDeferredWorkWithApplication:application completion:nil];
 }
 
 #pragma mark -
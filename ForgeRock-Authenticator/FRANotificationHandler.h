@@ -18,15 +18,46 @@
 
 @class FRAIdentityDatabase;
 @class FRAIdentityModel;
+@class FRANotification;
+@class FRASeenMessageFilter;
+
+/*!
+ * The stages a push notification passes through on its way into the identity model.
+ */
+typedef NS_ENUM(NSInteger, FRAPushIngestionStage) {
+    /*! Checking the message id against those already ingested. */
+    FRAPushIngestionFilterStage,
+    /*! Parsing the JWT carried by the message. */
+    FRAPushIngestionDecodeStage,
+    /*! Finding the target mechanism and verifying the message was signed with its secret. */
+    FRAPushIngestionRouteStage,
+    /*! Looking for a notification already created for the message. */
+    FRAPushIngestionDedupeStage,
+    /*! Creating the notification and writing it to the database. */
+    FRAPushIngestionPersistStage,
+    /*! Showing the notification or an error on the main thread, including the wait for the main queue. */
+    FRAPushIngestionPresentStage,
+    FRAPushIngestionStageCount
+};
 
 /*!
  * Consumer for notifications received by FRANotificationGateway.
  *
  * This handler creates FRANotification objects from the data payload of a push notification and persists them to the
  * appropriate FRAPushMechanism in the FRAIdentityModel.
+ *
+ * Messages are ingested on a private serial queue, one at a time, in the stages of FRAPushIngestionStage. Only the
+ * presentation stage runs on the main thread. The number of messages which reached each stage and the time spent in
+ * it are counted.
  */
 @interface FRANotificationHandler : NSObject
 
+/*!
+ * The ids of the messages already ingested. Redelivered messages found here skip decoding and persistence. May be
+ * nil, in which case duplicates are only found among the notifications of the target mechanism.
+ */
+@property (nonatomic, strong) FRASeenMessageFilter *seenMessageFilter;
+
 #pragma mark -
 #pragma mark Lifecycle
 
@@ -63,4 +94,50 @@
  */
 - (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)messageData;
 
+/*!
+ * Ingests a push notification in the background, as application:didReceiveRemoteNotification:, and reports
+ * the outcome once it has been presented.
+ *
+ * @param application The application object.
+ * @param messageData An object graph representing the push notification message received.
+ * @param completion Called on the main queue after the presentation stage with the notification for the message,
+ * or nil if the message was dropped, and whether it was newly created. May be nil.
+ */
+- (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)messageData completion:(void (^)(FRANotification *notification, BOOL created))completion;
+
+#pragma mark -
+#pragma mark Ingestion Statistics
+
+/*!
+ * The number of messages which have been through a stage.
+ *
+ * @param stage The stage.
+ * @return The number of messages.
+ */
+- (NSUInteger)messageCountForStage:(FRAPushIngestionStage)stage;
+
+/*!
+ * The time spent in a stage by every message which has been through it.
+ *
+ * @param stage The stage.
+ * @return The total latency in seconds.
+ */
+- (NSTimeInterval)totalLatencyForStage:(FRAPushIngestionStage)stage;
+
+/*!
+ * The mean time a message spends in a stage.
+ *
+ * @param stage The stage.
+ * @return The average latency in seconds, or 0 if no message has been through the stage.
+ */
+- (NSTimeInterval)averageLatencyForStage:(FRAPushIngestionStage)stage;
+
+/*!
+ * The longest time a message has spent in a stage.
+ *
+ * @param stage The stage.
+ * @return The maximum latency in seconds.
+ */
+- (NSTimeInterval)maximumLatencyForStage:(FRAPushIngestionStage)stage;
+
 @end
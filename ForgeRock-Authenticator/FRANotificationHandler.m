@@ -14,6 +14,8 @@
  * Copyright 2016 ForgeRock AS.
  */
 
+#include <mach/mach_time.h>
+
 #import "FRABlockAlertView.h"
 #import "FRAIdentity.h"
 #import "FRAIdentityModel.h"
@@ -21,9 +23,8 @@
 #import "FRANotification.h"
 #import "FRANotificationHandler.h"
 #import "FRANotificationViewController.h"
-#import "FRAMessageUtils.h"
-#import "FRAQRUtils.h"
-#import <JWT.h>
+#import "FRAPushMessage.h"
+#import "FRASeenMessageFilter.h"
 
 /*!
  * Private interface.
@@ -42,20 +43,39 @@
 
 @end
 
-@implementation FRANotificationHandler
+@implementation FRANotificationHandler {
+    /*! Serial queue on which every stage but presentation runs, so deliveries are ingested one at a time. */
+    dispatch_queue_t ingestionQueue;
+    NSUInteger stageCounts[FRAPushIngestionStageCount];
+    NSTimeInterval stageLatencies[FRAPushIngestionStageCount];
+    NSTimeInterval maximumStageLatencies[FRAPushIngestionStageCount];
+}
 
-static NSString * const TTL_KEY = @"t";
 static NSString * const MESSAGE_ID_KEY_PATH = @"aps.messageId";
 static NSString * const MESSAGE_DATA_PATH = @"aps.data";
-static NSString * const CHALLENGE_KEY = @"c";
-static NSString * const MECHANISM_UID_KEY = @"u";
-static NSString * const LOAD_BALANCE_KEY = @"l";
+
+/*!
+ * Seconds elapsed since a mach_absolute_time() reading.
+ */
+static NSTimeInterval secondsSince(uint64_t start) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return (double)(mach_absolute_time() - start) * timebase.numer / timebase.denom / NSEC_PER_SEC;
+}
+
+#pragma mark -
+#pragma mark Lifecycle
 
 - (instancetype)initWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel {
     self = [super init];
     if (self) {
         _database = database;
         _identityModel = identityModel;
+        ingestionQueue = dispatch_queue_create("org.forgerock.authenticator.push-ingestion", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(ingestionQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
     }
     return self;
 }
@@ -64,74 +84,166 @@ static NSString * const LOAD_BALANCE_KEY = @"l";
     return [[FRANotificationHandler alloc] initWithDatabase:database identityModel:identityModel];
 }
 
+#pragma mark -
+#pragma mark Remote Notifications
+
 - (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)messageData {
+    [self application:application didReceiveRemoteNotification:messageData completion:nil];
+}
 
-    FRANotification *notification = [self notificationFromRemoteNotification:messageData];
-    
-    if (!notification || !notification.pending) {
-        // if the notification is nil then there was a problem looking up the mechanism
-        // if the notification is not pending, then the notification timed out or was dealt with by opening the app
-        // from the homescreen and navigating to the notification; either way, there's nothing further to do here
-        return;
+- (void)application:(UIApplication *)application didReceiveRemoteNotification:(NSDictionary *)messageData completion:(void (^)(FRANotification *, BOOL))completion {
+    dispatch_async(ingestionQueue, ^{
+        BOOL created = NO;
+        BOOL failed = NO;
+        FRANotification *notification = [self ingestRemoteNotification:messageData created:&created failed:&failed];
+        
+        uint64_t start = mach_absolute_time();
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self presentNotification:notification failed:failed application:application];
+            [self recordStage:FRAPushIngestionPresentStage latency:secondsSince(start)];
+            if (completion) {
+                completion(notification, created);
+            }
+        });
+    });
+}
+
+#pragma mark -
+#pragma mark Ingestion Statistics
+
+- (NSUInteger)messageCountForStage:(FRAPushIngestionStage)stage {
+    @synchronized (self) {
+        return stageCounts[stage];
     }
-    
-    [self showNotification:notification ifForegroundApplication:application];
 }
 
-- (FRANotification *)notificationFromRemoteNotification:(NSDictionary *)messageData {
+- (NSTimeInterval)totalLatencyForStage:(FRAPushIngestionStage)stage {
+    @synchronized (self) {
+        return stageLatencies[stage];
+    }
+}
 
-    NSError* error;
-    
-    // Decode JWT from modessage
-    NSString* dataJwt = [messageData valueForKeyPath:MESSAGE_DATA_PATH];
+- (NSTimeInterval)averageLatencyForStage:(FRAPushIngestionStage)stage {
+    @synchronized (self) {
+        return stageCounts[stage] ? stageLatencies[stage] / stageCounts[stage] : 0;
+    }
+}
+
+- (NSTimeInterval)maximumLatencyForStage:(FRAPushIngestionStage)stage {
+    @synchronized (self) {
+        return maximumStageLatencies[stage];
+    }
+}
+
+#pragma mark -
+#pragma mark Pipeline Stages (private)
+
+/*!
+ * Runs the filter, decode, route, dedupe and persist stages for one delivery. Must be called on the ingestion queue.
+ *
+ * @param messageData The push notification message received.
+ * @param created Set to YES if a new notification was persisted.
+ * @param failed Set to YES if the message could not be ingested and the user should be told.
+ * @return The notification for the message, or nil if the message was dropped.
+ */
+- (FRANotification *)ingestRemoteNotification:(NSDictionary *)messageData created:(BOOL *)created failed:(BOOL *)failed {
+    NSError *error;
+    NSString *messageId = [messageData valueForKeyPath:MESSAGE_ID_KEY_PATH];
     
-    NSDictionary *payload = [FRAMessageUtils extractJTWBodyFromString:dataJwt error:&error];
-    if (!payload) {
-        [self showAlertWithTitle:NSLocalizedString(@"notification_request_error_title", nil)
-                         message:nil
-                         handler:nil];
+    // filter: a redelivered message only needs its existing notification, which is found without decoding
+    uint64_t start = mach_absolute_time();
+    NSString *seenMechanismUid;
+    FRASeenMessageState seen = [self.seenMessageFilter stateOfMessageId:messageId mechanismUid:&seenMechanismUid];
+    FRANotification *notification;
+    if (seen == FRAMessageRecentlySeen) {
+        notification = [[self pushMechanismWithId:seenMechanismUid] notificationWithMessageId:messageId];
+    }
+    [self recordStage:FRAPushIngestionFilterStage latency:secondsSince(start)];
+    if (seen != FRAMessageNotSeen) {
+        return notification;
     }
     
-    NSLog(@"message data: %@", payload);
-
-    // Lookup push mechanism to which the notification should be added
+    // decode
+    start = mach_absolute_time();
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:[messageData valueForKeyPath:MESSAGE_DATA_PATH] error:&error];
+    [self recordStage:FRAPushIngestionDecodeStage latency:secondsSince(start)];
+    if (!message) {
+        *failed = YES;
+        return nil;
+    }
     
-    FRAPushMechanism *mechanism = [self pushMechanismTargetForRemoteNotification:payload];
+    // route: only the holder of the target mechanism's secret can have signed the message
+    start = mach_absolute_time();
+    FRAPushMechanism *mechanism = [self pushMechanismWithId:message.mechanismUid];
+    BOOL authentic = mechanism && [message isSignedWithCryptoContext:mechanism.cryptoContext];
+    [self recordStage:FRAPushIngestionRouteStage latency:secondsSince(start)];
     if (!mechanism) {
         return nil;
     }
-
-    // Try to look up an existing notification (in case this message has already been handled)
-    FRANotification *notification = [mechanism notificationWithMessageId:[messageData valueForKeyPath:MESSAGE_ID_KEY_PATH]];
+    if (!authentic) {
+        NSLog(@"Rejected push message with invalid signature for mechanism %@", message.mechanismUid);
+        *failed = YES;
+        return nil;
+    }
+    
+    // dedupe: the message may already have been handled, e.g. by opening the app from the notification
+    start = mach_absolute_time();
+    notification = [mechanism notificationWithMessageId:messageId];
+    [self recordStage:FRAPushIngestionDedupeStage latency:secondsSince(start)];
     if (notification) {
+        [self.seenMessageFilter addMessageId:messageId mechanismUid:mechanism.mechanismUID];
         return notification;
     }
     
-    // otherwise, create the notification from the message and add it to the mechanism
-    
-    NSTimeInterval timeToLive = [[payload objectForKey:TTL_KEY] doubleValue];
-    
-    NSString * loadBalancerCookieData = [[NSString alloc] initWithData:[FRAQRUtils decodeBase64:[payload objectForKey:LOAD_BALANCE_KEY]] encoding:NSUTF8StringEncoding];
+    // persist
+    start = mach_absolute_time();
     notification = [FRANotification notificationWithDatabase:self.database
                                                identityModel:_identityModel
-                                                   messageId:[messageData valueForKeyPath:MESSAGE_ID_KEY_PATH]
-                                                   challenge:[payload objectForKey:CHALLENGE_KEY]
+                                                   messageId:messageId
+                                                   challenge:message.challenge
                                                 timeReceived:[NSDate date]
-                                                  timeToLive:timeToLive
-                                          loadBalancerCookieData:loadBalancerCookieData];
-
+                                                  timeToLive:message.timeToLive
+                                      loadBalancerCookieData:message.loadBalancerCookieData];
+    if ([mechanism addNotification:notification error:&error]) {
+        *created = YES;
+        [self.seenMessageFilter addMessageId:messageId mechanismUid:mechanism.mechanismUID];
+    } else {
+        *failed = YES;
+    }
+    [self recordStage:FRAPushIngestionPersistStage latency:secondsSince(start)];
     
-    if (![mechanism addNotification:notification error:&error]) {
+    return notification;
+}
+
+/*!
+ * The presentation stage. Must be called on the main queue.
+ */
+- (void)presentNotification:(FRANotification *)notification failed:(BOOL)failed application:(UIApplication *)application {
+    if (failed) {
         [self showAlertWithTitle:NSLocalizedString(@"notification_request_error_title", nil)
                          message:nil
                          handler:nil];
     }
     
-    return notification;
+    if (!notification || !notification.pending) {
+        // if the notification is nil then there was a problem looking up the mechanism
+        // if the notification is not pending, then the notification timed out or was dealt with by opening the app
+        // from the homescreen and navigating to the notification; either way, there's nothing further to do here
+        return;
+    }
+    
+    [self showNotification:notification ifForegroundApplication:application];
 }
 
-- (FRAPushMechanism *)pushMechanismTargetForRemoteNotification:(NSDictionary *)messageData {
-    NSString *mechanismId = [messageData objectForKey:MECHANISM_UID_KEY];
+- (void)recordStage:(FRAPushIngestionStage)stage latency:(NSTimeInterval)latency {
+    @synchronized (self) {
+        stageCounts[stage]++;
+        stageLatencies[stage] += latency;
+        maximumStageLatencies[stage] = MAX(maximumStageLatencies[stage], latency);
+    }
+}
+
+- (FRAPushMechanism *)pushMechanismWithId:(NSString *)mechanismId {
     FRAMechanism *mechanism = [self.identityModel mechanismWithId:mechanismId];
     if ([mechanism isKindOfClass:[FRAPushMechanism class]]) {
         return (FRAPushMechanism *)mechanism;
@@ -140,6 +252,9 @@ static NSString * const LOAD_BALANCE_KEY = @"l";
     }
 }
 
+#pragma mark -
+#pragma mark Presentation (private)
+
 - (void)showNotification:(FRANotification *)notification ifForegroundApplication:(UIApplication *)application {
     
     // jump to the notification if the app was in the foreground when the notification arrived or has
@@ -0,0 +1,56 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+@class FRANotification;
+
+/*!
+ * The outcome of responding to one of a batch of notifications.
+ */
+@interface FRANotificationResponse : NSObject
+
+/*!
+ * The notification responded to.
+ */
+@property (nonatomic, readonly) FRANotification *notification;
+
+/*!
+ * The status code of the response, or 0 if no response was received.
+ */
+@property (nonatomic, readonly) NSInteger statusCode;
+
+/*!
+ * The error which prevented the response from being sent or accepted, or nil.
+ */
+@property (nonatomic, readonly) NSError *error;
+
+/*!
+ * Init method.
+ *
+ * @param notification The notification responded to.
+ * @param statusCode The status code of the response, or 0 if no response was received.
+ * @param error The error which prevented the response from being sent or accepted, or nil.
+ * @return The initialized response.
+ */
+- (instancetype)initWithNotification:(FRANotification *)notification statusCode:(NSInteger)statusCode error:(NSError *)error;
+
+/*!
+ * Whether the server accepted the response.
+ *
+ * @return YES if the status code indicates success, otherwise NO.
+ */
+- (BOOL)isDelivered;
+
+@end
@@ -0,0 +1,35 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FRANotificationResponse.h"
+
+@implementation FRANotificationResponse
+
+- (instancetype)initWithNotification:(FRANotification *)notification statusCode:(NSInteger)statusCode error:(NSError *)error {
+    self = [super init];
+    if (self) {
+        _notification = notification;
+        _statusCode = statusCode;
+        _error = error;
+    }
+    return self;
+}
+
+- (BOOL)isDelivered {
+    return self.statusCode >= 200 && self.statusCode < 300;
+}
+
+@end
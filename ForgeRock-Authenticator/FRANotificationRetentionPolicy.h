@@ -0,0 +1,77 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+/*!
+ * Describes which notifications should be kept in the history of each mechanism.
+ */
+@interface FRANotificationRetentionPolicy : NSObject
+
+/*!
+ * Notifications received longer ago than this are removed. Zero means notifications are kept regardless of age.
+ */
+@property (nonatomic, readonly) NSTimeInterval maximumAge;
+
+/*!
+ * The most notifications to keep in the database for each mechanism, removing the oldest first. Zero means there
+ * is no limit.
+ */
+@property (nonatomic, readonly) NSUInteger maximumCountPerMechanism;
+
+/*!
+ * Whether notifications which are still pending are kept even if they exceed the maximum age or count.
+ */
+@property (nonatomic, readonly) BOOL keepPending;
+
+/*!
+ * Resolved notifications received longer ago than this are moved out of the database into the notification
+ * archive, where they are kept until they exceed the maximum age. Zero means notifications are never archived.
+ */
+@property (nonatomic, readonly) NSTimeInterval archiveAge;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param maximumAge The age beyond which notifications are removed, or zero for no limit.
+ * @param maximumCountPerMechanism The most notifications to keep for each mechanism, or zero for no limit.
+ * @param keepPending Whether pending notifications are always kept.
+ * @return The initialized policy.
+ */
+- (instancetype)initWithMaximumAge:(NSTimeInterval)maximumAge maximumCountPerMechanism:(NSUInteger)maximumCountPerMechanism keepPending:(BOOL)keepPending;
+
+/*!
+ * Init method.
+ *
+ * @param maximumAge The age beyond which notifications are removed, or zero for no limit.
+ * @param maximumCountPerMechanism The most notifications to keep in the database for each mechanism, or zero for no limit.
+ * @param keepPending Whether pending notifications are always kept.
+ * @param archiveAge The age beyond which resolved notifications are archived, or zero to never archive.
+ * @return The initialized policy.
+ */
+- (instancetype)initWithMaximumAge:(NSTimeInterval)maximumAge maximumCountPerMechanism:(NSUInteger)maximumCountPerMechanism keepPending:(BOOL)keepPending archiveAge:(NSTimeInterval)archiveAge;
+
+/*!
+ * The policy used by the App: resolved notifications are archived after a day and kept for 30 days, up to 100
+ * per mechanism are kept in the database, and pending notifications are always kept.
+ *
+ * @return The default policy.
+ */
++ (instancetype)defaultPolicy;
+
+@end
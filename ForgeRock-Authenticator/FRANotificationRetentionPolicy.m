@@ -0,0 +1,47 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRANotificationRetentionPolicy.h"
+
+static const NSTimeInterval FRADefaultMaximumAge = 30 * 24 * 60 * 60;
+static const NSUInteger FRADefaultMaximumCountPerMechanism = 100;
+static const NSTimeInterval FRADefaultArchiveAge = 24 * 60 * 60;
+
+@implementation FRANotificationRetentionPolicy
+
+- (instancetype)initWithMaximumAge:(NSTimeInterval)maximumAge maximumCountPerMechanism:(NSUInteger)maximumCountPerMechanism keepPending:(BOOL)keepPending {
+    return [self initWithMaximumAge:maximumAge maximumCountPerMechanism:maximumCountPerMechanism keepPending:keepPending archiveAge:0];
+}
+
+- (instancetype)initWithMaximumAge:(NSTimeInterval)maximumAge maximumCountPerMechanism:(NSUInteger)maximumCountPerMechanism keepPending:(BOOL)keepPending archiveAge:(NSTimeInterval)archiveAge {
+    if (self = [super init]) {
+        _maximumAge = maximumAge;
+        _maximumCountPerMechanism = maximumCountPerMechanism;
+        _keepPending = keepPending;
+        _archiveAge = archiveAge;
+    }
+    return self;
+}
+
++ (instancetype)defaultPolicy {
+    return [[FRANotificationRetentionPolicy alloc] initWithMaximumAge:FRADefaultMaximumAge
+                                             maximumCountPerMechanism:FRADefaultMaximumCountPerMechanism
+                                                          keepPending:YES
+                                                           archiveAge:FRADefaultArchiveAge];
+}
+
+@end
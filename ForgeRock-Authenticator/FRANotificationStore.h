@@ -0,0 +1,118 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+@class FRAIdentityDatabase;
+@class FRAIdentityModel;
+@class FRAMechanism;
+@class FRANotification;
+
+/*!
+ * Compact store for the completed notifications of a mechanism.
+ *
+ * Rather than keeping an object per notification, the store holds one fixed-width column per attribute (times,
+ * time to live, state bits and string offsets) with the strings themselves packed into a single UTF-8 arena.
+ * Load balancer cookies, which are shared by many notifications, are interned. Rows are kept in ascending order
+ * of timeReceived.
+ *
+ * FRANotification objects are only materialized when a row is requested. The store remembers materialized objects
+ * weakly, so while an object for a row is alive the same object is returned for that row.
+ *
+ * The store is thread safe.
+ */
+@interface FRANotificationStore : NSObject
+
+/*!
+ * The number of notifications in the store.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ * Incremented each time notifications are added to or removed from the store.
+ */
+@property (nonatomic, readonly) NSUInteger revision;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param database The database to which materialized notifications can be persisted.
+ * @param identityModel The identity model which contains the list of identities.
+ * @param mechanism The mechanism which materialized notifications belong to.
+ * @return The initialized store.
+ */
+- (instancetype)initWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel mechanism:(FRAMechanism *)mechanism;
+
+#pragma mark -
+#pragma mark Store Functions
+
+/*!
+ * Copies a notification into the store.
+ *
+ * @param notification The notification to store.
+ * @return The index at which the notification was stored.
+ */
+- (NSUInteger)addNotification:(FRANotification *)notification;
+
+/*!
+ * Finds the row holding a notification, matching on timeReceived and messageId.
+ *
+ * @param notification The notification to locate.
+ * @return The index of the notification, or NSNotFound if it is not in the store.
+ */
+- (NSUInteger)indexOfNotification:(FRANotification *)notification;
+
+/*!
+ * Finds the most recently received notification with the given message id.
+ *
+ * @param messageId The message id to search for.
+ * @return The index of the notification, or NSNotFound if there is none.
+ */
+- (NSUInteger)indexOfNotificationWithMessageId:(NSString *)messageId;
+
+/*!
+ * Removes a notification from the store.
+ *
+ * @param index The index of the notification, which must be less than count.
+ */
+- (void)removeNotificationAtIndex:(NSUInteger)index;
+
+/*!
+ * The time at which the notification at an index was received, read without materializing the notification.
+ *
+ * @param index The index of the notification, which must be less than count.
+ * @return The time received, or nil if the notification has none.
+ */
+- (NSDate *)timeReceivedAtIndex:(NSUInteger)index;
+
+/*!
+ * Materializes the notification at an index.
+ *
+ * @param index The index of the notification, which must be less than count.
+ * @return The notification.
+ */
+- (FRANotification *)notificationAtIndex:(NSUInteger)index;
+
+/*!
+ * Materializes every notification in the store, in ascending order of timeReceived.
+ *
+ * @return The notifications.
+ */
+- (NSArray<FRANotification *> *)allNotifications;
+
+@end
@@ -0,0 +1,500 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRAError.h"
+#import "FRAMechanism.h"
+#import "FRAModelObjectProtected.h"
+#import "FRANotification.h"
+#import "FRANotificationStore.h"
+
+/*! Offset recorded for a nil string. */
+static const uint32_t FRANoString = UINT32_MAX;
+
+/*! Arena garbage, in bytes, below which the arena is never compacted. */
+static const NSUInteger FRAMinimumArenaGarbage = 4096;
+
+/*! State bits held for each notification. */
+typedef NS_OPTIONS(uint8_t, FRANotificationStoreFlags) {
+    FRANotificationStorePending = 1 << 0,
+    FRANotificationStoreApproved = 1 << 1,
+    FRANotificationStoreHasTimeReceived = 1 << 2,
+    FRANotificationStoreHasTimeExpired = 1 << 3,
+};
+
+/*!
+ * Locates the latest row holding a message ID, along with the number of rows holding it.
+ */
+@interface FRANotificationStoreMessageIdEntry : NSObject
+
+@property (nonatomic) BOOL hasTimeReceived;
+@property (nonatomic) NSTimeInterval timeReceived;
+@property (nonatomic) uint32_t slot;
+@property (nonatomic) NSUInteger rows;
+
+@end
+
+@implementation FRANotificationStoreMessageIdEntry
+
+@end
+
+@implementation FRANotificationStore {
+    
+    FRAIdentityDatabase *database;
+    FRAIdentityModel *identityModel;
+    __weak FRAMechanism *mechanism;
+    
+    /*! Number of rows allocated in each column. */
+    NSUInteger capacity;
+    /*! timeReceived as seconds since the reference date. */
+    NSTimeInterval *timeReceived;
+    /*! timeExpired as seconds since the reference date. */
+    NSTimeInterval *timeExpired;
+    NSTimeInterval *timeToLive;
+    FRANotificationStoreFlags *flags;
+    /*! Offsets of the strings in the arena. */
+    uint32_t *messageIds;
+    uint32_t *challenges;
+    uint32_t *cookies;
+    /*! Identifier of each row which is stable as other rows are inserted and removed. */
+    uint32_t *slots;
+    
+    /*! NUL terminated UTF-8 strings referenced by the string columns. */
+    NSMutableData *arena;
+    /*! Bytes in the arena no longer referenced by any row. */
+    NSUInteger arenaGarbage;
+    /*! Arena offsets of interned load balancer cookies. */
+    NSMutableDictionary<NSString *, NSNumber *> *internedCookies;
+    
+    /*! The next slot identifier to assign. */
+    uint32_t nextSlot;
+    /*! Materialized notifications, keyed by slot and held weakly. */
+    NSMapTable<NSNumber *, FRANotification *> *materialized;
+    /*! The latest row holding each message ID. */
+    NSMutableDictionary<NSString *, FRANotificationStoreMessageIdEntry *> *rowsByMessageId;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithDatabase:(FRAIdentityDatabase *)aDatabase identityModel:(FRAIdentityModel *)anIdentityModel mechanism:(FRAMechanism *)aMechanism {
+    if (self = [super init]) {
+        database = aDatabase;
+        identityModel = anIdentityModel;
+        mechanism = aMechanism;
+        arena = [[NSMutableData alloc] init];
+        internedCookies = [[NSMutableDictionary alloc] init];
+        materialized = [NSMapTable strongToWeakObjectsMapTable];
+        rowsByMessageId = [[NSMutableDictionary alloc] init];
+        _count = 0;
+        _revision = 0;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(timeReceived);
+    free(timeExpired);
+    free(timeToLive);
+    free(flags);
+    free(messageIds);
+    free(challenges);
+    free(cookies);
+    free(slots);
+}
+
+#pragma mark -
+#pragma mark Store Functions
+
+- (NSUInteger)addNotification:(FRANotification *)notification {
+    @synchronized (self) {
+        [self ensureCapacity:_count + 1];
+        
+        NSTimeInterval received = notification.timeReceived ? [notification.timeReceived timeIntervalSinceReferenceDate] : 0;
+        BOOL hasTimeReceived = notification.timeReceived != nil;
+        NSUInteger index = [self insertionIndexForTimeReceived:received hasTimeReceived:hasTimeReceived];
+        [self openRowAtIndex:index];
+        
+        FRANotificationStoreFlags rowFlags = 0;
+        if ([notification isPending] || [notification isExpired]) {
+            rowFlags |= FRANotificationStorePending;
+        } else if ([notification isApproved]) {
+            rowFlags |= FRANotificationStoreApproved;
+        }
+        if (hasTimeReceived) {
+            rowFlags |= FRANotificationStoreHasTimeReceived;
+        }
+        if (notification.timeExpired) {
+            rowFlags |= FRANotificationStoreHasTimeExpired;
+        }
+        
+        timeReceived[index] = received;
+        timeExpired[index] = notification.timeExpired ? [notification.timeExpired timeIntervalSinceReferenceDate] : 0;
+        timeToLive[index] = notification.timeToLive;
+        flags[index] = rowFlags;
+        messageIds[index] = [self appendString:notification.messageId];
+        challenges[index] = [self appendString:notification.challenge];
+        cookies[index] = [self internCookie:notification.loadBalancerCookie];
+        slots[index] = nextSlot++;
+        [self recordMessageId:notification.messageId atIndex:index];
+        
+        // The caller's object stands in for the row for as long as it is alive
+        [materialized setObject:notification forKey:@(slots[index])];
+        
+        _count++;
+        _revision++;
+        return index;
+    }
+}
+
+- (NSUInteger)indexOfNotification:(FRANotification *)notification {
+    @synchronized (self) {
+        NSTimeInterval received = notification.timeReceived ? [notification.timeReceived timeIntervalSinceReferenceDate] : 0;
+        BOOL hasTimeReceived = notification.timeReceived != nil;
+        NSUInteger first = [self firstIndexForTimeReceived:received hasTimeReceived:hasTimeReceived];
+        
+        const char *messageId = [notification.messageId UTF8String];
+        NSUInteger match = NSNotFound;
+        for (NSUInteger index = first; index < _count && [self row:index hasTimeReceived:received present:hasTimeReceived]; index++) {
+            if ([materialized objectForKey:@(slots[index])] == notification) {
+                return index;
+            }
+            if (match == NSNotFound && [self string:messageIds[index] isEqualToUTF8String:messageId]) {
+                match = index;
+            }
+        }
+        return match;
+    }
+}
+
+- (NSUInteger)indexOfNotificationWithMessageId:(NSString *)messageId {
+    if (!messageId) {
+        return NSNotFound;
+    }
+    @synchronized (self) {
+        FRANotificationStoreMessageIdEntry *entry = rowsByMessageId[messageId];
+        return entry ? [self indexOfMessageIdEntry:entry] : NSNotFound;
+    }
+}
+
+- (void)removeNotificationAtIndex:(NSUInteger)index {
+    @synchronized (self) {
+        if (index >= _count) {
+            @throw [FRAError createIllegalStateException:@"Notification index out of range"];
+        }
+        [materialized removeObjectForKey:@(slots[index])];
+        [self forgetMessageIdAtIndex:index];
+        arenaGarbage += [self lengthOfString:messageIds[index]] + [self lengthOfString:challenges[index]];
+        [self closeRowAtIndex:index];
+        _count--;
+        _revision++;
+        if (arenaGarbage > FRAMinimumArenaGarbage && arenaGarbage > arena.length / 2) {
+            [self compactArena];
+        }
+    }
+}
+
+- (NSDate *)timeReceivedAtIndex:(NSUInteger)index {
+    @synchronized (self) {
+        if (index >= _count) {
+            @throw [FRAError createIllegalStateException:@"Notification index out of range"];
+        }
+        if (!(flags[index] & FRANotificationStoreHasTimeReceived)) {
+            return nil;
+        }
+        return [NSDate dateWithTimeIntervalSinceReferenceDate:timeReceived[index]];
+    }
+}
+
+- (FRANotification *)notificationAtIndex:(NSUInteger)index {
+    @synchronized (self) {
+        if (index >= _count) {
+            @throw [FRAError createIllegalStateException:@"Notification index out of range"];
+        }
+        NSNumber *slot = @(slots[index]);
+        FRANotification *notification = [materialized objectForKey:slot];
+        if (notification) {
+            return notification;
+        }
+        
+        FRANotificationStoreFlags rowFlags = flags[index];
+        NSDate *received = (rowFlags & FRANotificationStoreHasTimeReceived) ? [NSDate dateWithTimeIntervalSinceReferenceDate:timeReceived[index]] : nil;
+        notification = [FRANotification notificationWithDatabase:database
+                                                   identityModel:identityModel
+                                                       messageId:[self stringAtOffset:messageIds[index]]
+                                                       challenge:[self stringAtOffset:challenges[index]]
+                                                    timeReceived:received
+                                                      timeToLive:timeToLive[index]
+                                          loadBalancerCookieData:[self stringAtOffset:cookies[index]]
+                                                         pending:(rowFlags & FRANotificationStorePending) != 0
+                                                        approved:(rowFlags & FRANotificationStoreApproved) != 0];
+        // Set before the parent so that the mechanism is not told about the change
+        notification.timeExpired = (rowFlags & FRANotificationStoreHasTimeExpired) ? [NSDate dateWithTimeIntervalSinceReferenceDate:timeExpired[index]] : nil;
+        // Notifications are persisted along with their mechanism, so the mechanism's state stands in for the row's
+        notification.stored = [mechanism isStored];
+        notification.parent = mechanism;
+        [materialized setObject:notification forKey:slot];
+        return notification;
+    }
+}
+
+- (NSArray<FRANotification *> *)allNotifications {
+    @synchronized (self) {
+        NSMutableArray<FRANotification *> *notifications = [[NSMutableArray alloc] initWithCapacity:_count];
+        for (NSUInteger index = 0; index < _count; index++) {
+            [notifications addObject:[self notificationAtIndex:index]];
+        }
+        return notifications;
+    }
+}
+
+#pragma mark -
+#pragma mark Column Functions
+
+- (void)ensureCapacity:(NSUInteger)required {
+    if (required <= capacity) {
+        return;
+    }
+    NSUInteger newCapacity = MAX(16, capacity * 2);
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    timeReceived = reallocf(timeReceived, newCapacity * sizeof(*timeReceived));
+    timeExpired = reallocf(timeExpired, newCapacity * sizeof(*timeExpired));
+    timeToLive = reallocf(timeToLive, newCapacity * sizeof(*timeToLive));
+    flags = reallocf(flags, newCapacity * sizeof(*flags));
+    messageIds = reallocf(messageIds, newCapacity * sizeof(*messageIds));
+    challenges = reallocf(challenges, newCapacity * sizeof(*challenges));
+    cookies = reallocf(cookies, newCapacity * sizeof(*cookies));
+    slots = reallocf(slots, newCapacity * sizeof(*slots));
+    if (!timeReceived || !timeExpired || !timeToLive || !flags || !messageIds || !challenges || !cookies || !slots) {
+        @throw [NSException exceptionWithName:NSMallocException reason:@"Unable to grow notification store" userInfo:nil];
+    }
+    capacity = newCapacity;
+}
+
+/*!
+ * Shifts every column up by one row from the index, leaving a gap to be filled.
+ */
+- (void)openRowAtIndex:(NSUInteger)index {
+    NSUInteger tail = _count - index;
+    memmove(&timeReceived[index + 1], &timeReceived[index], tail * sizeof(*timeReceived));
+    memmove(&timeExpired[index + 1], &timeExpired[index], tail * sizeof(*timeExpired));
+    memmove(&timeToLive[index + 1], &timeToLive[index], tail * sizeof(*timeToLive));
+    memmove(&flags[index + 1], &flags[index], tail * sizeof(*flags));
+    memmove(&messageIds[index + 1], &messageIds[index], tail * sizeof(*messageIds));
+    memmove(&challenges[index + 1], &challenges[index], tail * sizeof(*challenges));
+    memmove(&cookies[index + 1], &cookies[index], tail * sizeof(*cookies));
+    memmove(&slots[index + 1], &slots[index], tail * sizeof(*slots));
+}
+
+/*!
+ * Shifts every column down by one row over the index.
+ */
+- (void)closeRowAtIndex:(NSUInteger)index {
+    NSUInteger tail = _count - index - 1;
+    memmove(&timeReceived[index], &timeReceived[index + 1], tail * sizeof(*timeReceived));
+    memmove(&timeExpired[index], &timeExpired[index + 1], tail * sizeof(*timeExpired));
+    memmove(&timeToLive[index], &timeToLive[index + 1], tail * sizeof(*timeToLive));
+    memmove(&flags[index], &flags[index + 1], tail * sizeof(*flags));
+    memmove(&messageIds[index], &messageIds[index + 1], tail * sizeof(*messageIds));
+    memmove(&challenges[index], &challenges[index + 1], tail * sizeof(*challenges));
+    memmove(&cookies[index], &cookies[index + 1], tail * sizeof(*cookies));
+    memmove(&slots[index], &slots[index + 1], tail * sizeof(*slots));
+}
+
+/*!
+ * Whether a row has the given timeReceived. Rows without a timeReceived sort before all others.
+ */
+- (BOOL)row:(NSUInteger)index hasTimeReceived:(NSTimeInterval)received present:(BOOL)hasTimeReceived {
+    BOOL rowHasTimeReceived = (flags[index] & FRANotificationStoreHasTimeReceived) != 0;
+    return rowHasTimeReceived == hasTimeReceived && (!hasTimeReceived || timeReceived[index] == received);
+}
+
+/*!
+ * Whether a row sorts strictly before the given timeReceived.
+ */
+- (BOOL)row:(NSUInteger)index isBeforeTimeReceived:(NSTimeInterval)received present:(BOOL)hasTimeReceived {
+    BOOL rowHasTimeReceived = (flags[index] & FRANotificationStoreHasTimeReceived) != 0;
+    if (!hasTimeReceived) {
+        return NO;
+    }
+    return !rowHasTimeReceived || timeReceived[index] < received;
+}
+
+- (NSUInteger)firstIndexForTimeReceived:(NSTimeInterval)received hasTimeReceived:(BOOL)hasTimeReceived {
+    NSUInteger low = 0;
+    NSUInteger high = _count;
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([self row:middle isBeforeTimeReceived:received present:hasTimeReceived]) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*!
+ * The index after any rows with the same timeReceived, so equal times keep insertion order.
+ */
+- (NSUInteger)insertionIndexForTimeReceived:(NSTimeInterval)received hasTimeReceived:(BOOL)hasTimeReceived {
+    NSUInteger index = [self firstIndexForTimeReceived:received hasTimeReceived:hasTimeReceived];
+    while (index < _count && [self row:index hasTimeReceived:received present:hasTimeReceived]) {
+        index++;
+    }
+    return index;
+}
+
+#pragma mark -
+#pragma mark Message ID Functions
+
+/*!
+ * Whether a row sorts after the row located by an entry. Rows are ordered by timeReceived and then by slot, as
+ * rows with equal times keep insertion order.
+ */
+- (BOOL)row:(NSUInteger)index isAfterMessageIdEntry:(FRANotificationStoreMessageIdEntry *)entry {
+    if ([self row:index hasTimeReceived:entry.timeReceived present:entry.hasTimeReceived]) {
+        return slots[index] > entry.slot;
+    }
+    return ![self row:index isBeforeTimeReceived:entry.timeReceived present:entry.hasTimeReceived];
+}
+
+- (void)setMessageIdEntry:(FRANotificationStoreMessageIdEntry *)entry toIndex:(NSUInteger)index {
+    entry.hasTimeReceived = (flags[index] & FRANotificationStoreHasTimeReceived) != 0;
+    entry.timeReceived = timeReceived[index];
+    entry.slot = slots[index];
+}
+
+- (NSUInteger)indexOfMessageIdEntry:(FRANotificationStoreMessageIdEntry *)entry {
+    NSUInteger first = [self firstIndexForTimeReceived:entry.timeReceived hasTimeReceived:entry.hasTimeReceived];
+    for (NSUInteger index = first; index < _count && [self row:index hasTimeReceived:entry.timeReceived present:entry.hasTimeReceived]; index++) {
+        if (slots[index] == entry.slot) {
+            return index;
+        }
+    }
+    return NSNotFound;
+}
+
+- (void)recordMessageId:(NSString *)messageId atIndex:(NSUInteger)index {
+    if (!messageId) {
+        return;
+    }
+    FRANotificationStoreMessageIdEntry *entry = rowsByMessageId[messageId];
+    if (!entry) {
+        entry = [[FRANotificationStoreMessageIdEntry alloc] init];
+        [self setMessageIdEntry:entry toIndex:index];
+        rowsByMessageId[messageId] = entry;
+    } else if ([self row:index isAfterMessageIdEntry:entry]) {
+        [self setMessageIdEntry:entry toIndex:index];
+    }
+    entry.rows++;
+}
+
+/*!
+ * Stops locating a row which is about to be removed, falling back to the latest other row with the same message ID.
+ */
+- (void)forgetMessageIdAtIndex:(NSUInteger)index {
+    NSString *messageId = [self stringAtOffset:messageIds[index]];
+    FRANotificationStoreMessageIdEntry *entry = messageId ? rowsByMessageId[messageId] : nil;
+    if (!entry) {
+        return;
+    }
+    entry.rows--;
+    if (entry.rows == 0) {
+        [rowsByMessageId removeObjectForKey:messageId];
+        return;
+    }
+    if (entry.slot != slots[index]) {
+        return;
+    }
+    const char *utf8 = [messageId UTF8String];
+    for (NSUInteger other = _count; other > 0; other--) {
+        if (other - 1 != index && [self string:messageIds[other - 1] isEqualToUTF8String:utf8]) {
+            [self setMessageIdEntry:entry toIndex:other - 1];
+            return;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Arena Functions
+
+- (uint32_t)appendString:(NSString *)string {
+    if (!string) {
+        return FRANoString;
+    }
+    const char *utf8 = [string UTF8String];
+    NSUInteger offset = arena.length;
+    if (offset + strlen(utf8) + 1 >= FRANoString) {
+        @throw [NSException exceptionWithName:NSMallocException reason:@"Notification store arena is full" userInfo:nil];
+    }
+    [arena appendBytes:utf8 length:strlen(utf8) + 1];
+    return (uint32_t)offset;
+}
+
+- (uint32_t)internCookie:(NSString *)cookie {
+    if (!cookie) {
+        return FRANoString;
+    }
+    NSNumber *offset = internedCookies[cookie];
+    if (!offset) {
+        offset = @([self appendString:cookie]);
+        internedCookies[cookie] = offset;
+    }
+    return offset.unsignedIntValue;
+}
+
+- (NSString *)stringAtOffset:(uint32_t)offset {
+    if (offset == FRANoString) {
+        return nil;
+    }
+    return [NSString stringWithUTF8String:(const char *)arena.bytes + offset];
+}
+
+- (NSUInteger)lengthOfString:(uint32_t)offset {
+    if (offset == FRANoString) {
+        return 0;
+    }
+    return strlen((const char *)arena.bytes + offset) + 1;
+}
+
+- (BOOL)string:(uint32_t)offset isEqualToUTF8String:(const char *)string {
+    if (offset == FRANoString || !string) {
+        return offset == FRANoString && !string;
+    }
+    return strcmp((const char *)arena.bytes + offset, string) == 0;
+}
+
+/*!
+ * Rebuilds the arena with only the strings still referenced, re-interning cookies.
+ */
+- (void)compactArena {
+    NSMutableData *oldArena = arena;
+    arena = [[NSMutableData alloc] initWithCapacity:oldArena.length - arenaGarbage];
+    [internedCookies removeAllObjects];
+    for (NSUInteger index = 0; index < _count; index++) {
+        const char *base = (const char *)oldArena.bytes;
+        messageIds[index] = messageIds[index] == FRANoString ? FRANoString : [self appendString:[NSString stringWithUTF8String:base + messageIds[index]]];
+        challenges[index] = challenges[index] == FRANoString ? FRANoString : [self appendString:[NSString stringWithUTF8String:base + challenges[index]]];
+        cookies[index] = cookies[index] == FRANoString ? FRANoString : [self internCookie:[NSString stringWithUTF8String:base + cookies[index]]];
+    }
+    arenaGarbage = 0;
+}
+
+@end
@@ -21,6 +21,7 @@ extern NSString * const FRANotificationsTableViewControllerStoryboardIdentifer;
 /*! The storyboard identifier for the segue from FRANotificationsTableViewController to FRANotificationViewController. */
 extern NSString * const FRANotificationsTableViewControllerShowNotificationsSegue;
 
+@class FRANotificationArchive;
 @class FRAPushMechanism;
 
 /*!
@@ -33,4 +34,10 @@ extern NSString * const FRANotificationsTableViewControllerShowNotificationsSegu
  */
 @property (strong, nonatomic) FRAPushMechanism *pushMechanism;
 
+/*!
+ * The archive from which older completed notifications are paged in as the table is scrolled to the end of the
+ * mechanism's history. Exposed to allow (setter) dependency injection.
+ */
+@property (strong, nonatomic) FRANotificationArchive *notificationArchive;
+
 @end
@@ -16,10 +16,15 @@
 
 #import "FRAIdentityDatabase.h"
 #import "FRANotification.h"
+#import "FRANotificationArchive.h"
+#import "FRANotificationStore.h"
 #import "FRANotificationsTableViewController.h"
 #import "FRANotificationViewController.h"
 #import "FRANotificationTableViewCell.h"
 #import "FRAPushMechanism.h"
+#import "FRASnapshotDiff.h"
+#import "FRASortedView.h"
+#import "FRAUIUtils.h"
 
 NSString * const FRANotificationsTableViewControllerStoryboardIdentifer = @"NotificationsTableViewController";
 NSString * const FRANotificationsTableViewControllerShowNotificationsSegue = @"showNotificationSegue";
@@ -27,6 +32,9 @@ NSString * const FRANotificationsTableViewControllerShowNotificationsSegue = @"s
 static const NSInteger NUMBER_OF_SECTIONS = 2;
 static const NSInteger PENDING_SECTION_INDEX = 0;
 static const NSInteger COMPLETED_SECTION_INDEX = 1;
+/*! Ages are shown to the minute at most, so there is no need to refresh them more often. */
+static const NSTimeInterval AGE_REFRESH_INTERVAL = 60.0;
+static const NSUInteger ARCHIVE_PAGE_SIZE = 50;
 
 /*!
  * Private interface.
@@ -38,6 +46,53 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
  */
 @property (strong, nonatomic) NSTimer *timer;
 
+/*!
+ * The pending notifications as last presented to the table view, against which changes are diffed.
+ */
+@property (copy, nonatomic) NSArray<FRANotification *> *displayedPendingNotifications;
+
+/*!
+ * The number of completed notifications last presented to the table view.
+ */
+@property (assign, nonatomic) NSUInteger displayedCompletedCount;
+
+/*!
+ * The revision of the notification history when the completed notifications were last presented to the table view.
+ */
+@property (assign, nonatomic) NSUInteger displayedHistoryRevision;
+
+/*!
+ * Pending notifications in reverse chronological order, maintained as notifications change.
+ */
+@property (strong, nonatomic) FRASortedView<FRANotification *> *pendingView;
+
+/*!
+ * The active notifications snapshot which the pending view reflects. A different snapshot from the push mechanism
+ * means there are changes which have not yet been reported, so the view is rebuilt.
+ */
+@property (strong, nonatomic) NSArray<FRANotification *> *syncedActiveNotifications;
+
+/*!
+ * Pages read from the notification archive so far, most recent first. They follow the history in the completed
+ * section.
+ */
+@property (strong, nonatomic) NSMutableArray<FRANotification *> *archivedNotifications;
+
+/*!
+ * Whether the archive has no more notifications to page in.
+ */
+@property (assign, nonatomic) BOOL archiveExhausted;
+
+/*!
+ * Incremented whenever the archived pages are discarded, so that a page read before then is not appended.
+ */
+@property (assign, nonatomic) NSUInteger archivePageGeneration;
+
+/*!
+ * Whether a page is being read from the archive.
+ */
+@property (assign, nonatomic) BOOL loadingArchivePage;
+
 @end
 
 @implementation FRANotificationsTableViewController
@@ -47,15 +102,15 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
 
 - (void)viewWillAppear:(BOOL)animated {
     [super viewWillAppear:animated];
-    [self.tableView reloadData];
-    if ([self numberOfNotifications] == 0) {
-        [self addLabelToTableViewBackground];
-    } else {
-        [self clearTableViewBackground];
+    [self reloadAllRows];
+    [self updateTableViewBackground];
+    if ([self numberOfCompletedNotifications] == 0) {
+        // There is no last completed row to scroll to, so start paging in straight away
+        [self loadNextArchivePage];
     }
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangedNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleIdentityDatabaseChanged:) name:FRAIdentityDatabaseChangesCoalescedNotification object:nil];
     if (!self.timer) {
-        self.timer = [NSTimer scheduledTimerWithTimeInterval:1.0 target:self selector:@selector(timerCallback:) userInfo:nil repeats:YES];
+        self.timer = [NSTimer scheduledTimerWithTimeInterval:AGE_REFRESH_INTERVAL target:self selector:@selector(timerCallback:) userInfo:nil repeats:YES];
     }
 }
 
@@ -70,7 +125,7 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
         FRANotificationViewController *controller = (FRANotificationViewController *)segue.destinationViewController;
         NSArray *selection = [self.tableView indexPathsForSelectedRows];
         NSIndexPath *indexPath = [selection objectAtIndex:0];
-        controller.notification = [[self pendingNotifications] objectAtIndex:indexPath.row];
+        controller.notification = [[self pendingNotificationsView] objectAtIndex:indexPath.row];
     }
 }
 
@@ -78,7 +133,7 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
 #pragma mark UITableViewDataSource
 
 - (NSInteger)numberOfSectionsInTableView:(UITableView *)tableView {
-    if ([self completedNotifications].count == 0) {
+    if ([self numberOfCompletedNotifications] == 0) {
         return 1;
     }
     return NUMBER_OF_SECTIONS;
@@ -86,10 +141,9 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
     if (section == PENDING_SECTION_INDEX) {
-        return [self pendingNotifications].count;
-    } else {
-        return [self completedNotifications].count;
+        return [self pendingNotificationsView].count;
     }
+    return [self numberOfCompletedNotifications];
 }
 
 - (NSString *)tableView:(UITableView *)tableView titleForHeaderInSection:(NSInteger)section {
@@ -105,7 +159,7 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
 
     if (indexPath.section == PENDING_SECTION_INDEX) {
         FRANotificationTableViewCell *cell = [tableView dequeueReusableCellWithIdentifier:CellIdentifier forIndexPath:indexPath];
-        FRANotification *notification = [[self pendingNotifications] objectAtIndex:indexPath.row];
+        FRANotification *notification = [[self pendingNotificationsView] objectAtIndex:indexPath.row];
         
         cell.status.text = NSLocalizedString(@"notifications_pending_status", nil);
         cell.image.image = [[UIImage imageNamed:@"PendingIcon"] imageWithRenderingMode:UIImageRenderingModeAlwaysTemplate];
@@ -121,7 +175,7 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
         
     } else if (indexPath.section == COMPLETED_SECTION_INDEX) {
         FRANotificationTableViewCell *cell = [tableView dequeueReusableCellWithIdentifier:CellIdentifier forIndexPath:indexPath];
-        FRANotification *notification = [[self completedNotifications] objectAtIndex:indexPath.row];
+        FRANotification *notification = [self completedNotificationAtRow:indexPath.row];
         
         if (notification.isApproved) {
             cell.status.text = NSLocalizedString(@"notifications_approved_status", nil);
@@ -170,52 +224,253 @@ static const NSInteger COMPLETED_SECTION_INDEX = 1;
     if ([cell respondsToSelector:@selector(setLayoutMargins:)]) {
         [cell setLayoutMargins:UIEdgeInsetsZero];
     }
+    if (indexPath.section == COMPLETED_SECTION_INDEX && (NSUInteger)indexPath.row + 1 == [self numberOfCompletedNotifications]) {
+        [self loadNextArchivePage];
+    }
 }
 
 #pragma mark -
 #pragma mark FRANotificationsTableViewController
 
-- (NSArray *)pendingNotifications {
-    NSMutableArray *pendingNotifications = [NSMutableArray array];
-    for (FRANotification *notification in [self.pushMechanism notifications]) {
-        if (notification.isPending) {
-            [pendingNotifications addObject:notification];
+/*!
+ * The pending view, rebuilt if the push mechanism's active notifications have changed without the change being
+ * reported.
+ */
+- (FRASortedView<FRANotification *> *)pendingNotificationsView {
+    if (!self.pendingView) {
+        // Reverse chronological order
+        self.pendingView = [[FRASortedView alloc] initWithComparator:^NSComparisonResult(FRANotification* first, FRANotification* second) {
+            return [second.timeReceived compare:first.timeReceived];
+        }];
+    }
+    NSArray<FRANotification *> *activeNotifications = [self.pushMechanism activeNotifications];
+    if (activeNotifications != self.syncedActiveNotifications) {
+        NSMutableArray<FRANotification *> *pendingNotifications = [NSMutableArray array];
+        for (FRANotification *notification in activeNotifications) {
+            if (notification.isPending) {
+                [pendingNotifications addObject:notification];
+            }
         }
+        [self.pendingView setObjects:pendingNotifications];
+        self.syncedActiveNotifications = activeNotifications;
     }
-    [self sortNotifications:pendingNotifications];
-    return pendingNotifications;
+    return self.pendingView;
 }
 
 /*!
- * Sorts notifications in reverse chronological order.
+ * Applies reported additions and removals of this mechanism's notifications to the pending view.
  */
-- (void)sortNotifications:(NSMutableArray *)notifications {
-    [notifications sortUsingComparator:^NSComparisonResult(FRANotification* first, FRANotification* second) {
-        return [second.timeReceived compare:first.timeReceived];
-    }];
+- (void)updatePendingViewWithStateChanges:(NSDictionary *)stateChanges {
+    if (!self.syncedActiveNotifications) {
+        return;
+    }
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationRemovedItems]) {
+        if ([item isKindOfClass:[FRANotification class]]) {
+            [self.pendingView removeObject:item];
+        }
+    }
+    for (id item in stateChanges[FRAIdentityDatabaseChangedNotificationAddedItems]) {
+        if ([item isKindOfClass:[FRANotification class]] && ((FRANotification *)item).parent == self.pushMechanism
+                && ((FRANotification *)item).isPending && [self.pendingView indexOfObject:item] == NSNotFound) {
+            [self.pendingView addObject:item];
+        }
+    }
+    self.syncedActiveNotifications = [self.pushMechanism activeNotifications];
 }
 
-- (NSArray *)completedNotifications {
-    NSMutableArray *completedNotifications = [NSMutableArray array];
-    for (FRANotification *notification in [self.pushMechanism notifications]) {
+/*!
+ * Moves notifications which have been approved, denied or have expired into the push mechanism's history and out
+ * of the pending view.
+ */
+- (void)archiveResolvedNotifications {
+    [self.pushMechanism archiveResolvedNotifications];
+    FRASortedView<FRANotification *> *pendingView = [self pendingNotificationsView];
+    for (NSInteger index = (NSInteger)pendingView.count - 1; index >= 0; index--) {
+        FRANotification *notification = [pendingView objectAtIndex:index];
         if (!notification.isPending) {
-            [completedNotifications addObject:notification];
+            [pendingView removeObject:notification];
         }
     }
-    [self sortNotifications:completedNotifications];
-    return completedNotifications;
 }
 
-- (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
+- (NSUInteger)numberOfCompletedNotifications {
+    return self.pushMechanism.notificationHistory.count + self.archivedNotifications.count;
+}
+
+/*!
+ * Materializes the completed notification for a row. The history is in chronological order, whereas the table
+ * shows the most recent notification first, followed by the pages read from the archive.
+ *
+ * Compaction may remove notifications from the history in the background before the table has been told, in which
+ * case the rows are out of step until the change is reported and nil may be returned.
+ */
+- (FRANotification *)completedNotificationAtRow:(NSInteger)row {
+    FRANotificationStore *history = self.pushMechanism.notificationHistory;
+    @synchronized (history) {
+        if ((NSUInteger)row < history.count) {
+            return [history notificationAtIndex:history.count - 1 - (NSUInteger)row];
+        }
+        NSUInteger archivedIndex = (NSUInteger)row - history.count;
+        return archivedIndex < self.archivedNotifications.count ? self.archivedNotifications[archivedIndex] : nil;
+    }
+}
+
+/*!
+ * Reads the next page of completed notifications from the archive in the background, unless the archive has no
+ * more or a page is already being read.
+ */
+- (void)loadNextArchivePage {
+    if (!self.notificationArchive || self.archiveExhausted || self.loadingArchivePage) {
+        return;
+    }
+    // Everything archived was received before the oldest notification still in the history
+    NSDate *receivedBefore = [self.archivedNotifications lastObject].timeReceived;
+    if (!receivedBefore) {
+        FRANotificationStore *history = self.pushMechanism.notificationHistory;
+        @synchronized (history) {
+            receivedBefore = history.count > 0 ? [history timeReceivedAtIndex:0] : nil;
+        }
+    }
+    self.loadingArchivePage = YES;
+    NSUInteger generation = self.archivePageGeneration;
+    NSString *mechanismUID = self.pushMechanism.mechanismUID;
+    FRANotificationArchive *archive = self.notificationArchive;
+    __weak FRANotificationsTableViewController *weakSelf = self;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *error;
+        NSArray<FRANotification *> *page = [archive notificationsWithMechanismUID:mechanismUID receivedBefore:receivedBefore limit:ARCHIVE_PAGE_SIZE error:&error];
+        if (!page) {
+            NSLog(@"Could not read notification archive: %@", error);
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf appendArchivePage:page generation:generation];
+        });
+    });
+}
+
+- (void)appendArchivePage:(NSArray<FRANotification *> *)page generation:(NSUInteger)generation {
+    self.loadingArchivePage = NO;
+    if (generation != self.archivePageGeneration) {
+        [self loadNextArchivePage];
+        return;
+    }
+    // A page which could not be read is not retried, to avoid spinning on a damaged archive
+    self.archiveExhausted = page.count < ARCHIVE_PAGE_SIZE;
+    if (page.count == 0) {
+        return;
+    }
+    if (!self.archivedNotifications) {
+        self.archivedNotifications = [[NSMutableArray alloc] init];
+    }
+    NSUInteger firstRow = self.displayedCompletedCount;
+    BOOL tableIsUpToDate = firstRow > 0 && [self.tableView numberOfSections] == NUMBER_OF_SECTIONS
+            && [self.tableView numberOfRowsInSection:COMPLETED_SECTION_INDEX] == (NSInteger)firstRow;
+    [self.archivedNotifications addObjectsFromArray:page];
+    if (!tableIsUpToDate) {
+        [self reloadAllRows];
+        [self updateTableViewBackground];
+        return;
+    }
+    NSMutableArray<NSIndexPath *> *indexPaths = [[NSMutableArray alloc] initWithCapacity:page.count];
+    for (NSUInteger row = firstRow; row < firstRow + page.count; row++) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:row inSection:COMPLETED_SECTION_INDEX]];
+    }
+    self.displayedCompletedCount = firstRow + page.count;
+    [self.tableView insertRowsAtIndexPaths:indexPaths withRowAnimation:UITableViewRowAnimationNone];
+}
+
+/*!
+ * Discards the pages read from the archive, which compaction may have added to since they were read.
+ */
+- (void)resetArchivePages {
+    self.archivedNotifications = nil;
+    self.archiveExhausted = NO;
+    self.archivePageGeneration++;
+}
+
+- (void)reloadAllRows {
+    [self archiveResolvedNotifications];
+    self.displayedPendingNotifications = [[self pendingNotificationsView] allObjects];
+    self.displayedCompletedCount = [self numberOfCompletedNotifications];
+    self.displayedHistoryRevision = self.pushMechanism.notificationHistory.revision;
     [self.tableView reloadData];
 }
 
+- (void)handleIdentityDatabaseChanged:(NSNotification *)notification {
+    [self updatePendingViewWithStateChanges:notification.userInfo];
+    NSMutableSet *updatedNotifications = [[NSMutableSet alloc] init];
+    for (NSSet *items in [notification.userInfo allValues]) {
+        [updatedNotifications unionSet:items];
+    }
+    [self applyChangesWithUpdatedNotifications:updatedNotifications];
+}
+
+/*!
+ * Brings the table view up to date with the push mechanism, using incremental row updates for the pending section
+ * and reloading the completed section only if the history has changed. Falls back to a full reload when the number
+ * of sections changes or the table has already picked up some of the changes.
+ */
+- (void)applyChangesWithUpdatedNotifications:(NSSet *)updatedNotifications {
+    [self archiveResolvedNotifications];
+    NSArray<FRANotification *> *pendingNotifications = [[self pendingNotificationsView] allObjects];
+    NSUInteger completedCount = [self numberOfCompletedNotifications];
+    NSUInteger historyRevision = self.pushMechanism.notificationHistory.revision;
+    
+    if (completedCount < self.displayedCompletedCount && self.archivedNotifications.count > 0) {
+        // Notifications have left the history, possibly for the archive, so the archived pages are read again
+        [self resetArchivePages];
+        [self reloadAllRows];
+        [self loadNextArchivePage];
+        return;
+    }
+    
+    BOOL hadCompletedSection = self.displayedCompletedCount > 0;
+    BOOL hasCompletedSection = completedCount > 0;
+    BOOL tableIsUpToDate = [self.tableView numberOfSections] == (hadCompletedSection ? NUMBER_OF_SECTIONS : 1)
+            && [self.tableView numberOfRowsInSection:PENDING_SECTION_INDEX] == (NSInteger)self.displayedPendingNotifications.count
+            && (!hadCompletedSection || [self.tableView numberOfRowsInSection:COMPLETED_SECTION_INDEX] == (NSInteger)self.displayedCompletedCount);
+    if (hadCompletedSection != hasCompletedSection || !tableIsUpToDate) {
+        [self reloadAllRows];
+        return;
+    }
+    
+    FRASnapshotDiff *pendingDiff = [FRASnapshotDiff diffFromSnapshot:self.displayedPendingNotifications
+                                                          toSnapshot:pendingNotifications
+                                                      updatedObjects:updatedNotifications];
+    BOOL historyChanged = hasCompletedSection && historyRevision != self.displayedHistoryRevision;
+    self.displayedPendingNotifications = pendingNotifications;
+    self.displayedCompletedCount = completedCount;
+    self.displayedHistoryRevision = historyRevision;
+    if ([pendingDiff isEmpty] && !historyChanged) {
+        return;
+    }
+    [self.tableView beginUpdates];
+    [FRAUIUtils tableView:self.tableView applySnapshotDiff:pendingDiff toSection:PENDING_SECTION_INDEX];
+    if (historyChanged) {
+        [self.tableView reloadSections:[NSIndexSet indexSetWithIndex:COMPLETED_SECTION_INDEX] withRowAnimation:UITableViewRowAnimationAutomatic];
+    }
+    [self.tableView endUpdates];
+}
+
 - (void)timerCallback:(NSTimer*)timer {
-    [self.tableView reloadData];
+    // Expiry is reported as a database change by the identity model's expiry queue, so only the age of the visible
+    // notifications needs refreshing here
+    NSArray<NSIndexPath *> *visibleRows = [self.tableView indexPathsForVisibleRows];
+    if (visibleRows.count > 0) {
+        [self.tableView reloadRowsAtIndexPaths:visibleRows withRowAnimation:UITableViewRowAnimationNone];
+    }
 }
 
 - (NSUInteger)numberOfNotifications {
-    return [self pendingNotifications].count + [self completedNotifications].count;
+    return [self pendingNotificationsView].count + [self numberOfCompletedNotifications];
+}
+
+- (void)updateTableViewBackground {
+    if ([self numberOfNotifications] == 0) {
+        [self addLabelToTableViewBackground];
+    } else {
+        [self clearTableViewBackground];
+    }
 }
 
 - (void)addLabelToTableViewBackground {
@@ -39,6 +39,20 @@
  */
 + (NSString *)hmac:(CCHmacAlgorithm)algorithm codeLength:(uint8_t)codeLength key:(NSData *)key counter:(uint64_t) counter;
 
+/*!
+ * Create a keyed-hash message authentication code (HMAC) from key bytes which are not held in an NSData, such as
+ * those of an FRAKeyMaterial.
+ *
+ * @param algorithm The cryptographic function to use in the calculation of the HMAC.
+ * @param codeLength The length of the code.
+ * @param keyBytes The secret key.
+ * @param keyLength The number of bytes of the secret key.
+ * @param counter The counter to hash.
+ *
+ * @return The keyed-hash message authentication code (HMAC).
+ */
++ (NSString *)hmac:(CCHmacAlgorithm)algorithm codeLength:(uint8_t)codeLength keyBytes:(const void *)keyBytes length:(size_t)keyLength counter:(uint64_t)counter;
+
 /*!
  * String representation of an HMAC algorithm.
  *
@@ -24,31 +24,18 @@
 #pragma mark Class Methods
 
 + (NSString *)hmac:(CCHmacAlgorithm)algorithm codeLength:(uint8_t)codeLength key:(NSData *)key counter:(uint64_t) counter {
-#ifdef __LITTLE_ENDIAN__
-    // Network byte order
-    counter = (((uint64_t) htonl(counter)) << 32) + htonl(counter >> 32);
-#endif
+    return [self hmac:algorithm codeLength:codeLength keyBytes:[key bytes] length:[key length] counter:counter];
+}
+
++ (NSString *)hmac:(CCHmacAlgorithm)algorithm codeLength:(uint8_t)codeLength keyBytes:(const void *)keyBytes length:(size_t)keyLength counter:(uint64_t)counter {
+    counter = CFSwapInt64HostToBig(counter);
     
-    // Create digits divisor
-    uint32_t div = 1;
-    for (int i = codeLength; i > 0; i--) {
-        div *= 10;
-    }
     // Create the HMAC
     int length = [self getDigestLength:algorithm];
     uint8_t digest[length];
-    CCHmac(algorithm, [key bytes], [key length], &counter, sizeof(counter), digest);
-    
-    // Truncate
-    uint32_t binary;
-    uint32_t off = digest[sizeof(digest) - 1] & 0xf;
-    binary  = (digest[off + 0] & 0x7f) << 0x18;
-    binary |= (digest[off + 1] & 0xff) << 0x10;
-    binary |= (digest[off + 2] & 0xff) << 0x08;
-    binary |= (digest[off + 3] & 0xff) << 0x00;
-    binary  = binary % div;
+    CCHmac(algorithm, keyBytes, keyLength, &counter, sizeof(counter), digest);
     
-    return [NSString stringWithFormat:[NSString stringWithFormat:@"%%0%hhulu", codeLength], binary];
+    return [self truncate:digest length:length codeLength:codeLength];
 }
 
 + (NSString *)asString:(CCHmacAlgorithm)algorithm {
@@ -91,4 +78,27 @@
     }
 }
 
+#pragma mark -
+#pragma mark Private Methods
+
++ (NSString *)truncate:(uint8_t *)digest length:(int)length codeLength:(uint8_t)codeLength {
+    // Create digits divisor
+    uint32_t div = 1;
+    for (int i = codeLength; i > 0; i--) {
+        div *= 10;
+    }
+    
+    // Truncate
+    uint32_t binary;
+    uint32_t off = digest[length - 1] & 0xf;
+    binary  = (digest[off + 0] & 0x7f) << 0x18;
+    binary |= (digest[off + 1] & 0xff) << 0x10;
+    binary |= (digest[off + 2] & 0xff) << 0x08;
+    binary |= (digest[off + 3] & 0xff) << 0x00;
+    binary  = binary % div;
+    memset_s(digest, length, 0, length);
+    
+    return [NSString stringWithFormat:[NSString stringWithFormat:@"%%0%hhulu", codeLength], binary];
+}
+
 @end
@@ -0,0 +1,53 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#include <CommonCrypto/CommonHMAC.h>
+
+/*!
+ * The secret key of an OATH mechanism, held in the default FRAKeyArena so that it is locked in memory and zeroized
+ * when released. Keys too long for an arena slot are held in an NSData instead.
+ *
+ * Shared by the HOTP and TOTP mechanisms, which generate their codes through it.
+ */
+@interface FRAOathKey : NSObject
+
+/*!
+ * Init method.
+ *
+ * @param secretKey The secret key, which is copied into the key arena.
+ * @return The initialized key.
+ */
+- (instancetype)initWithData:(NSData *)secretKey;
+
+/*!
+ * Copies the secret key into a new NSData.
+ *
+ * @return A copy of the secret key.
+ */
+- (NSData *)data;
+
+/*!
+ * Generates the code for a counter without copying the secret key out of the arena.
+ *
+ * @param algorithm The HMAC algorithm to use.
+ * @param codeLength The length of the code.
+ * @param counter The counter to hash.
+ * @return The code.
+ */
+- (NSString *)codeWithAlgorithm:(CCHmacAlgorithm)algorithm codeLength:(NSUInteger)codeLength counter:(uint64_t)counter;
+
+@end
@@ -0,0 +1,53 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRAKeyArena.h"
+#import "FRAOathCode.h"
+#import "FRAOathKey.h"
+
+@implementation FRAOathKey {
+    FRAKeyMaterial *keyMaterial;
+    NSData *oversizedKey;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithData:(NSData *)secretKey {
+    self = [super init];
+    if (self) {
+        keyMaterial = [[FRAKeyArena defaultArena] keyMaterialWithData:secretKey];
+        oversizedKey = keyMaterial ? nil : secretKey;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (NSData *)data {
+    return keyMaterial ? [keyMaterial data] : oversizedKey;
+}
+
+- (NSString *)codeWithAlgorithm:(CCHmacAlgorithm)algorithm codeLength:(NSUInteger)codeLength counter:(uint64_t)counter {
+    if (keyMaterial) {
+        return [FRAOathCode hmac:algorithm codeLength:codeLength keyBytes:keyMaterial.bytes length:keyMaterial.length counter:counter];
+    }
+    return [FRAOathCode hmac:algorithm codeLength:codeLength key:oversizedKey counter:counter];
+}
+
+@end
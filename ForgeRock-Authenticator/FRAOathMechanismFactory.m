@@ -15,6 +15,7 @@
  */
 
 #include "base32.h"
+#include "FRAUriParser.h"
 #include <CommonCrypto/CommonHMAC.h>
 
 #import "FRAError.h"
@@ -23,8 +24,8 @@
 #import "FRAIdentityDatabase.h"
 #import "FRAIdentityModel.h"
 #import "FRAMechanismFactory.h"
+#import "FRAMechanismUri.h"
 #import "FRAOathMechanismFactory.h"
-#import "FRAQRUtils.h"
 #import "FRATotpOathMechanism.h"
 
 static BOOL SUCCESS = YES;
@@ -36,18 +37,18 @@ static BOOL SUCCESS = YES;
 
 - (FRAMechanism *) buildMechanism:(NSURL *)uri database:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel handler:(void (^)(BOOL, NSError *))handler error:(NSError *__autoreleasing *)error {
     
-    NSDictionary *query = [self readQRCode:uri];
+    FRAMechanismUri *query = [self readQRCode:uri];
 
-    NSNumber *algorithm = parseAlgorithm([query objectForKey:@"algorithm"]);
-    NSData *key = parseKey([query objectForKey:@"secret"]);
-    NSNumber *_digits = parseDigits([query objectForKey:@"digits"]);
-    NSNumber *period = parsePeriod([query objectForKey:@"period"]);
-    NSString *image = [query objectForKey:@"image"];
-    NSString *label = [query objectForKey:@"_label"];
-    NSString *issuer = parseIssuer([query objectForKey:@"_issuer"], [query objectForKey:@"issuer"], label);
-    NSNumber *counter = parseCounter([query objectForKey:@"counter"]);
-    NSString *backgroundColor = [query objectForKey:@"b"];
-    NSString *_type = [query objectForKey:@"_type"];
+    NSNumber *algorithm = parseAlgorithm([query parameter:@"algorithm"]);
+    NSData *key = parseKey([query parameter:@"secret"]);
+    NSNumber *_digits = parseDigits([query parameter:@"digits"]);
+    NSNumber *period = parsePeriod([query parameter:@"period"]);
+    NSString *image = [query parameter:@"image"];
+    NSString *label = query.label;
+    NSString *issuer = parseIssuer(query.issuer, [query parameter:@"issuer"], label);
+    NSNumber *counter = parseCounter([query parameter:@"counter"]);
+    NSString *backgroundColor = [query parameter:@"b"];
+    NSString *_type = query.type;
     
     if(![self hasValidType:_type key:key issuer:issuer counter:counter algorithm:algorithm digits:_digits period:period backgroundColor:backgroundColor]) {
         if (error) {
@@ -76,60 +77,16 @@ static BOOL SUCCESS = YES;
     return mechanism;
 }
 
-- (NSDictionary *) readQRCode:(NSURL *)uri {
-    NSString* scheme = [uri scheme];
-    if (scheme == nil || !([scheme isEqualToString:@"otpauth"] || [scheme isEqualToString:@"pushauth"])) {
-        return nil;
-    }
-    NSString* _type = [uri host];
-    if (_type == nil || (![self isTotp:_type] && ![self isHotp:_type])) {
+- (FRAMechanismUri *) readQRCode:(NSURL *)uri {
+    FRAMechanismUri *mechanismUri = [FRAMechanismUri uriWithURL:uri];
+    if (mechanismUri == nil || !([mechanismUri hasScheme:@"otpauth"] || [mechanismUri hasScheme:@"pushauth"])) {
         return nil;
     }
-    // Get the path and strip it of its leading '/'
-    NSString* path = [uri path];
-    if (path == nil) {
+    NSString* _type = mechanismUri.type;
+    if (![self isTotp:_type] && ![self isHotp:_type]) {
         return nil;
     }
-    while ([path hasPrefix:@"/"]) {
-        path = [path substringFromIndex:1];
-    }
-    if ([path length] == 0) {
-        return nil;
-    }
-    // Get issuer and label
-    NSArray* array = [path componentsSeparatedByString:@":"];
-    if (array == nil || [array count] == 0) {
-        return nil;
-    }
-    NSString* _issuer;
-    NSString* _label;
-    if ([array count] > 1) {
-        _issuer = [FRAQRUtils decode:[array objectAtIndex:0]];
-        _label = [FRAQRUtils decode:[array objectAtIndex:1]];
-    } else {
-        _issuer = @"";
-        _label = [FRAQRUtils decode:[array objectAtIndex:0]];
-    }
-    
-    // Parse query
-    NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
-    array = [[uri query] componentsSeparatedByString:@"&"];
-    for (NSString *kv in array) {
-        // Value can contain '=' symbols, so look for first symbol.
-        NSRange index = [kv rangeOfString:@"="];
-        if (index.location == NSNotFound) {
-            continue;
-        }
-        NSString *name = [kv substringToIndex:index.location];
-        NSString *value = [kv substringFromIndex:index.location + index.length];
-        [query setValue:[FRAQRUtils decode:value] forKey:name];
-    }
-    
-    [query setValue:_issuer forKey:@"_issuer"];
-    [query setValue:_label forKey:@"_label"];
-    [query setValue:_type forKey:@"_type"];
-    
-    return query;
+    return mechanismUri;
 }
 
 /*!
@@ -309,13 +266,8 @@ static BOOL isValidBackgroundColor(NSString *color) {
         return YES;
     }
     
-    NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^[0-9a-fA-F]{6}$" options:0 error:nil];
-    NSUInteger numberOfMatches = [regex numberOfMatchesInString:color options:0 range:NSMakeRange(0, [color length])];
-    
-    if (numberOfMatches == 1) {
-        return YES;
-    };
-    return NO;
+    const char *bytes = [color UTF8String];
+    return bytes && FRAUriIsHexColor(bytes, strlen(bytes));
 }
 
 @end
\ No newline at end of file
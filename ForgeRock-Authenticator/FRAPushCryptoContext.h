@@ -0,0 +1,69 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/*!
+ * The cryptographic state of a push mechanism: its decoded shared secret, held in the default FRAKeyArena.
+ *
+ * Challenge responses and JWT signatures are signed with HMAC-SHA256 straight from the key held in the arena, so
+ * the secret is decoded only once. A context is immutable and may be used from any thread.
+ */
+@interface FRAPushCryptoContext : NSObject
+
+/*!
+ * Create a context from a Base64 or Base64url encoded shared secret.
+ *
+ * @param base64Secret The encoded shared secret.
+ * @return The context, or nil if the secret is not valid Base64.
+ */
++ (instancetype)contextWithBase64Secret:(NSString *)base64Secret;
+
+/*!
+ * Init a context with the raw bytes of the shared secret.
+ *
+ * @param key The shared secret.
+ * @return The initialized context, or nil if the key could not be placed in the key arena.
+ */
+- (instancetype)initWithKey:(NSData *)key;
+
+/*!
+ * Generate the response to a registration or authentication challenge: the Base64 encoded HMAC-SHA256 of
+ * the decoded challenge.
+ *
+ * @param challenge The Base64 encoded challenge.
+ * @return The challenge response.
+ */
+- (NSString *)challengeResponse:(NSString *)challenge;
+
+/*!
+ * Sign a payload as a compact HS256 JWS.
+ *
+ * @param payload The claims, which must be serializable as JSON.
+ * @return The signed token, or nil if the payload could not be serialized.
+ */
+- (NSString *)jwtWithPayload:(NSDictionary *)payload;
+
+/*!
+ * Check an HS256 signature in constant time.
+ *
+ * @param signature The signature bytes.
+ * @param signatureLength The length of the signature.
+ * @param bytes The signed bytes.
+ * @param length The number of signed bytes.
+ * @return YES if the signature is the HMAC-SHA256 of the bytes under this key.
+ */
+- (BOOL)verifySignature:(const uint8_t *)signature length:(size_t)signatureLength ofBytes:(const void *)bytes length:(size_t)length;
+
+@end
@@ -0,0 +1,117 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <CommonCrypto/CommonHMAC.h>
+#include "base64.h"
+
+#import "FRAKeyArena.h"
+#import "FRAPushCryptoContext.h"
+#import "FRAQRUtils.h"
+
+/*! Base64url encoding of {"typ":"JWT","alg":"HS256"}, the header of every token. */
+static const char FRAJwsHeader[] = "eyJ0eXAiOiJKV1QiLCJhbGciOiJIUzI1NiJ9";
+
+@implementation FRAPushCryptoContext {
+    FRAKeyMaterial *key;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
++ (instancetype)contextWithBase64Secret:(NSString *)base64Secret {
+    NSData *key = [FRAQRUtils decodeURL:base64Secret];
+    if (!key) {
+        return nil;
+    }
+    return [[FRAPushCryptoContext alloc] initWithKey:key];
+}
+
+- (instancetype)initWithKey:(NSData *)keyData {
+    self = [super init];
+    if (self) {
+        key = [[FRAKeyArena defaultArena] keyMaterialWithData:keyData ?: [NSData data]];
+        if (!key) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (NSString *)challengeResponse:(NSString *)challenge {
+    NSData *challengeBytes = [FRAQRUtils decodeBase64:challenge];
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    [self sign:challengeBytes.bytes length:challengeBytes.length digest:digest];
+    
+    char encoded[(CC_SHA256_DIGEST_LENGTH + 2) / 3 * 4 + 1];
+    int length = base64_encode(digest, sizeof(digest), encoded, sizeof(encoded), BASE64_STANDARD);
+    return [[NSString alloc] initWithBytes:encoded length:length encoding:NSASCIIStringEncoding];
+}
+
+- (NSString *)jwtWithPayload:(NSDictionary *)payload {
+    NSData *json = [NSJSONSerialization dataWithJSONObject:payload options:0 error:nil];
+    if (!json || json.length > INT_MAX / 2) {
+        return nil;
+    }
+    
+    // header "." payload "." signature, written once into a single buffer
+    int headerLength = sizeof(FRAJwsHeader) - 1;
+    int payloadLength = base64_encoded_size((int)json.length, BASE64_URL);
+    int signatureLength = base64_encoded_size(CC_SHA256_DIGEST_LENGTH, BASE64_URL);
+    int length = headerLength + 1 + payloadLength + 1 + signatureLength;
+    char *token = malloc(length + 1);
+    if (!token) {
+        return nil;
+    }
+    
+    char *cursor = token;
+    memcpy(cursor, FRAJwsHeader, headerLength);
+    cursor += headerLength;
+    *cursor++ = '.';
+    cursor += base64_encode(json.bytes, (int)json.length, cursor, payloadLength + 1, BASE64_URL);
+    
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    [self sign:token length:cursor - token digest:digest];
+    *cursor++ = '.';
+    base64_encode(digest, sizeof(digest), cursor, signatureLength + 1, BASE64_URL);
+    
+    return [[NSString alloc] initWithBytesNoCopy:token length:length encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+- (BOOL)verifySignature:(const uint8_t *)signature length:(size_t)signatureLength ofBytes:(const void *)bytes length:(size_t)length {
+    if (signatureLength != CC_SHA256_DIGEST_LENGTH) {
+        return NO;
+    }
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    [self sign:bytes length:length digest:digest];
+    
+    uint8_t difference = 0;
+    for (size_t i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        difference |= digest[i] ^ signature[i];
+    }
+    return difference == 0;
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+- (void)sign:(const void *)data length:(size_t)length digest:(uint8_t *)digest {
+    CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, data, length, digest);
+}
+
+@end
@@ -15,6 +15,9 @@
  */
 
 @class FRAIdentity;
+@class FRANotification;
+@class FRANotificationResponse;
+@class FRAPushCryptoContext;
 #import "FRAMechanism.h"
 
 /*!
@@ -24,9 +27,17 @@
 
 /*!
  * Secret key for Push Notifications
+ *
+ * The key is held in the default FRAKeyArena; each access returns a new string.
  */
 @property (nonatomic, readonly) NSString *secret;
 
+/*!
+ * The decoded secret and keyed HMAC state used to answer challenges and sign responses, or nil if the secret
+ * is not valid Base64.
+ */
+@property (nonatomic, readonly) FRAPushCryptoContext *cryptoContext;
+
 /*!
  * Authentication Endpoint to contact for Push Notifications
  */
@@ -106,4 +117,30 @@
  */
 + (instancetype)pushMechanismWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel authEndpoint:(NSString *)authEndPoint secret:(NSString *)secret version:(NSInteger)version mechanismIdentifier:(NSString *)mechanismIdentifier;
 
+
+#pragma mark -
+#pragma mark Notification Functions
+
+/*!
+ * Approve several pending notifications of this mechanism at once. See FRANotification
+ * approveNotifications:handler:error: for notifications of different mechanisms.
+ *
+ * @param notifications The notifications to approve, all of which must belong to this mechanism.
+ * @param handler A block object to be executed on the main queue once every response has finished. It takes one result per notification, in the order the notifications were given.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if a notification belongs to another mechanism or the notifications could not be saved, in which case none of them are approved and the error value will be populated.
+ */
+- (BOOL)approveNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *results))handler error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Deny several pending notifications of this mechanism at once. See FRANotification
+ * denyNotifications:handler:error: for notifications of different mechanisms.
+ *
+ * @param notifications The notifications to deny, all of which must belong to this mechanism.
+ * @param handler A block object to be executed on the main queue once every response has finished. It takes one result per notification, in the order the notifications were given.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return BOOL NO if a notification belongs to another mechanism or the notifications could not be saved, in which case none of them are denied and the error value will be populated.
+ */
+- (BOOL)denyNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *results))handler error:(NSError *__autoreleasing *)error;
+
 @end
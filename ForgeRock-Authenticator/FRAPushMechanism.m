@@ -14,9 +14,17 @@
  * Copyright 2016 ForgeRock AS.
  */
 
+#import "FRAError.h"
+#import "FRAKeyArena.h"
+#import "FRAMechanismProtected.h"
+#import "FRANotification.h"
+#import "FRAPushCryptoContext.h"
 #import "FRAPushMechanism.h"
 
-@implementation FRAPushMechanism
+@implementation FRAPushMechanism {
+    FRAKeyMaterial *secretMaterial;
+    NSString *oversizedSecret;
+}
 
 #pragma mark -
 #pragma mark Lifecyle
@@ -36,7 +44,7 @@
     if (self) {
         _version = version;
         _authEndpoint = authEndPoint;
-        _secret = secret;
+        [self setSecret:secret];
         _mechanismUID = mechanismIdentifier;
     }
     return self;
@@ -61,4 +69,58 @@
     return @"push";
 }
 
+- (NSString *)secret {
+    if (!secretMaterial) {
+        return oversizedSecret;
+    }
+    return [[NSString alloc] initWithBytes:secretMaterial.bytes length:secretMaterial.length encoding:NSUTF8StringEncoding];
+}
+
+#pragma mark -
+#pragma mark Notification Functions
+
+- (BOOL)approveNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *))handler error:(NSError *__autoreleasing *)error {
+    if (![self ownsNotifications:notifications error:error]) {
+        return NO;
+    }
+    return [FRANotification approveNotifications:notifications handler:handler error:error];
+}
+
+- (BOOL)denyNotifications:(NSArray<FRANotification *> *)notifications handler:(void (^)(NSArray<FRANotificationResponse *> *))handler error:(NSError *__autoreleasing *)error {
+    if (![self ownsNotifications:notifications error:error]) {
+        return NO;
+    }
+    return [FRANotification denyNotifications:notifications handler:handler error:error];
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+/*!
+ * Moves the shared secret into the key arena and derives the crypto context from it. Also used when the
+ * mechanism is loaded from the database.
+ */
+- (void)setSecret:(NSString *)secret {
+    NSData *bytes = [secret dataUsingEncoding:NSUTF8StringEncoding];
+    secretMaterial = [[FRAKeyArena defaultArena] keyMaterialWithData:bytes];
+    oversizedSecret = secretMaterial ? nil : secret;
+    _cryptoContext = [FRAPushCryptoContext contextWithBase64Secret:secret];
+}
+
+/*!
+ * Checks that every notification belongs to this mechanism.
+ */
+- (BOOL)ownsNotifications:(NSArray<FRANotification *> *)notifications error:(NSError *__autoreleasing *)error {
+    for (FRANotification *notification in notifications) {
+        if (notification.parent != self) {
+            if (error) {
+                NSString *reason = [[NSString alloc] initWithFormat:@"Notification %@ belongs to another mechanism", notification.messageId];
+                *error = [FRAError createError:reason code:FRAInvalidOperation];
+            }
+            return NO;
+        }
+    }
+    return YES;
+}
+
 @end
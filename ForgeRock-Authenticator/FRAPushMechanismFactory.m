@@ -18,6 +18,7 @@
 #import "FRAIdentity.h"
 #import "FRAIdentityDatabase.h"
 #import "FRAMechanismFactory.h"
+#import "FRAMechanismUri.h"
 #import "FRAMessageUtils.h"
 #import "FRAMockURLProtocol.h"
 #import "FRAPushMechanism.h"
@@ -82,18 +83,18 @@ static BOOL FAILURE = NO;
         return nil;
     }
     
-    NSDictionary * query = [self readQRCode:uri];
+    FRAMechanismUri *query = [self readQRCode:uri];
     
-    NSString *secret = [query objectForKey:SECRET_QR_KEY];
-    NSString *regEndpoint = [self utf8StringFromData:[FRAQRUtils decodeURL:[query objectForKey:REGISTRATION_ENDPOINT_URL_QR_KEY]]];
-    NSString *authEndpoint = [self utf8StringFromData:[FRAQRUtils decodeURL:[query objectForKey:AUTHENTICATION_ENDPOINT_URL_QR_KEY]]];
-    NSString *messageId = [query objectForKey:MESSAGE_ID_QR_KEY];
-    NSString *backgroundColor = [query objectForKey:BACKGROUND_COLOUR_QR_KEY];
-    NSString *challenge = [FRAQRUtils replaceCharactersForURLDecoding:[query objectForKey:REGISTRATION_CHALLENGE_QR_KEY]];
-    NSString *loadBalancer = [self utf8StringFromData:[FRAQRUtils decodeURL:[query objectForKey:REGISTRATION_LOAD_BALLANCE_KEY]]];
-    NSString *image = [self utf8StringFromData:[FRAQRUtils decodeURL:[query objectForKey:IMAGE_QR_KEY]]];
-    NSString *issuer = [self utf8StringFromData:[FRAQRUtils decodeURL:[query objectForKey:ISSUER_QR_KEY]]];
-    NSString *_label = [query objectForKey:@"_label"];
+    NSString *secret = [query rawParameter:SECRET_QR_KEY];
+    NSString *regEndpoint = [self utf8StringFromData:[FRAQRUtils decodeURL:[query rawParameter:REGISTRATION_ENDPOINT_URL_QR_KEY]]];
+    NSString *authEndpoint = [self utf8StringFromData:[FRAQRUtils decodeURL:[query rawParameter:AUTHENTICATION_ENDPOINT_URL_QR_KEY]]];
+    NSString *messageId = [query rawParameter:MESSAGE_ID_QR_KEY];
+    NSString *backgroundColor = [query rawParameter:BACKGROUND_COLOUR_QR_KEY];
+    NSString *challenge = [FRAQRUtils replaceCharactersForURLDecoding:[query rawParameter:REGISTRATION_CHALLENGE_QR_KEY]];
+    NSString *loadBalancer = [self utf8StringFromData:[FRAQRUtils decodeURL:[query rawParameter:REGISTRATION_LOAD_BALLANCE_KEY]]];
+    NSString *image = [self utf8StringFromData:[FRAQRUtils decodeURL:[query rawParameter:IMAGE_QR_KEY]]];
+    NSString *issuer = [self utf8StringFromData:[FRAQRUtils decodeURL:[query rawParameter:ISSUER_QR_KEY]]];
+    NSString *_label = query.label;
     
     if (![self isValidSecret:secret] || ![self isValid:regEndpoint] || ![self isValid:authEndpoint] || ![self isValid:messageId] || ![self isValid:challenge] || ![self isValid:issuer]) {
         *error = [FRAError createError:NSLocalizedString(@"Invalid QR code", nil) code:FRAInvalidQRCode];
@@ -107,7 +108,7 @@ static BOOL FAILURE = NO;
         return nil;
     }
     
-    [self registerMechanismWithEndpoint:regEndpoint secret:secret challenge:challenge messageId:messageId mechanismUid:mechanism.mechanismUID identity:identity mechanism:mechanism identityModel:identityModel loadBalancerCookieData:loadBalancer handler:handler];
+    [self registerMechanismWithEndpoint:regEndpoint cryptoContext:mechanism.cryptoContext challenge:challenge messageId:messageId mechanismUid:mechanism.mechanismUID identity:identity mechanism:mechanism identityModel:identityModel loadBalancerCookieData:loadBalancer handler:handler];
 
     return mechanism;
 }
@@ -120,60 +121,15 @@ static BOOL FAILURE = NO;
     return info.length > 0;
 }
 
-- (NSDictionary *) readQRCode:(NSURL *)uri {
-    
-    NSString* scheme = [uri scheme];
-    if (scheme == nil || ![scheme isEqualToString:@"pushauth"]) {
-        return nil;
-    }
-    NSString* _type = [uri host];
-    if (_type == nil || ![_type isEqualToString:[FRAPushMechanism mechanismType]]) {
+- (FRAMechanismUri *) readQRCode:(NSURL *)uri {
+    FRAMechanismUri *mechanismUri = [FRAMechanismUri uriWithURL:uri];
+    if (mechanismUri == nil || ![mechanismUri hasScheme:@"pushauth"]) {
         return nil;
     }
-    // Get the path and strip it of its leading '/'
-    NSString* path = [uri path];
-    if (path == nil) {
+    if (![mechanismUri.type isEqualToString:[FRAPushMechanism mechanismType]]) {
         return nil;
     }
-    while ([path hasPrefix:@"/"]) {
-        path = [path substringFromIndex:1];
-    }
-    if ([path length] == 0) {
-        return nil;
-    }
-    // Get issuer and label
-    NSArray* array = [path componentsSeparatedByString:@":"];
-    if (array == nil || [array count] == 0) {
-        return nil;
-    }
-    NSString* _issuer;
-    NSString* _label;
-    if ([array count] > 1) {
-        _issuer = [FRAQRUtils decode:[array objectAtIndex:0]];
-        _label = [FRAQRUtils decode:[array objectAtIndex:1]];
-    } else {
-        _issuer = @"";
-        _label = [FRAQRUtils decode:[array objectAtIndex:0]];
-    }
-    
-    // Parse query
-    NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
-    array = [[uri query] componentsSeparatedByString:@"&"];
-    for (NSString *kv in array) {
-        // Value can contain '=' symbols, so look for first symbol.
-        NSRange index = [kv rangeOfString:@"="];
-        if (index.location == NSNotFound) {
-            continue;
-        }
-        NSString *name = [kv substringToIndex:index.location];
-        NSString *value = [kv substringFromIndex:index.location + index.length];
-        [query setValue:value forKey:name];
-    }
-    
-    [query setValue:_issuer forKey:@"_issuer"];
-    [query setValue:_label forKey:@"_label"];
-    
-    return query;
+    return mechanismUri;
 }
 
 - (FRAIdentity *)identityWithIssuer:(NSString *)issuer accountName:(NSString *)accountName identityModel:(FRAIdentityModel *)identityModel backgroundColor:(NSString *)backgroundColor image:(NSString *)image database:(FRAIdentityDatabase *)database error:(NSError *__autoreleasing *)error {
@@ -200,13 +156,13 @@ static BOOL FAILURE = NO;
     return @"pushauth";
 }
 
-- (void)registerMechanismWithEndpoint:(NSString *)regEndpoint secret:(NSString *)secret challenge:(NSString *)challenge messageId:(NSString *)messageId mechanismUid:(NSString *)uid identity:(FRAIdentity *)identity mechanism:(FRAMechanism *)mechanism identityModel:(FRAIdentityModel *)identityModel loadBalancerCookieData:(NSString *)loadBalancerCookieData handler:(void(^)(BOOL, NSError *))handler {
+- (void)registerMechanismWithEndpoint:(NSString *)regEndpoint cryptoContext:(FRAPushCryptoContext *)cryptoContext challenge:(NSString *)challenge messageId:(NSString *)messageId mechanismUid:(NSString *)uid identity:(FRAIdentity *)identity mechanism:(FRAMechanism *)mechanism identityModel:(FRAIdentityModel *)identityModel loadBalancerCookieData:(NSString *)loadBalancerCookieData handler:(void(^)(BOOL, NSError *))handler {
     
     [FRAMessageUtils respondWithEndpoint:regEndpoint
-                            base64Secret:secret
+                           cryptoContext:cryptoContext
                                messageId:messageId
                   loadBalancerCookieData:loadBalancerCookieData
-                                    data:@{@"response":[FRAMessageUtils generateChallengeResponse:challenge secret:secret],
+                                    data:@{@"response":[FRAMessageUtils generateChallengeResponse:challenge cryptoContext:cryptoContext],
                                            @"mechanismUid":uid,
                                            @"deviceId":self.gateway.deviceToken,
                                            @"deviceType":@"ios",
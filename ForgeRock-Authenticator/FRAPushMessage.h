@@ -0,0 +1,75 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+@class FRAPushCryptoContext;
+
+/*!
+ * The payload of a push notification, read from the signed JWT in its data field.
+ *
+ * The token is parsed once, without a JSON DOM: only the claims the app needs are kept. The signature is not
+ * trusted until isSignedWithCryptoContext: has been called with the context of the mechanism the message
+ * claims to target.
+ */
+@interface FRAPushMessage : NSObject
+
+/*!
+ * The Base64 encoded challenge ("c").
+ */
+@property (nonatomic, readonly) NSString *challenge;
+/*!
+ * The time to live of the notification in seconds ("t").
+ */
+@property (nonatomic, readonly) NSTimeInterval timeToLive;
+/*!
+ * The UID of the target push mechanism ("u").
+ */
+@property (nonatomic, readonly) NSString *mechanismUid;
+/*!
+ * The load balancer cookie, decoded from its Base64 encoding ("l").
+ */
+@property (nonatomic, readonly) NSString *loadBalancerCookieData;
+
+#pragma mark -
+#pragma mark Lifecycle
+
+/*!
+ * Parse a push notification JWT.
+ *
+ * @param jwt The compact JWS from the notification.
+ * @param error If parsing fails, upon return contains an error describing the problem.
+ * @return The message, or nil if the token is malformed or its payload is not a JSON object.
+ */
++ (instancetype)messageWithJwt:(NSString *)jwt error:(NSError *__autoreleasing *)error;
+
+#pragma mark -
+#pragma mark Instance Methods
+
+/*!
+ * Verify the HS256 signature of the token.
+ *
+ * @param cryptoContext The crypto context of the target mechanism.
+ * @return YES if the token was signed with the secret of the context.
+ */
+- (BOOL)isSignedWithCryptoContext:(FRAPushCryptoContext *)cryptoContext;
+
+/*!
+ * The claims present in the payload, keyed by their JWT names, with their values as strings.
+ *
+ * @return The claims.
+ */
+- (NSDictionary *)claims;
+
+@end
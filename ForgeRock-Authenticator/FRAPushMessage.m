@@ -0,0 +1,148 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <CommonCrypto/CommonHMAC.h>
+#include "base64.h"
+#include "FRAJwsParser.h"
+
+#import "FRAError.h"
+#import "FRAPushCryptoContext.h"
+#import "FRAPushMessage.h"
+#import "FRAQRUtils.h"
+
+/*! Payloads up to this length are decoded on the stack. */
+static const int FRAMaximumStackPayloadLength = 1024;
+
+/*! JWT names of the claims, indexed by FRAPushClaim. */
+static NSString * const FRAPushClaimNames[FRAPushClaimCount] = { @"c", @"t", @"u", @"l" };
+
+static NSString *stringFromSpan(FRAJwsSpan span) {
+    if (!span.bytes) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:span.bytes length:span.length encoding:NSUTF8StringEncoding];
+}
+
+@implementation FRAPushMessage {
+    /*! The token, which owns the bytes of the signing input. */
+    NSString *token;
+    NSData *tokenBytes;
+    const char *signingInput;
+    size_t signingInputLength;
+    uint8_t signature[CC_SHA256_DIGEST_LENGTH];
+    size_t signatureLength;
+    NSDictionary *claims;
+}
+
+#pragma mark -
+#pragma mark Lifecycle
+
++ (instancetype)messageWithJwt:(NSString *)jwt error:(NSError *__autoreleasing *)error {
+    FRAPushMessage *message = [jwt isKindOfClass:[NSString class]] ? [[FRAPushMessage alloc] initWithJwt:jwt] : nil;
+    if (!message && error) {
+        *error = [FRAError createError:@"Invalid push message" code:FRAInvalidPushMessage];
+    }
+    return message;
+}
+
+- (instancetype)initWithJwt:(NSString *)jwt {
+    self = [super init];
+    if (self) {
+        // Use the string's own bytes when they are available, copying only when they are not
+        token = [jwt copy];
+        const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)token, kCFStringEncodingASCII);
+        size_t length;
+        if (bytes) {
+            length = strlen(bytes);
+        } else {
+            tokenBytes = [token dataUsingEncoding:NSASCIIStringEncoding];
+            if (!tokenBytes) {
+                return nil;
+            }
+            bytes = tokenBytes.bytes;
+            length = tokenBytes.length;
+        }
+        
+        FRAJws jws;
+        if (FRAJwsSplit(bytes, length, &jws) != 0 || jws.payload.length > INT_MAX || jws.signature.length > INT_MAX) {
+            return nil;
+        }
+        signingInput = jws.signingInput.bytes;
+        signingInputLength = jws.signingInput.length;
+        
+        // A signature which does not decode to a digest is kept as invalid rather than rejected here
+        int decoded = base64_decode(jws.signature.bytes, (int)jws.signature.length, signature, sizeof(signature), BASE64_URL);
+        signatureLength = decoded < 0 ? 0 : decoded;
+        
+        if (![self readClaims:jws.payload]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Instance Methods
+
+- (BOOL)isSignedWithCryptoContext:(FRAPushCryptoContext *)cryptoContext {
+    return [cryptoContext verifySignature:signature length:signatureLength ofBytes:signingInput length:signingInputLength];
+}
+
+- (NSDictionary *)claims {
+    return claims;
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+- (BOOL)readClaims:(FRAJwsSpan)payload {
+    int capacity = base64_decoded_size((int)payload.length);
+    char stackBuffer[FRAMaximumStackPayloadLength];
+    NSMutableData *heapBuffer;
+    char *json = stackBuffer;
+    if (capacity > FRAMaximumStackPayloadLength) {
+        heapBuffer = [NSMutableData dataWithLength:capacity];
+        json = heapBuffer.mutableBytes;
+    }
+    
+    // Earlier versions decoded the payload with the standard alphabet, so both are still accepted
+    int length = base64_decode(payload.bytes, (int)payload.length, (uint8_t *)json, capacity, BASE64_URL_OR_STANDARD);
+    FRAPushClaims values;
+    if (length < 0 || FRAJwsParsePushClaims(json, length, &values) != 0) {
+        return NO;
+    }
+    
+    NSMutableDictionary *present = [[NSMutableDictionary alloc] initWithCapacity:FRAPushClaimCount];
+    for (int i = 0; i < FRAPushClaimCount; i++) {
+        NSString *value = stringFromSpan(values.values[i]);
+        if (value) {
+            present[FRAPushClaimNames[i]] = value;
+        }
+    }
+    claims = present;
+    
+    _challenge = present[FRAPushClaimNames[FRAPushClaimChallenge]];
+    _timeToLive = [present[FRAPushClaimNames[FRAPushClaimTimeToLive]] doubleValue];
+    _mechanismUid = present[FRAPushClaimNames[FRAPushClaimMechanismUid]];
+    NSString *loadBalancer = present[FRAPushClaimNames[FRAPushClaimLoadBalancer]];
+    if (loadBalancer) {
+        NSData *cookie = [FRAQRUtils decodeBase64:loadBalancer];
+        _loadBalancerCookieData = cookie ? [[NSString alloc] initWithData:cookie encoding:NSUTF8StringEncoding] : nil;
+    }
+    return YES;
+}
+
+@end
@@ -28,18 +28,19 @@
 + (NSString *)replaceCharactersForURLDecoding:(NSString *)content;
 
 /*!
- * Decodes from Base64 url encoded string.
+ * Decodes from Base64 url encoded string. Padding is optional and characters of the standard alphabet are
+ * also accepted.
  *
  * @param content The original string to decode.
- * @return The decoded string.
+ * @return The decoded string, or nil if the string is not valid Base64.
  */
 + (NSData *)decodeURL:(NSString *)content;
 
 /*!
- * Decodes a Base64 encoded string.
+ * Decodes a Base64 encoded string. Padding is optional.
  *
  * @param base64String The original Base64 string to decode.
- * @return The decoded string.
+ * @return The decoded string, or nil if the string is not valid Base64.
  */
 + (NSData *)decodeBase64:(NSString *)base64String;
 
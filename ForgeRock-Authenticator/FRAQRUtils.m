@@ -15,6 +15,8 @@
  */
 
 
+#include "base64.h"
+
 #import "FRAQRUtils.h"
 
 static NSString * const VALID_BASE64_CHARACTERS = @"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
@@ -27,19 +29,12 @@ static NSString * const VALID_BASE64_CHARACTERS = @"ABCDEFGHIJKLMNOPQRSTUVWXYZab
 }
 
 + (NSData *)decodeURL:(NSString *) content {
-    NSString * fixed = [FRAQRUtils replaceCharactersForURLDecoding:content];
-    [self pad:fixed];
-    
-    return [FRAQRUtils decodeBase64:fixed];
+    // Secrets in QR codes use the standard alphabet, so both are accepted as they were before
+    return [self decodeBase64:content alphabet:BASE64_URL_OR_STANDARD];
 }
 
 + (NSData *)decodeBase64:(NSString *) base64String {
-    if (!base64String) {
-        return nil;
-    }
-    
-    base64String = [self pad:base64String];
-    return [[NSData alloc] initWithBase64EncodedString:base64String options:0];
+    return [self decodeBase64:base64String alphabet:BASE64_STANDARD];
 }
 
 + (NSString *)decode:(NSString *)content {
@@ -47,12 +42,10 @@ static NSString * const VALID_BASE64_CHARACTERS = @"ABCDEFGHIJKLMNOPQRSTUVWXYZab
 }
 
 + (NSString *)pad:(NSString *)content {
-    int paddSize = (4 - ([content length] % 4)) % 4;
+    NSUInteger paddSize = (4 - ([content length] % 4)) % 4;
     
-    if(paddSize != 0) {
-        for(int i = 0; i < paddSize; ++i) {
-            content = [content stringByAppendingString:@"="];
-        }
+    if (paddSize != 0) {
+        return [content stringByPaddingToLength:[content length] + paddSize withString:@"=" startingAtIndex:0];
     }
 
     return content;
@@ -66,4 +59,34 @@ static NSString * const VALID_BASE64_CHARACTERS = @"ABCDEFGHIJKLMNOPQRSTUVWXYZab
     return [content rangeOfCharacterFromSet:invertedBase64CharacterSet options:NSLiteralSearch].location == NSNotFound;
 }
 
+#pragma mark -
+#pragma mark Private Methods
+
++ (NSData *)decodeBase64:(NSString *)content alphabet:(int)alphabet {
+    if (!content) {
+        return nil;
+    }
+    
+    // Base64 strings are ASCII, so their characters can usually be read without copying
+    NSData *utf8;
+    const char *characters = CFStringGetCStringPtr((__bridge CFStringRef)content, kCFStringEncodingASCII);
+    NSUInteger length = content.length;
+    if (!characters) {
+        utf8 = [content dataUsingEncoding:NSUTF8StringEncoding];
+        characters = utf8.bytes;
+        length = utf8.length;
+    }
+    if (length > INT_MAX) {
+        return nil;
+    }
+    
+    NSMutableData *result = [[NSMutableData alloc] initWithLength:base64_decoded_size((int)length)];
+    int count = base64_decode(characters, (int)length, result.mutableBytes, (int)result.length, alphabet);
+    if (count < 0) {
+        return nil;
+    }
+    result.length = count;
+    return result;
+}
+
 @end
\ No newline at end of file
@@ -0,0 +1,168 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+@class FRAFMDatabaseConnectionHelper;
+
+/*!
+ * A response to be stored in the outbox.
+ */
+@interface FRAQueuedResponse : NSObject
+
+/*! The signed request body, as built by FRAMessageUtils payloadWithMessageId:cryptoContext:data:. */
+@property (copy, nonatomic, readonly) NSDictionary *payload;
+/*! The URL string of the endpoint to send the response to. */
+@property (copy, nonatomic, readonly) NSString *endpoint;
+/*! The id of the message being responded to. */
+@property (copy, nonatomic, readonly) NSString *messageId;
+/*! The load balancer cookie of the message, or nil. */
+@property (copy, nonatomic, readonly) NSString *loadBalancerCookie;
+/*! The time after which the server no longer accepts the response, or nil. */
+@property (strong, nonatomic, readonly) NSDate *timeExpired;
+/*! Executed on the main queue once the response is delivered, rejected, abandoned or expired, or nil. */
+@property (copy, nonatomic, readonly) void (^handler)(NSInteger statusCode, NSError *error);
+
+/*!
+ * Init method.
+ *
+ * @param payload The signed request body.
+ * @param endpoint The URL string of the endpoint to send the response to.
+ * @param messageId The id of the message being responded to.
+ * @param loadBalancerCookieData The load balancer cookie of the message, or nil.
+ * @param timeExpired The time after which the server no longer accepts the response, or nil.
+ * @param handler A block object to be executed on the main queue once the response is delivered, rejected,
+ * abandoned or expired. It is not called if the App is terminated first. May be nil.
+ * @return The initialized response.
+ */
+- (instancetype)initWithPayload:(NSDictionary *)payload
+                       endpoint:(NSString *)endpoint
+                      messageId:(NSString *)messageId
+         loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                    timeExpired:(NSDate *)timeExpired
+                        handler:(void (^)(NSInteger statusCode, NSError *error))handler;
+
+@end
+
+/*!
+ * Durable queue of the responses to push authentication messages.
+ *
+ * A response is written to the database before it is sent, and is only removed once the server has accepted or
+ * rejected it, so approving or denying a message while the device is offline, or just before the App is
+ * suspended, is not lost. Failed responses are retried with exponential backoff and jitter, and are kept across
+ * launches until they are delivered, give up or expire.
+ *
+ * Responses to the same endpoint are sent together as one burst over the pooled session of that endpoint. The
+ * first response of a burst probes the server; if the server cannot be reached the rest of the burst is not
+ * attempted and backs off with it.
+ *
+ * The outbox is thread safe.
+ */
+@interface FRAResponseOutbox : NSObject
+
+/*!
+ * The delay before the first retry, in seconds. Each further retry doubles it. Defaults to 2 seconds.
+ */
+@property (nonatomic) NSTimeInterval baseDelay;
+
+/*!
+ * The longest delay between retries, in seconds. Defaults to 5 minutes.
+ */
+@property (nonatomic) NSTimeInterval maximumDelay;
+
+/*!
+ * The number of failed attempts after which a response is abandoned, or 0 to keep retrying until it expires.
+ * Defaults to 10.
+ */
+@property (nonatomic) NSUInteger maximumAttempts;
+
+/*!
+ * A custom NSURLProtocol class used to send responses, or nil. Exposed for testing.
+ */
+@property (nonatomic, strong) Class protocol;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param database The connection helper of the database which the outbox is stored in.
+ * @return The initialized outbox.
+ */
+- (instancetype)initWithDatabase:(FRAFMDatabaseConnectionHelper *)database;
+
+#pragma mark -
+#pragma mark Outbox Functions
+
+/*!
+ * Stores a response and sends it. A response which replaces a queued response for the same message id takes
+ * over its place in the queue. If the response to the same message id is being sent, the new response is not
+ * stored and its handler is called with the outcome of that send.
+ *
+ * @param payload The signed request body, as built by FRAMessageUtils payloadWithMessageId:cryptoContext:data:.
+ * @param endpoint The URL string of the endpoint to send the response to.
+ * @param messageId The id of the message being responded to.
+ * @param loadBalancerCookieData The load balancer cookie of the message, or nil.
+ * @param timeExpired The time after which the server no longer accepts the response, or nil.
+ * @param handler A block object to be executed on the main queue once the response is delivered, rejected,
+ * abandoned or expired. It is not called if the App is terminated first. May be nil.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the response was stored, otherwise NO.
+ */
+- (BOOL)enqueuePayload:(NSDictionary *)payload
+              endpoint:(NSString *)endpoint
+             messageId:(NSString *)messageId
+loadBalancerCookieData:(NSString *)loadBalancerCookieData
+           timeExpired:(NSDate *)timeExpired
+               handler:(void (^)(NSInteger statusCode, NSError *error))handler
+                 error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Stores several responses in a single transaction and sends them, so that responses to the same endpoint go out
+ * as one burst. Either all of the responses are stored or, if there is an error, none of them are.
+ *
+ * @param responses The responses to store.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ * @return YES if the responses were stored, otherwise NO.
+ */
+- (BOOL)enqueueResponses:(NSArray<FRAQueuedResponse *> *)responses error:(NSError *__autoreleasing *)error;
+
+/*!
+ * Sends every queued response now, without waiting for its backoff to elapse. Call when delivery is likely
+ * to succeed, for example on launch or when the App returns to the foreground.
+ *
+ * @param completion A block object to be executed on the main queue once the responses have been attempted,
+ * taking the number of responses delivered and the number still queued. May be nil.
+ */
+- (void)flushWithCompletion:(void (^)(NSUInteger delivered, NSUInteger pending))completion;
+
+/*!
+ * The number of responses in the outbox, including those being sent.
+ *
+ * @return The number of queued responses.
+ */
+- (NSUInteger)pendingResponseCount;
+
+/*!
+ * The delay before the next attempt of a response which has failed a number of times: half of the capped
+ * exponential delay, plus a random share of the other half, so that devices which lost connectivity together
+ * do not retry in step.
+ *
+ * @param attempts The number of failed attempts, at least 1.
+ * @return The delay in seconds.
+ */
+- (NSTimeInterval)retryDelayAfterAttempts:(NSUInteger)attempts;
+
+@end
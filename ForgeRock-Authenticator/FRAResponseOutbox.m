@@ -0,0 +1,556 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import "FMDatabase.h"
+#import "FRAError.h"
+#import "FRAFMDatabaseConnectionHelper.h"
+#import "FRAMessageUtils.h"
+#import "FRAResponseOutbox.h"
+
+static const NSTimeInterval FRADefaultOutboxBaseDelay = 2.0;
+static const NSTimeInterval FRADefaultOutboxMaximumDelay = 300.0;
+static const NSUInteger FRADefaultOutboxMaximumAttempts = 10;
+
+/*!
+ * A response read from the outbox table.
+ */
+@interface FRAOutboxEntry : NSObject
+
+@property (copy, nonatomic) NSString *messageId;
+@property (copy, nonatomic) NSString *endpoint;
+@property (copy, nonatomic) NSString *loadBalancerCookie;
+@property (copy, nonatomic) NSDictionary *payload;
+@property (nonatomic) NSTimeInterval timeExpired;
+@property (nonatomic) NSUInteger attempts;
+@property (nonatomic) NSTimeInterval nextAttempt;
+
+@end
+
+@implementation FRAOutboxEntry
+@end
+
+@implementation FRAQueuedResponse
+
+- (instancetype)initWithPayload:(NSDictionary *)payload
+                       endpoint:(NSString *)endpoint
+                      messageId:(NSString *)messageId
+         loadBalancerCookieData:(NSString *)loadBalancerCookieData
+                    timeExpired:(NSDate *)timeExpired
+                        handler:(void (^)(NSInteger, NSError *))handler {
+    self = [super init];
+    if (self) {
+        _payload = [payload copy];
+        _endpoint = [endpoint copy];
+        _messageId = [messageId copy];
+        _loadBalancerCookie = [loadBalancerCookieData copy];
+        _timeExpired = timeExpired;
+        _handler = [handler copy];
+    }
+    return self;
+}
+
+@end
+
+@implementation FRAResponseOutbox {
+    FRAFMDatabaseConnectionHelper *sqlDatabase;
+    /*! Serialises access to the outbox table and to the state below. */
+    dispatch_queue_t outboxQueue;
+    /*! Whether the outbox table is known to exist. */
+    BOOL tableCreated;
+    /*! Handlers of the responses queued since launch, keyed by message id. */
+    NSMutableDictionary<NSString *, void (^)(NSInteger, NSError *)> *handlers;
+    /*! Ids of the messages whose responses are being sent. */
+    NSMutableSet<NSString *> *inFlight;
+    /*! Entered by every burst being sent, so that a flush can wait for bursts started before it. */
+    dispatch_group_t sendingGroup;
+    /*! Incremented whenever a retry is scheduled, so that only the latest scheduled retry runs. */
+    NSUInteger retryGeneration;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithDatabase:(FRAFMDatabaseConnectionHelper *)database {
+    self = [super init];
+    if (self) {
+        sqlDatabase = database;
+        _baseDelay = FRADefaultOutboxBaseDelay;
+        _maximumDelay = FRADefaultOutboxMaximumDelay;
+        _maximumAttempts = FRADefaultOutboxMaximumAttempts;
+        handlers = [[NSMutableDictionary alloc] init];
+        inFlight = [[NSMutableSet alloc] init];
+        sendingGroup = dispatch_group_create();
+        outboxQueue = dispatch_queue_create("org.forgerock.authenticator.response-outbox", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(outboxQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Outbox Functions
+
+- (BOOL)enqueuePayload:(NSDictionary *)payload
+              endpoint:(NSString *)endpoint
+             messageId:(NSString *)messageId
+loadBalancerCookieData:(NSString *)loadBalancerCookieData
+           timeExpired:(NSDate *)timeExpired
+               handler:(void (^)(NSInteger, NSError *))handler
+                 error:(NSError *__autoreleasing *)error {
+    FRAQueuedResponse *response = [[FRAQueuedResponse alloc] initWithPayload:payload
+                                                                    endpoint:endpoint
+                                                                   messageId:messageId
+                                                      loadBalancerCookieData:loadBalancerCookieData
+                                                                 timeExpired:timeExpired
+                                                                     handler:handler];
+    return [self enqueueResponses:@[response] error:error];
+}
+
+- (BOOL)enqueueResponses:(NSArray<FRAQueuedResponse *> *)responses error:(NSError *__autoreleasing *)error {
+    if (responses.count == 0) {
+        return YES;
+    }
+    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+    NSMutableArray<NSArray *> *valuesList = [[NSMutableArray alloc] initWithCapacity:responses.count];
+    for (FRAQueuedResponse *response in responses) {
+        NSData *json = [NSJSONSerialization dataWithJSONObject:response.payload options:0 error:error];
+        if (!json) {
+            return NO;
+        }
+        [valuesList addObject:@[response.messageId,
+                                response.endpoint,
+                                response.loadBalancerCookie ?: [NSNull null],
+                                [[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding],
+                                @(now),
+                                response.timeExpired ? @([response.timeExpired timeIntervalSince1970]) : [NSNull null],
+                                @0,
+                                @(now)]];
+    }
+    
+    __block BOOL result;
+    __block NSError *queueError;
+    dispatch_sync(outboxQueue, ^{
+        // Replacing the row of a response being sent would let that send delete the new row and report its result
+        // to the new handler, so a response to a message already in flight shares the outcome of that send instead
+        NSMutableArray<FRAQueuedResponse *> *queued = [[NSMutableArray alloc] initWithCapacity:responses.count];
+        NSMutableArray<NSArray *> *queuedValuesList = [[NSMutableArray alloc] initWithCapacity:responses.count];
+        [responses enumerateObjectsUsingBlock:^(FRAQueuedResponse *response, NSUInteger index, BOOL *stop) {
+            if ([inFlight containsObject:response.messageId]) {
+                [self addHandler:response.handler forMessageId:response.messageId];
+            } else {
+                [queued addObject:response];
+                [queuedValuesList addObject:valuesList[index]];
+            }
+        }];
+        NSError *insertError;
+        result = queuedValuesList.count == 0 || [self performStatement:@"insert_outbox_response" withValuesList:queuedValuesList error:&insertError];
+        queueError = insertError;
+        if (result) {
+            for (FRAQueuedResponse *response in queued) {
+                if (response.handler) {
+                    handlers[response.messageId] = response.handler;
+                }
+            }
+        }
+    });
+    if (!result) {
+        if (error) {
+            *error = queueError;
+        }
+        return NO;
+    }
+    
+    dispatch_async(outboxQueue, ^{
+        [self sendResponsesIncludingScheduled:NO completion:nil];
+    });
+    return YES;
+}
+
+- (void)flushWithCompletion:(void (^)(NSUInteger, NSUInteger))completion {
+    dispatch_async(outboxQueue, ^{
+        [self sendResponsesIncludingScheduled:YES completion:completion];
+    });
+}
+
+- (NSUInteger)pendingResponseCount {
+    __block NSUInteger count = 0;
+    dispatch_sync(outboxQueue, ^{
+        count = [self readResponsesWithError:nil].count;
+    });
+    return count;
+}
+
+- (NSTimeInterval)retryDelayAfterAttempts:(NSUInteger)attempts {
+    // Past 2^30 the doubling has long since reached any sensible maximum
+    NSUInteger exponent = MIN(MAX(attempts, (NSUInteger)1) - 1, (NSUInteger)30);
+    NSTimeInterval cap = MIN(self.maximumDelay, self.baseDelay * (double)(1UL << exponent));
+    return cap / 2 + (cap / 2) * arc4random_uniform(1001) / 1000.0;
+}
+
+/*!
+ * Arranges for a handler to be called, along with any already registered, with the outcome of a message's response.
+ *
+ * Must be called on the outbox queue.
+ */
+- (void)addHandler:(void (^)(NSInteger, NSError *))handler forMessageId:(NSString *)messageId {
+    if (!handler) {
+        return;
+    }
+    void (^existingHandler)(NSInteger, NSError *) = handlers[messageId];
+    if (!existingHandler) {
+        handlers[messageId] = handler;
+        return;
+    }
+    handlers[messageId] = ^(NSInteger statusCode, NSError *error) {
+        existingHandler(statusCode, error);
+        handler(statusCode, error);
+    };
+}
+
+#pragma mark -
+#pragma mark Sending Functions (outbox queue)
+
+/*!
+ * Sends the queued responses which are not already being sent, one burst per endpoint.
+ *
+ * @param includingScheduled Whether responses which are waiting out their backoff are sent too.
+ * @param completion Called on the main queue once every burst, including those already being sent, has finished.
+ */
+- (void)sendResponsesIncludingScheduled:(BOOL)includingScheduled completion:(void (^)(NSUInteger, NSUInteger))completion {
+    NSError *error;
+    NSArray<FRAOutboxEntry *> *responses = [self readResponsesWithError:&error];
+    if (!responses) {
+        NSLog(@"Could not read response outbox: %@", error);
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(0, 0);
+            });
+        }
+        return;
+    }
+    
+    // Responses are read in endpoint order, so each burst is a run of the list
+    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+    NSMutableArray<NSMutableArray<FRAOutboxEntry *> *> *bursts = [[NSMutableArray alloc] init];
+    for (FRAOutboxEntry *response in responses) {
+        if ([inFlight containsObject:response.messageId]) {
+            continue;
+        }
+        if (response.timeExpired > 0 && response.timeExpired < now) {
+            NSError *expiredError = [FRAError createError:@"Response expired before it could be delivered" code:FRANetworkFailure];
+            [self removeResponse:response statusCode:0 error:expiredError];
+            continue;
+        }
+        if (!includingScheduled && response.nextAttempt > now) {
+            continue;
+        }
+        if (![bursts.lastObject.firstObject.endpoint isEqualToString:response.endpoint]) {
+            [bursts addObject:[[NSMutableArray alloc] init]];
+        }
+        [bursts.lastObject addObject:response];
+        [inFlight addObject:response.messageId];
+    }
+    
+    __block NSUInteger delivered = 0;
+    for (NSArray<FRAOutboxEntry *> *burst in bursts) {
+        dispatch_group_enter(sendingGroup);
+        [self sendBurst:burst completion:^(NSUInteger deliveredInBurst) {
+            delivered += deliveredInBurst;
+            dispatch_group_leave(sendingGroup);
+        }];
+    }
+    // Responses already being sent were skipped above, so wait for those bursts as well
+    dispatch_group_notify(sendingGroup, outboxQueue, ^{
+        NSUInteger pending = [self scheduleRetry];
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(delivered, pending);
+            });
+        }
+    });
+}
+
+/*!
+ * Sends the first response of a burst and, if the server could be reached, the rest of the burst together.
+ *
+ * @param burst The responses to the same endpoint.
+ * @param completion Called on the outbox queue with the number of responses delivered.
+ */
+- (void)sendBurst:(NSArray<FRAOutboxEntry *> *)burst completion:(void (^)(NSUInteger))completion {
+    FRAOutboxEntry *probe = burst.firstObject;
+    [self sendResponse:probe completion:^(NSInteger statusCode, NSError *error) {
+        if ([self isRetryableStatusCode:statusCode]) {
+            // Only the probe was sent, so the rest of the burst waits out the same backoff without using an attempt
+            NSTimeInterval nextAttempt = [[NSDate date] timeIntervalSince1970] + [self retryDelayAfterAttempts:probe.attempts + 1];
+            [self retryResponse:probe statusCode:statusCode error:error];
+            for (NSUInteger i = 1; i < burst.count; i++) {
+                [self postponeResponse:burst[i] untilTime:nextAttempt];
+            }
+            completion(0);
+            return;
+        }
+        __block NSUInteger delivered = [self settleResponse:probe statusCode:statusCode error:error] ? 1 : 0;
+        dispatch_group_t group = dispatch_group_create();
+        for (NSUInteger i = 1; i < burst.count; i++) {
+            FRAOutboxEntry *response = burst[i];
+            dispatch_group_enter(group);
+            [self sendResponse:response completion:^(NSInteger responseStatusCode, NSError *responseError) {
+                if ([self isRetryableStatusCode:responseStatusCode]) {
+                    [self retryResponse:response statusCode:responseStatusCode error:responseError];
+                } else if ([self settleResponse:response statusCode:responseStatusCode error:responseError]) {
+                    delivered++;
+                }
+                dispatch_group_leave(group);
+            }];
+        }
+        dispatch_group_notify(group, outboxQueue, ^{
+            completion(delivered);
+        });
+    }];
+}
+
+/*!
+ * Posts a response, calling back on the outbox queue.
+ */
+- (void)sendResponse:(FRAOutboxEntry *)response completion:(void (^)(NSInteger, NSError *))completion {
+    [FRAMessageUtils postPayload:response.payload
+                      toEndpoint:response.endpoint
+          loadBalancerCookieData:response.loadBalancerCookie
+                        protocol:self.protocol
+                         handler:^(NSInteger statusCode, NSError *error) {
+                             dispatch_async(outboxQueue, ^{
+                                 completion(statusCode, error);
+                             });
+                         }];
+}
+
+/*!
+ * Whether a response may be accepted if it is sent again: the server could not be reached, was unavailable or
+ * asked the client to slow down.
+ */
+- (BOOL)isRetryableStatusCode:(NSInteger)statusCode {
+    return statusCode == 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500;
+}
+
+/*!
+ * Removes a response which the server has accepted or rejected.
+ *
+ * @return YES if the response was accepted.
+ */
+- (BOOL)settleResponse:(FRAOutboxEntry *)response statusCode:(NSInteger)statusCode error:(NSError *)error {
+    BOOL accepted = statusCode >= 200 && statusCode < 300;
+    [self removeResponse:response statusCode:statusCode error:accepted ? nil : error];
+    return accepted;
+}
+
+/*!
+ * Schedules the next attempt of a response which failed, or abandons it once it has used all of its attempts.
+ */
+- (void)retryResponse:(FRAOutboxEntry *)response statusCode:(NSInteger)statusCode error:(NSError *)error {
+    NSUInteger attempts = response.attempts + 1;
+    if (self.maximumAttempts > 0 && attempts >= self.maximumAttempts) {
+        NSLog(@"Abandoning response to message %@ after %lu attempts", response.messageId, (unsigned long)attempts);
+        NSError *abandonedError = [FRAError createError:@"Response could not be delivered" code:FRANetworkFailure underlyingError:error];
+        [self removeResponse:response statusCode:statusCode error:abandonedError];
+        return;
+    }
+    NSTimeInterval nextAttempt = [[NSDate date] timeIntervalSince1970] + [self retryDelayAfterAttempts:attempts];
+    [self rescheduleResponse:response attempts:attempts nextAttempt:nextAttempt];
+}
+
+/*!
+ * Schedules the next attempt of a response which was not sent, leaving its attempts unchanged.
+ */
+- (void)postponeResponse:(FRAOutboxEntry *)response untilTime:(NSTimeInterval)nextAttempt {
+    [self rescheduleResponse:response attempts:response.attempts nextAttempt:nextAttempt];
+}
+
+/*!
+ * Records when a response is next to be sent and releases it for sending.
+ */
+- (void)rescheduleResponse:(FRAOutboxEntry *)response attempts:(NSUInteger)attempts nextAttempt:(NSTimeInterval)nextAttempt {
+    NSError *updateError;
+    if (![self performStatement:@"update_outbox_response" withValues:@[@(attempts), @(nextAttempt), response.messageId] error:&updateError]) {
+        NSLog(@"Could not reschedule response to message %@: %@", response.messageId, updateError);
+    }
+    [inFlight removeObject:response.messageId];
+}
+
+/*!
+ * Deletes a response from the outbox and reports the outcome to its handler.
+ */
+- (void)removeResponse:(FRAOutboxEntry *)response statusCode:(NSInteger)statusCode error:(NSError *)error {
+    NSError *deleteError;
+    if (![self performStatement:@"delete_outbox_response" withValues:@[response.messageId] error:&deleteError]) {
+        NSLog(@"Could not remove response to message %@: %@", response.messageId, deleteError);
+    }
+    [inFlight removeObject:response.messageId];
+    void (^handler)(NSInteger, NSError *) = handlers[response.messageId];
+    [handlers removeObjectForKey:response.messageId];
+    if (handler) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            handler(statusCode, error);
+        });
+    }
+}
+
+/*!
+ * Arranges for the outbox to be sent again when the earliest backoff elapses, replacing any earlier arrangement.
+ *
+ * @return The number of responses in the outbox.
+ */
+- (NSUInteger)scheduleRetry {
+    NSArray<FRAOutboxEntry *> *responses = [self readResponsesWithError:nil];
+    NSTimeInterval nextAttempt = DBL_MAX;
+    for (FRAOutboxEntry *response in responses) {
+        if (![inFlight containsObject:response.messageId]) {
+            nextAttempt = MIN(nextAttempt, response.nextAttempt);
+        }
+    }
+    if (nextAttempt < DBL_MAX) {
+        NSUInteger generation = ++retryGeneration;
+        NSTimeInterval delay = MAX(0, nextAttempt - [[NSDate date] timeIntervalSince1970]);
+        __weak FRAResponseOutbox *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), outboxQueue, ^{
+            FRAResponseOutbox *strongSelf = weakSelf;
+            if (strongSelf && generation == strongSelf->retryGeneration) {
+                [strongSelf sendResponsesIncludingScheduled:NO completion:nil];
+            }
+        });
+    }
+    return responses.count;
+}
+
+#pragma mark -
+#pragma mark SQL Functions (outbox queue)
+
+/*!
+ * Opens the database, creating the outbox table the first time. Databases created before the outbox existed
+ * gain the table here rather than through the schema.
+ */
+- (FMDatabase *)openDatabaseWithError:(NSError *__autoreleasing *)error {
+    FMDatabase *database = [sqlDatabase getConnectionWithError:error];
+    if (database == nil || tableCreated) {
+        return database;
+    }
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"create_response_outbox" withError:error];
+    if (sql == nil) {
+        [sqlDatabase closeConnectionToDatabase:database];
+        return nil;
+    }
+    if (![database executeStatements:sql]) {
+        if (error) {
+            *error = [FRAError createErrorForLastFailure:database];
+        }
+        [sqlDatabase closeConnectionToDatabase:database];
+        return nil;
+    }
+    tableCreated = YES;
+    return database;
+}
+
+- (BOOL)performStatement:(NSString *)schema withValues:(NSArray *)values error:(NSError *__autoreleasing *)error {
+    return [self performStatement:schema withValuesList:@[values] error:error];
+}
+
+/*!
+ * Executes a statement once for each list of values, in a single transaction.
+ */
+- (BOOL)performStatement:(NSString *)schema withValuesList:(NSArray<NSArray *> *)valuesList error:(NSError *__autoreleasing *)error {
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:schema withError:error];
+    if (sql == nil) {
+        return NO;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [self openDatabaseWithError:error];
+        if (database == nil) {
+            return NO;
+        }
+        if (valuesList.count == 1) {
+            return [database executeUpdate:sql values:valuesList.firstObject error:error];
+        }
+        
+        if (![database beginTransaction]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return NO;
+        }
+        for (NSArray *values in valuesList) {
+            if (![database executeUpdate:sql values:values error:error]) {
+                [database rollback];
+                return NO;
+            }
+        }
+        if (![database commit]) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            [database rollback];
+            return NO;
+        }
+        return YES;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+- (NSArray<FRAOutboxEntry *> *)readResponsesWithError:(NSError *__autoreleasing *)error {
+    NSString *sql = [FRAFMDatabaseConnectionHelper readSchema:@"read_outbox_responses" withError:error];
+    if (sql == nil) {
+        return nil;
+    }
+    
+    FMDatabase *database;
+    @try {
+        database = [self openDatabaseWithError:error];
+        if (database == nil) {
+            return nil;
+        }
+        FMResultSet *results = [database executeQuery:sql];
+        if (results == nil) {
+            if (error) {
+                *error = [FRAError createErrorForLastFailure:database];
+            }
+            return nil;
+        }
+        
+        NSMutableArray<FRAOutboxEntry *> *responses = [[NSMutableArray alloc] init];
+        while ([results next]) {
+            FRAOutboxEntry *response = [[FRAOutboxEntry alloc] init];
+            response.messageId = [results stringForColumnIndex:0];
+            response.endpoint = [results stringForColumnIndex:1];
+            response.loadBalancerCookie = [results columnIndexIsNull:2] ? nil : [results stringForColumnIndex:2];
+            NSData *json = [[results stringForColumnIndex:3] dataUsingEncoding:NSUTF8StringEncoding];
+            response.payload = json ? [NSJSONSerialization JSONObjectWithData:json options:0 error:nil] : nil;
+            response.timeExpired = [results columnIndexIsNull:4] ? 0 : [results doubleForColumnIndex:4];
+            response.attempts = (NSUInteger)[results intForColumnIndex:5];
+            response.nextAttempt = [results doubleForColumnIndex:6];
+            if (response.messageId && response.endpoint && response.payload) {
+                [responses addObject:response];
+            }
+        }
+        [results close];
+        return responses;
+    }
+    @finally {
+        [sqlDatabase closeConnectionToDatabase:database];
+    }
+}
+
+@end
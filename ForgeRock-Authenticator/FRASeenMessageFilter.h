@@ -0,0 +1,100 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+@class FRADatabaseConfiguration;
+
+/*!
+ * Whether a push message id has been seen before.
+ */
+typedef NS_ENUM(NSInteger, FRASeenMessageState) {
+    /*! The id has not been seen. */
+    FRAMessageNotSeen,
+    /*! The id is one of the most recently seen, and the UID of its mechanism is known. */
+    FRAMessageRecentlySeen,
+    /*! The id is in one of the Bloom filters, so it was seen earlier, barring a false positive. */
+    FRAMessageProbablySeen
+};
+
+/*!
+ * Compact, persisted record of the push message ids already ingested, used to drop redelivered messages before
+ * any decoding or database work.
+ *
+ * Recent ids are held exactly, with the UID of their mechanism, in a small LRU. Every id is also added to the
+ * current of two Bloom filters. When the current filter has taken its capacity it becomes the previous one and
+ * the old previous filter is discarded, so an id is remembered for between one and two generations while the
+ * memory used stays fixed. Filters are sized for a false positive rate of one in a million each.
+ *
+ * Changes are written to disk in the background. The filter is thread safe.
+ */
+@interface FRASeenMessageFilter : NSObject
+
+/*!
+ * The number of ids each Bloom filter generation takes before the filters rotate.
+ */
+@property (nonatomic, readonly) NSUInteger generationCapacity;
+
+/*!
+ * The number of ids held exactly.
+ */
+@property (nonatomic, readonly) NSUInteger recentCapacity;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method, with a generation capacity of 4096 and a recent capacity of 256.
+ *
+ * @param configuration The configuration which locates the filter file.
+ * @return The initialized filter.
+ */
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)configuration;
+
+/*!
+ * Init method. The filter is read from the file if it exists and was written with the same capacities.
+ *
+ * @param path The path of the filter file.
+ * @param generationCapacity The number of ids each Bloom filter generation takes.
+ * @param recentCapacity The number of ids held exactly.
+ * @return The initialized filter.
+ */
+- (instancetype)initWithPath:(NSString *)path generationCapacity:(NSUInteger)generationCapacity recentCapacity:(NSUInteger)recentCapacity;
+
+#pragma mark -
+#pragma mark Filter Functions
+
+/*!
+ * Looks up a message id.
+ *
+ * @param messageId The message id.
+ * @param mechanismUid Set to the UID of the mechanism of the message if the id was recently seen. May be NULL.
+ * @return Whether the id has been seen.
+ */
+- (FRASeenMessageState)stateOfMessageId:(NSString *)messageId mechanismUid:(NSString *__autoreleasing *)mechanismUid;
+
+/*!
+ * Records a message id as seen.
+ *
+ * @param messageId The message id.
+ * @param mechanismUid The UID of the mechanism the message was for.
+ */
+- (void)addMessageId:(NSString *)messageId mechanismUid:(NSString *)mechanismUid;
+
+/*!
+ * Blocks until every change has been written to disk.
+ */
+- (void)flush;
+
+@end
@@ -0,0 +1,331 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <math.h>
+#include <zlib.h>
+
+#import "FRADatabaseConfiguration.h"
+#import "FRASeenMessageFilter.h"
+
+/*! The filter is written in the device's byte order; it never leaves the device. */
+static const uint32_t FRASeenMessageFilterMagic = 0x4D535246; // "FRSM"
+static const uint32_t FRASeenMessageFilterVersion = 1;
+static const NSUInteger FRADefaultGenerationCapacity = 4096;
+static const NSUInteger FRADefaultRecentCapacity = 256;
+static const double FRASeenMessageFalsePositiveRate = 1e-6;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    /*! CRC-32 of everything after the header. */
+    uint32_t checksum;
+    uint32_t bitCount;
+    uint32_t hashCount;
+    /*! The number of ids added to the current generation. */
+    uint32_t currentCount;
+    uint32_t recentCount;
+    uint32_t reserved;
+} FRASeenMessageFilterHeader;
+
+/*!
+ * The two halves of a 128 bit hash of the UTF-8 bytes of an id, from which the bit positions are derived by
+ * double hashing.
+ */
+typedef struct {
+    uint64_t h1;
+    uint64_t h2;
+} FRASeenMessageHash;
+
+static FRASeenMessageHash hashMessageId(NSString *messageId) {
+    const char *bytes = [messageId UTF8String];
+    // FNV-1a, then a SplitMix64 finalizer for the second, odd, step
+    uint64_t h1 = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)bytes; *p; p++) {
+        h1 = (h1 ^ *p) * 0x100000001b3ULL;
+    }
+    uint64_t h2 = h1 + 0x9e3779b97f4a7c15ULL;
+    h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111ebULL;
+    h2 ^= h2 >> 31;
+    return (FRASeenMessageHash){ h1, h2 | 1 };
+}
+
+static BOOL bloomContains(const uint8_t *bits, uint32_t bitCount, uint32_t hashCount, FRASeenMessageHash hash) {
+    uint64_t position = hash.h1;
+    for (uint32_t i = 0; i < hashCount; i++, position += hash.h2) {
+        uint32_t bit = (uint32_t)(position % bitCount);
+        if (!(bits[bit >> 3] & (1 << (bit & 7)))) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static void bloomAdd(uint8_t *bits, uint32_t bitCount, uint32_t hashCount, FRASeenMessageHash hash) {
+    uint64_t position = hash.h1;
+    for (uint32_t i = 0; i < hashCount; i++, position += hash.h2) {
+        uint32_t bit = (uint32_t)(position % bitCount);
+        bits[bit >> 3] |= 1 << (bit & 7);
+    }
+}
+
+@implementation FRASeenMessageFilter {
+    FRADatabaseConfiguration *configuration;
+    NSString *path;
+    uint32_t bitCount;
+    uint32_t hashCount;
+    NSMutableData *currentBits;
+    NSMutableData *previousBits;
+    uint32_t currentCount;
+    /*! Recent ids, least recently seen first, and the UIDs of their mechanisms. */
+    NSMutableOrderedSet<NSString *> *recentIds;
+    NSMutableDictionary<NSString *, NSString *> *recentMechanismUids;
+    BOOL loaded;
+    BOOL writeScheduled;
+    dispatch_queue_t writeQueue;
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithConfiguration:(FRADatabaseConfiguration *)aConfiguration {
+    self = [self initWithPath:nil generationCapacity:FRADefaultGenerationCapacity recentCapacity:FRADefaultRecentCapacity];
+    if (self) {
+        configuration = aConfiguration;
+    }
+    return self;
+}
+
+- (instancetype)initWithPath:(NSString *)aPath generationCapacity:(NSUInteger)generationCapacity recentCapacity:(NSUInteger)recentCapacity {
+    self = [super init];
+    if (self) {
+        path = aPath;
+        _generationCapacity = MAX(generationCapacity, 1);
+        _recentCapacity = recentCapacity;
+        // optimal size for the capacity and false positive rate, in whole bytes
+        double bits = ceil(-(double)_generationCapacity * log(FRASeenMessageFalsePositiveRate) / (M_LN2 * M_LN2));
+        bitCount = (uint32_t)(ceil(bits / 8) * 8);
+        hashCount = (uint32_t)MAX(1, lround(bitCount / (double)_generationCapacity * M_LN2));
+        writeQueue = dispatch_queue_create("org.forgerock.authenticator.seen-messages", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(writeQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark Filter Functions
+
+- (FRASeenMessageState)stateOfMessageId:(NSString *)messageId mechanismUid:(NSString *__autoreleasing *)mechanismUid {
+    if (!messageId) {
+        return FRAMessageNotSeen;
+    }
+    FRASeenMessageHash hash = hashMessageId(messageId);
+    @synchronized (self) {
+        [self load];
+        NSString *uid = recentMechanismUids[messageId];
+        if (uid) {
+            [recentIds removeObject:messageId];
+            [recentIds addObject:messageId];
+            if (mechanismUid) {
+                *mechanismUid = uid;
+            }
+            return FRAMessageRecentlySeen;
+        }
+        if (bloomContains(currentBits.bytes, bitCount, hashCount, hash) || bloomContains(previousBits.bytes, bitCount, hashCount, hash)) {
+            return FRAMessageProbablySeen;
+        }
+        return FRAMessageNotSeen;
+    }
+}
+
+- (void)addMessageId:(NSString *)messageId mechanismUid:(NSString *)mechanismUid {
+    if (!messageId || !mechanismUid) {
+        return;
+    }
+    FRASeenMessageHash hash = hashMessageId(messageId);
+    @synchronized (self) {
+        [self load];
+        if (!recentMechanismUids[messageId]) {
+            if (!bloomContains(currentBits.bytes, bitCount, hashCount, hash)) {
+                if (currentCount >= self.generationCapacity) {
+                    previousBits = currentBits;
+                    currentBits = [NSMutableData dataWithLength:bitCount / 8];
+                    currentCount = 0;
+                }
+                bloomAdd(currentBits.mutableBytes, bitCount, hashCount, hash);
+                currentCount++;
+            }
+            if (self.recentCapacity > 0) {
+                if (recentIds.count >= self.recentCapacity) {
+                    [recentMechanismUids removeObjectForKey:recentIds.firstObject];
+                    [recentIds removeObjectAtIndex:0];
+                }
+                [recentIds addObject:messageId];
+                recentMechanismUids[messageId] = mechanismUid;
+            }
+        }
+        [self scheduleWrite];
+    }
+}
+
+- (void)flush {
+    dispatch_sync(writeQueue, ^{});
+}
+
+#pragma mark -
+#pragma mark Persistence Functions (private)
+
+/*!
+ * Reads the filter from disk on first use. Must be called while synchronized on self.
+ */
+- (void)load {
+    if (loaded) {
+        return;
+    }
+    loaded = YES;
+    currentBits = [NSMutableData dataWithLength:bitCount / 8];
+    previousBits = [NSMutableData dataWithLength:bitCount / 8];
+    recentIds = [[NSMutableOrderedSet alloc] init];
+    recentMechanismUids = [[NSMutableDictionary alloc] init];
+    
+    NSString *filterPath = [self pathWithError:nil];
+    NSData *data = filterPath ? [NSData dataWithContentsOfFile:filterPath] : nil;
+    if (data && ![self decode:data]) {
+        NSLog(@"Discarding unreadable seen message filter");
+        currentBits = [NSMutableData dataWithLength:bitCount / 8];
+        previousBits = [NSMutableData dataWithLength:bitCount / 8];
+        currentCount = 0;
+        [recentIds removeAllObjects];
+        [recentMechanismUids removeAllObjects];
+    }
+}
+
+- (BOOL)decode:(NSData *)data {
+    FRASeenMessageFilterHeader header;
+    if (data.length < sizeof(header)) {
+        return NO;
+    }
+    memcpy(&header, data.bytes, sizeof(header));
+    const uint8_t *body = (const uint8_t *)data.bytes + sizeof(header);
+    size_t bodyLength = data.length - sizeof(header);
+    if (header.magic != FRASeenMessageFilterMagic || header.version != FRASeenMessageFilterVersion
+        || header.bitCount != bitCount || header.hashCount != hashCount
+        || header.checksum != (uint32_t)crc32(0, body, (uInt)bodyLength)
+        || bodyLength < 2 * bitCount / 8) {
+        return NO;
+    }
+    [currentBits replaceBytesInRange:NSMakeRange(0, bitCount / 8) withBytes:body];
+    [previousBits replaceBytesInRange:NSMakeRange(0, bitCount / 8) withBytes:body + bitCount / 8];
+    currentCount = header.currentCount;
+    
+    // recent ids: id length, id, mechanism UID length, mechanism UID
+    const uint8_t *p = body + 2 * bitCount / 8;
+    const uint8_t *end = body + bodyLength;
+    for (uint32_t i = 0; i < header.recentCount; i++) {
+        NSString *strings[2];
+        for (int j = 0; j < 2; j++) {
+            uint16_t length;
+            if (end - p < (ptrdiff_t)sizeof(length)) {
+                return NO;
+            }
+            memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            if (end - p < length) {
+                return NO;
+            }
+            strings[j] = [[NSString alloc] initWithBytes:p length:length encoding:NSUTF8StringEncoding];
+            p += length;
+            if (!strings[j]) {
+                return NO;
+            }
+        }
+        if (recentIds.count < self.recentCapacity) {
+            [recentIds addObject:strings[0]];
+            recentMechanismUids[strings[0]] = strings[1];
+        }
+    }
+    return YES;
+}
+
+- (NSData *)encode {
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(FRASeenMessageFilterHeader)];
+    [data appendData:currentBits];
+    [data appendData:previousBits];
+    uint32_t recentCount = 0;
+    for (NSString *messageId in recentIds) {
+        NSData *idBytes = [messageId dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *uidBytes = [recentMechanismUids[messageId] dataUsingEncoding:NSUTF8StringEncoding];
+        if (idBytes.length > UINT16_MAX || uidBytes.length > UINT16_MAX) {
+            continue;
+        }
+        for (NSData *bytes in @[idBytes, uidBytes]) {
+            uint16_t length = (uint16_t)bytes.length;
+            [data appendBytes:&length length:sizeof(length)];
+            [data appendData:bytes];
+        }
+        recentCount++;
+    }
+    
+    FRASeenMessageFilterHeader header = {
+        .magic = FRASeenMessageFilterMagic,
+        .version = FRASeenMessageFilterVersion,
+        .bitCount = bitCount,
+        .hashCount = hashCount,
+        .currentCount = currentCount,
+        .recentCount = recentCount,
+    };
+    const uint8_t *body = (const uint8_t *)data.bytes + sizeof(header);
+    header.checksum = (uint32_t)crc32(0, body, (uInt)(data.length - sizeof(header)));
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:&header];
+    return data;
+}
+
+/*!
+ * Writes the filter on the write queue, coalescing changes made before the write starts. Must be called while
+ * synchronized on self.
+ */
+- (void)scheduleWrite {
+    if (writeScheduled) {
+        return;
+    }
+    writeScheduled = YES;
+    dispatch_async(writeQueue, ^{
+        NSData *data;
+        @synchronized (self) {
+            writeScheduled = NO;
+            data = [self encode];
+        }
+        NSError *error;
+        NSString *filterPath = [self pathWithError:&error];
+        if (!filterPath || ![data writeToFile:filterPath options:NSDataWritingAtomic | NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication error:&error]) {
+            NSLog(@"Could not write seen message filter: %@", error);
+        }
+    });
+}
+
+/*!
+ * Resolves the location of the filter file.
+ */
+- (NSString *)pathWithError:(NSError *__autoreleasing *)error {
+    @synchronized (self) {
+        if (!path) {
+            path = [configuration getSeenMessageFilterPathWithError:error];
+        }
+        return path;
+    }
+}
+
+@end
@@ -104,6 +104,18 @@ extern NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE;
  */
 + (BOOL)deserializeJSON:(NSString *)dictionaryJson intoDictionary:(NSDictionary *__autoreleasing *)dictionary error:(NSError *__autoreleasing *)error;
 
+/*!
+ * Given the contents of a stored column, deserialise it into a Dictionary. The column may hold either
+ * the binary encoding of FRABinarySerialization or JSON text written by earlier versions.
+ *
+ * @param data Bytes of the column to deserialise, maybe nil or empty.
+ * @param dictionary Output value to store Dictionary into.
+ * @param error If an error occurs, upon returns contains an NSError object that describes the problem. If you are not interested in possible errors, you may pass in NULL.
+ *
+ * @return NO if there was an error, otherwise YES to indicate no error occurred.
+ */
++ (BOOL)deserializeData:(NSData *)data intoDictionary:(NSDictionary *__autoreleasing *)dictionary error:(NSError *__autoreleasing *)error;
+
 /*!
  * Given a byte array, serialise it to text using Base64.
  *
@@ -121,18 +133,18 @@ extern NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE;
 + (NSData *)deserializeBytes:(NSString *)data;
 
 /*!
- * Given an NSData object, serialise it to a hexadecimal string.
+ * Given an NSData object, serialise it to a lower case hexadecimal string.
  *
- * @param data Encoded data to deserialise.
- * @return nil if the input was nil, otherwise non nil byte array.
+ * @param data Bytes to serialise, may be nil.
+ * @return nil if the input was nil or the string could not be allocated, otherwise non nil string of two hex digits per byte.
  */
 + (NSString *)serializeSecret:(NSData *)data;
 
 /*!
- * Given a hex encoded string, deserialise it to an NSData object.
+ * Given a hex encoded string, deserialise it to an NSData object. Both upper and lower case digits are accepted.
  *
- * @param hexOfSecret hex encoded data to deserialise.
- * @return nil if the input was nil, otherwise non nil byte array.
+ * @param hexOfSecret hex encoded data to deserialise, may be nil or NSNull.
+ * @return nil if the input was nil, NSNull, of odd length or contained a character other than a hex digit, otherwise non nil byte array.
  */
 + (NSData *)deserializeSecret:(NSString *)hexOfSecret;
 
@@ -144,6 +156,15 @@ extern NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE;
  */
 + (id)nonNilDate:(NSDate *)date;
 
+/*!
+ * Returns the numeric value of a deserialised Dictionary entry, which is an NSNumber when read from
+ * the binary encoding and a String when read from JSON.
+ *
+ * @param value The entry to convert, may be nil.
+ * @return The number, or nil if the entry is missing or not numeric.
+ */
++ (NSNumber *)numberFromValue:(id)value;
+
 /*!
  * Returns the string if not nil, NSNull otherwise.
  *
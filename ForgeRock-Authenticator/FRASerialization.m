@@ -15,6 +15,8 @@
  */
 
 
+#import "FRABinarySerialization.h"
+#import "FRAHex.h"
 #import "FRASerialization.h"
 
 NSString * const OATH_MECHANISM_SECRET = @"secret";
@@ -32,6 +34,9 @@ NSString * const NOTIFICATION_PUSH_CHALLENGE = @"push_challenge";
 NSString * const NOTIFICATION_TIME_TO_LIVE = @"time_to_live";
 NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE = @"load_balancer_cookie";
 
+/*! Lower case hex digit of each nibble value. */
+static const char FRAHexDigits[16] = "0123456789abcdef";
+
 @implementation FRASerialization
 
 #pragma mark -
@@ -62,6 +67,23 @@ NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE = @"load_balancer_cookie";
     return YES;
 }
 
++ (BOOL)deserializeData:(NSData *)data intoDictionary:(NSDictionary *__autoreleasing *)dictionary error:(NSError *__autoreleasing *)error {
+    if (data.length == 0) {
+        return YES;
+    }
+    NSDictionary *map;
+    if ([FRABinarySerialization isBinaryEncoded:data]) {
+        map = [FRABinarySerialization decodeData:data error:error];
+    } else {
+        map = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingMutableContainers error:error];
+    }
+    if (map == nil) {
+        return NO;
+    }
+    *dictionary = map;
+    return YES;
+}
+
 + (NSString *)serializeBytes:(NSData *)data {
     if (data == nil) {
         return nil;
@@ -73,40 +95,55 @@ NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE = @"load_balancer_cookie";
     if (data == nil) {
         return nil;
     }
-    const unsigned char *dataBuffer = (const unsigned char *)[data bytes];
-
-    if (!dataBuffer) {
+    NSUInteger length = data.length;
+    if (length == 0) {
         return [NSString string];
     }
-
-    NSUInteger dataLength = [data length];
-    NSMutableString *hexString  = [NSMutableString stringWithCapacity:(dataLength * 2)];
-
-    for (int i = 0; i < dataLength; ++i) {
-        [hexString appendString:[NSString stringWithFormat:@"%02lx", (unsigned long)dataBuffer[i]]];
+    
+    const uint8_t *bytes = data.bytes;
+    char *characters = malloc(length * 2);
+    if (!characters) {
+        return nil;
     }
-
-    return [NSString stringWithString:hexString];
+    for (NSUInteger i = 0; i < length; i++) {
+        characters[2 * i] = FRAHexDigits[bytes[i] >> 4];
+        characters[2 * i + 1] = FRAHexDigits[bytes[i] & 0x0F];
+    }
+    return [[NSString alloc] initWithBytesNoCopy:characters length:length * 2 encoding:NSASCIIStringEncoding freeWhenDone:YES];
 }
 
 + (NSData *)deserializeSecret:(NSString *)hexOfSecret {
-    if (hexOfSecret == (id)[NSNull null]) {
+    if (![hexOfSecret isKindOfClass:[NSString class]]) {
         return nil;
     }
     
-    char characterBuffer[3];
-    characterBuffer[2] = '\0';
-
-    unsigned char *bytes = malloc([hexOfSecret length]/2);
-    unsigned char *byteTraversal = bytes;
-    for (int i = 0; i < [hexOfSecret length]; i += 2) {
-        characterBuffer[0] = [hexOfSecret characterAtIndex:i];
-        characterBuffer[1] = [hexOfSecret characterAtIndex:i+1];
-        char *byte2 = NULL;
-        *byteTraversal++ = strtol(characterBuffer, &byte2, 16);
+    // Hex strings are ASCII, so their characters can usually be read without copying
+    NSData *ascii;
+    const char *characters = CFStringGetCStringPtr((__bridge CFStringRef)hexOfSecret, kCFStringEncodingASCII);
+    NSUInteger length = hexOfSecret.length;
+    if (!characters) {
+        ascii = [hexOfSecret dataUsingEncoding:NSASCIIStringEncoding];
+        if (!ascii) {
+            return nil;
+        }
+        characters = ascii.bytes;
+        length = ascii.length;
     }
-
-    return [NSData dataWithBytesNoCopy:bytes length:[hexOfSecret length]/2 freeWhenDone:YES];
+    if (length % 2 != 0) {
+        return nil;
+    }
+    
+    NSMutableData *secret = [[NSMutableData alloc] initWithLength:length / 2];
+    uint8_t *bytes = secret.mutableBytes;
+    // Invalid digits are accumulated rather than checked per byte, which keeps the loop free of branches
+    uint8_t invalid = 0;
+    for (NSUInteger i = 0; i < length / 2; i++) {
+        uint8_t high = FRAHexValues[(uint8_t)characters[2 * i]];
+        uint8_t low = FRAHexValues[(uint8_t)characters[2 * i + 1]];
+        invalid |= high | low;
+        bytes[i] = (uint8_t)(high << 4 | low);
+    }
+    return (invalid & 0xF0) ? nil : secret;
 }
 
 + (NSData *)deserializeBytes:(NSString *)data {
@@ -133,6 +170,17 @@ NSString * const NOTIFICATION_LOAD_BALANCER_COOKIE = @"load_balancer_cookie";
     return string;
 }
 
++ (NSNumber *)numberFromValue:(id)value {
+    if ([value isKindOfClass:[NSNumber class]]) {
+        return value;
+    }
+    if (![value isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    NSDecimalNumber *number = [NSDecimalNumber decimalNumberWithString:value locale:nil];
+    return [number isEqualToNumber:[NSDecimalNumber notANumber]] ? nil : number;
+}
+
 + (id)nonNilDate:(NSDate *)date {
     if (date != nil) {
         NSTimeInterval interval = [date timeIntervalSince1970];
@@ -0,0 +1,62 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+/*!
+ * The minimal set of edits which transforms one snapshot of a list into another.
+ *
+ * Objects are matched using isEqual:, so model objects are matched by identity. Deleted and updated indexes refer
+ * to positions in the old snapshot and inserted indexes to positions in the new snapshot, which is the convention
+ * expected by batch updates of table and collection views.
+ */
+@interface FRASnapshotDiff : NSObject
+
+/*!
+ * Indexes in the old snapshot of objects which are not in the new snapshot.
+ */
+@property (strong, nonatomic, readonly) NSIndexSet *deletedIndexes;
+
+/*!
+ * Indexes in the new snapshot of objects which were not in the old snapshot.
+ */
+@property (strong, nonatomic, readonly) NSIndexSet *insertedIndexes;
+
+/*!
+ * Indexes in the old snapshot of objects which are retained in the new snapshot but were reported as updated.
+ */
+@property (strong, nonatomic, readonly) NSIndexSet *updatedIndexes;
+
+/*!
+ * Calculates the minimal number of insertions and deletions required to turn one snapshot into another.
+ *
+ * Uses Myers' O(ND) difference algorithm after trimming any common prefix and suffix, so the cost is proportional
+ * to the size of the change rather than the size of the snapshots.
+ *
+ * @param oldSnapshot The snapshot currently being displayed.
+ * @param newSnapshot The snapshot which should be displayed.
+ * @param updatedObjects Objects whose content has changed. May be nil.
+ * @return The difference between the snapshots.
+ */
++ (instancetype)diffFromSnapshot:(NSArray *)oldSnapshot toSnapshot:(NSArray *)newSnapshot updatedObjects:(NSSet *)updatedObjects;
+
+/*!
+ * Whether the diff contains any edits.
+ *
+ * @return YES if there are no insertions, deletions or updates, otherwise NO.
+ */
+- (BOOL)isEmpty;
+
+@end
@@ -0,0 +1,146 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRASnapshotDiff.h"
+
+@implementation FRASnapshotDiff
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithDeletedIndexes:(NSIndexSet *)deletedIndexes insertedIndexes:(NSIndexSet *)insertedIndexes updatedIndexes:(NSIndexSet *)updatedIndexes {
+    if (self = [super init]) {
+        _deletedIndexes = deletedIndexes;
+        _insertedIndexes = insertedIndexes;
+        _updatedIndexes = updatedIndexes;
+    }
+    return self;
+}
+
++ (instancetype)diffFromSnapshot:(NSArray *)oldSnapshot toSnapshot:(NSArray *)newSnapshot updatedObjects:(NSSet *)updatedObjects {
+    NSUInteger oldCount = oldSnapshot.count;
+    NSUInteger newCount = newSnapshot.count;
+    
+    // Trim common prefix and suffix, which covers the typical append, remove or in place update
+    NSUInteger prefix = 0;
+    while (prefix < oldCount && prefix < newCount && [oldSnapshot[prefix] isEqual:newSnapshot[prefix]]) {
+        prefix++;
+    }
+    NSUInteger suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+           && [oldSnapshot[oldCount - suffix - 1] isEqual:newSnapshot[newCount - suffix - 1]]) {
+        suffix++;
+    }
+    
+    NSMutableIndexSet *deletedIndexes = [[NSMutableIndexSet alloc] init];
+    NSMutableIndexSet *insertedIndexes = [[NSMutableIndexSet alloc] init];
+    [self diffOldSnapshot:oldSnapshot
+                    range:NSMakeRange(prefix, oldCount - prefix - suffix)
+              newSnapshot:newSnapshot
+                    range:NSMakeRange(prefix, newCount - prefix - suffix)
+           deletedIndexes:deletedIndexes
+          insertedIndexes:insertedIndexes];
+    
+    NSMutableIndexSet *updatedIndexes = [[NSMutableIndexSet alloc] init];
+    if (updatedObjects.count > 0) {
+        [oldSnapshot enumerateObjectsUsingBlock:^(id object, NSUInteger index, BOOL *stop) {
+            if (![deletedIndexes containsIndex:index] && [updatedObjects containsObject:object]) {
+                [updatedIndexes addIndex:index];
+            }
+        }];
+    }
+    
+    return [[FRASnapshotDiff alloc] initWithDeletedIndexes:deletedIndexes insertedIndexes:insertedIndexes updatedIndexes:updatedIndexes];
+}
+
+/*!
+ * Myers' greedy shortest edit script between the given ranges of two snapshots.
+ */
++ (void)diffOldSnapshot:(NSArray *)oldSnapshot range:(NSRange)oldRange newSnapshot:(NSArray *)newSnapshot range:(NSRange)newRange deletedIndexes:(NSMutableIndexSet *)deletedIndexes insertedIndexes:(NSMutableIndexSet *)insertedIndexes {
+    NSInteger n = oldRange.length;
+    NSInteger m = newRange.length;
+    if (n == 0 || m == 0) {
+        [deletedIndexes addIndexesInRange:oldRange];
+        [insertedIndexes addIndexesInRange:newRange];
+        return;
+    }
+    
+    NSInteger max = n + m;
+    NSInteger offset = max;
+    size_t width = (size_t)(2 * max + 1);
+    NSInteger *v = calloc(width, sizeof(NSInteger));
+    // trace[d] holds the furthest reaching x for each diagonal k before edit d was considered
+    NSMutableArray<NSData *> *trace = [[NSMutableArray alloc] init];
+    
+    NSInteger editCount = 0;
+    BOOL found = NO;
+    for (NSInteger d = 0; d <= max && !found; d++) {
+        [trace addObject:[NSData dataWithBytes:v length:width * sizeof(NSInteger)]];
+        for (NSInteger k = -d; k <= d; k += 2) {
+            NSInteger x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                x = v[offset + k + 1];
+            } else {
+                x = v[offset + k - 1] + 1;
+            }
+            NSInteger y = x - k;
+            while (x < n && y < m && [oldSnapshot[oldRange.location + x] isEqual:newSnapshot[newRange.location + y]]) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                editCount = d;
+                found = YES;
+                break;
+            }
+        }
+    }
+    free(v);
+    
+    // Walk back through the trace to recover which edit was taken at each step
+    NSInteger x = n;
+    NSInteger y = m;
+    for (NSInteger d = editCount; d > 0; d--) {
+        const NSInteger *previous = trace[d].bytes;
+        NSInteger k = x - y;
+        NSInteger previousK;
+        if (k == -d || (k != d && previous[offset + k - 1] < previous[offset + k + 1])) {
+            previousK = k + 1;
+        } else {
+            previousK = k - 1;
+        }
+        NSInteger previousX = previous[offset + previousK];
+        NSInteger previousY = previousX - previousK;
+        if (previousK == k + 1) {
+            [insertedIndexes addIndex:newRange.location + previousY];
+        } else {
+            [deletedIndexes addIndex:oldRange.location + previousX];
+        }
+        x = previousX;
+        y = previousY;
+    }
+}
+
+#pragma mark -
+#pragma mark Diff Functions
+
+- (BOOL)isEmpty {
+    return self.deletedIndexes.count == 0 && self.insertedIndexes.count == 0 && self.updatedIndexes.count == 0;
+}
+
+@end
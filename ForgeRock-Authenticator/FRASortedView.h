@@ -0,0 +1,98 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+/*!
+ * An ordered view of a collection of objects which is kept sorted as objects are added and removed, so that
+ * looking up the object at a row is constant time and each change is a binary search rather than a re-sort.
+ *
+ * Objects are compared with the comparator to find their position and matched by identity within runs of equal
+ * keys. The sort key of an object must therefore not change while it is in the view; to move an object whose key
+ * has changed, remove it before the change and add it again afterwards, or add it to a different view.
+ */
+@interface FRASortedView<ObjectType> : NSObject
+
+/*!
+ * The number of objects in the view.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ * Incremented each time the contents of the view change.
+ */
+@property (nonatomic, readonly) NSUInteger revision;
+
+#pragma mark -
+#pragma mark Lifecyle
+
+/*!
+ * Init method.
+ *
+ * @param comparator Defines the order of the view. Objects which compare equal are kept in insertion order.
+ * @return The initialized view.
+ */
+- (instancetype)initWithComparator:(NSComparator)comparator;
+
+#pragma mark -
+#pragma mark View Functions
+
+/*!
+ * The object at a position in the view.
+ *
+ * @param index The position, which must be less than count.
+ * @return The object.
+ */
+- (ObjectType)objectAtIndex:(NSUInteger)index;
+
+/*!
+ * Finds the position of an object in the view.
+ *
+ * @param object The object to locate.
+ * @return The position of the object, or NSNotFound if it is not in the view.
+ */
+- (NSUInteger)indexOfObject:(ObjectType)object;
+
+/*!
+ * Inserts an object at its sorted position.
+ *
+ * @param object The object to add.
+ * @return The position at which the object was inserted.
+ */
+- (NSUInteger)addObject:(ObjectType)object;
+
+/*!
+ * Removes an object from the view.
+ *
+ * @param object The object to remove.
+ * @return The position the object was removed from, or NSNotFound if it was not in the view.
+ */
+- (NSUInteger)removeObject:(ObjectType)object;
+
+/*!
+ * Replaces the contents of the view, sorting the new objects once.
+ *
+ * @param objects The new contents of the view.
+ */
+- (void)setObjects:(NSArray<ObjectType> *)objects;
+
+/*!
+ * The contents of the view in order.
+ *
+ * @return An immutable copy of the contents of the view.
+ */
+- (NSArray<ObjectType> *)allObjects;
+
+@end
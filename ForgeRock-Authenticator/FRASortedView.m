@@ -0,0 +1,94 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import "FRASortedView.h"
+
+@implementation FRASortedView {
+    
+    /*! Defines the order of objects. */
+    NSComparator comparator;
+    /*! The objects in sorted order. */
+    NSMutableArray *objects;
+    
+}
+
+#pragma mark -
+#pragma mark Lifecyle
+
+- (instancetype)initWithComparator:(NSComparator)aComparator {
+    if (self = [super init]) {
+        comparator = [aComparator copy];
+        objects = [[NSMutableArray alloc] init];
+        _revision = 0;
+    }
+    return self;
+}
+
+#pragma mark -
+#pragma mark View Functions
+
+- (NSUInteger)count {
+    return objects.count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    return [objects objectAtIndex:index];
+}
+
+- (NSUInteger)indexOfObject:(id)object {
+    NSRange range = NSMakeRange(0, objects.count);
+    NSUInteger first = [objects indexOfObject:object inSortedRange:range options:NSBinarySearchingFirstEqual usingComparator:comparator];
+    if (first == NSNotFound) {
+        return NSNotFound;
+    }
+    for (NSUInteger index = first; index < objects.count && comparator(objects[index], object) == NSOrderedSame; index++) {
+        if (objects[index] == object) {
+            return index;
+        }
+    }
+    return NSNotFound;
+}
+
+- (NSUInteger)addObject:(id)object {
+    NSUInteger index = [objects indexOfObject:object
+                                inSortedRange:NSMakeRange(0, objects.count)
+                                      options:NSBinarySearchingInsertionIndex | NSBinarySearchingLastEqual
+                              usingComparator:comparator];
+    [objects insertObject:object atIndex:index];
+    _revision++;
+    return index;
+}
+
+- (NSUInteger)removeObject:(id)object {
+    NSUInteger index = [self indexOfObject:object];
+    if (index != NSNotFound) {
+        [objects removeObjectAtIndex:index];
+        _revision++;
+    }
+    return index;
+}
+
+- (void)setObjects:(NSArray *)newObjects {
+    objects = [[newObjects sortedArrayWithOptions:NSSortStable usingComparator:comparator] mutableCopy];
+    _revision++;
+}
+
+- (NSArray *)allObjects {
+    return [objects copy];
+}
+
+@end
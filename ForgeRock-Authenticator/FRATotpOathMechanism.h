@@ -33,6 +33,8 @@
 @property (nonatomic, readonly) NSString *code;
 /*!
  * The secret key bytes used by the OATH mechanism.
+ *
+ * The key is held in the default FRAKeyArena; each access returns a copy which is zeroized when released.
  */
 @property (nonatomic, readonly) NSData *secretKey;
 /*!
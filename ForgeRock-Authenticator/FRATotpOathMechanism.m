@@ -16,7 +16,8 @@
 
 #include <CommonCrypto/CommonHMAC.h>
 
-#import "FRAOathCode.h"
+#import "FRAMechanismProtected.h"
+#import "FRAOathKey.h"
 #import "FRATotpOathMechanism.h"
 
 static uint64_t currentTimeInMilli() {
@@ -32,6 +33,7 @@ static uint64_t currentTimeInMilli() {
 @implementation FRATotpOathMechanism {
     uint64_t startTime;
     uint64_t endTime;
+    FRAOathKey *oathKey;
 }
 
 #pragma mark -
@@ -40,7 +42,7 @@ static uint64_t currentTimeInMilli() {
 - (instancetype)initWithDatabase:(FRAIdentityDatabase *)database identityModel:(FRAIdentityModel *)identityModel secretKey:(NSData *)secretKey HMACAlgorithm:(CCHmacAlgorithm)algorithm codeLength:(NSUInteger)codeLength period:(u_int32_t)period {
     self = [super initWithDatabase:database identityModel:identityModel];
     if (self) {
-        _secretKey = secretKey;
+        [self setSecretKey:secretKey];
         _algorithm = algorithm;
         _codeLength = codeLength;
         _period = period;
@@ -64,7 +66,7 @@ static uint64_t currentTimeInMilli() {
     uint64_t startTimeInSeconds = (now / self.period * self.period);
     startTime = startTimeInSeconds * 1000;
     endTime = (startTimeInSeconds + self.period) * 1000;
-    _code = [FRAOathCode hmac:self.algorithm codeLength:self.codeLength key:self.secretKey counter:now/self.period];
+    _code = [self codeForCounter:now/self.period];
     
     return YES;
 }
@@ -90,4 +92,22 @@ static uint64_t currentTimeInMilli() {
     return @"totp";
 }
 
+- (NSData *)secretKey {
+    return [oathKey data];
+}
+
+#pragma mark -
+#pragma mark Private Methods
+
+/*!
+ * Moves the secret key into the key arena. Also used when the mechanism is loaded from the database.
+ */
+- (void)setSecretKey:(NSData *)secretKey {
+    oathKey = [[FRAOathKey alloc] initWithData:secretKey];
+}
+
+- (NSString *)codeForCounter:(uint64_t)counter {
+    return [oathKey codeWithAlgorithm:self.algorithm codeLength:self.codeLength counter:counter];
+}
+
 @end
\ No newline at end of file
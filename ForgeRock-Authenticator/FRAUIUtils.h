@@ -14,6 +14,8 @@
  * Copyright 2016 ForgeRock AS.
  */
 
+@class FRASnapshotDiff;
+
 /*!
  * Utility class for common UI functions.
  */
@@ -37,4 +39,14 @@
  */
 + (void)setView:(UIView *)view issuerBackgroundColor:(NSString *)backgroundColor;
 
+/*!
+ * Applies the row deletions, insertions and reloads described by a snapshot diff to one section of a table view.
+ * Must be called between beginUpdates and endUpdates so that edits to several sections are animated together.
+ *
+ * @param tableView The UITableView to update.
+ * @param diff      The difference between the displayed and new rows of the section.
+ * @param section   The index of the section to update.
+ */
++ (void)tableView:(UITableView *)tableView applySnapshotDiff:(FRASnapshotDiff *)diff toSection:(NSInteger)section;
+
 @end
@@ -16,6 +16,7 @@
 
 #import <UIImageView+AFNetworking.h>
 
+#import "FRASnapshotDiff.h"
 #import "FRAUIUtils.h"
 
 static NSString * const FRA_DEFAULT_BACKGROUND_COLOR = @"#519387";
@@ -42,6 +43,23 @@ static NSString * const FRA_DEFAULT_BACKGROUND_COLOR = @"#519387";
     view.backgroundColor = color;
 }
 
++ (void)tableView:(UITableView *)tableView applySnapshotDiff:(FRASnapshotDiff *)diff toSection:(NSInteger)section {
+    [tableView deleteRowsAtIndexPaths:[FRAUIUtils indexPathsForIndexes:diff.deletedIndexes inSection:section]
+                     withRowAnimation:UITableViewRowAnimationAutomatic];
+    [tableView insertRowsAtIndexPaths:[FRAUIUtils indexPathsForIndexes:diff.insertedIndexes inSection:section]
+                     withRowAnimation:UITableViewRowAnimationAutomatic];
+    [tableView reloadRowsAtIndexPaths:[FRAUIUtils indexPathsForIndexes:diff.updatedIndexes inSection:section]
+                     withRowAnimation:UITableViewRowAnimationNone];
+}
+
++ (NSArray<NSIndexPath *> *)indexPathsForIndexes:(NSIndexSet *)indexes inSection:(NSInteger)section {
+    NSMutableArray<NSIndexPath *> *indexPaths = [[NSMutableArray alloc] initWithCapacity:indexes.count];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:index inSection:section]];
+    }];
+    return indexPaths;
+}
+
 + (UIColor *)convertHexToColor:(NSString *)hexString {
     unsigned rgbValue = 0;
     NSString *hex = [hexString stringByReplacingOccurrencesOfString:@"#" withString:@""];
@@ -0,0 +1,165 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#include <string.h>
+
+#include "FRAHex.h"
+#include "FRAUriParser.h"
+
+static int isEscape(const char *p, const char *end) {
+    return p + 2 < end && p[0] == '%'
+        && FRAHexValues[(unsigned char)p[1]] != FRA_HEX_INVALID
+        && FRAHexValues[(unsigned char)p[2]] != FRA_HEX_INVALID;
+}
+
+/* Length of the separator at p: 1 for ':', 3 for "%3A", 0 otherwise. */
+static size_t colonLength(const char *p, const char *end) {
+    if (*p == ':') {
+        return 1;
+    }
+    if (p + 2 < end && p[0] == '%' && p[1] == '3' && (p[2] == 'A' || p[2] == 'a')) {
+        return 3;
+    }
+    return 0;
+}
+
+int FRAUriParse(const char *uri, size_t length, FRAUri *result) {
+    const char *p = uri;
+    const char *end = uri + length;
+    const char *start;
+
+    memset(result, 0, sizeof(*result) - sizeof(result->parameters));
+
+    /* scheme ":" "//" */
+    for (start = p; p < end && *p != ':'; p++) {
+        if (*p == '/' || *p == '?' || *p == '#') {
+            return -1;
+        }
+    }
+    if (p == start || end - p < 3 || p[1] != '/' || p[2] != '/') {
+        return -1;
+    }
+    result->scheme = (FRAUriSpan){start, (size_t)(p - start)};
+    p += 3;
+
+    /* type */
+    for (start = p; p < end && *p != '/' && *p != '?' && *p != '#'; p++);
+    if (p == start) {
+        return -1;
+    }
+    result->type = (FRAUriSpan){start, (size_t)(p - start)};
+
+    /* path, split into issuer and label at the first colon */
+    while (p < end && *p == '/') {
+        p++;
+    }
+    const char *colon = NULL;
+    const char *labelEnd = NULL;
+    size_t separator = 0;
+    for (start = p; p < end && *p != '?' && *p != '#'; p++) {
+        size_t found = labelEnd ? 0 : colonLength(p, end);
+        if (found && !colon) {
+            colon = p;
+            separator = found;
+        } else if (found) {
+            labelEnd = p;
+        }
+    }
+    if (p == start) {
+        return -1;
+    }
+    if (colon) {
+        result->issuer = (FRAUriSpan){start, (size_t)(colon - start)};
+        start = colon + separator;
+    }
+    result->label = (FRAUriSpan){start, (size_t)((labelEnd ? labelEnd : p) - start)};
+
+    /* query */
+    if (p < end && *p == '?') {
+        p++;
+        while (p < end && *p != '#') {
+            const char *key = p;
+            const char *equals = NULL;
+            for (; p < end && *p != '&' && *p != '#'; p++) {
+                if (!equals && *p == '=') {
+                    equals = p;
+                }
+            }
+            if (equals) {
+                FRAUriSpan keySpan = {key, (size_t)(equals - key)};
+                FRAUriSpan valueSpan = {equals + 1, (size_t)(p - equals - 1)};
+                if (result->parameterCount < FRA_URI_MAX_PARAMETERS) {
+                    FRAUriParameter *parameter = &result->parameters[result->parameterCount++];
+                    parameter->key = keySpan;
+                    parameter->value = valueSpan;
+                } else {
+                    /* Once the table is full, only repeats of kept keys are recorded, so the last value still wins */
+                    FRAUriParameter *parameter = (FRAUriParameter *)FRAUriFindParameter(result, keySpan.bytes, keySpan.length);
+                    if (parameter) {
+                        parameter->value = valueSpan;
+                    }
+                }
+            }
+            if (p < end && *p == '&') {
+                p++;
+            }
+        }
+    }
+    return 0;
+}
+
+const FRAUriParameter *FRAUriFindParameter(const FRAUri *uri, const char *key, size_t keyLength) {
+    for (size_t i = uri->parameterCount; i > 0; i--) {
+        if (FRAUriSpanEquals(uri->parameters[i - 1].key, key, keyLength)) {
+            return &uri->parameters[i - 1];
+        }
+    }
+    return NULL;
+}
+
+int FRAUriSpanEquals(FRAUriSpan span, const char *bytes, size_t length) {
+    return span.length == length && (length == 0 || memcmp(span.bytes, bytes, length) == 0);
+}
+
+int FRAUriSpanNeedsDecoding(FRAUriSpan span) {
+    return span.length > 0 && memchr(span.bytes, '%', span.length) != NULL;
+}
+
+size_t FRAUriPercentDecode(FRAUriSpan span, char *result) {
+    const char *p = span.bytes;
+    const char *end = span.bytes + span.length;
+    char *out = result;
+    while (p < end) {
+        if (isEscape(p, end)) {
+            *out++ = (char)((FRAHexValues[(unsigned char)p[1]] << 4) | FRAHexValues[(unsigned char)p[2]]);
+            p += 3;
+        } else {
+            *out++ = *p++;
+        }
+    }
+    return (size_t)(out - result);
+}
+
+int FRAUriIsHexColor(const char *color, size_t length) {
+    if (length != 6) {
+        return 0;
+    }
+    unsigned char invalid = 0;
+    for (size_t i = 0; i < 6; i++) {
+        invalid |= FRAHexValues[(unsigned char)color[i]] & 0xF0;
+    }
+    return invalid == 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/***********************************************************************
+ * Single pass parser for otpauth:// and pushauth:// mechanism URIs.
+ *
+ * The parser never allocates and never copies: the scheme, type,
+ * issuer, label and every query parameter are returned as spans over
+ * the original buffer, which must outlive the parsed FRAUri. Values are
+ * percent-decoded only when asked for with FRAUriPercentDecode.
+ *
+ *   scheme://type/[issuer:]label?key=value&key=value
+ *
+ * The issuer and label are separated by a literal or percent-encoded
+ * colon, as described by the Key URI format.
+ ***********************************************************************/
+
+#ifndef _FRA_URI_PARSER_H_
+#define _FRA_URI_PARSER_H_
+#include <stddef.h>
+
+/* Maximum number of distinct query parameters kept by FRAUriParse. */
+#define FRA_URI_MAX_PARAMETERS 32
+
+typedef struct {
+    const char *bytes;
+    size_t length;
+} FRAUriSpan;
+
+typedef struct {
+    FRAUriSpan key;
+    FRAUriSpan value;
+} FRAUriParameter;
+
+typedef struct {
+    FRAUriSpan scheme;
+    FRAUriSpan type;
+    /* Empty if the path has no issuer prefix. */
+    FRAUriSpan issuer;
+    FRAUriSpan label;
+    size_t parameterCount;
+    FRAUriParameter parameters[FRA_URI_MAX_PARAMETERS];
+} FRAUri;
+
+/*
+ * Parse a mechanism URI. Query parameters without '=' are skipped, as
+ * are parameters with new keys beyond the first FRA_URI_MAX_PARAMETERS.
+ * Returns 0 on success, -1 if the URI has no scheme, no type or an
+ * empty path.
+ */
+int FRAUriParse(const char *uri, size_t length, FRAUri *result);
+
+/*
+ * Find a query parameter by its (undecoded) key. When a key is repeated
+ * the last occurrence wins. Returns NULL if the key is absent.
+ */
+const FRAUriParameter *FRAUriFindParameter(const FRAUri *uri, const char *key, size_t keyLength);
+
+/* Returns 1 if the span holds exactly the given bytes, 0 otherwise. */
+int FRAUriSpanEquals(FRAUriSpan span, const char *bytes, size_t length);
+
+/* Returns 1 if the span contains a percent escape, 0 otherwise. */
+int FRAUriSpanNeedsDecoding(FRAUriSpan span);
+
+/*
+ * Percent-decode a span into result, which must hold span.length bytes.
+ * Malformed escapes are copied as they are. Returns the decoded length.
+ */
+size_t FRAUriPercentDecode(FRAUriSpan span, char *result);
+
+/* Returns 1 if the bytes are a six digit hexadecimal colour, 0 otherwise. */
+int FRAUriIsHexColor(const char *color, size_t length);
+
+#endif /* _FRA_URI_PARSER_H_ */
@@ -0,0 +1 @@
+PRAGMA auto_vacuum;
\ No newline at end of file
@@ -0,0 +1,325 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/*************************************************************************
+ * Base64 encode and decode functions.
+ *
+ * Decoding:
+ * Blocks of 16 characters are validated and translated to sextets with
+ * compiler vector extensions, which compile to NEON on devices and SSE
+ * on the simulator. The remaining characters go through a lookup table.
+ *
+ * Return/Error:
+ * All functions return the number of output bytes or -1 on error.
+ *
+ * Buffer:
+ * If the output buffer is too small, -1 is returned and nothing is
+ * guaranteed about its contents.
+ *************************************************************************/
+
+
+#include <string.h>
+#include "base64.h"
+
+static const char base64_standard_digits[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url_digits[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/*
+ * Sextet of each character; characters outside the alphabet have their high bit set.
+ * Written out in full, as range designators are a GNU extension.
+ */
+static const uint8_t base64_standard_values[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint8_t base64_url_values[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x3F,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint8_t base64_url_or_standard_values[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x3E, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x3F,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BASE64_VECTORS 1
+
+typedef uint8_t base64_u8x16 __attribute__((vector_size(16)));
+typedef uint32_t base64_u32x4 __attribute__((vector_size(16)));
+
+#define U8X16(x) ((base64_u8x16){x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x})
+#define U32X4(x) ((base64_u32x4){x, x, x, x})
+#define IN_RANGE(c, low, high) ((base64_u8x16)((c) >= U8X16(low)) & (base64_u8x16)((c) <= U8X16(high)))
+#define EQUALS(c, x) ((base64_u8x16)((c) == U8X16(x)))
+
+/*************************************************************************
+ * Decode 16 characters into 12 bytes.
+ *
+ * Each character is classified by range and shifted onto its sextet by
+ * adding a per-range offset (modulo 256).
+ *
+ * Return:
+ *   0 if a character is outside the alphabet, 1 otherwise
+ *************************************************************************/
+static int base64_decode_block(const char *encoded, uint8_t *result, int alphabet) {
+    base64_u8x16 c;
+    memcpy(&c, encoded, sizeof(c));
+
+    base64_u8x16 upper = IN_RANGE(c, 'A', 'Z');
+    base64_u8x16 lower = IN_RANGE(c, 'a', 'z');
+    base64_u8x16 digit = IN_RANGE(c, '0', '9');
+    base64_u8x16 valid = upper | lower | digit;
+    base64_u8x16 offset = (upper & U8X16((uint8_t)(0 - 'A')))
+                        | (lower & U8X16((uint8_t)(26 - 'a')))
+                        | (digit & U8X16((uint8_t)(52 - '0')));
+    if (alphabet != BASE64_URL) {
+        base64_u8x16 plus = EQUALS(c, '+');
+        base64_u8x16 slash = EQUALS(c, '/');
+        valid |= plus | slash;
+        offset |= (plus & U8X16((uint8_t)(62 - '+'))) | (slash & U8X16((uint8_t)(63 - '/')));
+    }
+    if (alphabet != BASE64_STANDARD) {
+        base64_u8x16 minus = EQUALS(c, '-');
+        base64_u8x16 underscore = EQUALS(c, '_');
+        valid |= minus | underscore;
+        offset |= (minus & U8X16((uint8_t)(62 - '-'))) | (underscore & U8X16((uint8_t)(63 - '_')));
+    }
+
+    uint64_t lanes[2];
+    memcpy(lanes, &valid, sizeof(lanes));
+    if ((lanes[0] & lanes[1]) != UINT64_MAX) {
+        return 0;
+    }
+
+    // Little endian lanes hold the four sextets of a quantum as d:c:b:a
+    base64_u32x4 quantum = (base64_u32x4)(c + offset);
+    base64_u32x4 packed = ((quantum & U32X4(0xFF)) << 18)
+                        | (((quantum >> 8) & U32X4(0xFF)) << 12)
+                        | (((quantum >> 16) & U32X4(0xFF)) << 6)
+                        | (quantum >> 24);
+    uint32_t words[4];
+    memcpy(words, &packed, sizeof(words));
+    for (int i = 0; i < 4; i++) {
+        result[3 * i + 0] = (uint8_t)(words[i] >> 16);
+        result[3 * i + 1] = (uint8_t)(words[i] >> 8);
+        result[3 * i + 2] = (uint8_t)words[i];
+    }
+    return 1;
+}
+#endif
+
+/*************************************************************************
+ * The largest number of bytes the given number of characters decode to.
+ *************************************************************************/
+int base64_decoded_size(int length) {
+    return length < 0 ? -1 : length / 4 * 3 + 2;
+}
+
+/*************************************************************************
+ * The number of characters the given number of bytes encode to,
+ * excluding the null terminator written by base64_encode.
+ *************************************************************************/
+int base64_encoded_size(int length, int alphabet) {
+    if (length < 0 || (alphabet != BASE64_STANDARD && alphabet != BASE64_URL)) {
+        return -1;
+    }
+    if (alphabet == BASE64_URL) {
+        return length / 3 * 4 + (length % 3 ? length % 3 + 1 : 0);
+    }
+    return (length + 2) / 3 * 4;
+}
+
+/*************************************************************************
+ * Decode a base64 or base64url encoded string into the provided buffer.
+ *
+ * Trailing padding is optional, but must not extend past the last
+ * quantum. White-space and any other characters are invalid.
+ *
+ * Parameters:
+ *   encoded - The encoded characters, need not be null terminated
+ *   length - The number of encoded characters
+ *   result - An initialised buffer to contain the decoded result
+ *   bufSize - The size of the initialised buffer
+ *   alphabet - BASE64_STANDARD, BASE64_URL or BASE64_URL_OR_STANDARD
+ *
+ * Return:
+ *   The length of the decoded data, or -1 on error
+ *************************************************************************/
+int base64_decode(const char *encoded, int length, uint8_t *result, int bufSize, int alphabet) {
+    if (length < 0) {
+        return -1;
+    }
+    int padding = 0;
+    while (length > 0 && encoded[length - 1] == '=') {
+        length--;
+        padding++;
+    }
+    if (length % 4 == 1 || padding > (4 - length % 4) % 4) {
+        return -1;
+    }
+    int tail = length % 4;
+    int count = length / 4 * 3 + (tail ? tail - 1 : 0);
+    if (count > bufSize) {
+        return -1;
+    }
+
+    const uint8_t *values;
+    switch (alphabet) {
+        case BASE64_STANDARD:
+            values = base64_standard_values;
+            break;
+        case BASE64_URL:
+            values = base64_url_values;
+            break;
+        case BASE64_URL_OR_STANDARD:
+            values = base64_url_or_standard_values;
+            break;
+        default:
+            return -1;
+    }
+    const char *end = encoded + length;
+    uint8_t invalid = 0;
+#ifdef BASE64_VECTORS
+    while (end - encoded >= 16) {
+        if (!base64_decode_block(encoded, result, alphabet)) {
+            return -1;
+        }
+        encoded += 16;
+        result += 12;
+    }
+#endif
+    // Invalid characters are accumulated rather than checked per quantum
+    while (end - encoded >= 4) {
+        uint8_t a = values[(uint8_t)encoded[0]];
+        uint8_t b = values[(uint8_t)encoded[1]];
+        uint8_t c = values[(uint8_t)encoded[2]];
+        uint8_t d = values[(uint8_t)encoded[3]];
+        invalid |= a | b | c | d;
+        result[0] = (uint8_t)(a << 2 | b >> 4);
+        result[1] = (uint8_t)(b << 4 | c >> 2);
+        result[2] = (uint8_t)(c << 6 | d);
+        encoded += 4;
+        result += 3;
+    }
+    if (tail >= 2) {
+        uint8_t a = values[(uint8_t)encoded[0]];
+        uint8_t b = values[(uint8_t)encoded[1]];
+        invalid |= a | b;
+        result[0] = (uint8_t)(a << 2 | b >> 4);
+        if (tail == 3) {
+            uint8_t c = values[(uint8_t)encoded[2]];
+            invalid |= c;
+            result[1] = (uint8_t)(b << 4 | c >> 2);
+        }
+    }
+    return (invalid & 0x80) ? -1 : count;
+}
+
+/*************************************************************************
+ * Encode data as base64 or base64url into the provided buffer.
+ *
+ * The standard alphabet is padded, base64url is not. The result is null
+ * terminated if there is room for the terminator.
+ *
+ * Parameters:
+ *   data - The data to encode
+ *   length - The number of bytes to encode
+ *   result - An initialised buffer to contain the encoded result
+ *   bufSize - The size of the initialised buffer
+ *   alphabet - BASE64_STANDARD or BASE64_URL
+ *
+ * Return:
+ *   The number of characters written, excluding the null terminator,
+ *   or -1 on error
+ *************************************************************************/
+int base64_encode(const uint8_t *data, int length, char *result, int bufSize, int alphabet) {
+    int count = base64_encoded_size(length, alphabet);
+    if (count < 0 || count > bufSize) {
+        return -1;
+    }
+    const char *digits = alphabet == BASE64_URL ? base64_url_digits : base64_standard_digits;
+    char *out = result;
+    int i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t quantum = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+        out[0] = digits[quantum >> 18];
+        out[1] = digits[(quantum >> 12) & 0x3F];
+        out[2] = digits[(quantum >> 6) & 0x3F];
+        out[3] = digits[quantum & 0x3F];
+        out += 4;
+    }
+    if (i < length) {
+        uint32_t quantum = (uint32_t)data[i] << 16 | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0);
+        *out++ = digits[quantum >> 18];
+        *out++ = digits[(quantum >> 12) & 0x3F];
+        if (i + 1 < length) {
+            *out++ = digits[(quantum >> 6) & 0x3F];
+        } else if (alphabet != BASE64_URL) {
+            *out++ = '=';
+        }
+        if (alphabet != BASE64_URL) {
+            *out++ = '=';
+        }
+    }
+    if (count < bufSize) {
+        *out = '\0';
+    }
+    return count;
+}
@@ -0,0 +1,44 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+/***********************************************************************
+ * Encode and decode Base64 and Base64url based on the RFC 4648
+ * (http://tools.ietf.org/html/rfc4648)
+ *
+ * Decoding works directly on the encoded bytes: padding is optional and
+ * no intermediate strings are built. Each alphabet accepts only its own
+ * characters, apart from BASE64_URL_OR_STANDARD which accepts both.
+ ***********************************************************************/
+
+#ifndef _BASE64_H_
+#define _BASE64_H_
+#include <stdint.h>
+
+/* Standard alphabet, "+/", padded when encoding. */
+#define BASE64_STANDARD 0
+/* URL and filename safe alphabet, "-_", unpadded when encoding. */
+#define BASE64_URL 1
+/* Either of the above when decoding, for producers which mix them. Cannot be used to encode. */
+#define BASE64_URL_OR_STANDARD 2
+
+int base64_decoded_size(int length);
+
+int base64_encoded_size(int length, int alphabet);
+
+int base64_decode(const char *encoded, int length, uint8_t *result, int bufSize, int alphabet);
+
+int base64_encode(const uint8_t *data, int length, char *result, int bufSize, int alphabet);
+#endif /* _BASE64_H_ */
@@ -0,0 +1,9 @@
+CREATE TABLE IF NOT EXISTS response_outbox (
+messageId           TEXT PRIMARY KEY,
+endpoint            TEXT,
+loadBalancerCookie  TEXT,
+payload             TEXT,
+timeQueued          REAL,
+timeExpired         REAL,
+attempts            INTEGER,
+nextAttempt         REAL);
\ No newline at end of file
@@ -0,0 +1 @@
+DELETE FROM response_outbox WHERE messageId = ?;
\ No newline at end of file
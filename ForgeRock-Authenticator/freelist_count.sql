@@ -0,0 +1 @@
+PRAGMA freelist_count;
\ No newline at end of file
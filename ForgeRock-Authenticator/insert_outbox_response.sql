@@ -0,0 +1 @@
+INSERT OR REPLACE INTO response_outbox (messageId, endpoint, loadBalancerCookie, payload, timeQueued, timeExpired, attempts, nextAttempt) VALUES (?, ?, ?, ?, ?, ?, ?, ?);
\ No newline at end of file
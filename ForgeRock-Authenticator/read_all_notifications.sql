@@ -0,0 +1,8 @@
+SELECT
+    n.mechanismUID,
+    n.timeReceived,
+    n.timeExpired,
+    n.data,
+    n.pending,
+    n.approved
+FROM notification n;
\ No newline at end of file
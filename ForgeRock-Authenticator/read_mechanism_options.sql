@@ -0,0 +1,6 @@
+SELECT
+    m.idIssuer,
+    m.idAccountName,
+    m.options
+FROM mechanism m
+WHERE m.type = ?;
\ No newline at end of file
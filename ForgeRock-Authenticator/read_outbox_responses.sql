@@ -0,0 +1,10 @@
+SELECT
+    o.messageId,
+    o.endpoint,
+    o.loadBalancerCookie,
+    o.payload,
+    o.timeExpired,
+    o.attempts,
+    o.nextAttempt
+FROM response_outbox o
+ORDER BY o.endpoint, o.timeQueued;
\ No newline at end of file
@@ -1,3 +1,5 @@
+PRAGMA auto_vacuum = INCREMENTAL;
+
 CREATE TABLE identity (
 issuer         TEXT,
 accountName    TEXT,
@@ -0,0 +1 @@
+UPDATE response_outbox SET attempts = ?, nextAttempt = ? WHERE messageId = ?;
\ No newline at end of file
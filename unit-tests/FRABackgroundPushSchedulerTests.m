@@ -0,0 +1,183 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+#import "FRABackgroundPushScheduler.h"
+#import "FRANotificationHandler.h"
+
+/*! Index of the completion block of application:didReceiveRemoteNotification:completion:. */
+static NSInteger const INGESTION_COMPLETION_PARAMETER_INDEX = 4;
+static NSTimeInterval const TEST_TIMEOUT = 10.0;
+
+@interface FRABackgroundPushSchedulerTests : XCTestCase
+
+@end
+
+@implementation FRABackgroundPushSchedulerTests {
+    id mockHandler;
+    id mockApplication;
+    NSString *path;
+    FRABackgroundPushScheduler *scheduler;
+    NSDictionary *message;
+}
+
+- (void)setUp {
+    [super setUp];
+    mockHandler = OCMClassMock([FRANotificationHandler class]);
+    mockApplication = OCMClassMock([UIApplication class]);
+    path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    scheduler = [[FRABackgroundPushScheduler alloc] initWithHandler:mockHandler path:path];
+    // a simulated budget, so that the deadline arrives in a fraction of a second
+    scheduler.budget = 0.3;
+    scheduler.safetyMargin = 0.1;
+    message = @{@"aps":@{@"messageId":@"123", @"data":@"jwt"}};
+}
+
+- (void)tearDown {
+    [scheduler flush];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [mockHandler stopMocking];
+    [mockApplication stopMocking];
+    [super tearDown];
+}
+
+- (void)handlerCompletesWithCreated:(BOOL)created {
+    OCMStub([mockHandler application:[OCMArg any] didReceiveRemoteNotification:[OCMArg any] completion:[OCMArg any]])
+    .andDo(^(NSInvocation *invocation) {
+        void (^completion)(FRANotification *, BOOL);
+        [invocation getArgument:&completion atIndex:INGESTION_COMPLETION_PARAMETER_INDEX];
+        completion(nil, created);
+    });
+}
+
+- (UIBackgroundFetchResult)processMessage {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch completion"];
+    __block UIBackgroundFetchResult fetchResult;
+    [scheduler application:mockApplication processRemoteNotification:message completionHandler:^(UIBackgroundFetchResult result) {
+        fetchResult = result;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    return fetchResult;
+}
+
+- (void)testReportsNewDataWhenNotificationCreated {
+    // Given
+    [self handlerCompletesWithCreated:YES];
+    
+    // When
+    UIBackgroundFetchResult result = [self processMessage];
+    
+    // Then
+    XCTAssertEqual(result, UIBackgroundFetchResultNewData);
+    XCTAssertEqual([scheduler deferredWork].count, 0);
+}
+
+- (void)testReportsNoDataWhenNothingCreated {
+    // Given
+    [self handlerCompletesWithCreated:NO];
+    
+    // When
+    UIBackgroundFetchResult result = [self processMessage];
+    
+    // Then
+    XCTAssertEqual(result, UIBackgroundFetchResultNoData);
+}
+
+- (void)testReportsFailureAndDefersWorkWhenBudgetRunsOut {
+    // Given
+    OCMStub([mockHandler application:[OCMArg any] didReceiveRemoteNotification:[OCMArg any] completion:[OCMArg any]]);
+    
+    // When
+    UIBackgroundFetchResult result = [self processMessage];
+    [scheduler flush];
+    
+    // Then
+    XCTAssertEqual(result, UIBackgroundFetchResultFailed);
+    XCTAssertEqualObjects([scheduler deferredWork], @[message]);
+    FRABackgroundPushScheduler *nextLaunch = [[FRABackgroundPushScheduler alloc] initWithHandler:mockHandler path:path];
+    XCTAssertEqualObjects([nextLaunch deferredWork], @[message], @"Deferred work should survive a relaunch");
+}
+
+- (void)testCallsCompletionHandlerOnceWhenWorkFinishesAfterDeadline {
+    // Given
+    __block void (^ingestionCompletion)(FRANotification *, BOOL);
+    OCMStub([mockHandler application:[OCMArg any] didReceiveRemoteNotification:[OCMArg any] completion:[OCMArg any]])
+    .andDo(^(NSInvocation *invocation) {
+        void (^completion)(FRANotification *, BOOL);
+        [invocation getArgument:&completion atIndex:INGESTION_COMPLETION_PARAMETER_INDEX];
+        ingestionCompletion = [completion copy];
+    });
+    __block NSUInteger calls = 0;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch completion"];
+    
+    // When
+    [scheduler application:mockApplication processRemoteNotification:message completionHandler:^(UIBackgroundFetchResult result) {
+        calls++;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    ingestionCompletion(nil, YES);
+    
+    // Then
+    XCTAssertEqual(calls, 1);
+    XCTAssertEqual([scheduler deferredWork].count, 0, @"Work finished late should no longer be pending");
+}
+
+- (void)testResumesDeferredWorkOnNextLaunch {
+    // Given
+    OCMStub([mockHandler application:[OCMArg any] didReceiveRemoteNotification:[OCMArg any] completion:[OCMArg any]]);
+    [self processMessage];
+    [scheduler flush];
+    [mockHandler stopMocking];
+    mockHandler = OCMClassMock([FRANotificationHandler class]);
+    [self handlerCompletesWithCreated:YES];
+    FRABackgroundPushScheduler *nextLaunch = [[FRABackgroundPushScheduler alloc] initWithHandler:mockHandler path:path];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"resume"];
+    __block NSUInteger resumedCount = 0;
+    
+    // When
+    [nextLaunch resumeDeferredWorkWithApplication:mockApplication completion:^(NSUInteger resumed) {
+        resumedCount = resumed;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    [nextLaunch flush];
+    
+    // Then
+    XCTAssertEqual(resumedCount, 1);
+    OCMVerify([mockHandler application:mockApplication didReceiveRemoteNotification:message completion:[OCMArg any]]);
+    XCTAssertEqual([nextLaunch deferredWork].count, 0);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:path]);
+}
+
+- (void)testResumeWithoutDeferredWorkCompletesImmediately {
+    // Given
+    __block BOOL completed = NO;
+    OCMReject([mockHandler application:[OCMArg any] didReceiveRemoteNotification:[OCMArg any] completion:[OCMArg any]]);
+    
+    // When
+    [scheduler resumeDeferredWorkWithApplication:mockApplication completion:^(NSUInteger resumed) {
+        completed = resumed == 0;
+    }];
+    
+    // Then
+    XCTAssertTrue(completed);
+}
+
+@end
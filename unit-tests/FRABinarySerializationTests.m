@@ -0,0 +1,227 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRABinarySerialization.h"
+#import "FRASerialization.h"
+
+/*! Number of notification maps encoded and decoded by each benchmark iteration. */
+static const NSUInteger FRABenchmarkMapCount = 10000;
+
+@interface FRABinarySerializationTests : XCTestCase
+
+@end
+
+@implementation FRABinarySerializationTests {
+    NSDictionary *notificationData;
+    NSDictionary *legacyNotificationData;
+}
+
+- (void)setUp {
+    [super setUp];
+    notificationData = @{ NOTIFICATION_MESSAGE_ID : @"AUTHENTICATE:64e909a2-3d9e-4b4e-a7a4-7f2c0d1d7c5b1465470183138",
+                          NOTIFICATION_PUSH_CHALLENGE : @"fZl8wu9JBxdRQ7miq3dE0fbF0Bcdd+gRETUbtl6qSuM=",
+                          NOTIFICATION_TIME_TO_LIVE : @120.0,
+                          NOTIFICATION_LOAD_BALANCER_COOKIE : @"ZnJfc3NvX2FtbGJfcHJvZD0wMQ==" };
+    legacyNotificationData = @{ NOTIFICATION_MESSAGE_ID : notificationData[NOTIFICATION_MESSAGE_ID],
+                                NOTIFICATION_PUSH_CHALLENGE : notificationData[NOTIFICATION_PUSH_CHALLENGE],
+                                NOTIFICATION_TIME_TO_LIVE : @"120.000000",
+                                NOTIFICATION_LOAD_BALANCER_COOKIE : notificationData[NOTIFICATION_LOAD_BALANCER_COOKIE] };
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)testNotificationDataSurvivesRoundTrip {
+    // Given
+    NSData *encoded = [FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil];
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:encoded error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(result, notificationData);
+}
+
+- (void)testOathOptionsKeepRawSecretAndNumbers {
+    // Given
+    uint8_t secretBytes[] = {0x00, 0x01, 0xFE, 0xFF};
+    NSDictionary *options = @{ OATH_MECHANISM_SECRET : [NSData dataWithBytes:secretBytes length:sizeof(secretBytes)],
+                               OATH_MECHANISM_ALGORITHM : @2,
+                               OATH_MECHANISM_DIGITS : @6,
+                               OATH_MECHANISM_COUNTER : @(UINT64_MAX) };
+    NSData *encoded = [FRABinarySerialization encodeMap:options schema:FRABinarySchemaHotpOptions error:nil];
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:encoded error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(result, options);
+    XCTAssertEqual([result[OATH_MECHANISM_COUNTER] unsignedLongLongValue], UINT64_MAX);
+}
+
+- (void)testEncodingIsSmallerThanJSON {
+    // Given
+    NSString *json;
+    [FRASerialization serializeMap:legacyNotificationData intoString:&json error:nil];
+    
+    // When
+    NSData *encoded = [FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil];
+    
+    // Then
+    XCTAssertLessThan(encoded.length, [json lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+}
+
+- (void)testNullValuesAreOmitted {
+    // Given
+    NSDictionary *options = @{ PUSH_MECHANISM_SECRET : [NSNull null], PUSH_MECHANISM_VERSION : @1 };
+    NSData *encoded = [FRABinarySerialization encodeMap:options schema:FRABinarySchemaPushOptions error:nil];
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:encoded error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(result, @{ PUSH_MECHANISM_VERSION : @1 });
+}
+
+- (void)testKeyOutsideSchemaIsRejected {
+    // Given
+    NSDictionary *options = @{ OATH_MECHANISM_PERIOD : @30 };
+    NSError *error;
+    
+    // When
+    NSData *encoded = [FRABinarySerialization encodeMap:options schema:FRABinarySchemaHotpOptions error:&error];
+    
+    // Then
+    XCTAssertNil(encoded);
+    XCTAssertNotNil(error);
+}
+
+- (void)testValueOfWrongTypeIsRejected {
+    // Given
+    NSDictionary *options = @{ OATH_MECHANISM_DIGITS : @"6" };
+    NSError *error;
+    
+    // When
+    NSData *encoded = [FRABinarySerialization encodeMap:options schema:FRABinarySchemaTotpOptions error:&error];
+    
+    // Then
+    XCTAssertNil(encoded);
+    XCTAssertNotNil(error);
+}
+
+- (void)testTruncatedDataIsRejected {
+    // Given
+    NSData *encoded = [FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil];
+    NSError *error;
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:[encoded subdataWithRange:NSMakeRange(0, encoded.length - 1)] error:&error];
+    
+    // Then
+    XCTAssertNil(result);
+    XCTAssertNotNil(error);
+}
+
+- (void)testNewerVersionIsRejected {
+    // Given
+    NSMutableData *encoded = [[FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil] mutableCopy];
+    ((uint8_t *)encoded.mutableBytes)[1] = 2;
+    NSError *error;
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:encoded error:&error];
+    
+    // Then
+    XCTAssertNil(result);
+    XCTAssertNotNil(error);
+}
+
+- (void)testUnknownTagsAreSkipped {
+    // Given - a version 1 encoding with a varint field 9 and a string field 10 from a later schema revision
+    NSMutableData *encoded = [[FRABinarySerialization encodeMap:@{ PUSH_MECHANISM_VERSION : @1 } schema:FRABinarySchemaPushOptions error:nil] mutableCopy];
+    uint8_t unknownFields[] = {9 << 3 | 0, 0x96, 0x01, 10 << 3 | 3, 2, 'h', 'i'};
+    [encoded appendBytes:unknownFields length:sizeof(unknownFields)];
+    
+    // When
+    NSDictionary *result = [FRABinarySerialization decodeData:encoded error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(result, @{ PUSH_MECHANISM_VERSION : @1 });
+}
+
+- (void)testLegacyJSONIsReadTransparently {
+    // Given
+    NSString *json;
+    [FRASerialization serializeMap:legacyNotificationData intoString:&json error:nil];
+    NSData *column = [json dataUsingEncoding:NSUTF8StringEncoding];
+    
+    // When
+    NSDictionary *result;
+    BOOL success = [FRASerialization deserializeData:column intoDictionary:&result error:nil];
+    
+    // Then
+    XCTAssertTrue(success);
+    XCTAssertFalse([FRABinarySerialization isBinaryEncoded:column]);
+    XCTAssertEqualObjects(result, legacyNotificationData);
+    XCTAssertEqual([[FRASerialization numberFromValue:result[NOTIFICATION_TIME_TO_LIVE]] doubleValue], 120.0);
+}
+
+- (void)testBinaryIsReadTransparently {
+    // Given
+    NSData *column = [FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil];
+    
+    // When
+    NSDictionary *result;
+    BOOL success = [FRASerialization deserializeData:column intoDictionary:&result error:nil];
+    
+    // Then
+    XCTAssertTrue(success);
+    XCTAssertTrue([FRABinarySerialization isBinaryEncoded:column]);
+    XCTAssertEqualObjects(result, notificationData);
+}
+
+#pragma mark --
+#pragma mark Throughput
+
+- (void)testBinaryEncodeDecodeThroughput {
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < FRABenchmarkMapCount; i++) {
+            @autoreleasepool {
+                NSData *encoded = [FRABinarySerialization encodeMap:notificationData schema:FRABinarySchemaNotificationData error:nil];
+                NSDictionary *result;
+                [FRASerialization deserializeData:encoded intoDictionary:&result error:nil];
+            }
+        }
+    }];
+}
+
+- (void)testJSONEncodeDecodeThroughput {
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < FRABenchmarkMapCount; i++) {
+            @autoreleasepool {
+                NSString *json;
+                [FRASerialization serializeMap:legacyNotificationData intoString:&json error:nil];
+                NSDictionary *result;
+                [FRASerialization deserializeJSON:json intoDictionary:&result error:nil];
+            }
+        }
+    }];
+}
+
+@end
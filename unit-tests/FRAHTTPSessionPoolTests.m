@@ -0,0 +1,167 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAHTTPSessionPool.h"
+#import "FRAInFlightRequestTable.h"
+#import "FRAMessageUtils.h"
+#import "FRAMockURLProtocol.h"
+
+static NSTimeInterval const testTimeout = 10.0;
+
+@interface FRAHTTPSessionPoolTests : XCTestCase
+
+@end
+
+@implementation FRAHTTPSessionPoolTests {
+    FRAHTTPSessionPool *pool;
+}
+
+- (void)setUp {
+    [super setUp];
+    pool = [[FRAHTTPSessionPool alloc] init];
+    [[FRAInFlightRequestTable sharedTable] removeAllResults];
+}
+
+- (void)tearDown {
+    [pool drain];
+    [super tearDown];
+}
+
+- (void)testShouldReuseSessionForSameOrigin {
+    // Given
+    AFHTTPSessionManager *first = [pool sessionManagerForURL:[NSURL URLWithString:@"https://openam.example.com/openam/json/push/sns/message?_action=register"] protocol:nil];
+    
+    // When
+    AFHTTPSessionManager *second = [pool sessionManagerForURL:[NSURL URLWithString:@"https://OpenAM.example.com/openam/json/push/sns/message?_action=authenticate"] protocol:nil];
+    
+    // Then
+    XCTAssertEqual(first, second);
+    XCTAssertEqual(pool.sessionCount, 1);
+    XCTAssertEqual(pool.requestCount, 2);
+    XCTAssertEqual(pool.reuseCount, 1);
+    XCTAssertEqualWithAccuracy([pool reuseRate], 0.5, 0.001);
+}
+
+- (void)testShouldUseSeparateSessionsForDifferentOrigins {
+    // Given
+    AFHTTPSessionManager *first = [pool sessionManagerForURL:[NSURL URLWithString:@"https://openam.example.com/openam"] protocol:nil];
+    
+    // When
+    AFHTTPSessionManager *otherHost = [pool sessionManagerForURL:[NSURL URLWithString:@"https://am.example.com/openam"] protocol:nil];
+    AFHTTPSessionManager *otherPort = [pool sessionManagerForURL:[NSURL URLWithString:@"https://openam.example.com:8443/openam"] protocol:nil];
+    AFHTTPSessionManager *otherScheme = [pool sessionManagerForURL:[NSURL URLWithString:@"http://openam.example.com/openam"] protocol:nil];
+    
+    // Then
+    XCTAssertNotEqual(first, otherHost);
+    XCTAssertNotEqual(first, otherPort);
+    XCTAssertNotEqual(first, otherScheme);
+    XCTAssertEqual(pool.sessionCount, 4);
+    XCTAssertEqual(pool.reuseCount, 0);
+}
+
+- (void)testShouldRegisterCustomProtocolWithSession {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"http://any.website.com"];
+    
+    // When
+    AFHTTPSessionManager *plain = [pool sessionManagerForURL:url protocol:nil];
+    AFHTTPSessionManager *mocked = [pool sessionManagerForURL:url protocol:[FRAMockURLProtocol class]];
+    
+    // Then
+    XCTAssertNotEqual(plain, mocked);
+    XCTAssertEqualObjects(mocked.session.configuration.protocolClasses.firstObject, [FRAMockURLProtocol class]);
+}
+
+- (void)testShouldDrainOnMemoryWarning {
+    // Given
+    [pool sessionManagerForURL:[NSURL URLWithString:@"https://openam.example.com/openam"] protocol:nil];
+    
+    // When
+    [[NSNotificationCenter defaultCenter] postNotificationName:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    
+    // Then
+    XCTAssertEqual(pool.sessionCount, 0);
+}
+
+- (void)testShouldNotInvalidateLeasedSessionUntilReleased {
+    // Given
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"https://openam.example.com/openam"]];
+    AFHTTPSessionManager *manager = [pool sessionManagerForURL:request.URL protocol:nil];
+    
+    // When
+    [pool drain];
+    
+    // Then
+    XCTAssertEqual(pool.sessionCount, 0);
+    XCTAssertNoThrow([[manager dataTaskWithRequest:request completionHandler:nil] cancel]);
+    [pool releaseSessionManager:manager];
+    XCTAssertThrows([manager dataTaskWithRequest:request completionHandler:nil]);
+}
+
+- (void)testMessageUtilsShouldReuseSharedSessionAcrossResponses {
+    // Given
+    FRAHTTPSessionPool *sharedPool = [FRAHTTPSessionPool sharedPool];
+    NSUInteger reused = sharedPool.reuseCount;
+    
+    // When
+    for (int i = 0; i < 3; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+        [FRAMessageUtils respondWithEndpoint:@"http://pooled.website.com/openam"
+                                base64Secret:@"c2VjcmV0"
+                                   messageId:[NSString stringWithFormat:@"message id %d", i]
+                      loadBalancerCookieData:@"amlbcookie=03"
+                                        data:@{@"some":@"data"}
+                                    protocol:[FRAMockURLProtocol class]
+                                     handler:^(NSInteger statusCode, NSError *error) {
+                                         [expectation fulfill];
+                                     }];
+        [self waitForExpectationsWithTimeout:testTimeout handler:nil];
+    }
+    
+    // Then
+    XCTAssertGreaterThanOrEqual(sharedPool.reuseCount - reused, 2);
+}
+
+- (void)testPerformanceOfResponsesThroughPool {
+    FRAHTTPSessionPool *sharedPool = [FRAHTTPSessionPool sharedPool];
+    NSUInteger requested = sharedPool.requestCount;
+    NSUInteger reused = sharedPool.reuseCount;
+    
+    [self measureBlock:^{
+        for (int i = 0; i < 20; i++) {
+            XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+            [FRAMessageUtils respondWithEndpoint:@"http://pooled.website.com/openam"
+                                    base64Secret:@"c2VjcmV0"
+                                       messageId:[[NSUUID UUID] UUIDString]
+                          loadBalancerCookieData:@"amlbcookie=03"
+                                            data:@{@"some":@"data"}
+                                        protocol:[FRAMockURLProtocol class]
+                                         handler:^(NSInteger statusCode, NSError *error) {
+                                             [expectation fulfill];
+                                         }];
+            [self waitForExpectationsWithTimeout:testTimeout handler:nil];
+        }
+    }];
+    
+    // Only the first response to the origin should need a new session
+    NSUInteger requestedHere = sharedPool.requestCount - requested;
+    XCTAssertGreaterThan(requestedHere, 0);
+    XCTAssertGreaterThanOrEqual((double)(sharedPool.reuseCount - reused) / requestedHere, 0.9);
+}
+
+@end
@@ -258,4 +258,39 @@
     // Then
     XCTAssertFalse([identityModel isEmpty]);}
 
+- (void)testIdentitiesSnapshotIsSharedUntilModelChanges {
+    // Given
+    OCMStub([mockSqlOperations insertIdentity:[OCMArg any] error:nil]).andReturn(YES);
+    [identityModel addIdentity:aliceIdentity error:nil];
+    NSArray *snapshot = [identityModel identities];
+    NSUInteger revision = [identityModel revision];
+
+    // When
+    [identityModel addIdentity:bobIdentity error:nil];
+
+    // Then
+    XCTAssertEqualObjects(snapshot, @[aliceIdentity], @"Previously returned snapshot should not change");
+    XCTAssertEqual([identityModel identities], [identityModel identities], @"Unchanged model should return the same snapshot");
+    XCTAssertEqual([identityModel revision], revision + 1);
+}
+
+- (void)testPendingNotificationsCountReflectsChangesToNotifications {
+    // Given
+    OCMStub([mockSqlOperations insertIdentity:aliceIdentity error:nil]).andReturn(YES);
+    [identityModel addIdentity:aliceIdentity error:nil];
+    FRAPushMechanism *mechanism = [[FRAPushMechanism alloc] initWithDatabase:database identityModel:identityModel];
+    OCMStub([mockSqlOperations insertMechanism:mechanism error:nil]).andReturn(YES);
+    [aliceIdentity addMechanism:mechanism error:nil];
+    FRANotification *notification = [[FRANotification alloc] initWithDatabase:database identityModel:identityModel messageId:@"messageId" challenge:@"challenge" timeReceived:[NSDate date] timeToLive:120.0 loadBalancerCookieData:@"amlbcookie=03"];
+    OCMStub([mockSqlOperations insertNotification:notification error:nil]).andReturn(YES);
+    XCTAssertEqual([identityModel pendingNotificationsCount], 0);
+
+    // When
+    [mechanism addNotification:notification error:nil];
+
+    // Then
+    XCTAssertEqual([identityModel pendingNotificationsCount], 1);
+    XCTAssertEqual([aliceIdentity pendingNotificationsCount], 1);
+}
+
 @end
@@ -0,0 +1,157 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "FRAIdentity.h"
+#import "FRAIdentitySearchIndex.h"
+
+@interface FRAIdentitySearchIndexTests : XCTestCase
+
+@end
+
+@implementation FRAIdentitySearchIndexTests {
+    FRAIdentitySearchIndex *index;
+    FRAIdentity *aliceAtForgeRock;
+    FRAIdentity *bobAtForgeRock;
+    FRAIdentity *aliceAtZurich;
+}
+
+- (void)setUp {
+    [super setUp];
+    index = [[FRAIdentitySearchIndex alloc] init];
+    aliceAtForgeRock = [self identityWithIssuer:@"ForgeRock" accountName:@"alice@example.com"];
+    bobAtForgeRock = [self identityWithIssuer:@"ForgeRock" accountName:@"Bob"];
+    aliceAtZurich = [self identityWithIssuer:@"Zürich Bank" accountName:@"Alice"];
+    [index addIdentity:aliceAtForgeRock];
+    [index addIdentity:bobAtForgeRock];
+    [index addIdentity:aliceAtZurich];
+}
+
+- (void)testEmptyQueryMatchesAllIdentities {
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"  "];
+    
+    // Then
+    XCTAssertEqual(results.count, 3);
+}
+
+- (void)testShortQueryMatchesAnywhereIgnoringCase {
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"b"];
+    
+    // Then
+    NSSet *expected = [NSSet setWithObjects:bobAtForgeRock, aliceAtZurich, nil];
+    XCTAssertEqualObjects(results, expected);
+}
+
+- (void)testLongQueryMatchesAnywhereIgnoringCaseAndDiacritics {
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"ZURI"];
+    
+    // Then
+    XCTAssertEqualObjects(results, [NSSet setWithObject:aliceAtZurich]);
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"uric"], [NSSet setWithObject:aliceAtZurich]);
+}
+
+- (void)testShortAndLongQueriesShareMatchSemantic {
+    // Given
+    NSSet *shortResults = [index identitiesMatchingQuery:@"ex"];
+    
+    // When
+    NSSet *longResults = [index identitiesMatchingQuery:@"exa"];
+    
+    // Then
+    XCTAssertEqualObjects(shortResults, [NSSet setWithObject:aliceAtForgeRock]);
+    XCTAssertTrue([longResults isSubsetOfSet:shortResults]);
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"ob"], [NSSet setWithObject:bobAtForgeRock]);
+    XCTAssertEqual([index identitiesMatchingQuery:@"obb"].count, 0);
+}
+
+- (void)testQueryMatchesSubstringInMiddleOfWord {
+    // Given
+    FRAIdentity *gmail = [self identityWithIssuer:@"Google" accountName:@"someone@gmail.com"];
+    [index addIdentity:gmail];
+    
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"mail"];
+    
+    // Then
+    XCTAssertEqualObjects(results, [NSSet setWithObject:gmail]);
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"ma"], [NSSet setWithObject:gmail]);
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"oogl"], [NSSet setWithObject:gmail]);
+}
+
+- (void)testQueryDoesNotMatchAcrossIssuerAndAccountName {
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"rockbob"];
+    
+    // Then
+    XCTAssertEqual(results.count, 0);
+}
+
+- (void)testExtendingQueryNarrowsResults {
+    // Given
+    XCTAssertEqual([index identitiesMatchingQuery:@"ali"].count, 2);
+    
+    // When
+    NSSet *results = [index identitiesMatchingQuery:@"alice@"];
+    
+    // Then
+    XCTAssertEqualObjects(results, [NSSet setWithObject:aliceAtForgeRock]);
+}
+
+- (void)testRemovedIdentityIsNoLongerMatched {
+    // Given
+    XCTAssertEqual([index identitiesMatchingQuery:@"forge"].count, 2);
+    
+    // When
+    [index removeIdentity:bobAtForgeRock];
+    
+    // Then
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"forge"], [NSSet setWithObject:aliceAtForgeRock]);
+    XCTAssertEqualObjects([index identitiesMatchingQuery:@"b"], [NSSet setWithObject:aliceAtZurich]);
+    XCTAssertEqual(index.count, 2);
+}
+
+- (void)testIncrementalQueriesAt10000Identities {
+    // Given
+    FRAIdentitySearchIndex *largeIndex = [[FRAIdentitySearchIndex alloc] init];
+    for (NSInteger i = 0; i < 10000; i++) {
+        NSString *issuer = [NSString stringWithFormat:@"Issuer %ld", (long)(i % 500)];
+        NSString *accountName = [NSString stringWithFormat:@"user%ld@example.com", (long)i];
+        [largeIndex addIdentity:[self identityWithIssuer:issuer accountName:accountName]];
+    }
+    NSArray<NSString *> *keystrokes = @[@"u", @"us", @"use", @"user", @"user4", @"user42", @"user421"];
+    
+    // When
+    [self measureBlock:^{
+        for (NSString *query in keystrokes) {
+            [largeIndex identitiesMatchingQuery:query];
+        }
+        [largeIndex identitiesMatchingQuery:@"issuer 49"];
+    }];
+    
+    // Then
+    XCTAssertEqual([largeIndex identitiesMatchingQuery:@"user4217@"].count, 1);
+}
+
+- (FRAIdentity *)identityWithIssuer:(NSString *)issuer accountName:(NSString *)accountName {
+    return [FRAIdentity identityWithDatabase:nil identityModel:nil accountName:accountName issuer:issuer image:nil backgroundColor:nil];
+}
+
+@end
@@ -0,0 +1,198 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAHotpOathMechanism.h"
+#import "FRAIdentity.h"
+#import "FRAIdentitySnapshotFile.h"
+#import "FRAMechanismProtected.h"
+#import "FRAModelObjectProtected.h"
+#import "FRAPushMechanism.h"
+#import "FRATotpOathMechanism.h"
+
+@interface FRAIdentitySnapshotFileTests : XCTestCase
+
+@end
+
+@implementation FRAIdentitySnapshotFileTests {
+    NSString *path;
+    FRAIdentitySnapshotFile *snapshotFile;
+}
+
+- (void)setUp {
+    [super setUp];
+    path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    snapshotFile = [[FRAIdentitySnapshotFile alloc] initWithPath:path];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [super tearDown];
+}
+
+- (void)testReadsBackWrittenIdentitiesAndMechanisms {
+    // Given
+    FRAIdentity *alice = [self storedIdentityWithAccountName:@"alice"];
+    NSData *secret = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    FRAHotpOathMechanism *storedHotp = [FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA256 codeLength:8 counter:42];
+    storedHotp.version = 2;
+    [self addStoredMechanism:storedHotp toIdentity:alice];
+    [self addStoredMechanism:[FRAPushMechanism pushMechanismWithDatabase:nil identityModel:nil authEndpoint:@"http://service.endpoint" secret:@"c2VjcmV0" version:1 mechanismIdentifier:@"push-uid"] toIdentity:alice];
+    FRAIdentity *bob = [self storedIdentityWithAccountName:@"bob"];
+    [self addStoredMechanism:[FRATotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA1 codeLength:6 period:60] toIdentity:bob];
+    
+    // When
+    [snapshotFile writeIdentities:@[alice, bob]];
+    [snapshotFile waitUntilWritten];
+    NSArray<FRAIdentity *> *identities = [snapshotFile identitiesWithDatabase:nil identityModel:nil error:nil];
+    
+    // Then
+    XCTAssertEqual(identities.count, 2);
+    XCTAssertEqualObjects(identities[0].accountName, @"alice");
+    XCTAssertEqualObjects(identities[0].issuer, @"ForgeRock");
+    XCTAssertEqualObjects(identities[0].backgroundColor, @"#519387");
+    XCTAssertEqual(identities[0].mechanisms.count, 2);
+    FRAHotpOathMechanism *hotp = (FRAHotpOathMechanism *)[identities[0] mechanismOfClass:[FRAHotpOathMechanism class]];
+    XCTAssertEqualObjects(hotp.secretKey, secret);
+    XCTAssertEqual(hotp.algorithm, kCCHmacAlgSHA256);
+    XCTAssertEqual(hotp.codeLength, 8);
+    XCTAssertEqual(hotp.version, 2);
+    XCTAssertEqual(hotp.counter, 0, @"Counter should be left to the database");
+    FRAPushMechanism *push = (FRAPushMechanism *)[identities[0] mechanismOfClass:[FRAPushMechanism class]];
+    XCTAssertEqualObjects(push.authEndpoint, @"http://service.endpoint");
+    XCTAssertEqualObjects(push.secret, @"c2VjcmV0");
+    XCTAssertEqualObjects(push.mechanismUID, @"push-uid");
+    FRATotpOathMechanism *totp = (FRATotpOathMechanism *)[identities[1] mechanismOfClass:[FRATotpOathMechanism class]];
+    XCTAssertEqual(totp.period, 60);
+    XCTAssertFalse([identities[0] isStored]);
+}
+
+- (void)testLeavesOutObjectsWhichAreNotStored {
+    // Given
+    FRAIdentity *stored = [self storedIdentityWithAccountName:@"alice"];
+    FRAIdentity *notStored = [FRAIdentity identityWithDatabase:nil identityModel:nil accountName:@"bob" issuer:@"ForgeRock" image:nil backgroundColor:nil];
+    
+    // When
+    [snapshotFile writeIdentities:@[stored, notStored]];
+    [snapshotFile waitUntilWritten];
+    NSArray<FRAIdentity *> *identities = [snapshotFile identitiesWithDatabase:nil identityModel:nil error:nil];
+    
+    // Then
+    XCTAssertEqual(identities.count, 1);
+    XCTAssertEqualObjects(identities[0].accountName, @"alice");
+}
+
+- (void)testInvalidateRemovesSnapshot {
+    // Given
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"alice"]]];
+    
+    // When
+    [snapshotFile invalidate];
+    NSError *error;
+    NSArray<FRAIdentity *> *identities = [snapshotFile identitiesWithDatabase:nil identityModel:nil error:&error];
+    
+    // Then
+    XCTAssertNil(identities);
+    XCTAssertNotNil(error);
+}
+
+- (void)testInvalidateDropsWriteOfEarlierIdentities {
+    // Given
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"alice"]]];
+    [snapshotFile invalidate];
+    
+    // When
+    [snapshotFile waitUntilWritten];
+    
+    // Then
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:path]);
+}
+
+- (void)testWritesLatestIdentitiesWhenWritesAreCoalesced {
+    // Given
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"alice"]]];
+    [snapshotFile invalidate];
+    
+    // When
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"bob"]]];
+    [snapshotFile waitUntilWritten];
+    NSArray<FRAIdentity *> *identities = [snapshotFile identitiesWithDatabase:nil identityModel:nil error:nil];
+    
+    // Then
+    XCTAssertEqual(identities.count, 1);
+    XCTAssertEqualObjects(identities[0].accountName, @"bob");
+}
+
+- (void)testExcludesSnapshotFromBackups {
+    // Given
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"alice"]]];
+    
+    // When
+    [snapshotFile waitUntilWritten];
+    
+    // Then
+    NSNumber *excluded;
+    [[NSURL fileURLWithPath:path] getResourceValue:&excluded forKey:NSURLIsExcludedFromBackupKey error:nil];
+    XCTAssertTrue([excluded boolValue]);
+}
+
+- (void)testHotpCounterUpdatesAreNotRecorded {
+    // Given
+    NSData *secret = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    FRAMechanism *hotp = [FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:0];
+    FRAMechanism *totp = [FRATotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA1 codeLength:6 period:30];
+    
+    // Then
+    XCTAssertFalse([snapshotFile recordsUpdatesOfMechanism:hotp]);
+    XCTAssertTrue([snapshotFile recordsUpdatesOfMechanism:totp]);
+}
+
+- (void)testRejectsCorruptSnapshot {
+    // Given
+    [snapshotFile writeIdentities:@[[self storedIdentityWithAccountName:@"alice"]]];
+    [snapshotFile waitUntilWritten];
+    NSMutableData *contents = [NSMutableData dataWithContentsOfFile:path];
+    ((uint8_t *)contents.mutableBytes)[contents.length - 1] ^= 0xFF;
+    [contents writeToFile:path atomically:YES];
+    
+    // When
+    NSError *error;
+    NSArray<FRAIdentity *> *identities = [snapshotFile identitiesWithDatabase:nil identityModel:nil error:&error];
+    
+    // Then
+    XCTAssertNil(identities);
+    XCTAssertNotNil(error);
+}
+
+#pragma mark -
+#pragma mark Helper Functions
+
+- (FRAIdentity *)storedIdentityWithAccountName:(NSString *)accountName {
+    FRAIdentity *identity = [FRAIdentity identityWithDatabase:nil identityModel:nil accountName:accountName issuer:@"ForgeRock" image:[NSURL URLWithString:@"http://forgerock.com/logo.jpg"] backgroundColor:@"#519387"];
+    identity.stored = YES;
+    return identity;
+}
+
+- (void)addStoredMechanism:(FRAMechanism *)mechanism toIdentity:(FRAIdentity *)identity {
+    // Added while the identity is not stored, so that nothing is written to the database
+    identity.stored = NO;
+    [identity addMechanism:mechanism error:nil];
+    identity.stored = YES;
+    mechanism.stored = YES;
+}
+
+@end
@@ -0,0 +1,154 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAInFlightRequestTable.h"
+
+static NSTimeInterval const TEST_TIMEOUT = 10.0;
+
+@interface FRAInFlightRequestTableTests : XCTestCase
+
+@end
+
+@implementation FRAInFlightRequestTableTests {
+    FRAInFlightRequestTable *table;
+    NSMutableArray<void (^)(NSInteger, NSError *)> *pendingSends;
+    NSUInteger sendCount;
+}
+
+- (void)setUp {
+    [super setUp];
+    table = [[FRAInFlightRequestTable alloc] init];
+    pendingSends = [[NSMutableArray alloc] init];
+    sendCount = 0;
+}
+
+/*!
+ * Performs a request whose network operation only completes when completeSendsWithStatusCode: is called.
+ */
+- (void)performRequestWithMessageId:(NSString *)messageId fingerprint:(id)fingerprint handler:(void (^)(NSInteger, NSError *))handler {
+    [table performRequestWithMessageId:messageId fingerprint:fingerprint handler:handler send:^(void (^complete)(NSInteger, NSError *)) {
+        sendCount++;
+        [pendingSends addObject:complete];
+    }];
+}
+
+- (void)completeSendsWithStatusCode:(NSInteger)statusCode {
+    NSArray<void (^)(NSInteger, NSError *)> *sends = [pendingSends copy];
+    [pendingSends removeAllObjects];
+    for (void (^complete)(NSInteger, NSError *) in sends) {
+        complete(statusCode, nil);
+    }
+}
+
+- (void)testCollapsesIdenticalRequestsInFlight {
+    // Given
+    __block NSUInteger handlerCount = 0;
+    void (^handler)(NSInteger, NSError *) = ^(NSInteger statusCode, NSError *error) {
+        XCTAssertEqual(statusCode, 200);
+        handlerCount++;
+    };
+    
+    // When
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:handler];
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:handler];
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:handler];
+    NSUInteger inFlight = [table inFlightCount];
+    [self completeSendsWithStatusCode:200];
+    
+    // Then
+    XCTAssertEqual(sendCount, 1);
+    XCTAssertEqual(inFlight, 1);
+    XCTAssertEqual(handlerCount, 3);
+    XCTAssertEqual(table.requestCount, 3);
+    XCTAssertEqual(table.collapsedCount, 2);
+    XCTAssertEqual([table inFlightCount], 0);
+}
+
+- (void)testSendsDifferentRequestsForSameMessage {
+    // Given
+    
+    // When
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self performRequestWithMessageId:@"message" fingerprint:@"deny" handler:nil];
+    [self performRequestWithMessageId:@"other message" fingerprint:@"approve" handler:nil];
+    
+    // Then
+    XCTAssertEqual(sendCount, 3);
+    XCTAssertEqual(table.collapsedCount, 0);
+}
+
+- (void)testGivesKeptResultToIdenticalRequest {
+    // Given
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self completeSendsWithStatusCode:401];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"kept result"];
+    __block NSInteger keptStatusCode = 0;
+    
+    // When
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:^(NSInteger statusCode, NSError *error) {
+        keptStatusCode = statusCode;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertEqual(sendCount, 1);
+    XCTAssertEqual(keptStatusCode, 401);
+}
+
+- (void)testDoesNotKeepResultsWhichMayChange {
+    // Given
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self completeSendsWithStatusCode:503];
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self completeSendsWithStatusCode:0];
+    
+    // When
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    
+    // Then
+    XCTAssertEqual(sendCount, 3);
+}
+
+- (void)testSendsAgainOnceResultExpires {
+    // Given
+    table.resultLifetime = 0;
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self completeSendsWithStatusCode:200];
+    
+    // When
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    
+    // Then
+    XCTAssertEqual(sendCount, 2);
+}
+
+- (void)testSendsAgainOnceResultsAreRemoved {
+    // Given
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    [self completeSendsWithStatusCode:200];
+    
+    // When
+    [table removeAllResults];
+    [self performRequestWithMessageId:@"message" fingerprint:@"approve" handler:nil];
+    
+    // Then
+    XCTAssertEqual(sendCount, 2);
+}
+
+@end
@@ -0,0 +1,206 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAHotpOathMechanism.h"
+#import "FRAKeyArena.h"
+#import "FRAOathCode.h"
+#import "FRAOathKey.h"
+#import "FRAPushMechanism.h"
+
+@interface FRAKeyArenaTests : XCTestCase
+
+@end
+
+@implementation FRAKeyArenaTests {
+    FRAKeyArena *arena;
+}
+
+- (void)setUp {
+    [super setUp];
+    arena = [[FRAKeyArena alloc] initWithLockedMemory:NO];
+}
+
+- (void)testShouldCopyKeyMaterialIntoCacheLineAlignedSlot {
+    // Given
+    NSData *key = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    
+    // When
+    FRAKeyMaterial *keyMaterial = [arena keyMaterialWithData:key];
+    
+    // Then
+    XCTAssertEqual(keyMaterial.length, key.length);
+    XCTAssertEqual((uintptr_t)keyMaterial.bytes % FRAKeyArenaMinimumSlotSize, 0);
+    XCTAssertEqualObjects([keyMaterial data], key);
+    XCTAssertTrue([keyMaterial isEqualToData:key]);
+    XCTAssertEqual(arena.allocatedSlotCount, 1);
+}
+
+- (void)testShouldZeroizeSlotWhenKeyMaterialIsReleased {
+    // Given
+    const uint8_t *slot;
+    NSUInteger length;
+    @autoreleasepool {
+        FRAKeyMaterial *keyMaterial = [arena keyMaterialWithData:[@"secret" dataUsingEncoding:NSUTF8StringEncoding]];
+        slot = keyMaterial.bytes;
+        length = keyMaterial.length;
+        
+        // When
+        keyMaterial = nil;
+    }
+    
+    // Then
+    for (NSUInteger i = 0; i < length; i++) {
+        XCTAssertEqual(slot[i], 0);
+    }
+    XCTAssertEqual(arena.allocatedSlotCount, 0);
+}
+
+- (void)testShouldReuseReleasedSlotsWithoutMappingNewSlabs {
+    // Given
+    @autoreleasepool {
+        FRAKeyMaterial *keyMaterial = [arena keyMaterialWithLength:20];
+        XCTAssertNotNil(keyMaterial);
+    }
+    NSUInteger slabCount = arena.slabCount;
+    
+    // When
+    NSMutableArray *keys = [[NSMutableArray alloc] init];
+    for (int i = 0; i < 100; i++) {
+        [keys addObject:[arena keyMaterialWithLength:20]];
+    }
+    
+    // Then
+    XCTAssertEqual(slabCount, 1);
+    XCTAssertEqual(arena.slabCount, 1);
+    XCTAssertEqual(arena.allocatedSlotCount, 100);
+}
+
+- (void)testShouldUseSeparateSizeClassForLongKeys {
+    // Given
+    FRAKeyMaterial *shortKey = [arena keyMaterialWithLength:20];
+    
+    // When
+    FRAKeyMaterial *longKey = [arena keyMaterialWithLength:FRAKeyArenaMaximumSlotSize];
+    
+    // Then
+    XCTAssertNotNil(shortKey);
+    XCTAssertNotNil(longKey);
+    XCTAssertEqual(arena.slabCount, 2);
+}
+
+- (void)testShouldRefuseKeyMaterialLongerThanLargestSlot {
+    // Given
+    NSUInteger length = FRAKeyArenaMaximumSlotSize + 1;
+    
+    // When
+    FRAKeyMaterial *keyMaterial = [arena keyMaterialWithLength:length];
+    
+    // Then
+    XCTAssertNil(keyMaterial);
+    XCTAssertEqual(arena.slabCount, 0);
+}
+
+- (void)testShouldReturnNilForNilData {
+    // Given
+    NSData *key = nil;
+    
+    // When
+    FRAKeyMaterial *keyMaterial = [arena keyMaterialWithData:key];
+    
+    // Then
+    XCTAssertNil(keyMaterial);
+}
+
+- (void)testOathKeyShouldGenerateSameCodesAsKey {
+    // Given
+    NSData *key = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    CCHmacAlgorithm algorithms[] = {kCCHmacAlgSHA1, kCCHmacAlgSHA256, kCCHmacAlgSHA512, kCCHmacAlgMD5};
+    
+    // When
+    FRAOathKey *oathKey = [[FRAOathKey alloc] initWithData:key];
+    
+    // Then
+    for (int i = 0; i < 4; i++) {
+        for (uint64_t counter = 0; counter < 10; counter++) {
+            XCTAssertEqualObjects([oathKey codeWithAlgorithm:algorithms[i] codeLength:6 counter:counter],
+                                  [FRAOathCode hmac:algorithms[i] codeLength:6 key:key counter:counter]);
+        }
+    }
+}
+
+- (void)testOathKeyShouldGenerateRfc4226Codes {
+    // Given
+    NSData *key = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    FRAOathKey *oathKey = [[FRAOathKey alloc] initWithData:key];
+    
+    // When
+    NSString *first = [oathKey codeWithAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:0];
+    NSString *second = [oathKey codeWithAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:1];
+    
+    // Then
+    XCTAssertEqualObjects(first, @"755224");
+    XCTAssertEqualObjects(second, @"287082");
+}
+
+- (void)testOathKeyShouldHoldOversizedKeyOutsideArena {
+    // Given
+    NSMutableData *key = [NSMutableData dataWithLength:FRAKeyArenaMaximumSlotSize + 1];
+    
+    // When
+    FRAOathKey *oathKey = [[FRAOathKey alloc] initWithData:key];
+    
+    // Then
+    XCTAssertEqualObjects([oathKey data], key);
+    XCTAssertEqualObjects([oathKey codeWithAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:0],
+                          [FRAOathCode hmac:kCCHmacAlgSHA1 codeLength:6 key:key counter:0]);
+}
+
+- (void)testMechanismShouldReturnCopyOfSecretKeyHeldInArena {
+    // Given
+    NSData *key = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    
+    // When
+    FRAHotpOathMechanism *mechanism = [FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:key HMACAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:0];
+    
+    // Then
+    XCTAssertEqualObjects(mechanism.secretKey, key);
+    XCTAssertNotEqual(mechanism.secretKey.bytes, key.bytes);
+}
+
+- (void)testPushMechanismShouldReturnSecretHeldInArena {
+    // Given
+    NSString *secret = @"c2VjcmV0";
+    
+    // When
+    FRAPushMechanism *mechanism = [FRAPushMechanism pushMechanismWithDatabase:nil identityModel:nil authEndpoint:@"http://service.endpoint" secret:secret];
+    
+    // Then
+    XCTAssertEqualObjects(mechanism.secret, secret);
+}
+
+- (void)testPerformanceOfCodeGenerationFromOathKey {
+    NSData *key = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    FRAOathKey *oathKey = [[FRAOathKey alloc] initWithData:key];
+    [self measureBlock:^{
+        for (uint64_t counter = 0; counter < 10000; counter++) {
+            [oathKey codeWithAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:counter];
+        }
+    }];
+}
+
+@end
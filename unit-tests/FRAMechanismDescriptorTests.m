@@ -0,0 +1,187 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAHotpOathMechanism.h"
+#import "FRAMechanismDescriptor.h"
+#import "FRAPushMechanism.h"
+#import "FRASerialization.h"
+#import "FRATotpOathMechanism.h"
+
+/*!
+ * Subclass which is not registered, so resolves to the descriptor of its superclass.
+ */
+@interface FRAMechanismDescriptorTestsHotpSubclass : FRAHotpOathMechanism
+
+@end
+
+@implementation FRAMechanismDescriptorTestsHotpSubclass
+
+@end
+
+@interface FRAMechanismDescriptorTests : XCTestCase
+
+@end
+
+@implementation FRAMechanismDescriptorTests {
+    NSData *secret;
+}
+
+- (void)setUp {
+    [super setUp];
+    secret = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)testDescriptorsAreRegisteredForEachTypeOfMechanism {
+    // Given
+    NSArray<Class> *mechanismClasses = @[[FRAHotpOathMechanism class], [FRATotpOathMechanism class], [FRAPushMechanism class]];
+    
+    for (Class mechanismClass in mechanismClasses) {
+        // When
+        FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForType:[mechanismClass mechanismType]];
+        
+        // Then
+        XCTAssertEqualObjects(descriptor.mechanismClass, mechanismClass);
+        XCTAssertEqualObjects(descriptor.type, [mechanismClass mechanismType]);
+    }
+    XCTAssertNil([FRAMechanismDescriptor descriptorForType:@"unknown"]);
+}
+
+- (void)testSubclassesResolveToDescriptorOfRegisteredSuperclass {
+    // Given
+    FRAMechanism *subclassMechanism = [[FRAMechanismDescriptorTestsHotpSubclass alloc] initWithDatabase:nil identityModel:nil];
+    FRAMechanism *baseMechanism = [[FRAMechanism alloc] initWithDatabase:nil identityModel:nil];
+    FRAMechanismDescriptor *hotpDescriptor = [FRAMechanismDescriptor descriptorForType:[FRAHotpOathMechanism mechanismType]];
+    
+    for (NSUInteger i = 0; i < 2; i++) {
+        // When
+        FRAMechanismDescriptor *subclassDescriptor = [FRAMechanismDescriptor descriptorForMechanism:subclassMechanism];
+        FRAMechanismDescriptor *baseDescriptor = [FRAMechanismDescriptor descriptorForMechanism:baseMechanism];
+        
+        // Then
+        XCTAssertEqual(subclassDescriptor, hotpDescriptor);
+        XCTAssertNil(baseDescriptor);
+    }
+}
+
+- (void)testHotpMechanismSurvivesRoundTrip {
+    // Given
+    FRAHotpOathMechanism *mechanism = [FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA256 codeLength:8 counter:42];
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    NSData *options = [descriptor encodeOptionsOfMechanism:mechanism error:nil];
+    
+    // When
+    FRAHotpOathMechanism *result = (FRAHotpOathMechanism *)[descriptor mechanismWithDatabase:nil identityModel:nil version:mechanism.version mechanismUID:nil options:options error:nil];
+    
+    // Then
+    XCTAssertEqual([result class], [FRAHotpOathMechanism class]);
+    XCTAssertNil([descriptor mechanismUIDOfMechanism:mechanism]);
+    XCTAssertEqualObjects(result.secretKey, secret);
+    XCTAssertEqual(result.algorithm, kCCHmacAlgSHA256);
+    XCTAssertEqual(result.codeLength, 8);
+    XCTAssertEqual(result.counter, 42);
+    XCTAssertEqual(result.version, 1);
+}
+
+- (void)testTotpMechanismSurvivesRoundTrip {
+    // Given
+    FRATotpOathMechanism *mechanism = [FRATotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA512 codeLength:6 period:60];
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    NSData *options = [descriptor encodeOptionsOfMechanism:mechanism error:nil];
+    
+    // When
+    FRATotpOathMechanism *result = (FRATotpOathMechanism *)[descriptor mechanismWithDatabase:nil identityModel:nil version:mechanism.version mechanismUID:nil options:options error:nil];
+    
+    // Then
+    XCTAssertEqual([result class], [FRATotpOathMechanism class]);
+    XCTAssertEqualObjects(result.secretKey, secret);
+    XCTAssertEqual(result.algorithm, kCCHmacAlgSHA512);
+    XCTAssertEqual(result.codeLength, 6);
+    XCTAssertEqual(result.period, 60);
+}
+
+- (void)testPushMechanismSurvivesRoundTrip {
+    // Given
+    FRAPushMechanism *mechanism = [FRAPushMechanism pushMechanismWithDatabase:nil identityModel:nil authEndpoint:@"http://service.endpoint" secret:@"c2VjcmV0" version:2 mechanismIdentifier:@"push-uid"];
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    NSData *options = [descriptor encodeOptionsOfMechanism:mechanism error:nil];
+    
+    // When
+    FRAPushMechanism *result = (FRAPushMechanism *)[descriptor mechanismWithDatabase:nil identityModel:nil version:2 mechanismUID:[descriptor mechanismUIDOfMechanism:mechanism] options:options error:nil];
+    
+    // Then
+    XCTAssertEqual([result class], [FRAPushMechanism class]);
+    XCTAssertEqualObjects(result.mechanismUID, @"push-uid");
+    XCTAssertEqualObjects(result.authEndpoint, @"http://service.endpoint");
+    XCTAssertEqualObjects(result.secret, @"c2VjcmV0");
+    XCTAssertEqual(result.version, 2);
+}
+
+- (void)testOptionsChangingWithUseAreLeftOutAndRestoredSeparately {
+    // Given
+    FRAHotpOathMechanism *mechanism = [FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA256 codeLength:8 counter:42];
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForMechanism:mechanism];
+    NSData *staticOptions = [descriptor encodeOptionsOfMechanism:mechanism includingOptionsChangingWithUse:NO error:nil];
+    NSData *allOptions = [descriptor encodeOptionsOfMechanism:mechanism error:nil];
+    
+    // When
+    FRAHotpOathMechanism *result = (FRAHotpOathMechanism *)[descriptor mechanismWithDatabase:nil identityModel:nil version:mechanism.version mechanismUID:nil options:staticOptions error:nil];
+    u_int64_t counterBeforeRestore = result.counter;
+    BOOL restored = [descriptor restoreOptionsChangingWithUse:allOptions toMechanism:result error:nil];
+    
+    // Then
+    XCTAssertTrue(descriptor.hasOptionsChangingWithUse);
+    XCTAssertFalse([FRAMechanismDescriptor descriptorForType:[FRATotpOathMechanism mechanismType]].hasOptionsChangingWithUse);
+    XCTAssertEqual(counterBeforeRestore, 0);
+    XCTAssertTrue(restored);
+    XCTAssertEqual(result.counter, 42);
+    XCTAssertFalse([descriptor restoreOptionsChangingWithUse:staticOptions toMechanism:result error:nil]);
+}
+
+- (void)testHotpMechanismIsReadFromLegacyJSON {
+    // Given
+    NSString *json = @"{\"secret\":\"3132333435363738393031323334353637383930\",\"algorithm\":\"sha256\",\"digits\":\"8\",\"counter\":\"42\"}";
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForType:[FRAHotpOathMechanism mechanismType]];
+    
+    // When
+    FRAHotpOathMechanism *result = (FRAHotpOathMechanism *)[descriptor mechanismWithDatabase:nil identityModel:nil version:1 mechanismUID:nil options:[json dataUsingEncoding:NSUTF8StringEncoding] error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(result.secretKey, secret);
+    XCTAssertEqual(result.algorithm, kCCHmacAlgSHA256);
+    XCTAssertEqual(result.codeLength, 8);
+    XCTAssertEqual(result.counter, 42);
+}
+
+- (void)testInvalidOptionsAreReported {
+    // Given
+    FRAMechanismDescriptor *descriptor = [FRAMechanismDescriptor descriptorForType:[FRAPushMechanism mechanismType]];
+    NSError *error;
+    
+    // When
+    FRAMechanism *result = [descriptor mechanismWithDatabase:nil identityModel:nil version:1 mechanismUID:@"push-uid" options:[@"{not json" dataUsingEncoding:NSUTF8StringEncoding] error:&error];
+    
+    // Then
+    XCTAssertNil(result);
+    XCTAssertNotNil(error);
+}
+
+@end
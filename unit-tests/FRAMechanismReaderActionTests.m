@@ -54,7 +54,7 @@ static NSString * const DEVICE_ID = @"device id";
     [super setUp];
     mockMessageUtils = OCMClassMock([FRAMessageUtils class]);
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
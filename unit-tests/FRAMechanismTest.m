@@ -95,6 +95,34 @@
     OCMVerifyAll(databaseObserverMock);
 }
 
+- (void)testBroadcastsOneCoalescedChangeNotificationForBurstOfSavedNotifications {
+    // Given
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations*)mockSqlOperations insertMechanism:mechanism error:nil]).andReturn(YES);
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations*)mockSqlOperations insertNotification:[OCMArg any] error:nil]).andReturn(YES);
+    [database insertMechanism:mechanism error:nil];
+    FRANotification *first = [self dummyNotificationWithMessageId:@"ID-1"];
+    FRANotification *second = [self dummyNotificationWithMessageId:@"ID-2"];
+    FRANotification *third = [self dummyNotificationWithMessageId:@"ID-3"];
+    __block NSInteger broadcasts = 0;
+    __block NSDictionary *stateChanges = nil;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:FRAIdentityDatabaseChangesCoalescedNotification object:database queue:nil usingBlock:^(NSNotification *note) {
+        broadcasts++;
+        stateChanges = note.userInfo;
+    }];
+    
+    // When
+    [mechanism addNotification:first error:nil];
+    [mechanism addNotification:second error:nil];
+    [mechanism addNotification:third error:nil];
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    
+    // Then
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    XCTAssertEqual(broadcasts, 1);
+    NSSet *expectedAdded = [NSSet setWithObjects:first, second, third, nil];
+    XCTAssertEqualObjects(stateChanges[FRAIdentityDatabaseChangedNotificationAddedItems], expectedAdded);
+}
+
 - (void)testCanRemoveNotificationFromMechanism {
     // Given
     FRANotification *notification = [self dummyNotification];
@@ -164,6 +192,99 @@
 }
 
 
+- (void)testNotificationsSnapshotIsSharedUntilMechanismChanges {
+    // Given
+    [mechanism addNotification:[self dummyNotificationWithMessageId:@"ID-1"] error:nil];
+    NSArray *snapshot = [mechanism notifications];
+
+    // When
+    [mechanism addNotification:[self dummyNotificationWithMessageId:@"ID-2"] error:nil];
+
+    // Then
+    XCTAssertEqual(snapshot.count, 1, @"Previously returned snapshot should not change");
+    XCTAssertEqual([mechanism notifications].count, 2);
+    XCTAssertEqual([mechanism notifications], [mechanism notifications], @"Unchanged mechanism should return the same snapshot");
+}
+
+- (void)testPendingNotificationsCountIsMaintainedAsNotificationsChange {
+    // Given
+    FRANotification *first = [self dummyNotificationWithMessageId:@"ID-1"];
+    FRANotification *second = [self dummyNotificationWithMessageId:@"ID-2"];
+    [mechanism addNotification:first error:nil];
+    [mechanism addNotification:second error:nil];
+    XCTAssertEqual([mechanism pendingNotificationsCount], 2);
+
+    // When
+    [first denyWithHandler:nil error:nil];
+    [mechanism removeNotification:second error:nil];
+
+    // Then
+    XCTAssertEqual([mechanism pendingNotificationsCount], 0);
+    XCTAssertNil([mechanism nextPendingNotificationExpiry]);
+}
+
+- (void)testRemovingEarliestPendingNotificationMovesExpiryToNextPendingNotification {
+    // Given
+    FRANotification *first = [self dummyNotificationWithMessageId:@"ID-1"];
+    FRANotification *second = [self dummyNotificationWithMessageId:@"ID-2"];
+    second.timeExpired = [first.timeExpired dateByAddingTimeInterval:60.0];
+    [mechanism addNotification:first error:nil];
+    [mechanism addNotification:second error:nil];
+    XCTAssertEqualObjects([mechanism nextPendingNotificationExpiry], first.timeExpired);
+
+    // When
+    [mechanism removeNotifications:@[first] error:nil];
+
+    // Then
+    XCTAssertEqual([mechanism pendingNotificationsCount], 1);
+    XCTAssertEqualObjects([mechanism nextPendingNotificationExpiry], second.timeExpired);
+}
+
+- (void)testPendingNotificationsCountExcludesExpiredNotifications {
+    // Given
+    FRANotification *notification = [self dummyNotification];
+    [mechanism addNotification:notification error:nil];
+    XCTAssertEqual([mechanism pendingNotificationsCount], 1);
+
+    // When
+    notification.timeExpired = [NSDate dateWithTimeIntervalSinceNow:-1.0];
+
+    // Then
+    XCTAssertEqual([mechanism pendingNotificationsCount], 0);
+}
+
+- (void)testNotificationsCanBeReadOnOtherThreadsWhileBeingAdded {
+    // Given
+    const NSInteger count = 200;
+    dispatch_queue_t readers = dispatch_queue_create("readers", DISPATCH_QUEUE_CONCURRENT);
+    dispatch_group_t group = dispatch_group_create();
+    __block BOOL snapshotsConsistent = YES;
+    FRAMechanism *mechanismUnderTest = mechanism;
+    
+    // When
+    for (NSInteger i = 0; i < count; i++) {
+        FRANotification *notification = [self dummyNotificationWithMessageId:[NSString stringWithFormat:@"ID-%ld", (long)i]];
+        dispatch_group_async(group, readers, ^{
+            NSArray *snapshot = [mechanismUnderTest notifications];
+            NSUInteger snapshotCount = snapshot.count;
+            for (__unused FRANotification *each in snapshot) {
+                snapshotCount--;
+            }
+            if (snapshotCount != 0) {
+                snapshotsConsistent = NO;
+            }
+            [mechanismUnderTest pendingNotificationsCount];
+        });
+        [mechanism addNotification:notification error:nil];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    // Then
+    XCTAssertTrue(snapshotsConsistent);
+    XCTAssertEqual([mechanism notifications].count, (NSUInteger)count);
+    XCTAssertEqual([mechanism pendingNotificationsCount], count);
+}
+
 - (FRANotification *)dummyNotification {
     return [self dummyNotificationWithMessageId:@"messageId"];
 }
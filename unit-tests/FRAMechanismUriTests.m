@@ -0,0 +1,196 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#include "FRAUriParser.h"
+
+#import "FRAMechanismUri.h"
+
+@interface FRAMechanismUriTests : XCTestCase
+
+@end
+
+@implementation FRAMechanismUriTests
+
+- (void)testShouldParseSchemeTypeIssuerAndLabel {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://totp/Forgerock:demo?secret=IJQWIZ3FOIQUEYLE"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects(uri.scheme, @"otpauth");
+    XCTAssertTrue([uri hasScheme:@"otpauth"]);
+    XCTAssertFalse([uri hasScheme:@"pushauth"]);
+    XCTAssertEqualObjects(uri.type, @"totp");
+    XCTAssertEqualObjects(uri.issuer, @"Forgerock");
+    XCTAssertEqualObjects(uri.label, @"demo");
+}
+
+- (void)testShouldSplitIssuerAtEncodedColon {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://totp/Example%3Aalice%40google.com?secret=JBSWY3DPEHPK3PXP"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects(uri.issuer, @"Example");
+    XCTAssertEqualObjects(uri.label, @"alice@google.com");
+}
+
+- (void)testShouldReturnEmptyIssuerWithoutPrefix {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://totp/demo?secret=JBSWY3DPEHPK3PXP"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects(uri.issuer, @"");
+    XCTAssertEqualObjects(uri.label, @"demo");
+}
+
+- (void)testShouldDecodeParameterValuesOnlyWhenAsked {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://totp/demo?issuer=Big%20Corp&image=http%3A%2F%2Fexample.com%2Fa.png"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects([uri parameter:@"issuer"], @"Big Corp");
+    XCTAssertEqualObjects([uri rawParameter:@"issuer"], @"Big%20Corp");
+    XCTAssertEqualObjects([uri parameter:@"image"], @"http://example.com/a.png");
+}
+
+- (void)testShouldKeepLastValueOfRepeatedParameter {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://hotp/demo?counter=1&counter=2"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects([uri parameter:@"counter"], @"2");
+}
+
+- (void)testShouldIgnoreParametersBeyondLimit {
+    // Given
+    NSMutableString *string = [NSMutableString stringWithString:@"otpauth://hotp/demo?counter=1"];
+    for (int i = 0; i < FRA_URI_MAX_PARAMETERS; i++) {
+        [string appendFormat:@"&extra%d=%d", i, i];
+    }
+    [string appendString:@"&counter=2"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:[NSURL URLWithString:string]];
+    
+    // Then
+    XCTAssertNotNil(uri);
+    XCTAssertEqualObjects([uri parameter:@"extra0"], @"0");
+    XCTAssertNil([uri parameter:[NSString stringWithFormat:@"extra%d", FRA_URI_MAX_PARAMETERS - 1]]);
+    XCTAssertEqualObjects([uri parameter:@"counter"], @"2");
+}
+
+- (void)testShouldSplitParameterAtFirstEquals {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"pushauth://push/demo?s=c2VjcmV0==&flag&c=x#fragment"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertEqualObjects([uri rawParameter:@"s"], @"c2VjcmV0==");
+    XCTAssertNil([uri rawParameter:@"flag"]);
+    XCTAssertEqualObjects([uri rawParameter:@"c"], @"x");
+}
+
+- (void)testShouldRejectUriWithoutPath {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth://totp/?secret=JBSWY3DPEHPK3PXP"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertNil(uri);
+}
+
+- (void)testShouldRejectUriWithoutAuthority {
+    // Given
+    NSURL *url = [NSURL URLWithString:@"otpauth:totp/demo"];
+    
+    // When
+    FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+    
+    // Then
+    XCTAssertNil(uri);
+}
+
+- (void)testShouldValidateHexColors {
+    XCTAssertTrue(FRAUriIsHexColor("ff00AA", 6));
+    XCTAssertTrue(FRAUriIsHexColor("519387", 6));
+    XCTAssertFalse(FRAUriIsHexColor("ff00AG", 6));
+    XCTAssertFalse(FRAUriIsHexColor("#ff00A", 6));
+    XCTAssertFalse(FRAUriIsHexColor("ff00A", 5));
+    XCTAssertFalse(FRAUriIsHexColor("ff00AAB", 7));
+}
+
+- (void)testShouldCopyMalformedEscapesWhenDecoding {
+    // Given
+    const char *value = "100%25%zz%4";
+    char result[16];
+    
+    // When
+    size_t length = FRAUriPercentDecode((FRAUriSpan){value, strlen(value)}, result);
+    
+    // Then
+    XCTAssertEqual(length, 9);
+    XCTAssertEqual(strncmp(result, "100%%zz%4", length), 0);
+}
+
+- (void)testPerformanceOfParsingUriCorpus {
+    NSArray<NSString *> *templates = @[
+        @"otpauth://totp/Google%3Auser%d%%40gmail.com?secret=JBSWY3DPEHPK3PXP&issuer=Google",
+        @"otpauth://totp/GitHub:user%d?secret=ONSWG4TFOQYTEMZU&issuer=GitHub",
+        @"otpauth://totp/Amazon%%20Web%%20Services:root-account-mfa-device%%40%d?secret=GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ&issuer=Amazon%%20Web%%20Services",
+        @"otpauth://totp/Microsoft:user%d%%40outlook.com?secret=MFRGGZDFMZTWQ2LK&issuer=Microsoft&algorithm=SHA1&digits=6&period=30",
+        @"otpauth://totp/Dropbox:user%d%%40example.com?secret=KRSXG5CTMVRXEZLUKN2XAZLSKNSWG4TFOQ&issuer=Dropbox",
+        @"otpauth://hotp/Forgerock:demo%d?secret=IJQWIZ3FOIQUEYLE&issuer=Forgerock&counter=0&b=032b75&image=http%%3A%%2F%%2Fseattlewriter.com%%2Fwp-content%%2Fuploads%%2F2013%%2F01%%2Fweight-watchers-small.gif",
+        @"otpauth://totp/ForgeRock:user%d?secret=R2PYFZRISXA5L25NVSSYK2RQ6E======&issuer=ForgeRock&digits=8&algorithm=SHA256&period=60&b=519387",
+        @"pushauth://push/forgerock:user%d?a=aHR0cDovL2FtcWEtY2xvbmU2OS50ZXN0LmZvcmdlcm9jay5jb206ODA4MC9vcGVuYW0vanNvbi9wdXNoL3Nucy9tZXNzYWdlP19hY3Rpb249YXV0aGVudGljYXRl&image=aHR0cDovL3NlYXR0bGV3cml0ZXIuY29tL3dwLWNvbnRlbnQvdXBsb2Fkcy8yMDEzLzAxL3dlaWdodC13YXRjaGVycy1zbWFsbC5naWY&b=ff00ff&r=aHR0cDovL2FtcWEtY2xvbmU2OS50ZXN0LmZvcmdlcm9jay5jb206ODA4MC9vcGVuYW0vanNvbi9wdXNoL3Nucy9tZXNzYWdlP19hY3Rpb249cmVnaXN0ZXI&s=dA18Iph3slIUDVuRc5+3y7nv9NLGnPksH66d3jIF6uE=&c=Yf66ojm3Pm80PVvNpljTB6X9CUhgSJ0WZUzB4su3vCY=&l=YW1sYmNvb2tpZT0wMQ==&m=9326d19c-4d08-4538-8151-f8558e71475f1464361288472&issuer=Rm9yZ2Vyb2Nr",
+    ];
+    NSMutableArray<NSURL *> *corpus = [[NSMutableArray alloc] init];
+    for (int i = 0; i < 10000; i++) {
+        [corpus addObject:[NSURL URLWithString:[NSString stringWithFormat:templates[i % templates.count], i]]];
+    }
+    NSArray<NSString *> *names = @[@"secret", @"issuer", @"algorithm", @"digits", @"period", @"counter", @"image", @"b", @"s", @"a", @"r", @"c", @"l", @"m"];
+    
+    [self measureBlock:^{
+        for (NSURL *url in corpus) {
+            FRAMechanismUri *uri = [FRAMechanismUri uriWithURL:url];
+            XCTAssertNotNil(uri.label);
+            for (NSString *name in names) {
+                [uri parameter:name];
+            }
+        }
+    }];
+}
+
+@end
@@ -15,6 +15,7 @@
  */
 
 #import <XCTest/XCTest.h>
+#import "FRAInFlightRequestTable.h"
 #import "FRAMessageUtils.h"
 #import "FRAMockURLProtocol.h"
 
@@ -31,6 +32,8 @@ static NSTimeInterval const testTimeout = 10.0;
 
 - (void)setUp {
     [super setUp];
+    [[FRAInFlightRequestTable sharedTable] removeAllResults];
+    [FRAMockURLProtocol resetRequests];
 }
 
 - (void)tearDown {
@@ -105,6 +108,21 @@ static NSTimeInterval const testTimeout = 10.0;
     XCTAssertEqualObjects([dictionary valueForKey:@"u"], @"3");
 }
 
+- (void)testDecodeJWTMessageKeepsEveryClaimAndItsType {
+    // Given
+    NSString *body = [[@"{\"c\":\"challenge\",\"t\":120,\"u\":3,\"l\":\"cookie\",\"extra\":[1]}" dataUsingEncoding:NSUTF8StringEncoding] base64EncodedStringWithOptions:0];
+    NSString *jwt = [NSString stringWithFormat:@"e30.%@.c2lnbmF0dXJl", body];
+    
+    // When
+    NSDictionary *dictionary = [FRAMessageUtils extractJTWBodyFromString:jwt error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(dictionary[@"t"], @120);
+    XCTAssertTrue([dictionary[@"t"] isKindOfClass:[NSNumber class]]);
+    XCTAssertEqualObjects(dictionary[@"u"], @3);
+    XCTAssertEqualObjects(dictionary[@"extra"], @[@1]);
+}
+
 - (void)testIncludesLoadBalancerCookie {
     XCTestExpectation *expectation = [self expectationWithDescription:@"request with cookie"];
 
@@ -156,5 +174,62 @@ static NSTimeInterval const testTimeout = 10.0;
     [self waitForExpectationsWithTimeout:testTimeout handler:nil];
 }
 
+
+- (void)testCollapsesIdenticalResponsesIntoOneRequest {
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"first response"];
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"second response"];
+    __block NSInteger firstStatusCode = 0;
+    __block NSInteger secondStatusCode = 0;
+    
+    for (XCTestExpectation *expectation in @[firstExpectation, secondExpectation]) {
+        [FRAMessageUtils respondWithEndpoint:url
+                                base64Secret:base64Secret
+                                   messageId:messageId
+                      loadBalancerCookieData:@"amlbcookie=03"
+                                        data:@{@"some":@"data"}
+                                    protocol:[FRAMockURLProtocol class]
+                                     handler:^(NSInteger statusCode, NSError *error) {
+                                         if (expectation == firstExpectation) {
+                                             firstStatusCode = statusCode;
+                                         } else {
+                                             secondStatusCode = statusCode;
+                                         }
+                                         [expectation fulfill];
+                                     }];
+    }
+    
+    [self waitForExpectationsWithTimeout:testTimeout handler:nil];
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+    XCTAssertEqual(firstStatusCode, 200);
+    XCTAssertEqual(secondStatusCode, 200);
+}
+
+- (void)testSendsDifferentResponsesToSameMessage {
+    XCTestExpectation *approveExpectation = [self expectationWithDescription:@"approve"];
+    XCTestExpectation *denyExpectation = [self expectationWithDescription:@"deny"];
+    
+    [FRAMessageUtils respondWithEndpoint:url
+                            base64Secret:base64Secret
+                               messageId:messageId
+                  loadBalancerCookieData:@"amlbcookie=03"
+                                    data:@{@"response":@"response"}
+                                protocol:[FRAMockURLProtocol class]
+                                 handler:^(NSInteger statusCode, NSError *error) {
+                                     [approveExpectation fulfill];
+                                 }];
+    [FRAMessageUtils respondWithEndpoint:url
+                            base64Secret:base64Secret
+                               messageId:messageId
+                  loadBalancerCookieData:@"amlbcookie=03"
+                                    data:@{@"response":@"response", @"deny":@YES}
+                                protocol:[FRAMockURLProtocol class]
+                                 handler:^(NSInteger statusCode, NSError *error) {
+                                     [denyExpectation fulfill];
+                                 }];
+    
+    [self waitForExpectationsWithTimeout:testTimeout handler:nil];
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 2);
+}
+
 @end
 
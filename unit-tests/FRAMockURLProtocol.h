@@ -54,4 +54,25 @@
  */
 + (void)setError:(NSError*)error;
 
+
+/*!
+ * Fail the next requests, before the configured response is returned again.
+ *
+ * @param count The number of requests to fail.
+ * @param statusCode The status code of the failed responses, or 0 to fail as if the server could not be reached.
+ */
++ (void)failNextRequests:(NSUInteger)count withStatusCode:(NSInteger)statusCode;
+
+/*!
+ * Get the number of requests loaded since the count was last reset.
+ *
+ * @return The number of requests.
+ */
++ (NSUInteger)requestCount;
+
+/*!
+ * Reset the request count and cancel any pending failures.
+ */
++ (void)resetRequests;
+
 @end
\ No newline at end of file
@@ -21,6 +21,9 @@ static NSData *mockResponseData = nil;
 static NSDictionary *mockResponseHeaders = nil;
 static NSInteger mockStatusCode = 200;
 static NSError *mockError = nil;
+static NSUInteger mockFailureCount = 0;
+static NSInteger mockFailureStatusCode = 0;
+static NSUInteger mockRequestCount = 0;
 
 @implementation FRAMockURLProtocol
 
@@ -62,6 +65,26 @@ static NSError *mockError = nil;
     }
 }
 
++ (void)failNextRequests:(NSUInteger)count withStatusCode:(NSInteger)statusCode {
+    @synchronized (self) {
+        mockFailureCount = count;
+        mockFailureStatusCode = statusCode;
+    }
+}
+
++ (NSUInteger)requestCount {
+    @synchronized (self) {
+        return mockRequestCount;
+    }
+}
+
++ (void)resetRequests {
+    @synchronized (self) {
+        mockRequestCount = 0;
+        mockFailureCount = 0;
+    }
+}
+
 - (NSCachedURLResponse *)cachedResponse {
     return nil;
 }
@@ -70,8 +93,20 @@ static NSError *mockError = nil;
     
     NSURLRequest *request = [self request];
     id<NSURLProtocolClient> client = [self client];
+    NSInteger statusCode = mockStatusCode;
+    @synchronized ([FRAMockURLProtocol class]) {
+        mockRequestCount++;
+        if (mockFailureCount > 0) {
+            mockFailureCount--;
+            statusCode = mockFailureStatusCode;
+        }
+    }
+    if (statusCode == 0) {
+        [client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil]];
+        return;
+    }
     NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[request URL]
-                                                              statusCode:mockStatusCode
+                                                              statusCode:statusCode
                                                              HTTPVersion:@"1.1"
                                                             headerFields:mockResponseHeaders];
     
@@ -18,15 +18,18 @@
 #import <XCTest/XCTest.h>
 
 #import "FMDatabase.h"
+#import "FRABinarySerialization.h"
 #import "FRAError.h"
 #import "FRAFMDatabaseConnectionHelper.h"
 #import "FRAHotpOathMechanism.h"
 #import "FRAIdentity.h"
 #import "FRAIdentityDatabase.h"
+#import "FRAIdentityDatabaseSQLiteOperations.h"
 #import "FRAIdentityModel.h"
 #import "FRAModelsFromDatabase.h"
 #import "FRANotification.h"
 #import "FRAPushMechanism.h"
+#import "FRASerialization.h"
 #import "FRATotpOathMechanism.h"
 
 static NSString * const ReadSchema = @"read_all schema";
@@ -167,6 +170,76 @@ static NSString * const Data = @"{\"message_id\":\"message id\", \"push_challeng
     XCTAssertEqual(notification.timeToLive, (NSTimeInterval)60.0);
 }
 
+- (void)testGetAllIdentitiesReadsBinaryEncodedOptionsAndData {
+    // Given
+    OCMStub([mockSqlDatabase readSchema:@"read_all" withError:nil]).andReturn(ReadSchema);
+    OCMStub([mockSqlDatabase getConnectionWithError:nil]).andReturn(mockDatabase);
+    OCMStub([mockDatabase executeQuery:ReadSchema]).andReturn(mockQueryResults);
+    NSData *options = [FRABinarySerialization encodeMap:@{ PUSH_MECHANISM_SECRET : @"secret",
+                                                           PUSH_MECHANISM_AUTH_END_POINT : @"http://example.com/auth",
+                                                           PUSH_MECHANISM_VERSION : @1 }
+                                                 schema:FRABinarySchemaPushOptions
+                                                  error:nil];
+    NSData *data = [FRABinarySerialization encodeMap:@{ NOTIFICATION_MESSAGE_ID : @"message id",
+                                                        NOTIFICATION_PUSH_CHALLENGE : @"challenge_data",
+                                                        NOTIFICATION_TIME_TO_LIVE : @120.0,
+                                                        NOTIFICATION_LOAD_BALANCER_COOKIE : @"amlbcookie=01" }
+                                              schema:FRABinarySchemaNotificationData
+                                               error:nil];
+    [self setUpDummyIdentity:PushType options:options data:data];
+    
+    // When
+    NSArray<FRAIdentity*>* identities = [FRAModelsFromDatabase allIdentitiesWithDatabase:mockSqlDatabase identityDatabase:mockIdentityDatabase identityModel:mockIdentityModel error:nil];
+    
+    // Then
+    FRAPushMechanism *mechanism = (FRAPushMechanism *)[[identities objectAtIndex:0].mechanisms objectAtIndex:0];
+    XCTAssertEqualObjects(mechanism.secret, @"secret");
+    XCTAssertEqualObjects(mechanism.authEndpoint, @"http://example.com/auth");
+    XCTAssertEqual(mechanism.version, 1);
+    FRANotification *notification = [mechanism.notifications objectAtIndex:0];
+    XCTAssertEqualObjects(notification.messageId, @"message id");
+    XCTAssertEqualObjects(notification.challenge, @"challenge_data");
+    XCTAssertEqualObjects(notification.loadBalancerCookie, @"amlbcookie=01");
+    XCTAssertEqual(notification.timeToLive, (NSTimeInterval)120.0);
+}
+
+- (void)testGetAllIdentitiesRewritesMechanismsStoredAsJSON {
+    // Given
+    id mockSqlOperations = OCMClassMock([FRAIdentityDatabaseSQLiteOperations class]);
+    OCMStub([mockIdentityDatabase sqlOperations]).andReturn(mockSqlOperations);
+    OCMStub([mockSqlDatabase readSchema:@"read_all" withError:nil]).andReturn(ReadSchema);
+    OCMStub([mockSqlDatabase getConnectionWithError:nil]).andReturn(mockDatabase);
+    OCMStub([mockDatabase executeQuery:ReadSchema]).andReturn(mockQueryResults);
+    [self setUpDummyIdentity:TimeOtpType];
+    
+    // When
+    NSArray<FRAIdentity*>* identities = [FRAModelsFromDatabase allIdentitiesWithDatabase:mockSqlDatabase identityDatabase:mockIdentityDatabase identityModel:mockIdentityModel error:nil];
+    
+    // Then
+    FRAMechanism *mechanism = [[identities objectAtIndex:0].mechanisms objectAtIndex:0];
+    OCMVerify([mockSqlOperations updateMechanism:mechanism error:[OCMArg anyObjectRef]]);
+    [mockSqlOperations stopMocking];
+}
+
+- (void)testGetAllIdentitiesDoesNotRewriteBinaryEncodedMechanisms {
+    // Given
+    id mockSqlOperations = OCMStrictClassMock([FRAIdentityDatabaseSQLiteOperations class]);
+    OCMStub([mockIdentityDatabase sqlOperations]).andReturn(mockSqlOperations);
+    OCMStub([mockSqlDatabase readSchema:@"read_all" withError:nil]).andReturn(ReadSchema);
+    OCMStub([mockSqlDatabase getConnectionWithError:nil]).andReturn(mockDatabase);
+    OCMStub([mockDatabase executeQuery:ReadSchema]).andReturn(mockQueryResults);
+    NSData *options = [FRABinarySerialization encodeMap:@{ OATH_MECHANISM_PERIOD : @30 } schema:FRABinarySchemaTotpOptions error:nil];
+    [self setUpDummyIdentity:TimeOtpType options:options data:nil];
+    
+    // When
+    NSArray<FRAIdentity*>* identities = [FRAModelsFromDatabase allIdentitiesWithDatabase:mockSqlDatabase identityDatabase:mockIdentityDatabase identityModel:mockIdentityModel error:nil];
+    
+    // Then - the strict mock rejects any update
+    XCTAssertEqual(identities.count, 1);
+    XCTAssertEqual(((FRATotpOathMechanism *)[[identities objectAtIndex:0].mechanisms objectAtIndex:0]).period, 30);
+    [mockSqlOperations stopMocking];
+}
+
 - (void)testGetAllIdentitiesThrowsExceptionForUnknownMechanismType {
     
     OCMStub([mockSqlDatabase readSchema:@"read_all" withError:nil]).andReturn(ReadSchema);
@@ -177,7 +250,51 @@ static NSString * const Data = @"{\"message_id\":\"message id\", \"push_challeng
     XCTAssertThrows([FRAModelsFromDatabase allIdentitiesWithDatabase:mockSqlDatabase identityDatabase:mockIdentityDatabase identityModel:mockIdentityModel error:nil]);
 }
 
+- (void)testRestoreOptionsChangingWithUseSetsHotpCounterFromDatabase {
+    
+    FRAIdentity *identity = [self identityWithHotpMechanism];
+    OCMStub([mockSqlDatabase readSchema:@"read_mechanism_options" withError:[OCMArg anyObjectRef]]).andReturn(ReadSchema);
+    OCMStub([mockSqlDatabase getConnectionWithError:[OCMArg anyObjectRef]]).andReturn(mockDatabase);
+    OCMStub([mockDatabase executeQuery:ReadSchema values:@[HMACOtpType] error:[OCMArg anyObjectRef]]).andReturn(mockQueryResults);
+    OCMExpect([mockQueryResults next]).andReturn(YES);
+    OCMStub([mockQueryResults stringForColumn:@"idIssuer"]).andReturn(Issuer);
+    OCMStub([mockQueryResults stringForColumn:@"idAccountName"]).andReturn(AccountName);
+    OCMStub([mockQueryResults dataForColumn:@"options"]).andReturn([@"{\"counter\":\"7\"}" dataUsingEncoding:NSUTF8StringEncoding]);
+    OCMExpect([mockQueryResults next]).andReturn(NO);
+    
+    BOOL restored = [FRAModelsFromDatabase restoreOptionsChangingWithUseWithDatabase:mockSqlDatabase toIdentities:@[identity] error:nil];
+    
+    XCTAssertTrue(restored);
+    XCTAssertEqual(((FRAHotpOathMechanism *)[identity mechanismOfClass:[FRAHotpOathMechanism class]]).counter, 7);
+}
+
+- (void)testRestoreOptionsChangingWithUseFailsIfMechanismIsMissingFromDatabase {
+    
+    FRAIdentity *identity = [self identityWithHotpMechanism];
+    OCMStub([mockSqlDatabase readSchema:@"read_mechanism_options" withError:[OCMArg anyObjectRef]]).andReturn(ReadSchema);
+    OCMStub([mockSqlDatabase getConnectionWithError:[OCMArg anyObjectRef]]).andReturn(mockDatabase);
+    OCMStub([mockDatabase executeQuery:ReadSchema values:@[HMACOtpType] error:[OCMArg anyObjectRef]]).andReturn(mockQueryResults);
+    OCMExpect([mockQueryResults next]).andReturn(NO);
+    NSError *error;
+    
+    BOOL restored = [FRAModelsFromDatabase restoreOptionsChangingWithUseWithDatabase:mockSqlDatabase toIdentities:@[identity] error:&error];
+    
+    XCTAssertFalse(restored);
+    XCTAssertNotNil(error);
+}
+
+- (FRAIdentity *)identityWithHotpMechanism {
+    FRAIdentity *identity = [FRAIdentity identityWithDatabase:nil identityModel:nil accountName:AccountName issuer:Issuer image:nil backgroundColor:nil];
+    NSData *secret = [@"12345678901234567890" dataUsingEncoding:NSUTF8StringEncoding];
+    [identity addMechanism:[FRAHotpOathMechanism mechanismWithDatabase:nil identityModel:nil secretKey:secret HMACAlgorithm:kCCHmacAlgSHA1 codeLength:6 counter:0] error:nil];
+    return identity;
+}
+
 - (void)setUpDummyIdentity:(NSString *)type {
+    [self setUpDummyIdentity:type options:[Options dataUsingEncoding:NSUTF8StringEncoding] data:[Data dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)setUpDummyIdentity:(NSString *)type options:(NSData *)options data:(NSData *)data {
     OCMExpect([mockQueryResults next]).andReturn(YES);
     OCMStub([mockQueryResults stringForColumn:@"issuer"]).andReturn(Issuer);
     OCMStub([mockQueryResults stringForColumn:@"accountName"]).andReturn(AccountName);
@@ -186,10 +303,10 @@ static NSString * const Data = @"{\"message_id\":\"message id\", \"push_challeng
     OCMStub([mockQueryResults stringForColumn:@"type"]).andReturn(type);
     OCMStub([mockQueryResults stringForColumn:@"version"]).andReturn(Version);
     OCMStub([mockQueryResults stringForColumn:@"mechanismUID"]).andReturn(MechanismUID);
-    OCMStub([mockQueryResults stringForColumn:@"options"]).andReturn(Options);
+    OCMStub([mockQueryResults dataForColumn:@"options"]).andReturn(options);
     OCMStub([mockQueryResults stringForColumn:@"timeReceived"]).andReturn(TimeReceived);
     OCMStub([mockQueryResults stringForColumn:@"timeExpired"]).andReturn(TimeExpired);
-    OCMStub([mockQueryResults stringForColumn:@"data"]).andReturn(Data);
+    OCMStub([mockQueryResults dataForColumn:@"data"]).andReturn(data);
     OCMStub([mockQueryResults intForColumn:@"pending"]).andReturn(-1);
     OCMStub([mockQueryResults intForColumn:@"approved"]).andReturn(0);
     OCMExpect([mockQueryResults next]).andReturn(NO);
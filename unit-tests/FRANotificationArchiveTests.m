@@ -0,0 +1,197 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRANotification.h"
+#import "FRANotificationArchive.h"
+
+static NSString * const MECHANISM_UID = @"mechanism";
+static const NSTimeInterval OneDay = 24 * 60 * 60;
+
+@interface FRANotificationArchiveTests : XCTestCase
+
+@end
+
+@implementation FRANotificationArchiveTests {
+    NSString *directory;
+    FRANotificationArchive *archive;
+}
+
+- (void)setUp {
+    [super setUp];
+    directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    archive = [[FRANotificationArchive alloc] initWithDirectory:directory];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+    [super tearDown];
+}
+
+- (void)testReadsBackAppendedNotificationsMostRecentFirst {
+    // Given
+    FRANotification *older = [self approvedNotificationReceivedDaysAgo:3];
+    FRANotification *newer = [self deniedNotificationReceivedDaysAgo:2];
+    [archive appendNotifications:@[newer, older] mechanismUID:MECHANISM_UID error:nil];
+    
+    // When
+    NSArray<FRANotification *> *page = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil];
+    
+    // Then
+    XCTAssertEqual(page.count, 2);
+    XCTAssertEqualObjects(page[0].messageId, newer.messageId);
+    XCTAssertTrue(page[0].isDenied);
+    XCTAssertEqualObjects(page[1].messageId, older.messageId);
+    XCTAssertTrue(page[1].isApproved);
+    XCTAssertEqualWithAccuracy([page[1].timeReceived timeIntervalSinceReferenceDate], [older.timeReceived timeIntervalSinceReferenceDate], 0.001);
+    XCTAssertNil(page[1].parent);
+}
+
+- (void)testDropsRepeatedAppendOfSameMessageButKeepsMessagesReceivedAtSameTime {
+    // Given
+    FRANotification *first = [self approvedNotificationReceivedDaysAgo:1];
+    FRANotification *second = [FRANotification notificationWithDatabase:nil
+                                                          identityModel:nil
+                                                              messageId:[[NSUUID UUID] UUIDString]
+                                                              challenge:@"challenge"
+                                                           timeReceived:first.timeReceived
+                                                             timeToLive:120.0
+                                                 loadBalancerCookieData:@"amlbcookie=01"];
+    [archive appendNotifications:@[first, second] mechanismUID:MECHANISM_UID error:nil];
+    [archive appendNotifications:@[first] mechanismUID:MECHANISM_UID error:nil];
+    
+    // When
+    NSArray<FRANotification *> *page = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil];
+    
+    // Then
+    XCTAssertEqual(page.count, 2);
+    NSSet *messageIds = [NSSet setWithArray:[page valueForKey:@"messageId"]];
+    XCTAssertEqualObjects(messageIds, ([NSSet setWithObjects:first.messageId, second.messageId, nil]));
+}
+
+- (void)testPagesAcrossBlocks {
+    // Given
+    for (NSInteger block = 0; block < 3; block++) {
+        NSMutableArray<FRANotification *> *notifications = [[NSMutableArray alloc] init];
+        for (NSInteger i = 0; i < 4; i++) {
+            [notifications addObject:[self approvedNotificationReceivedDaysAgo:20 - block * 4 - i]];
+        }
+        [archive appendNotifications:notifications mechanismUID:MECHANISM_UID error:nil];
+    }
+    
+    // When
+    NSArray<FRANotification *> *first = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:5 error:nil];
+    NSArray<FRANotification *> *second = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:[first lastObject].timeReceived limit:5 error:nil];
+    NSArray<FRANotification *> *third = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:[second lastObject].timeReceived limit:5 error:nil];
+    
+    // Then
+    XCTAssertEqual(first.count, 5);
+    XCTAssertEqual(second.count, 5);
+    XCTAssertEqual(third.count, 2);
+    XCTAssertEqual([first[0].timeReceived compare:first[1].timeReceived], NSOrderedDescending);
+    XCTAssertEqual([[first lastObject].timeReceived compare:second[0].timeReceived], NSOrderedDescending);
+}
+
+- (void)testOnlyReturnsNotificationsOfRequestedMechanism {
+    // Given
+    FRANotification *notification = [self approvedNotificationReceivedDaysAgo:2];
+    [archive appendNotifications:@[notification] mechanismUID:MECHANISM_UID error:nil];
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:1]] mechanismUID:@"other" error:nil];
+    
+    // When
+    NSArray<FRANotification *> *page = [archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil];
+    
+    // Then
+    XCTAssertEqual(page.count, 1);
+    XCTAssertEqualObjects(page[0].messageId, notification.messageId);
+}
+
+- (void)testReopensArchiveFromDisk {
+    // Given
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:2]] mechanismUID:MECHANISM_UID error:nil];
+    
+    // When
+    FRANotificationArchive *reopened = [[FRANotificationArchive alloc] initWithDirectory:directory];
+    NSArray<FRANotification *> *page = [reopened notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil];
+    
+    // Then
+    XCTAssertEqual(page.count, 1);
+}
+
+- (void)testTruncatesTornBlockWhenReopened {
+    // Given
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:2]] mechanismUID:MECHANISM_UID error:nil];
+    NSString *segment = [directory stringByAppendingPathComponent:[[[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:nil] firstObject]];
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:segment];
+    [handle seekToEndOfFile];
+    [handle writeData:[@"FBLK partial block" dataUsingEncoding:NSUTF8StringEncoding]];
+    [handle closeFile];
+    
+    // When
+    FRANotificationArchive *reopened = [[FRANotificationArchive alloc] initWithDirectory:directory];
+    BOOL appended = [reopened appendNotifications:@[[self approvedNotificationReceivedDaysAgo:1]] mechanismUID:MECHANISM_UID error:nil];
+    NSArray<FRANotification *> *page = [reopened notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil];
+    
+    // Then
+    XCTAssertTrue(appended);
+    XCTAssertEqual(page.count, 2);
+}
+
+- (void)testRemovesSegmentsOlderThanCutoff {
+    // Given
+    archive.maximumSegmentSize = 1;
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:40]] mechanismUID:MECHANISM_UID error:nil];
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:35]] mechanismUID:MECHANISM_UID error:nil];
+    [archive appendNotifications:@[[self approvedNotificationReceivedDaysAgo:5]] mechanismUID:MECHANISM_UID error:nil];
+    XCTAssertEqual([archive segmentCountWithError:nil], 3);
+    
+    // When
+    BOOL removed = [archive removeSegmentsOlderThan:[NSDate dateWithTimeIntervalSinceNow:-30 * OneDay] error:nil];
+    
+    // Then
+    XCTAssertTrue(removed);
+    XCTAssertEqual([archive segmentCountWithError:nil], 1);
+    XCTAssertEqual([archive notificationsWithMechanismUID:MECHANISM_UID receivedBefore:nil limit:10 error:nil].count, 1);
+}
+
+#pragma mark -
+#pragma mark Helper Functions
+
+- (FRANotification *)approvedNotificationReceivedDaysAgo:(NSInteger)days {
+    FRANotification *notification = [self notificationReceivedDaysAgo:days];
+    [notification approveWithHandler:nil error:nil];
+    return notification;
+}
+
+- (FRANotification *)deniedNotificationReceivedDaysAgo:(NSInteger)days {
+    FRANotification *notification = [self notificationReceivedDaysAgo:days];
+    [notification denyWithHandler:nil error:nil];
+    return notification;
+}
+
+- (FRANotification *)notificationReceivedDaysAgo:(NSInteger)days {
+    return [FRANotification notificationWithDatabase:nil
+                                       identityModel:nil
+                                           messageId:[[NSUUID UUID] UUIDString]
+                                           challenge:@"challenge"
+                                        timeReceived:[NSDate dateWithTimeIntervalSinceNow:-days * OneDay]
+                                          timeToLive:120.0
+                              loadBalancerCookieData:@"amlbcookie=01"];
+}
+
+@end
@@ -0,0 +1,270 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+#import "FRAIdentity.h"
+#import "FRAIdentityDatabase.h"
+#import "FRAIdentityModel.h"
+#import "FRAMechanism.h"
+#import "FRANotification.h"
+#import "FRANotificationArchive.h"
+#import "FRANotificationCompactor.h"
+#import "FRANotificationRetentionPolicy.h"
+#import "FRANotificationStore.h"
+#import "FRAPushMechanism.h"
+
+static const NSTimeInterval OneDay = 24 * 60 * 60;
+
+@interface FRANotificationCompactorTests : XCTestCase
+
+@end
+
+@implementation FRANotificationCompactorTests {
+    id mockIdentityModel;
+    id mockDatabase;
+    FRAIdentity *identity;
+    FRAMechanism *mechanism;
+}
+
+- (void)setUp {
+    [super setUp];
+    mockIdentityModel = OCMClassMock([FRAIdentityModel class]);
+    mockDatabase = OCMClassMock([FRAIdentityDatabase class]);
+    identity = [FRAIdentity identityWithDatabase:nil identityModel:nil accountName:@"alice" issuer:@"ForgeRock" image:nil backgroundColor:nil];
+    mechanism = [[FRAMechanism alloc] initWithDatabase:nil identityModel:nil];
+    [identity addMechanism:mechanism error:nil];
+    OCMStub([mockIdentityModel identities]).andReturn(@[identity]);
+}
+
+- (void)tearDown {
+    [mockIdentityModel stopMocking];
+    [mockDatabase stopMocking];
+    [super tearDown];
+}
+
+- (void)testSelectsNotificationsOlderThanMaximumAge {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:7 * OneDay maximumCount:0 keepPending:YES];
+    FRANotification *old = [self approvedNotificationReceivedDaysAgo:10];
+    [mechanism addNotification:old error:nil];
+    [mechanism addNotification:[self approvedNotificationReceivedDaysAgo:1] error:nil];
+    
+    // When
+    NSArray *notifications = [compactor notificationsToRemoveFromMechanism:mechanism limit:100];
+    
+    // Then
+    XCTAssertEqualObjects(notifications, @[old]);
+}
+
+- (void)testSelectsOldestNotificationsBeyondMaximumCount {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:0 maximumCount:2 keepPending:YES];
+    FRANotification *oldest = [self approvedNotificationReceivedDaysAgo:3];
+    [mechanism addNotification:[self approvedNotificationReceivedDaysAgo:1] error:nil];
+    [mechanism addNotification:oldest error:nil];
+    [mechanism addNotification:[self approvedNotificationReceivedDaysAgo:2] error:nil];
+    
+    // When
+    NSArray *notifications = [compactor notificationsToRemoveFromMechanism:mechanism limit:100];
+    
+    // Then
+    XCTAssertEqualObjects(notifications, @[oldest]);
+}
+
+- (void)testKeepsPendingNotificationsWhenPolicyRequires {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:0 maximumCount:1 keepPending:YES];
+    [mechanism addNotification:[self pendingNotification] error:nil];
+    [mechanism addNotification:[self pendingNotification] error:nil];
+    
+    // When
+    NSArray *notifications = [compactor notificationsToRemoveFromMechanism:mechanism limit:100];
+    
+    // Then
+    XCTAssertEqual(notifications.count, 0);
+}
+
+- (void)testSelectsPendingNotificationsWhenPolicyAllows {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:0 maximumCount:1 keepPending:NO];
+    FRANotification *approved = [self approvedNotificationReceivedDaysAgo:1];
+    [mechanism addNotification:approved error:nil];
+    [mechanism addNotification:[self pendingNotification] error:nil];
+    
+    // When
+    NSArray *notifications = [compactor notificationsToRemoveFromMechanism:mechanism limit:100];
+    
+    // Then
+    XCTAssertEqualObjects(notifications, @[approved]);
+}
+
+- (void)testCompactionRemovesNotificationsInBatchesAndVacuums {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:7 * OneDay maximumCount:0 keepPending:YES];
+    compactor.batchSize = 2;
+    for (NSInteger i = 0; i < 5; i++) {
+        [mechanism addNotification:[self approvedNotificationReceivedDaysAgo:10 + i] error:nil];
+    }
+    [mechanism addNotification:[self approvedNotificationReceivedDaysAgo:1] error:nil];
+    NSInteger pages = 3;
+    OCMStub([mockDatabase incrementalVacuumReclaimingPages:[OCMArg setToValue:OCMOCK_VALUE(pages)] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    XCTestExpectation *expectation = [self expectationWithDescription:@"compaction"];
+    __block NSUInteger removed = 0;
+    __block NSInteger reclaimed = 0;
+    
+    // When
+    [compactor compactWithCompletion:^(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error) {
+        removed = removedNotifications;
+        reclaimed = reclaimedPages;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    
+    // Then
+    XCTAssertEqual(removed, 5);
+    XCTAssertEqual(reclaimed, 3);
+    XCTAssertEqual(mechanism.notificationHistory.count, 1);
+}
+
+- (void)testCompactionDoesNotConvertDatabaseForIncrementalVacuum {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:7 * OneDay maximumCount:0 keepPending:YES];
+    OCMStub([mockDatabase incrementalVacuumReclaimingPages:[OCMArg anyPointer] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    OCMReject([mockDatabase enableIncrementalVacuumWithError:[OCMArg anyObjectRef]]);
+    XCTestExpectation *compacted = [self expectationWithDescription:@"compaction"];
+
+    // When
+    [compactor compactWithCompletion:^(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error) {
+        [compacted fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    // Then
+    OCMVerify([mockDatabase incrementalVacuumReclaimingPages:[OCMArg anyPointer] error:[OCMArg anyObjectRef]]);
+}
+
+- (void)testEnableIncrementalVacuumConvertsDatabaseOnCompactionQueue {
+    // Given
+    FRANotificationCompactor *compactor = [self compactorWithMaximumAge:7 * OneDay maximumCount:0 keepPending:YES];
+    OCMStub([mockDatabase enableIncrementalVacuumWithError:[OCMArg anyObjectRef]]).andReturn(YES);
+    XCTestExpectation *converted = [self expectationWithDescription:@"conversion"];
+
+    // When
+    [compactor enableIncrementalVacuumWithCompletion:^(NSError *error) {
+        XCTAssertNil(error);
+        [converted fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    // Then
+    OCMVerify([mockDatabase enableIncrementalVacuumWithError:[OCMArg anyObjectRef]]);
+}
+
+- (void)testCompactionMovesOldResolvedNotificationsIntoArchive {
+    // Given
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    FRANotificationArchive *archive = [[FRANotificationArchive alloc] initWithDirectory:directory];
+    FRAPushMechanism *pushMechanism = [FRAPushMechanism pushMechanismWithDatabase:nil identityModel:nil authEndpoint:@"http://service.endpoint" secret:@"secret" version:1 mechanismIdentifier:@"push"];
+    [identity addMechanism:pushMechanism error:nil];
+    FRANotification *old = [self approvedNotificationReceivedDaysAgo:3];
+    [pushMechanism addNotification:old error:nil];
+    [pushMechanism addNotification:[self approvedNotificationReceivedDaysAgo:40] error:nil];
+    [pushMechanism addNotification:[self approvedNotificationReceivedDaysAgo:0] error:nil];
+    FRANotificationRetentionPolicy *policy = [[FRANotificationRetentionPolicy alloc] initWithMaximumAge:30 * OneDay maximumCountPerMechanism:0 keepPending:YES archiveAge:OneDay];
+    FRANotificationCompactor *compactor = [[FRANotificationCompactor alloc] initWithIdentityModel:mockIdentityModel database:mockDatabase archive:archive policy:policy];
+    OCMStub([mockDatabase incrementalVacuumReclaimingPages:[OCMArg anyPointer] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    XCTestExpectation *expectation = [self expectationWithDescription:@"compaction"];
+    __block NSUInteger removed = 0;
+    
+    // When
+    [compactor compactWithCompletion:^(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error) {
+        removed = removedNotifications;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    
+    // Then
+    NSArray<FRANotification *> *archived = [archive notificationsWithMechanismUID:@"push" receivedBefore:nil limit:10 error:nil];
+    XCTAssertEqual(removed, 2);
+    XCTAssertEqual(pushMechanism.notificationHistory.count, 1);
+    XCTAssertEqual(archived.count, 1);
+    XCTAssertEqualObjects(archived[0].messageId, old.messageId);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+}
+
+- (void)testArchivingInBatchesContinuesPastSkippedNotifications {
+    // Given
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    FRANotificationArchive *archive = [[FRANotificationArchive alloc] initWithDirectory:directory];
+    FRAPushMechanism *pushMechanism = [FRAPushMechanism pushMechanismWithDatabase:nil identityModel:nil authEndpoint:@"http://service.endpoint" secret:@"secret" version:1 mechanismIdentifier:@"push"];
+    [identity addMechanism:pushMechanism error:nil];
+    for (NSInteger days = 3; days <= 5; days++) {
+        [pushMechanism addNotification:[self approvedNotificationReceivedDaysAgo:days] error:nil];
+        [pushMechanism addNotification:[self approvedNotificationReceivedDaysAgo:37 + days] error:nil];
+    }
+    FRANotificationRetentionPolicy *policy = [[FRANotificationRetentionPolicy alloc] initWithMaximumAge:30 * OneDay maximumCountPerMechanism:0 keepPending:YES archiveAge:OneDay];
+    FRANotificationCompactor *compactor = [[FRANotificationCompactor alloc] initWithIdentityModel:mockIdentityModel database:mockDatabase archive:archive policy:policy];
+    compactor.batchSize = 1;
+    OCMStub([mockDatabase incrementalVacuumReclaimingPages:[OCMArg anyPointer] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    XCTestExpectation *expectation = [self expectationWithDescription:@"compaction"];
+
+    // When
+    [compactor compactWithCompletion:^(NSUInteger removedNotifications, NSInteger reclaimedPages, NSError *error) {
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    // Then
+    NSArray<FRANotification *> *archived = [archive notificationsWithMechanismUID:@"push" receivedBefore:nil limit:10 error:nil];
+    XCTAssertEqual(archived.count, 3);
+    XCTAssertEqual(pushMechanism.notificationHistory.count, 0);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+}
+
+#pragma mark -
+#pragma mark Helper Functions
+
+- (FRANotificationCompactor *)compactorWithMaximumAge:(NSTimeInterval)maximumAge maximumCount:(NSUInteger)maximumCount keepPending:(BOOL)keepPending {
+    FRANotificationRetentionPolicy *policy = [[FRANotificationRetentionPolicy alloc] initWithMaximumAge:maximumAge maximumCountPerMechanism:maximumCount keepPending:keepPending];
+    return [[FRANotificationCompactor alloc] initWithIdentityModel:mockIdentityModel database:mockDatabase policy:policy];
+}
+
+- (FRANotification *)pendingNotification {
+    return [self notificationReceivedAt:[NSDate date]];
+}
+
+- (FRANotification *)approvedNotificationReceivedDaysAgo:(NSInteger)days {
+    FRANotification *notification = [self notificationReceivedAt:[NSDate dateWithTimeIntervalSinceNow:-days * OneDay]];
+    [notification approveWithHandler:nil error:nil];
+    return notification;
+}
+
+- (FRANotification *)notificationReceivedAt:(NSDate *)timeReceived {
+    return [FRANotification notificationWithDatabase:nil
+                                       identityModel:nil
+                                           messageId:[[NSUUID UUID] UUIDString]
+                                           challenge:@"challenge"
+                                        timeReceived:timeReceived
+                                          timeToLive:120.0
+                              loadBalancerCookieData:nil];
+}
+
+@end
@@ -0,0 +1,151 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "FRAMechanism.h"
+#import "FRANotification.h"
+#import "FRANotificationExpiryQueue.h"
+#import "FRANotificationStore.h"
+
+@interface FRANotificationExpiryQueueTests : XCTestCase
+
+@end
+
+@implementation FRANotificationExpiryQueueTests {
+    FRANotificationExpiryQueue *queue;
+    FRAMechanism *mechanism;
+}
+
+- (void)setUp {
+    [super setUp];
+    queue = [[FRANotificationExpiryQueue alloc] init];
+    mechanism = [[FRAMechanism alloc] initWithDatabase:nil identityModel:nil];
+}
+
+- (void)testNextExpiryIsEarliestQueuedExpiry {
+    // Given
+    FRANotification *late = [self notificationExpiringIn:300.0];
+    FRANotification *early = [self notificationExpiringIn:60.0];
+    FRANotification *middle = [self notificationExpiringIn:120.0];
+    
+    // When
+    [queue addNotification:late];
+    [queue addNotification:early];
+    [queue addNotification:middle];
+    
+    // Then
+    XCTAssertEqual(queue.count, 3);
+    XCTAssertEqualObjects([queue nextExpiry], early.timeExpired);
+}
+
+- (void)testRemovingNotificationUpdatesNextExpiry {
+    // Given
+    FRANotification *early = [self notificationExpiringIn:60.0];
+    FRANotification *late = [self notificationExpiringIn:300.0];
+    [queue addNotification:early];
+    [queue addNotification:late];
+    
+    // When
+    [queue removeNotification:early];
+    
+    // Then
+    XCTAssertEqual(queue.count, 1);
+    XCTAssertEqualObjects([queue nextExpiry], late.timeExpired);
+}
+
+- (void)testReaddingNotificationMovesItToItsNewExpiry {
+    // Given
+    FRANotification *first = [self notificationExpiringIn:60.0];
+    FRANotification *second = [self notificationExpiringIn:120.0];
+    [queue addNotification:first];
+    [queue addNotification:second];
+    
+    // When
+    first.timeExpired = [NSDate dateWithTimeIntervalSinceNow:600.0];
+    [queue addNotification:first];
+    
+    // Then
+    XCTAssertEqual(queue.count, 2);
+    XCTAssertEqualObjects([queue nextExpiry], second.timeExpired);
+}
+
+- (void)testNotificationWhichIsNotPendingIsNotQueued {
+    // Given
+    FRANotification *notification = [self notificationExpiringIn:60.0];
+    [notification approveWithHandler:nil error:nil];
+    
+    // When
+    [queue addNotification:notification];
+    
+    // Then
+    XCTAssertEqual(queue.count, 0);
+    XCTAssertNil([queue nextExpiry]);
+}
+
+- (void)testExpiresOnlyDueNotifications {
+    // Given
+    FRANotification *due = [self notificationExpiringIn:0.05];
+    FRANotification *notDue = [self notificationExpiringIn:60.0];
+    [mechanism addNotification:due error:nil];
+    [mechanism addNotification:notDue error:nil];
+    [queue addNotification:due];
+    [queue addNotification:notDue];
+    [NSThread sleepForTimeInterval:0.1];
+    
+    // When
+    NSArray *expired = [queue expireDueNotifications];
+    
+    // Then
+    XCTAssertEqualObjects(expired, @[due]);
+    XCTAssertEqual(queue.count, 1);
+    XCTAssertEqual([mechanism pendingNotificationsCount], 1);
+    XCTAssertEqual(mechanism.activeNotifications.count, 1);
+    XCTAssertEqual(mechanism.notificationHistory.count, 1);
+}
+
+- (void)testTimerExpiresNotificationWhenItFallsDue {
+    // Given
+    FRANotification *notification = [self notificationExpiringIn:0.05];
+    [mechanism addNotification:notification error:nil];
+    
+    // When
+    [queue addNotification:notification];
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    
+    // Then
+    XCTAssertEqual(queue.count, 0);
+    XCTAssertTrue([notification isExpired]);
+    XCTAssertEqual([mechanism pendingNotificationsCount], 0);
+    XCTAssertEqual(mechanism.activeNotifications.count, 0);
+}
+
+#pragma mark -
+#pragma mark Helper Functions
+
+- (FRANotification *)notificationExpiringIn:(NSTimeInterval)interval {
+    NSTimeInterval timeToLive = 120.0;
+    return [FRANotification notificationWithDatabase:nil
+                                       identityModel:nil
+                                           messageId:[[NSUUID UUID] UUIDString]
+                                           challenge:@"challenge"
+                                        timeReceived:[NSDate dateWithTimeIntervalSinceNow:interval - timeToLive]
+                                          timeToLive:timeToLive
+                              loadBalancerCookieData:nil];
+}
+
+@end
@@ -18,6 +18,7 @@
 
 #import <XCTest/XCTest.h>
 
+#import "FRABackgroundPushScheduler.h"
 #import "FRANotificationGateway.h"
 #import "FRANotificationHandler.h"
 
@@ -27,6 +28,7 @@
 
 @implementation FRANotificationGatewayTests {
     id mockNotificationHandler;
+    id mockScheduler;
     id mockApplication;
     FRANotificationGateway *notificationGateway;
 }
@@ -35,11 +37,13 @@
     [super setUp];
     mockApplication = OCMClassMock([UIApplication class]);
     mockNotificationHandler = OCMClassMock([FRANotificationHandler class]);
-    notificationGateway = [FRANotificationGateway gatewayWithHandler:mockNotificationHandler];
+    mockScheduler = OCMClassMock([FRABackgroundPushScheduler class]);
+    notificationGateway = [FRANotificationGateway gatewayWithHandler:mockNotificationHandler scheduler:mockScheduler];
 }
 
 - (void)tearDown {
     [mockNotificationHandler stopMocking];
+    [mockScheduler stopMocking];
     [mockApplication stopMocking];
     [super tearDown];
 }
@@ -55,16 +59,42 @@
     OCMVerify([mockNotificationHandler application:mockApplication didReceiveRemoteNotification:notification]);
 }
 
-- (void)testBackgroundPropagatesPushNotificationsToRegisteredHandler {
+- (void)testBackgroundPropagatesPushNotificationsToScheduler {
     // Given
     NSDictionary *notification = @{};
+    void (^completionHandler)(UIBackgroundFetchResult) = ^(UIBackgroundFetchResult result){};
+    
     // When
     [notificationGateway application:mockApplication
         didReceiveRemoteNotification:notification
-              fetchCompletionHandler:^(UIBackgroundFetchResult result){}];
+              fetchCompletionHandler:completionHandler];
     
     // Then
-    OCMVerify([mockNotificationHandler application:mockApplication didReceiveRemoteNotification:notification]);
+    OCMVerify([mockScheduler application:mockApplication processRemoteNotification:notification completionHandler:completionHandler]);
+}
+
+- (void)testBackgroundDoesNotReportResultBeforeProcessing {
+    // Given
+    NSDictionary *notification = @{};
+    __block BOOL reported = NO;
+    
+    // When
+    [notificationGateway application:mockApplication
+        didReceiveRemoteNotification:notification
+              fetchCompletionHandler:^(UIBackgroundFetchResult result){
+                  reported = YES;
+              }];
+    
+    // Then
+    XCTAssertFalse(reported, @"The result should be reported by the scheduler once processing finishes");
+}
+
+- (void)testResumesDeferredWorkWithScheduler {
+    // When
+    [notificationGateway resumeDeferredWorkWithApplication:mockApplication];
+    
+    // Then
+    OCMVerify([mockScheduler resumeDeferredWorkWithApplication:mockApplication completion:[OCMArg any]]);
 }
 
 @end
@@ -27,6 +27,7 @@
 #import "FRANotification.h"
 #import "FRANotificationHandler.h"
 #import "FRAPushMechanism.h"
+#import "FRASeenMessageFilter.h"
 #import "FRAFMDatabaseConnectionHelper.h"
 
 @interface FRANotificationHandlerTest : XCTestCase
@@ -35,6 +36,8 @@
 
 static NSString *const TEST_USERNAME = @"Alice";
 static NSString *const CHALLENGE = @"dGhlbGVnZW5kb2ZsdW5h";
+static NSString *const SIGNED_JWT = @"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.uOWDShBAG4JtJLrTkRLdJ8-6JQXRYRpnXqd54q_QlYA";
+static NSTimeInterval const TEST_TIMEOUT = 10.0;
 
 @implementation FRANotificationHandlerTest {
     FRANotificationHandler *handler;
@@ -64,6 +67,7 @@ static NSString *const CHALLENGE = @"dGhlbGVnZW5kb2ZsdW5h";
     
     pushMechanism = [[FRAPushMechanism alloc] initWithDatabase:database identityModel:identityModel];
     [pushMechanism setValue:@"0" forKey:@"mechanismUID"];
+    [pushMechanism setValue:@"c2VjcmV0" forKey:@"secret"];
 
     oathMechanism = [[FRAHotpOathMechanism alloc] initWithDatabase:database identityModel:identityModel];
     [identityModel addIdentity:identity error:nil];
@@ -82,11 +86,25 @@ static NSString *const CHALLENGE = @"dGhlbGVnZW5kb2ZsdW5h";
     [super tearDown];
 }
 
+/*!
+ * Delivers a message and waits for the handler to finish ingesting it.
+ */
+- (FRANotification *)receiveRemoteNotification:(NSDictionary *)data {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"ingestion"];
+    __block FRANotification *result;
+    [handler application:mockApplication didReceiveRemoteNotification:data completion:^(FRANotification *notification, BOOL created) {
+        result = notification;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    return result;
+}
+
 - (void)testCreatesNotificationObjectFromMessageAndSavesToIdentifiedPushMechanism {
     // Given
-    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.1SAWJlT-5vjYRbpZ_57K-NpFRs4VZbSzZjAF_3RTu7k"}};
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.uOWDShBAG4JtJLrTkRLdJ8-6JQXRYRpnXqd54q_QlYA"}};
     // When
-    [handler application:mockApplication didReceiveRemoteNotification:data];
+    [self receiveRemoteNotification:data];
     
     // Then
     FRANotification *notification = [pushMechanism notificationWithMessageId:@"123"];
@@ -100,11 +118,11 @@ static NSString *const CHALLENGE = @"dGhlbGVnZW5kb2ZsdW5h";
 
 - (void)testNotificationHandlingShouldBeIdempotent {
     // Given
-    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.1SAWJlT-5vjYRbpZ_57K-NpFRs4VZbSzZjAF_3RTu7k"}};
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.uOWDShBAG4JtJLrTkRLdJ8-6JQXRYRpnXqd54q_QlYA"}};
     
     // When
-    [handler application:mockApplication didReceiveRemoteNotification:data];
-    [handler application:mockApplication didReceiveRemoteNotification:data];
+    [self receiveRemoteNotification:data];
+    [self receiveRemoteNotification:data];
     
     // Then
     XCTAssertEqual([pushMechanism notifications].count, 1, @"Notification handling should be idempotent");
@@ -112,14 +130,113 @@ static NSString *const CHALLENGE = @"dGhlbGVnZW5kb2ZsdW5h";
 
 - (void)testOnlyHandlesNotificationsThatReferToPushMechanism {
     // Given
-    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.1SAWJlT-5vjYRbpZ_57K-NpFRs4VZbSzZjAF_3RTu7k"}};
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.uOWDShBAG4JtJLrTkRLdJ8-6JQXRYRpnXqd54q_QlYA"}};
     
     // When
-    [handler application:mockApplication didReceiveRemoteNotification:data];
+    [self receiveRemoteNotification:data];
     
     // Then
     XCTAssertEqual([oathMechanism notifications].count, 0, @"Only Push-Mechanism notifications should be handled");
     XCTAssertEqual([pushMechanism notifications].count, 1, @"Only Push-Mechanism notifications should be handled");
 }
 
+- (void)testIgnoresNotificationWithInvalidSignature {
+    // Given
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.1SAWJlT-5vjYRbpZ_57K-NpFRs4VZbSzZjAF_3RTu7k"}};
+    
+    // When
+    [self receiveRemoteNotification:data];
+    
+    // Then
+    XCTAssertEqual([pushMechanism notifications].count, 0, @"Notifications with an invalid signature should be ignored");
+}
+
+- (void)testIgnoresMalformedNotification {
+    // Given
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0"}};
+    
+    // When
+    [self receiveRemoteNotification:data];
+    
+    // Then
+    XCTAssertEqual([pushMechanism notifications].count, 0, @"Malformed notifications should be ignored");
+}
+
+- (void)testIngestsOffMainThreadAndCompletesOnMainThread {
+    // Given
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":SIGNED_JWT}};
+    XCTestExpectation *expectation = [self expectationWithDescription:@"ingestion"];
+    __block BOOL completedOnMainThread = NO;
+    __block BOOL notificationCreated = NO;
+    
+    // When
+    [handler application:mockApplication didReceiveRemoteNotification:data completion:^(FRANotification *notification, BOOL created) {
+        completedOnMainThread = [NSThread isMainThread];
+        notificationCreated = created;
+        [expectation fulfill];
+    }];
+    BOOL ingestedBeforeReturning = [pushMechanism notificationWithMessageId:@"123"] != nil;
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertFalse(ingestedBeforeReturning, @"Ingestion should not block the delivering thread");
+    XCTAssertTrue(completedOnMainThread);
+    XCTAssertTrue(notificationCreated);
+}
+
+- (void)testCountsMessagesThroughEachStage {
+    // Given
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":SIGNED_JWT}};
+    
+    // When
+    [self receiveRemoteNotification:data];
+    [self receiveRemoteNotification:data];
+    
+    // Then
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionDecodeStage], 2);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionRouteStage], 2);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionDedupeStage], 2);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionPersistStage], 1, @"A duplicate message should not be persisted");
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionPresentStage], 2);
+    XCTAssertGreaterThan([handler totalLatencyForStage:FRAPushIngestionDecodeStage], 0);
+    XCTAssertGreaterThan([handler totalLatencyForStage:FRAPushIngestionPersistStage], 0);
+    for (FRAPushIngestionStage stage = 0; stage < FRAPushIngestionStageCount; stage++) {
+        XCTAssertGreaterThanOrEqual([handler maximumLatencyForStage:stage], [handler averageLatencyForStage:stage]);
+    }
+}
+
+- (void)testStopsAtDecodeStageForMalformedMessage {
+    // Given
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":@"not a jwt"}};
+    
+    // When
+    FRANotification *notification = [self receiveRemoteNotification:data];
+    
+    // Then
+    XCTAssertNil(notification);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionDecodeStage], 1);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionRouteStage], 0);
+    XCTAssertEqual([handler averageLatencyForStage:FRAPushIngestionRouteStage], 0);
+}
+
+- (void)testRedeliveredMessageSkipsDecodingWhenSeen {
+    // Given
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    FRASeenMessageFilter *filter = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:100 recentCapacity:10];
+    handler.seenMessageFilter = filter;
+    NSDictionary *data = @{@"aps":@{@"messageId":@"123", @"data":SIGNED_JWT}};
+    FRANotification *first = [self receiveRemoteNotification:data];
+    
+    // When
+    FRANotification *redelivered = [self receiveRemoteNotification:data];
+    
+    // Then
+    XCTAssertEqual(redelivered, first, @"The existing notification should be presented again");
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionFilterStage], 2);
+    XCTAssertEqual([handler messageCountForStage:FRAPushIngestionDecodeStage], 1);
+    XCTAssertEqual([pushMechanism notifications].count, 1);
+    [filter flush];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
 @end
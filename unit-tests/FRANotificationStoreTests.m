@@ -0,0 +1,181 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "FRAMechanism.h"
+#import "FRANotification.h"
+#import "FRANotificationStore.h"
+
+@interface FRANotificationStoreTests : XCTestCase
+
+@end
+
+@implementation FRANotificationStoreTests {
+    FRAMechanism *mechanism;
+    FRANotificationStore *store;
+}
+
+- (void)setUp {
+    [super setUp];
+    mechanism = [[FRAMechanism alloc] initWithDatabase:nil identityModel:nil];
+    store = [[FRANotificationStore alloc] initWithDatabase:nil identityModel:nil mechanism:mechanism];
+}
+
+- (void)testNotificationsAreKeptInOrderOfTimeReceived {
+    // Given
+    FRANotification *older = [self approvedNotificationWithMessageId:@"older" receivedAt:100.0];
+    FRANotification *newer = [self approvedNotificationWithMessageId:@"newer" receivedAt:200.0];
+    
+    // When
+    NSUInteger newerIndex = [store addNotification:newer];
+    NSUInteger olderIndex = [store addNotification:older];
+    
+    // Then
+    XCTAssertEqual(newerIndex, 0);
+    XCTAssertEqual(olderIndex, 0);
+    XCTAssertEqual(store.count, 2);
+    XCTAssertEqual([store notificationAtIndex:0], older);
+    XCTAssertEqual([store notificationAtIndex:1], newer);
+}
+
+- (void)testReleasedNotificationIsMaterializedFromColumns {
+    // Given
+    @autoreleasepool {
+        FRANotification *notification = [self approvedNotificationWithMessageId:@"message id" receivedAt:500.0];
+        [store addNotification:notification];
+    }
+    
+    // When
+    FRANotification *notification = [store notificationAtIndex:0];
+    
+    // Then
+    XCTAssertEqualObjects(notification.messageId, @"message id");
+    XCTAssertEqualObjects(notification.challenge, @"challenge");
+    XCTAssertEqualObjects(notification.loadBalancerCookie, @"cookie");
+    XCTAssertEqualObjects(notification.timeReceived, [NSDate dateWithTimeIntervalSince1970:500.0]);
+    XCTAssertEqual(notification.timeToLive, (NSTimeInterval)120.0);
+    XCTAssertTrue([notification isApproved]);
+    XCTAssertEqual(notification.parent, mechanism);
+    XCTAssertEqual([store notificationAtIndex:0], notification, @"Live materialized notification should be reused");
+}
+
+- (void)testDeniedAndExpiredStatesAreRetained {
+    // Given
+    FRANotification *denied = [self notificationWithMessageId:@"denied" receivedAt:100.0];
+    [denied denyWithHandler:nil error:nil];
+    FRANotification *expired = [self notificationWithMessageId:@"expired" receivedAt:200.0];
+    expired.timeExpired = [NSDate dateWithTimeIntervalSince1970:300.0];
+    @autoreleasepool {
+        [store addNotification:denied];
+        [store addNotification:expired];
+        denied = nil;
+        expired = nil;
+    }
+    
+    // Then
+    XCTAssertTrue([[store notificationAtIndex:0] isDenied]);
+    XCTAssertTrue([[store notificationAtIndex:1] isExpired]);
+    XCTAssertEqualObjects([store notificationAtIndex:1].timeExpired, [NSDate dateWithTimeIntervalSince1970:300.0]);
+}
+
+- (void)testCanFindAndRemoveNotifications {
+    // Given
+    FRANotification *first = [self approvedNotificationWithMessageId:@"ID-1" receivedAt:100.0];
+    FRANotification *second = [self approvedNotificationWithMessageId:@"ID-2" receivedAt:200.0];
+    [store addNotification:first];
+    [store addNotification:second];
+    NSUInteger revision = store.revision;
+    
+    // When
+    [store removeNotificationAtIndex:[store indexOfNotification:first]];
+    
+    // Then
+    XCTAssertEqual(store.count, 1);
+    XCTAssertGreaterThan(store.revision, revision);
+    XCTAssertEqual([store indexOfNotification:first], NSNotFound);
+    XCTAssertEqual([store indexOfNotificationWithMessageId:@"ID-1"], NSNotFound);
+    XCTAssertEqual([store indexOfNotificationWithMessageId:@"ID-2"], 0);
+}
+
+- (void)testFindsLatestNotificationWithRepeatedMessageId {
+    // Given
+    [store addNotification:[self approvedNotificationWithMessageId:@"ID-1" receivedAt:300.0]];
+    [store addNotification:[self approvedNotificationWithMessageId:@"ID-1" receivedAt:100.0]];
+    [store addNotification:[self approvedNotificationWithMessageId:@"ID-2" receivedAt:200.0]];
+    XCTAssertEqual([store indexOfNotificationWithMessageId:@"ID-1"], 2);
+
+    // When
+    [store removeNotificationAtIndex:2];
+
+    // Then
+    XCTAssertEqual([store indexOfNotificationWithMessageId:@"ID-1"], 0);
+    XCTAssertEqual([store indexOfNotificationWithMessageId:@"ID-2"], 1);
+}
+
+- (void)testStringsSurviveArenaCompaction {
+    // Given
+    for (NSInteger i = 0; i < 1000; i++) {
+        [store addNotification:[self approvedNotificationWithMessageId:[NSString stringWithFormat:@"ID-%ld", (long)i] receivedAt:i]];
+    }
+    
+    // When
+    while (store.count > 10) {
+        [store removeNotificationAtIndex:0];
+    }
+    
+    // Then
+    XCTAssertEqualObjects([store notificationAtIndex:0].messageId, @"ID-990");
+    XCTAssertEqualObjects([store notificationAtIndex:9].loadBalancerCookie, @"cookie");
+}
+
+- (void)testMechanismMovesResolvedNotificationsIntoHistory {
+    // Given
+    FRANotification *notification = [self notificationWithMessageId:@"ID-1" receivedAt:[[NSDate date] timeIntervalSince1970]];
+    [mechanism addNotification:notification error:nil];
+    XCTAssertEqual(mechanism.activeNotifications.count, 1);
+    
+    // When
+    [notification approveWithHandler:nil error:nil];
+    
+    // Then
+    XCTAssertEqual(mechanism.activeNotifications.count, 0);
+    XCTAssertEqual(mechanism.notificationHistory.count, 1);
+    XCTAssertEqual([mechanism notificationWithMessageId:@"ID-1"], notification);
+    XCTAssertTrue([[mechanism notifications] containsObject:notification]);
+}
+
+#pragma mark -
+#pragma mark Helper Functions
+
+- (FRANotification *)notificationWithMessageId:(NSString *)messageId receivedAt:(NSTimeInterval)timeReceived {
+    return [FRANotification notificationWithDatabase:nil
+                                       identityModel:nil
+                                           messageId:messageId
+                                           challenge:@"challenge"
+                                        timeReceived:[NSDate dateWithTimeIntervalSince1970:timeReceived]
+                                          timeToLive:120.0
+                              loadBalancerCookieData:@"cookie"];
+}
+
+- (FRANotification *)approvedNotificationWithMessageId:(NSString *)messageId receivedAt:(NSTimeInterval)timeReceived {
+    FRANotification *notification = [self notificationWithMessageId:messageId receivedAt:timeReceived];
+    [notification approveWithHandler:nil error:nil];
+    return notification;
+}
+
+@end
@@ -22,8 +22,14 @@
 #import "FRAIdentityDatabaseSQLiteOperations.h"
 #import "FRAIdentityModel.h"
 #import "FRAMessageUtils.h"
+#import "FRAError.h"
 #import "FRANotification.h"
+#import "FRANotificationResponse.h"
 #import "FRAPushMechanism.h"
+#import "FRAResponseOutbox.h"
+
+static NSTimeInterval const TEST_TIMEOUT = 10.0;
+static NSInteger const POST_HANDLER_PARAMETER_INDEX = 6;
 
 @interface FRANotificationTest : XCTestCase
 
@@ -101,11 +107,11 @@
     // Given
     [database insertNotification:notification error:nil];
     OCMExpect([messageUtilsMock respondWithEndpoint:@"http://service.endpoint"
-                                       base64Secret:@"secret"
+                                      cryptoContext:mechanism.cryptoContext
                                           messageId:@"messageId"
                              loadBalancerCookieData:@"amlbcookie=03"
                                                data:@{@"response":[FRAMessageUtils generateChallengeResponse:@"challenge"
-                                                                                                      secret:@"secret"]}
+                                                                                               cryptoContext:mechanism.cryptoContext]}
                                             handler:[OCMArg any]]);
     
     // When
@@ -115,6 +121,39 @@
     OCMVerifyAll(messageUtilsMock);
 }
 
+- (void)testApproveNotificationQueuesResponseInOutbox {
+    // Given
+    [database insertNotification:notification error:nil];
+    id mockOutbox = OCMClassMock([FRAResponseOutbox class]);
+    database.responseOutbox = mockOutbox;
+    NSDictionary *payload = [FRAMessageUtils payloadWithMessageId:@"messageId"
+                                                    cryptoContext:mechanism.cryptoContext
+                                                             data:@{@"response":[FRAMessageUtils generateChallengeResponse:@"challenge"
+                                                                                                             cryptoContext:mechanism.cryptoContext]}];
+    OCMExpect([mockOutbox enqueuePayload:payload
+                                endpoint:@"http://service.endpoint"
+                               messageId:@"messageId"
+                  loadBalancerCookieData:@"amlbcookie=03"
+                             timeExpired:notification.timeExpired
+                                 handler:[OCMArg any]
+                                   error:[OCMArg anyObjectRef]]).andReturn(YES);
+    OCMReject([messageUtilsMock respondWithEndpoint:[OCMArg any]
+                                      cryptoContext:[OCMArg any]
+                                          messageId:[OCMArg any]
+                             loadBalancerCookieData:[OCMArg any]
+                                               data:[OCMArg any]
+                                            handler:[OCMArg any]]);
+    
+    // When
+    BOOL result = [notification approveWithHandler:nil error:nil];
+    
+    // Then
+    XCTAssertTrue(result);
+    OCMVerifyAll(mockOutbox);
+    OCMVerifyAll(messageUtilsMock);
+    [mockOutbox stopMocking];
+}
+
 - (void)testShouldDenyNotification {
     // Given
     
@@ -131,11 +170,11 @@
     // Given
     [database insertNotification:notification error:nil];
     NSDictionary *expectedData = @{
-            @"response":[FRAMessageUtils generateChallengeResponse:@"challenge" secret:@"secret"],
+            @"response":[FRAMessageUtils generateChallengeResponse:@"challenge" cryptoContext:mechanism.cryptoContext],
             @"deny": @YES
             };
     OCMExpect([messageUtilsMock respondWithEndpoint:@"http://service.endpoint"
-                                       base64Secret:@"secret"
+                                      cryptoContext:mechanism.cryptoContext
                                           messageId:@"messageId"
                              loadBalancerCookieData:@"amlbcookie=03"
                                                data:expectedData
@@ -154,11 +193,11 @@
     [database insertNotification:notification error:nil];
     OCMStub([(FRAIdentityDatabaseSQLiteOperations*)mockSqlOperations updateNotification:notification error:nil]).andReturn(YES);
     OCMStub([messageUtilsMock respondWithEndpoint:@"http://service.endpoint"
-                                     base64Secret:@"secret"
+                                    cryptoContext:mechanism.cryptoContext
                                         messageId:@"messageId"
                            loadBalancerCookieData:@"amlbcookie=03"
                                              data:@{@"response":[FRAMessageUtils generateChallengeResponse:@"challenge"
-                                                                                                    secret:@"secret"]}
+                                                                                             cryptoContext:mechanism.cryptoContext]}
                                           handler:[OCMArg any]]);
 
     
@@ -190,11 +229,11 @@
     [[NSNotificationCenter defaultCenter] addMockObserver:databaseObserverMock name:FRAIdentityDatabaseChangedNotification object:database];
     [[databaseObserverMock expect] notificationWithName:FRAIdentityDatabaseChangedNotification object:database userInfo:[OCMArg any]];
     OCMStub([messageUtilsMock respondWithEndpoint:@"http://service.endpoint"
-                                     base64Secret:@"secret"
+                                    cryptoContext:mechanism.cryptoContext
                                         messageId:@"messageId"
                            loadBalancerCookieData:@"amlbcookie=03"
                                              data:@{@"response":[FRAMessageUtils generateChallengeResponse:@"challenge"
-                                                                                                    secret:@"secret"]}
+                                                                                             cryptoContext:mechanism.cryptoContext]}
                                           handler:[OCMArg any]]);
     
     // When
@@ -205,6 +244,131 @@
     OCMVerifyAll(databaseObserverMock);
 }
 
+- (FRANotification *)storedNotificationWithMessageId:(NSString *)messageId {
+    FRANotification *storedNotification = [[FRANotification alloc] initWithDatabase:database identityModel:mockIdentityModel messageId:messageId challenge:@"challenge" timeReceived:[NSDate date] timeToLive:120.0 loadBalancerCookieData:@"amlbcookie=03"];
+    [storedNotification setParent:mechanism];
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations insertNotification:storedNotification error:nil]).andReturn(YES);
+    [database insertNotification:storedNotification error:nil];
+    return storedNotification;
+}
+
+- (void)serviceRespondsWithStatusCode:(NSInteger)statusCode {
+    OCMStub([messageUtilsMock postPayload:[OCMArg any] toEndpoint:[OCMArg any] loadBalancerCookieData:[OCMArg any] protocol:[OCMArg any] handler:[OCMArg any]])
+    .andDo(^(NSInvocation *invocation) {
+        void (^handler)(NSInteger, NSError *);
+        [invocation getArgument:&handler atIndex:POST_HANDLER_PARAMETER_INDEX];
+        if (handler) {
+            handler(statusCode, nil);
+        }
+    });
+}
+
+- (NSArray<FRANotificationResponse *> *)approveNotifications:(NSArray<FRANotification *> *)notifications {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"batch responses"];
+    __block NSArray<FRANotificationResponse *> *responses;
+    BOOL result = [FRANotification approveNotifications:notifications handler:^(NSArray<FRANotificationResponse *> *results) {
+        responses = results;
+        [expectation fulfill];
+    } error:nil];
+    XCTAssertTrue(result);
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    return responses;
+}
+
+- (void)testBatchApproveSavesNotificationsInOneTransaction {
+    // Given
+    FRANotification *first = [self storedNotificationWithMessageId:@"first"];
+    FRANotification *second = [self storedNotificationWithMessageId:@"second"];
+    NSArray *notifications = @[first, second];
+    OCMExpect([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotifications:notifications error:[OCMArg anyObjectRef]]).andReturn(YES);
+    OCMReject([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotification:[OCMArg any] error:[OCMArg anyObjectRef]]);
+    [self serviceRespondsWithStatusCode:200];
+    
+    // When
+    NSArray<FRANotificationResponse *> *responses = [self approveNotifications:notifications];
+    
+    // Then
+    OCMVerifyAll(mockSqlOperations);
+    XCTAssertTrue([first isApproved]);
+    XCTAssertTrue([second isApproved]);
+    XCTAssertEqual(responses.count, 2);
+    XCTAssertEqual(responses[0].notification, first);
+    XCTAssertEqual(responses[1].notification, second);
+    XCTAssertTrue([responses[0] isDelivered]);
+    XCTAssertTrue([responses[1] isDelivered]);
+}
+
+- (void)testBatchApproveSendsOneResponsePerNotification {
+    // Given
+    FRANotification *first = [self storedNotificationWithMessageId:@"first"];
+    FRANotification *second = [self storedNotificationWithMessageId:@"second"];
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotifications:[OCMArg any] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    [self serviceRespondsWithStatusCode:200];
+    
+    // When
+    [self approveNotifications:@[first, second]];
+    
+    // Then
+    for (FRANotification *approved in @[first, second]) {
+        NSDictionary *payload = [FRAMessageUtils payloadWithMessageId:approved.messageId
+                                                        cryptoContext:mechanism.cryptoContext
+                                                                 data:@{@"response":[FRAMessageUtils generateChallengeResponse:@"challenge"
+                                                                                                                 cryptoContext:mechanism.cryptoContext]}];
+        OCMVerify([messageUtilsMock postPayload:payload toEndpoint:@"http://service.endpoint" loadBalancerCookieData:@"amlbcookie=03" protocol:[OCMArg any] handler:[OCMArg any]]);
+    }
+}
+
+- (void)testBatchApproveReportsSkippedAndFailedNotifications {
+    // Given
+    [self serviceRespondsWithStatusCode:500];
+    FRANotification *resolved = [self storedNotificationWithMessageId:@"resolved"];
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotification:resolved error:nil]).andReturn(YES);
+    [resolved denyWithHandler:nil error:nil];
+    FRANotification *pending = [self storedNotificationWithMessageId:@"pending"];
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotifications:[OCMArg any] error:[OCMArg anyObjectRef]]).andReturn(YES);
+    
+    // When
+    NSArray<FRANotificationResponse *> *responses = [self approveNotifications:@[resolved, pending]];
+    
+    // Then
+    XCTAssertTrue([resolved isDenied]);
+    XCTAssertEqual(responses[0].error.code, FRAInvalidOperation);
+    XCTAssertEqual(responses[1].statusCode, 500);
+    XCTAssertFalse([responses[1] isDelivered]);
+}
+
+- (void)testBatchApproveLeavesNotificationsPendingIfTheyCannotBeSaved {
+    // Given
+    FRANotification *first = [self storedNotificationWithMessageId:@"first"];
+    FRANotification *second = [self storedNotificationWithMessageId:@"second"];
+    OCMStub([(FRAIdentityDatabaseSQLiteOperations *)mockSqlOperations updateNotifications:[OCMArg any] error:[OCMArg anyObjectRef]]).andReturn(NO);
+    OCMReject([messageUtilsMock postPayload:[OCMArg any] toEndpoint:[OCMArg any] loadBalancerCookieData:[OCMArg any] protocol:[OCMArg any] handler:[OCMArg any]]);
+    
+    // When
+    BOOL result = [FRANotification approveNotifications:@[first, second] handler:nil error:nil];
+    
+    // Then
+    XCTAssertFalse(result);
+    XCTAssertTrue([first isPending]);
+    XCTAssertTrue([second isPending]);
+    OCMVerifyAll(messageUtilsMock);
+}
+
+- (void)testMechanismBatchApproveRejectsNotificationsOfAnotherMechanism {
+    // Given
+    FRAPushMechanism *otherMechanism = [[FRAPushMechanism alloc] initWithDatabase:database identityModel:mockIdentityModel authEndpoint:@"http://other.endpoint" secret:@"secret"];
+    FRANotification *first = [self storedNotificationWithMessageId:@"first"];
+    NSError *error;
+    
+    // When
+    BOOL result = [otherMechanism approveNotifications:@[first] handler:nil error:&error];
+    
+    // Then
+    XCTAssertFalse(result);
+    XCTAssertEqual(error.code, FRAInvalidOperation);
+    XCTAssertTrue([first isPending]);
+}
+
 - (void)testIsExpiredReturnsYesIfNotificationHasExpired {
     // Given
     FRANotification *expiredNotification = [[FRANotification alloc] initWithDatabase:database identityModel:mockIdentityModel messageId:@"messageId" challenge:@"challenge" timeReceived:[NSDate date] timeToLive:-10.0 loadBalancerCookieData:@"amlbcookie=03"];
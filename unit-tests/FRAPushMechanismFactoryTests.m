@@ -68,7 +68,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testParseSetsImageUrlOnIdentity {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -83,7 +83,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testMechanismIsCreatedEvenIfImageIsMissing {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -97,7 +97,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testMechanismIsRemovedIfFailedToRespond {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -117,7 +117,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testIdentityIsRemovedIfFailedToRespondAndIdentityHasNoOtherMechanism {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -137,7 +137,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testIdentityIsNotRemovedIfFailedToRespondButIdentityHasOtherMechanisms {
     OCMExpect([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                       base64Secret:[OCMArg any]
+                                      cryptoContext:[OCMArg any]
                                           messageId:[OCMArg any]
                              loadBalancerCookieData:[OCMArg any]
                                                data:[OCMArg any]
@@ -146,7 +146,7 @@ static NSString * const DEVICE_ID = @"device id";
     [factory buildMechanism:successfulQr database:identityDatabase identityModel:identityModel handler:nil error:nil];
     
     OCMExpect([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                       base64Secret:[OCMArg any]
+                                      cryptoContext:[OCMArg any]
                                           messageId:[OCMArg any]
                              loadBalancerCookieData:[OCMArg any]
                                                data:[OCMArg any]
@@ -165,7 +165,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfDuplicate {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -185,7 +185,7 @@ static NSString * const DEVICE_ID = @"device id";
     OCMStub(((FRANotificationGateway *)gateway).deviceToken).andReturn(@"");
     FRAPushMechanismFactory *mechanismFactory = [[FRAPushMechanismFactory alloc] initWithGateway:gateway];
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -201,7 +201,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoSecret {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -217,7 +217,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfInvalidSecret {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -233,7 +233,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoAuthEndpoint {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -249,7 +249,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoRegEndpoint {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -265,7 +265,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoMessageId {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -281,7 +281,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoChallenge {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -297,7 +297,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismReturnsNilIfNoIssuer {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -314,7 +314,7 @@ static NSString * const DEVICE_ID = @"device id";
 - (void)testErrorCodeIsSetToNetworkFailureIfCantContactServer {
     NSError *error = [[NSError alloc] init];
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -343,7 +343,7 @@ static NSString * const DEVICE_ID = @"device id";
     identityDatabase = [[FRAIdentityDatabase alloc] initWithSqlOperations:databaseOperations];
     identityModel = [[FRAIdentityModel alloc] initWithDatabase:identityDatabase sqlDatabase:nil];
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -362,7 +362,7 @@ static NSString * const DEVICE_ID = @"device id";
     identityDatabase = [[FRAIdentityDatabase alloc] initWithSqlOperations:databaseOperations];
     identityModel = [[FRAIdentityModel alloc] initWithDatabase:identityDatabase sqlDatabase:nil];
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
@@ -376,7 +376,7 @@ static NSString * const DEVICE_ID = @"device id";
 
 - (void)testBuildMechanismWhenSecretHasUrlEncodedCharactersCreatesMechanism {
     OCMStub([mockMessageUtils respondWithEndpoint:[OCMArg any]
-                                     base64Secret:[OCMArg any]
+                                    cryptoContext:[OCMArg any]
                                         messageId:[OCMArg any]
                            loadBalancerCookieData:[OCMArg any]
                                              data:[OCMArg any]
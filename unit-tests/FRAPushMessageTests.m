@@ -0,0 +1,154 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRAMessageUtils.h"
+#import "FRAPushCryptoContext.h"
+#import "FRAPushMessage.h"
+
+static NSString * const base64Secret = @"c2VjcmV0";
+/*! A push payload as sent by OpenAM, with a padded, pretty printed payload segment. */
+static NSString * const capturedJwt = @"eyAidHlwIjogIkpXVCIsICJhbGciOiAiSFMyNTYiIH0.ew0KICAgICJjIjoiZEdobGJHVm5aVzVrYjJac2RXNWgiLA0KICAgICJsIjoiWVcxc1ltTnZiMnRwWlQxaGJXeGlZMjl2YTJsbFBUQXgiLA0KICAgICJ0IiA6IjEyMCIsDQogICAgInUiOiIwIg0KfQ==.uOWDShBAG4JtJLrTkRLdJ8-6JQXRYRpnXqd54q_QlYA";
+
+@interface FRAPushMessageTests : XCTestCase
+
+@end
+
+@implementation FRAPushMessageTests {
+    FRAPushCryptoContext *cryptoContext;
+}
+
+- (void)setUp {
+    [super setUp];
+    cryptoContext = [FRAPushCryptoContext contextWithBase64Secret:base64Secret];
+}
+
+- (void)testShouldReadClaimsOfCapturedMessage {
+    // Given
+    NSString *jwt = capturedJwt;
+    
+    // When
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:jwt error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(message.challenge, @"dGhlbGVnZW5kb2ZsdW5h");
+    XCTAssertEqual(message.timeToLive, 120);
+    XCTAssertEqualObjects(message.mechanismUid, @"0");
+    XCTAssertEqualObjects(message.loadBalancerCookieData, @"amlbcookie=amlbcookie=01");
+}
+
+- (void)testShouldVerifySignatureWithKeyOfMechanism {
+    // Given
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:capturedJwt error:nil];
+    
+    // When
+    BOOL signedWithSecret = [message isSignedWithCryptoContext:cryptoContext];
+    BOOL signedWithOtherSecret = [message isSignedWithCryptoContext:[FRAPushCryptoContext contextWithBase64Secret:@"b3RoZXI"]];
+    
+    // Then
+    XCTAssertTrue(signedWithSecret);
+    XCTAssertFalse(signedWithOtherSecret);
+}
+
+- (void)testShouldRejectTamperedPayload {
+    // Given
+    NSString *jwt = [cryptoContext jwtWithPayload:@{@"c":@"Y2hhbGxlbmdl", @"t":@"120", @"u":@"0"}];
+    NSArray *segments = [jwt componentsSeparatedByString:@"."];
+    NSString *otherPayload = [[cryptoContext jwtWithPayload:@{@"c":@"Y2hhbGxlbmdl", @"t":@"120", @"u":@"1"}] componentsSeparatedByString:@"."][1];
+    NSString *tampered = [@[segments[0], otherPayload, segments[2]] componentsJoinedByString:@"."];
+    
+    // When
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:tampered error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(message.mechanismUid, @"1");
+    XCTAssertFalse([message isSignedWithCryptoContext:cryptoContext]);
+}
+
+- (void)testShouldReadNumericAndEscapedClaims {
+    // Given
+    NSString *jwt = [cryptoContext jwtWithPayload:@{@"c":@"Je/HBM=", @"t":@30, @"u":@"3", @"x":@{@"nested":@[@1, @"}"]}}];
+    
+    // When
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:jwt error:nil];
+    
+    // Then
+    XCTAssertEqualObjects(message.challenge, @"Je/HBM=");
+    XCTAssertEqual(message.timeToLive, 30);
+    XCTAssertEqualObjects(message.mechanismUid, @"3");
+    XCTAssertNil(message.loadBalancerCookieData);
+    XCTAssertTrue([message isSignedWithCryptoContext:cryptoContext]);
+}
+
+- (void)testShouldFailWithoutCrashingOnMalformedTokens {
+    NSArray *tokens = @[@"", @"abc", @"abc.def", @"a.b.c.d", @".eyJ1IjoiMCJ9.sig", @"e30..sig", @"e30.!!!!.sig", @"e30.WzFd.sig"];
+    for (NSString *token in tokens) {
+        // Given
+        NSError *error;
+        
+        // When
+        FRAPushMessage *message = [FRAPushMessage messageWithJwt:token error:&error];
+        
+        // Then
+        XCTAssertNil(message, @"%@ should not parse", token);
+        XCTAssertEqual(error.code, FRAInvalidPushMessage);
+    }
+}
+
+- (void)testShouldFailForNonStringData {
+    // Given
+    id data = @42;
+    
+    // When
+    FRAPushMessage *message = [FRAPushMessage messageWithJwt:data error:nil];
+    
+    // Then
+    XCTAssertNil(message);
+}
+
+- (void)testMessageUtilsShouldReturnNilForTokenWithoutSignature {
+    // Given
+    NSString *jwt = @"e30";
+    
+    // When
+    NSDictionary *claims = [FRAMessageUtils extractJTWBodyFromString:jwt error:nil];
+    
+    // Then
+    XCTAssertNil(claims);
+}
+
+- (void)testPerformanceOfParsingAndVerifyingCapturedMessages {
+    // a corpus shaped like captured traffic: OpenAM's pretty printed tokens and compact ones
+    NSMutableArray *corpus = [NSMutableArray arrayWithCapacity:1000];
+    for (int i = 0; i < 1000; i++) {
+        if (i % 2 == 0) {
+            [corpus addObject:capturedJwt];
+        } else {
+            NSString *challenge = [[[NSString stringWithFormat:@"challenge-%d", i] dataUsingEncoding:NSUTF8StringEncoding] base64EncodedStringWithOptions:0];
+            [corpus addObject:[cryptoContext jwtWithPayload:@{@"c":challenge, @"t":@"120", @"u":@"0", @"l":@"YW1sYmNvb2tpZT0wMQ=="}]];
+        }
+    }
+    
+    [self measureBlock:^{
+        for (NSString *jwt in corpus) {
+            FRAPushMessage *message = [FRAPushMessage messageWithJwt:jwt error:nil];
+            XCTAssertTrue([message isSignedWithCryptoContext:cryptoContext]);
+        }
+    }];
+}
+
+@end
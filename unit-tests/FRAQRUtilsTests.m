@@ -58,6 +58,21 @@
     XCTAssertNil(result);
 }
 
+- (void)testDecodeURLDecodesUnpaddedUrlSafeString {
+    
+    NSData *result = [FRAQRUtils decodeURL:@"-_-_QUI"];
+    
+    const uint8_t expected[] = {0xFB, 0xFF, 0xBF, 'A', 'B'};
+    XCTAssertEqualObjects(result, [NSData dataWithBytes:expected length:sizeof(expected)]);
+}
+
+- (void)testDecodeBase64ReturnsNilForInvalidString {
+    
+    NSData *result = [FRAQRUtils decodeBase64:@"QUJD%EF"];
+    
+    XCTAssertNil(result);
+}
+
 - (void)testIsBase64ReturnsTrueIfStringIsValidBase64 {
     
     BOOL result = [FRAQRUtils isBase64:@"somethingTHATisvalid1244+"];
@@ -0,0 +1,385 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+#import "FRADatabaseConfiguration.h"
+#import "FRAError.h"
+#import "FRAFMDatabaseConnectionHelper.h"
+#import "FRAFMDatabaseFactory.h"
+#import "FRAInFlightRequestTable.h"
+#import "FRAMockURLProtocol.h"
+#import "FRAResponseOutbox.h"
+
+static NSTimeInterval const TEST_TIMEOUT = 10.0;
+static NSString * const ENDPOINT = @"http://outbox.example.com/openam/json/push/sns/message?_action=authenticate";
+static NSString * const OTHER_ENDPOINT = @"http://other.example.com/openam/json/push/sns/message?_action=authenticate";
+
+@interface FRAResponseOutboxTests : XCTestCase
+
+@end
+
+/*!
+ * Exercises the outbox against a real SQLite database and FRAMockURLProtocol standing in for the server, with
+ * failures injected through the protocol.
+ */
+@implementation FRAResponseOutboxTests {
+    NSString *path;
+    id mockConfiguration;
+    FRAResponseOutbox *outbox;
+}
+
+- (void)setUp {
+    [super setUp];
+    path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    mockConfiguration = OCMClassMock([FRADatabaseConfiguration class]);
+    OCMStub([mockConfiguration getDatabasePathWithError:[OCMArg anyObjectRef]]).andReturn(path);
+    outbox = [self newOutbox];
+    [FRAMockURLProtocol setStatusCode:200];
+    [FRAMockURLProtocol resetRequests];
+    [[FRAInFlightRequestTable sharedTable] removeAllResults];
+}
+
+- (void)tearDown {
+    outbox = nil;
+    [FRAMockURLProtocol resetRequests];
+    [mockConfiguration stopMocking];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [super tearDown];
+}
+
+/*!
+ * A new outbox on its own connection helper, as after a relaunch of the App.
+ */
+- (FRAResponseOutbox *)newOutbox {
+    FRAFMDatabaseConnectionHelper *database = [[FRAFMDatabaseConnectionHelper alloc] initWithConfiguration:mockConfiguration databaseFactory:[[FRAFMDatabaseFactory alloc] init]];
+    FRAResponseOutbox *newOutbox = [[FRAResponseOutbox alloc] initWithDatabase:database];
+    newOutbox.protocol = [FRAMockURLProtocol class];
+    // Keep automatic retries out of the way unless a test asks for them
+    newOutbox.baseDelay = 60.0;
+    return newOutbox;
+}
+
+- (BOOL)enqueueMessageId:(NSString *)messageId endpoint:(NSString *)endpoint handler:(void (^)(NSInteger, NSError *))handler {
+    return [outbox enqueuePayload:@{@"messageId":messageId, @"jwt":@"jwt"}
+                         endpoint:endpoint
+                        messageId:messageId
+           loadBalancerCookieData:@"amlbcookie=01"
+                      timeExpired:[NSDate dateWithTimeIntervalSinceNow:120.0]
+                          handler:handler
+                            error:nil];
+}
+
+- (void)flushOutbox:(FRAResponseOutbox *)anOutbox delivered:(NSUInteger *)delivered pending:(NSUInteger *)pending {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"flush"];
+    [anOutbox flushWithCompletion:^(NSUInteger deliveredCount, NSUInteger pendingCount) {
+        if (delivered) {
+            *delivered = deliveredCount;
+        }
+        if (pending) {
+            *pending = pendingCount;
+        }
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+}
+
+- (void)testDeliversQueuedResponse {
+    // Given
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    __block NSInteger responseStatusCode = 0;
+    
+    // When
+    BOOL result = [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        responseStatusCode = statusCode;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertTrue(result);
+    XCTAssertEqual(responseStatusCode, 200);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+    XCTAssertEqualObjects([FRAMockURLProtocol getRequest].URL.absoluteString, ENDPOINT);
+}
+
+- (void)testResponseToMessageInFlightSharesOutcomeOfSend {
+    // Given
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"first response"];
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"second response"];
+    __block NSInteger firstStatusCode = 0;
+    __block NSInteger secondStatusCode = 0;
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        firstStatusCode = statusCode;
+        [firstExpectation fulfill];
+    }];
+    
+    // When
+    BOOL result = [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        secondStatusCode = statusCode;
+        [secondExpectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertTrue(result);
+    XCTAssertEqual(firstStatusCode, 200);
+    XCTAssertEqual(secondStatusCode, 200);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+}
+
+- (void)testKeepsResponseWhileServerIsUnreachable {
+    // Given
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    __block BOOL handlerCalled = NO;
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        handlerCalled = YES;
+    }];
+    
+    // When
+    NSUInteger delivered;
+    NSUInteger pending;
+    [self flushOutbox:outbox delivered:&delivered pending:&pending];
+    
+    // Then
+    XCTAssertEqual(delivered, 0);
+    XCTAssertEqual(pending, 1);
+    XCTAssertFalse(handlerCalled);
+}
+
+- (void)testRetriesWithBackoffUntilDelivered {
+    // Given
+    outbox.baseDelay = 0.05;
+    outbox.maximumDelay = 0.1;
+    [FRAMockURLProtocol failNextRequests:2 withStatusCode:503];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    __block NSInteger responseStatusCode = 0;
+    
+    // When
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        responseStatusCode = statusCode;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertEqual(responseStatusCode, 200);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 3);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+}
+
+- (void)testAbandonsResponseAfterMaximumAttempts {
+    // Given
+    outbox.baseDelay = 0.05;
+    outbox.maximumDelay = 0.1;
+    outbox.maximumAttempts = 3;
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    __block NSError *responseError;
+    
+    // When
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        responseError = error;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertEqual(responseError.code, FRANetworkFailure);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 3);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+}
+
+- (void)testDropsResponseRejectedByServer {
+    // Given
+    [FRAMockURLProtocol failNextRequests:1 withStatusCode:401];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    __block NSInteger responseStatusCode = 0;
+    
+    // When
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:^(NSInteger statusCode, NSError *error) {
+        responseStatusCode = statusCode;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertEqual(responseStatusCode, 401);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+}
+
+- (void)testDropsExpiredResponseWithoutSendingIt {
+    // Given
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:nil];
+    [self flushOutbox:outbox delivered:nil pending:nil];
+    [FRAMockURLProtocol resetRequests];
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    __block NSError *responseError;
+    [outbox enqueuePayload:@{@"messageId":@"2", @"jwt":@"jwt"}
+                  endpoint:ENDPOINT
+                 messageId:@"2"
+    loadBalancerCookieData:nil
+               timeExpired:[NSDate dateWithTimeIntervalSinceNow:-1.0]
+                   handler:^(NSInteger statusCode, NSError *error) {
+                       responseError = error;
+                   }
+                     error:nil];
+    
+    // When
+    NSUInteger pending;
+    [self flushOutbox:outbox delivered:nil pending:&pending];
+    
+    // Then
+    XCTAssertEqual(responseError.code, FRANetworkFailure);
+    XCTAssertEqual(pending, 1);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+}
+
+- (void)testSendsResponsesToSameEndpointAsOneBurst {
+    // Given
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    for (NSString *messageId in @[@"1", @"2", @"3"]) {
+        [self enqueueMessageId:messageId endpoint:ENDPOINT handler:nil];
+    }
+    [self flushOutbox:outbox delivered:nil pending:nil];
+    [FRAMockURLProtocol resetRequests];
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    
+    // When
+    NSUInteger pending;
+    [self flushOutbox:outbox delivered:nil pending:&pending];
+    
+    // Then
+    // Only the first response of the burst is tried against the unreachable server
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 1);
+    XCTAssertEqual(pending, 3);
+}
+
+- (void)testOnlyProbeOfFailedBurstUsesAnAttempt {
+    // Given
+    outbox.maximumAttempts = 5;
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    for (NSString *messageId in @[@"1", @"2", @"3"]) {
+        [self enqueueMessageId:messageId endpoint:ENDPOINT handler:nil];
+    }
+    
+    // When
+    NSUInteger pending = 3;
+    for (NSUInteger flush = 0; flush < outbox.maximumAttempts && pending == 3; flush++) {
+        [self flushOutbox:outbox delivered:nil pending:&pending];
+    }
+    
+    // Then
+    // The probe is abandoned while the responses behind it keep their remaining attempts
+    XCTAssertEqual(pending, 2);
+}
+
+- (void)testSendsOneBurstPerEndpoint {
+    // Given
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:nil];
+    [self enqueueMessageId:@"2" endpoint:OTHER_ENDPOINT handler:nil];
+    [self enqueueMessageId:@"3" endpoint:ENDPOINT handler:nil];
+    [self flushOutbox:outbox delivered:nil pending:nil];
+    [FRAMockURLProtocol resetRequests];
+    
+    // When
+    NSUInteger delivered;
+    NSUInteger pending;
+    [self flushOutbox:outbox delivered:&delivered pending:&pending];
+    
+    // Then
+    XCTAssertEqual(delivered, 3);
+    XCTAssertEqual(pending, 0);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 3);
+}
+
+- (void)testEnqueuesSeveralResponsesTogether {
+    // Given
+    NSMutableArray<FRAQueuedResponse *> *responses = [[NSMutableArray alloc] init];
+    __block NSUInteger deliveredCount = 0;
+    for (NSString *messageId in @[@"1", @"2", @"3"]) {
+        XCTestExpectation *expectation = [self expectationWithDescription:messageId];
+        [responses addObject:[[FRAQueuedResponse alloc] initWithPayload:@{@"messageId":messageId, @"jwt":@"jwt"}
+                                                               endpoint:ENDPOINT
+                                                              messageId:messageId
+                                                 loadBalancerCookieData:nil
+                                                            timeExpired:nil
+                                                                handler:^(NSInteger statusCode, NSError *error) {
+                                                                    if (statusCode == 200) {
+                                                                        deliveredCount++;
+                                                                    }
+                                                                    [expectation fulfill];
+                                                                }]];
+    }
+    
+    // When
+    BOOL result = [outbox enqueueResponses:responses error:nil];
+    [self waitForExpectationsWithTimeout:TEST_TIMEOUT handler:nil];
+    
+    // Then
+    XCTAssertTrue(result);
+    XCTAssertEqual(deliveredCount, 3);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 3);
+    XCTAssertEqual([outbox pendingResponseCount], 0);
+}
+
+- (void)testQueuedResponsesSurviveRelaunch {
+    // Given
+    [FRAMockURLProtocol failNextRequests:NSUIntegerMax withStatusCode:0];
+    [self enqueueMessageId:@"1" endpoint:ENDPOINT handler:nil];
+    [self enqueueMessageId:@"2" endpoint:ENDPOINT handler:nil];
+    [self flushOutbox:outbox delivered:nil pending:nil];
+    outbox = nil;
+    [FRAMockURLProtocol resetRequests];
+    
+    // When
+    FRAResponseOutbox *relaunchedOutbox = [self newOutbox];
+    NSUInteger delivered;
+    NSUInteger pending;
+    [self flushOutbox:relaunchedOutbox delivered:&delivered pending:&pending];
+    
+    // Then
+    XCTAssertEqual(delivered, 2);
+    XCTAssertEqual(pending, 0);
+    XCTAssertEqual([FRAMockURLProtocol requestCount], 2);
+}
+
+- (void)testRetryDelayDoublesWithJitterUpToMaximum {
+    // Given
+    outbox.baseDelay = 2.0;
+    outbox.maximumDelay = 300.0;
+    
+    // When
+    NSTimeInterval first = [outbox retryDelayAfterAttempts:1];
+    NSTimeInterval third = [outbox retryDelayAfterAttempts:3];
+    NSTimeInterval capped = [outbox retryDelayAfterAttempts:100];
+    
+    // Then
+    XCTAssertGreaterThanOrEqual(first, 1.0);
+    XCTAssertLessThanOrEqual(first, 2.0);
+    XCTAssertGreaterThanOrEqual(third, 4.0);
+    XCTAssertLessThanOrEqual(third, 8.0);
+    XCTAssertGreaterThanOrEqual(capped, 150.0);
+    XCTAssertLessThanOrEqual(capped, 300.0);
+}
+
+@end
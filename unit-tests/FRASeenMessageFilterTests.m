@@ -0,0 +1,185 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "FRASeenMessageFilter.h"
+
+@interface FRASeenMessageFilterTests : XCTestCase
+
+@end
+
+@implementation FRASeenMessageFilterTests {
+    NSString *path;
+    FRASeenMessageFilter *filter;
+}
+
+- (void)setUp {
+    [super setUp];
+    path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    filter = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:100 recentCapacity:10];
+}
+
+- (void)tearDown {
+    [filter flush];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    [super tearDown];
+}
+
+- (void)testUnknownMessageIdIsNotSeen {
+    // Given
+    NSString *mechanismUid;
+    
+    // When
+    FRASeenMessageState state = [filter stateOfMessageId:@"123" mechanismUid:&mechanismUid];
+    
+    // Then
+    XCTAssertEqual(state, FRAMessageNotSeen);
+    XCTAssertNil(mechanismUid);
+}
+
+- (void)testRecentMessageIdIsSeenWithItsMechanism {
+    // Given
+    [filter addMessageId:@"123" mechanismUid:@"0"];
+    NSString *mechanismUid;
+    
+    // When
+    FRASeenMessageState state = [filter stateOfMessageId:@"123" mechanismUid:&mechanismUid];
+    
+    // Then
+    XCTAssertEqual(state, FRAMessageRecentlySeen);
+    XCTAssertEqualObjects(mechanismUid, @"0");
+}
+
+- (void)testMessageIdEvictedFromRecentIdsIsProbablySeen {
+    // Given
+    [filter addMessageId:@"first" mechanismUid:@"0"];
+    for (int i = 0; i < 10; i++) {
+        [filter addMessageId:[NSString stringWithFormat:@"message-%d", i] mechanismUid:@"0"];
+    }
+    
+    // When
+    FRASeenMessageState state = [filter stateOfMessageId:@"first" mechanismUid:nil];
+    
+    // Then
+    XCTAssertEqual(state, FRAMessageProbablySeen);
+}
+
+- (void)testLookupKeepsMessageIdRecent {
+    // Given
+    [filter addMessageId:@"first" mechanismUid:@"0"];
+    for (int i = 0; i < 9; i++) {
+        [filter addMessageId:[NSString stringWithFormat:@"message-%d", i] mechanismUid:@"0"];
+    }
+    [filter stateOfMessageId:@"first" mechanismUid:nil];
+    
+    // When
+    [filter addMessageId:@"last" mechanismUid:@"0"];
+    
+    // Then
+    XCTAssertEqual([filter stateOfMessageId:@"first" mechanismUid:nil], FRAMessageRecentlySeen);
+    XCTAssertEqual([filter stateOfMessageId:@"message-0" mechanismUid:nil], FRAMessageProbablySeen);
+}
+
+- (void)testMessageIdIsForgottenAfterTwoRotations {
+    // Given
+    [filter addMessageId:@"first" mechanismUid:@"0"];
+    
+    // When
+    for (int i = 0; i < 200; i++) {
+        [filter addMessageId:[NSString stringWithFormat:@"message-%d", i] mechanismUid:@"0"];
+    }
+    
+    // Then
+    XCTAssertEqual([filter stateOfMessageId:@"first" mechanismUid:nil], FRAMessageNotSeen);
+    XCTAssertEqual([filter stateOfMessageId:@"message-120" mechanismUid:nil], FRAMessageProbablySeen, @"The previous generation should still be consulted");
+}
+
+- (void)testFalsePositiveRateIsLow {
+    // Given
+    for (int i = 0; i < 200; i++) {
+        [filter addMessageId:[NSString stringWithFormat:@"message-%d", i] mechanismUid:@"0"];
+    }
+    
+    // When
+    NSUInteger falsePositives = 0;
+    for (int i = 0; i < 100000; i++) {
+        if ([filter stateOfMessageId:[[NSUUID UUID] UUIDString] mechanismUid:nil] != FRAMessageNotSeen) {
+            falsePositives++;
+        }
+    }
+    
+    // Then
+    XCTAssertLessThan(falsePositives, 5);
+}
+
+- (void)testFilterIsPersisted {
+    // Given
+    [filter addMessageId:@"old" mechanismUid:@"0"];
+    for (int i = 0; i < 10; i++) {
+        [filter addMessageId:[NSString stringWithFormat:@"message-%d", i] mechanismUid:@"1"];
+    }
+    [filter flush];
+    
+    // When
+    FRASeenMessageFilter *reloaded = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:100 recentCapacity:10];
+    NSString *mechanismUid;
+    FRASeenMessageState recentState = [reloaded stateOfMessageId:@"message-9" mechanismUid:&mechanismUid];
+    
+    // Then
+    XCTAssertEqual(recentState, FRAMessageRecentlySeen);
+    XCTAssertEqualObjects(mechanismUid, @"1");
+    XCTAssertEqual([reloaded stateOfMessageId:@"old" mechanismUid:nil], FRAMessageProbablySeen);
+    XCTAssertEqual([reloaded stateOfMessageId:@"new" mechanismUid:nil], FRAMessageNotSeen);
+}
+
+- (void)testFilterWithOtherCapacityIgnoresFile {
+    // Given
+    [filter addMessageId:@"123" mechanismUid:@"0"];
+    [filter flush];
+    
+    // When
+    FRASeenMessageFilter *resized = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:1000 recentCapacity:10];
+    
+    // Then
+    XCTAssertEqual([resized stateOfMessageId:@"123" mechanismUid:nil], FRAMessageNotSeen);
+}
+
+- (void)testCorruptFileIsDiscarded {
+    // Given
+    [@"not a filter" writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+    
+    // When
+    FRASeenMessageFilter *corrupt = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:100 recentCapacity:10];
+    
+    // Then
+    XCTAssertEqual([corrupt stateOfMessageId:@"123" mechanismUid:nil], FRAMessageNotSeen);
+}
+
+- (void)testPerformanceOfRedeliveryBurst {
+    FRASeenMessageFilter *defaultFilter = [[FRASeenMessageFilter alloc] initWithPath:path generationCapacity:4096 recentCapacity:256];
+    for (int i = 0; i < 256; i++) {
+        [defaultFilter addMessageId:[NSString stringWithFormat:@"9326d19c-4d08-4538-8151-%012d", i] mechanismUid:@"0"];
+    }
+    [self measureBlock:^{
+        for (int i = 0; i < 10000; i++) {
+            [defaultFilter stateOfMessageId:[NSString stringWithFormat:@"9326d19c-4d08-4538-8151-%012d", i % 256] mechanismUid:nil];
+        }
+    }];
+    [defaultFilter flush];
+}
+
+@end
@@ -88,6 +88,58 @@
     XCTAssertNil(result, @"Did not return nil for null input");
 }
 
+- (void)testEveryByteValueSurvivesHexRoundTrip {
+    // Given
+    uint8_t allBytes[256];
+    for (NSUInteger i = 0; i < sizeof(allBytes); i++) {
+        allBytes[i] = (uint8_t)i;
+    }
+    NSData *secret = [NSData dataWithBytes:allBytes length:sizeof(allBytes)];
+    
+    // When
+    NSString *hex = [FRASerialization serializeSecret:secret];
+    
+    // Then
+    XCTAssertEqual(hex.length, 512);
+    XCTAssertTrue([hex hasPrefix:@"000102"]);
+    XCTAssertTrue([hex hasSuffix:@"fdfeff"]);
+    XCTAssertEqualObjects([FRASerialization deserializeSecret:hex], secret);
+}
+
+- (void)testUpperCaseHexIsDeserialised {
+    // Given
+    NSString *hex = @"DEADbeef";
+    
+    // When
+    NSData *result = [FRASerialization deserializeSecret:hex];
+    
+    // Then
+    uint8_t expected[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    XCTAssertEqualObjects(result, [NSData dataWithBytes:expected length:sizeof(expected)]);
+}
+
+- (void)testEmptySecretIsSerialisedAsEmptyString {
+    // Given
+    NSData *emptySecret = [NSData data];
+    
+    // When
+    NSString *hex = [FRASerialization serializeSecret:emptySecret];
+    
+    // Then
+    XCTAssertEqualObjects(hex, @"");
+    XCTAssertEqualObjects([FRASerialization deserializeSecret:hex], emptySecret);
+}
+
+- (void)testHexOfOddLengthIsRejected {
+    XCTAssertNil([FRASerialization deserializeSecret:@"abc"]);
+}
+
+- (void)testHexWithInvalidCharactersIsRejected {
+    XCTAssertNil([FRASerialization deserializeSecret:@"0g"]);
+    XCTAssertNil([FRASerialization deserializeSecret:@"12 4"]);
+    XCTAssertNil([FRASerialization deserializeSecret:@"\u00e91"]);
+}
+
 #pragma mark --
 #pragma mark Dictionary Serialisation/Deserialisation
 
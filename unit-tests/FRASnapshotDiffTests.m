@@ -0,0 +1,106 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "FRASnapshotDiff.h"
+
+@interface FRASnapshotDiffTests : XCTestCase
+
+@end
+
+@implementation FRASnapshotDiffTests
+
+- (void)testIdenticalSnapshotsHaveNoEdits {
+    // Given
+    NSArray *snapshot = @[@"a", @"b", @"c"];
+    
+    // When
+    FRASnapshotDiff *diff = [FRASnapshotDiff diffFromSnapshot:snapshot toSnapshot:[snapshot copy] updatedObjects:nil];
+    
+    // Then
+    XCTAssertTrue([diff isEmpty]);
+}
+
+- (void)testAppendedObjectIsSingleInsertion {
+    // Given
+    NSArray *oldSnapshot = @[@"a", @"b"];
+    NSArray *newSnapshot = @[@"a", @"b", @"c"];
+    
+    // When
+    FRASnapshotDiff *diff = [FRASnapshotDiff diffFromSnapshot:oldSnapshot toSnapshot:newSnapshot updatedObjects:nil];
+    
+    // Then
+    XCTAssertEqualObjects(diff.insertedIndexes, [NSIndexSet indexSetWithIndex:2]);
+    XCTAssertEqual(diff.deletedIndexes.count, 0);
+}
+
+- (void)testEmptySnapshotsProduceOnlyInsertionsOrDeletions {
+    // Given
+    NSArray *snapshot = @[@"a", @"b", @"c"];
+    
+    // When
+    FRASnapshotDiff *insertAll = [FRASnapshotDiff diffFromSnapshot:@[] toSnapshot:snapshot updatedObjects:nil];
+    FRASnapshotDiff *deleteAll = [FRASnapshotDiff diffFromSnapshot:snapshot toSnapshot:@[] updatedObjects:nil];
+    
+    // Then
+    XCTAssertEqualObjects(insertAll.insertedIndexes, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 3)]);
+    XCTAssertEqual(insertAll.deletedIndexes.count, 0);
+    XCTAssertEqualObjects(deleteAll.deletedIndexes, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 3)]);
+    XCTAssertEqual(deleteAll.insertedIndexes.count, 0);
+}
+
+- (void)testCalculatesMinimalEditsForInterleavedChanges {
+    // Given
+    NSArray *oldSnapshot = @[@"a", @"b", @"c", @"a", @"b", @"b", @"a"];
+    NSArray *newSnapshot = @[@"c", @"b", @"a", @"b", @"a", @"c"];
+    
+    // When
+    FRASnapshotDiff *diff = [FRASnapshotDiff diffFromSnapshot:oldSnapshot toSnapshot:newSnapshot updatedObjects:nil];
+    
+    // Then
+    // Longest common subsequence has length 4, so 3 deletions and 2 insertions are the minimum
+    XCTAssertEqual(diff.deletedIndexes.count, 3);
+    XCTAssertEqual(diff.insertedIndexes.count, 2);
+    XCTAssertEqualObjects([self applyDiff:diff from:oldSnapshot to:newSnapshot], newSnapshot);
+}
+
+- (void)testReportsUpdatedObjectsAtTheirOldIndexes {
+    // Given
+    NSArray *oldSnapshot = @[@"a", @"b", @"c"];
+    NSArray *newSnapshot = @[@"b", @"c"];
+    
+    // When
+    FRASnapshotDiff *diff = [FRASnapshotDiff diffFromSnapshot:oldSnapshot toSnapshot:newSnapshot updatedObjects:[NSSet setWithObjects:@"a", @"c", nil]];
+    
+    // Then
+    XCTAssertEqualObjects(diff.deletedIndexes, [NSIndexSet indexSetWithIndex:0]);
+    XCTAssertEqualObjects(diff.updatedIndexes, [NSIndexSet indexSetWithIndex:2]);
+}
+
+/*!
+ * Applies the edits in the same way as a table view: deletions against the old snapshot, then insertions against
+ * the new one.
+ */
+- (NSArray *)applyDiff:(FRASnapshotDiff *)diff from:(NSArray *)oldSnapshot to:(NSArray *)newSnapshot {
+    NSMutableArray *result = [oldSnapshot mutableCopy];
+    [result removeObjectsAtIndexes:diff.deletedIndexes];
+    [result insertObjects:[newSnapshot objectsAtIndexes:diff.insertedIndexes] atIndexes:diff.insertedIndexes];
+    return result;
+}
+
+@end
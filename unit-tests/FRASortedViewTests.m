@@ -0,0 +1,94 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "FRASortedView.h"
+
+@interface FRASortedViewTests : XCTestCase
+
+@end
+
+@implementation FRASortedViewTests {
+    FRASortedView<NSString *> *view;
+}
+
+- (void)setUp {
+    [super setUp];
+    view = [[FRASortedView alloc] initWithComparator:^NSComparisonResult(NSString *first, NSString *second) {
+        return [first caseInsensitiveCompare:second];
+    }];
+}
+
+- (void)testAddedObjectsAreKeptInOrder {
+    // When
+    NSUInteger first = [view addObject:@"b"];
+    NSUInteger second = [view addObject:@"c"];
+    NSUInteger third = [view addObject:@"a"];
+    
+    // Then
+    XCTAssertEqual(first, 0);
+    XCTAssertEqual(second, 1);
+    XCTAssertEqual(third, 0);
+    NSArray *expected = @[@"a", @"b", @"c"];
+    XCTAssertEqualObjects([view allObjects], expected);
+    XCTAssertEqualObjects([view objectAtIndex:2], @"c");
+}
+
+- (void)testEqualKeysKeepInsertionOrderAndAreMatchedByIdentity {
+    // Given
+    NSString *upper = [NSMutableString stringWithString:@"A"];
+    NSString *lower = [NSMutableString stringWithString:@"a"];
+    [view addObject:@"b"];
+    [view addObject:upper];
+    [view addObject:lower];
+    
+    // When
+    NSUInteger removedIndex = [view removeObject:lower];
+    
+    // Then
+    XCTAssertEqual(removedIndex, 1);
+    XCTAssertEqual([view objectAtIndex:0], upper);
+    XCTAssertEqual([view indexOfObject:lower], NSNotFound);
+    XCTAssertEqual(view.count, 2);
+}
+
+- (void)testRemovingMissingObjectHasNoEffect {
+    // Given
+    [view addObject:@"a"];
+    NSUInteger revision = view.revision;
+    
+    // When
+    NSUInteger removedIndex = [view removeObject:@"z"];
+    
+    // Then
+    XCTAssertEqual(removedIndex, NSNotFound);
+    XCTAssertEqual(view.revision, revision);
+    XCTAssertEqual(view.count, 1);
+}
+
+- (void)testSetObjectsSortsContents {
+    // When
+    [view setObjects:@[@"c", @"a", @"b"]];
+    
+    // Then
+    NSArray *expected = @[@"a", @"b", @"c"];
+    XCTAssertEqualObjects([view allObjects], expected);
+    XCTAssertEqual([view indexOfObject:@"b"], 1);
+}
+
+@end
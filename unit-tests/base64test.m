@@ -0,0 +1,170 @@
+/*
+ * The contents of this file are subject to the terms of the Common Development and
+ * Distribution License (the License). You may not use this file except in compliance with the
+ * License.
+ *
+ * You can obtain a copy of the License at legal/CDDLv1.0.txt. See the License for the
+ * specific language governing permission and limitations under the License.
+ *
+ * When distributing Covered Software, include this CDDL Header Notice in each file and include
+ * the License file at legal/CDDLv1.0.txt. If applicable, add the following below the CDDL
+ * Header, with the fields enclosed by brackets [] replaced by your own identifying
+ * information: "Portions copyright [year] [name of copyright owner]".
+ *
+ * Copyright 2016 ForgeRock AS.
+ */
+
+#import <XCTest/XCTest.h>
+#import "base64.h"
+
+@interface base64test : XCTestCase
+
+@end
+
+@implementation base64test
+
+- (void)testShouldDecodeStringIncludingPadding {
+    // Given
+    uint8_t key[64];
+    const char *tmp = "QmFkZ2VyIQ==";
+    
+    // When
+    int res = base64_decode(tmp, (int)strlen(tmp), key, sizeof(key), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqualObjects([[NSString alloc] initWithBytes:key length:res encoding:NSUTF8StringEncoding], @"Badger!");
+}
+
+- (void)testShouldDecodeStringWithoutPadding {
+    // Given
+    uint8_t key[64];
+    const char *tmp = "QmFkZ2VyIQ";
+    
+    // When
+    int res = base64_decode(tmp, (int)strlen(tmp), key, sizeof(key), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqualObjects([[NSString alloc] initWithBytes:key length:res encoding:NSUTF8StringEncoding], @"Badger!");
+}
+
+- (void)testShouldDecodeUrlAlphabetOnlyWhenAsked {
+    // Given
+    uint8_t key[64];
+    const char *tmp = "-_-_";
+    
+    // When
+    int standard = base64_decode(tmp, (int)strlen(tmp), key, sizeof(key), BASE64_STANDARD);
+    int url = base64_decode(tmp, (int)strlen(tmp), key, sizeof(key), BASE64_URL);
+    
+    // Then
+    XCTAssertEqual(standard, -1);
+    XCTAssertEqual(url, 3);
+    XCTAssertEqual(key[0], 0xFB);
+    XCTAssertEqual(key[1], 0xFF);
+    XCTAssertEqual(key[2], 0xBF);
+}
+
+- (void)testShouldRejectStandardAlphabetInUrlAlphabet {
+    // Given
+    uint8_t key[64];
+    const char *tail = "+/+/";
+    const char *block = "++++////++++////AAAA";
+    
+    // When
+    int urlTail = base64_decode(tail, (int)strlen(tail), key, sizeof(key), BASE64_URL);
+    int urlBlock = base64_decode(block, (int)strlen(block), key, sizeof(key), BASE64_URL);
+    int eitherTail = base64_decode(tail, (int)strlen(tail), key, sizeof(key), BASE64_URL_OR_STANDARD);
+    int eitherBlock = base64_decode(block, (int)strlen(block), key, sizeof(key), BASE64_URL_OR_STANDARD);
+    
+    // Then
+    XCTAssertEqual(urlTail, -1);
+    XCTAssertEqual(urlBlock, -1);
+    XCTAssertEqual(eitherTail, 3);
+    XCTAssertEqual(eitherBlock, 15);
+}
+
+- (void)testShouldRejectInvalidCharacterInVectorBlock {
+    // Given
+    uint8_t key[64];
+    const char *tmp = "QmFkZ2VyIUJhZGdl cg==";
+    
+    // When
+    int res = base64_decode(tmp, (int)strlen(tmp), key, sizeof(key), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqual(res, -1);
+}
+
+- (void)testShouldRejectTruncatedQuantumAndExcessPadding {
+    // Given
+    uint8_t key[64];
+    
+    // When
+    int truncated = base64_decode("QUJDR", 5, key, sizeof(key), BASE64_STANDARD);
+    int excessPadding = base64_decode("QUJD=", 5, key, sizeof(key), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqual(truncated, -1);
+    XCTAssertEqual(excessPadding, -1);
+}
+
+- (void)testShouldRejectBufferTooSmall {
+    // Given
+    uint8_t key[2];
+    
+    // When
+    int res = base64_decode("QUJD", 4, key, sizeof(key), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqual(res, -1);
+}
+
+- (void)testShouldRoundTripEveryLengthThroughBothAlphabets {
+    for (int alphabet = BASE64_STANDARD; alphabet <= BASE64_URL; alphabet++) {
+        for (int length = 0; length < 100; length++) {
+            // Given
+            uint8_t data[100];
+            for (int i = 0; i < length; i++) {
+                data[i] = (uint8_t)(i * 37 + length);
+            }
+            char encoded[200];
+            uint8_t decoded[100];
+            
+            // When
+            int encodedLength = base64_encode(data, length, encoded, sizeof(encoded), alphabet);
+            int decodedLength = base64_decode(encoded, encodedLength, decoded, sizeof(decoded), alphabet);
+            
+            // Then
+            XCTAssertEqual(encodedLength, base64_encoded_size(length, alphabet));
+            XCTAssertEqual(decodedLength, length);
+            XCTAssertEqual(memcmp(decoded, data, length), 0);
+        }
+    }
+}
+
+- (void)testShouldEncodeMatchingFoundation {
+    // Given
+    NSData *data = [@"Badger!Bad" dataUsingEncoding:NSUTF8StringEncoding];
+    char encoded[64];
+    
+    // When
+    int res = base64_encode(data.bytes, (int)data.length, encoded, sizeof(encoded), BASE64_STANDARD);
+    
+    // Then
+    XCTAssertEqualObjects([[NSString alloc] initWithBytes:encoded length:res encoding:NSASCIIStringEncoding], [data base64EncodedStringWithOptions:0]);
+}
+
+- (void)testPerformanceOfDecoding {
+    NSMutableData *data = [NSMutableData dataWithLength:4096];
+    arc4random_buf(data.mutableBytes, data.length);
+    const char *encoded = [[data base64EncodedStringWithOptions:0] UTF8String];
+    int length = (int)strlen(encoded);
+    uint8_t decoded[4096];
+    [self measureBlock:^{
+        for (int i = 0; i < 1000; i++) {
+            base64_decode(encoded, length, decoded, sizeof(decoded), BASE64_STANDARD);
+        }
+    }];
+}
+
+@end